@@ -325,10 +325,13 @@ void Rover::one_second_loop(void)
         if (scheduler.debug() != 0) {
             hal.console->printf("G_Dt_max=%lu\n", (unsigned long)G_Dt_max);
         }
-        if (should_log(MASK_LOG_PM))
+        if (should_log(MASK_LOG_PM)) {
             Log_Write_Performance();
+            DataFlash.Log_Write_Scheduler_Stats(scheduler);
+        }
         G_Dt_max = 0;
         resetPerfData();
+        scheduler.reset_task_stats();
     }
 
     // save compass offsets once a minute
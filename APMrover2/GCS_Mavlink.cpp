@@ -438,6 +438,16 @@ bool GCS_MAVLINK_Rover::try_send_message(enum ap_message id)
         send_vibration(rover.ins);
         break;
 
+    case MSG_SCHED_STATS:
+        CHECK_PAYLOAD_SIZE(DEBUG_VECT);
+        send_scheduler_stats(rover.scheduler);
+        break;
+
+    case MSG_FFT_PEAKS:
+        CHECK_PAYLOAD_SIZE(DEBUG_VECT);
+        send_fft_peaks(rover.ins);
+        break;
+
     case MSG_BATTERY2:
         CHECK_PAYLOAD_SIZE(BATTERY2);
         send_battery2(rover.battery);
@@ -696,6 +706,8 @@ GCS_MAVLINK_Rover::data_stream_send(void)
         send_message(MSG_MOUNT_STATUS);
         send_message(MSG_EKF_STATUS_REPORT);
         send_message(MSG_VIBRATION);
+        send_message(MSG_SCHED_STATS);
+        send_message(MSG_FFT_PEAKS);
     }
 }
 
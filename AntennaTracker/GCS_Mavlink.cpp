@@ -267,6 +267,8 @@ bool GCS_MAVLINK_Tracker::try_send_message(enum ap_message id)
     case MSG_EKF_STATUS_REPORT:
     case MSG_PID_TUNING:
     case MSG_VIBRATION:
+    case MSG_SCHED_STATS:
+    case MSG_FFT_PEAKS:
     case MSG_RPM:
     case MSG_MISSION_ITEM_REACHED:
     case MSG_POSITION_TARGET_GLOBAL_INT:
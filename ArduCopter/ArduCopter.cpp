@@ -195,8 +195,10 @@ void Copter::barometer_accumulate(void)
 
 void Copter::perf_update(void)
 {
-    if (should_log(MASK_LOG_PM))
+    if (should_log(MASK_LOG_PM)) {
         Log_Write_Performance();
+        DataFlash.Log_Write_Scheduler_Stats(scheduler);
+    }
     if (scheduler.debug()) {
         gcs_send_text_fmt(MAV_SEVERITY_WARNING, "PERF: %u/%u %lu %lu\n",
                           (unsigned)perf_info_get_num_long_running(),
@@ -205,6 +207,7 @@ void Copter::perf_update(void)
                           (unsigned long)perf_info_get_min_time());
     }
     perf_info_reset();
+    scheduler.reset_task_stats();
     pmTest1 = 0;
 }
 
@@ -268,6 +271,9 @@ void Copter::fast_loop()
     // send outputs to the motors library
     motors_output();
 
+    // let a throttle following gyro notch track the motor noise
+    ins.set_notch_throttle(motors.get_throttle());
+
     // Inertial Nav
     // --------------------
     read_inertia();
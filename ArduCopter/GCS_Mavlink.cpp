@@ -559,6 +559,16 @@ bool GCS_MAVLINK_Copter::try_send_message(enum ap_message id)
         send_vibration(copter.ins);
         break;
 
+    case MSG_SCHED_STATS:
+        CHECK_PAYLOAD_SIZE(DEBUG_VECT);
+        send_scheduler_stats(copter.scheduler);
+        break;
+
+    case MSG_FFT_PEAKS:
+        CHECK_PAYLOAD_SIZE(DEBUG_VECT);
+        send_fft_peaks(copter.ins);
+        break;
+
     case MSG_MISSION_ITEM_REACHED:
         CHECK_PAYLOAD_SIZE(MISSION_ITEM_REACHED);
         mavlink_msg_mission_item_reached_send(chan, mission_item_reached_index);
@@ -779,6 +789,8 @@ GCS_MAVLINK_Copter::data_stream_send(void)
         send_message(MSG_MAG_CAL_PROGRESS);
         send_message(MSG_EKF_STATUS_REPORT);
         send_message(MSG_VIBRATION);
+        send_message(MSG_SCHED_STATS);
+        send_message(MSG_FFT_PEAKS);
         send_message(MSG_RPM);
     }
 
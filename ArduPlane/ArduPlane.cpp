@@ -378,9 +378,11 @@ void Plane::log_perf_info()
 
     if (should_log(MASK_LOG_PM)) {
         Log_Write_Performance();
+        DataFlash.Log_Write_Scheduler_Stats(scheduler);
     }
 
     resetPerfData();
+    scheduler.reset_task_stats();
 }
 
 void Plane::compass_save()
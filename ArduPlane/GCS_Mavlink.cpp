@@ -639,6 +639,16 @@ bool GCS_MAVLINK_Plane::try_send_message(enum ap_message id)
         send_vibration(plane.ins);
         break;
 
+    case MSG_SCHED_STATS:
+        CHECK_PAYLOAD_SIZE(DEBUG_VECT);
+        send_scheduler_stats(plane.scheduler);
+        break;
+
+    case MSG_FFT_PEAKS:
+        CHECK_PAYLOAD_SIZE(DEBUG_VECT);
+        send_fft_peaks(plane.ins);
+        break;
+
     case MSG_RPM:
         CHECK_PAYLOAD_SIZE(RPM);
         plane.send_rpm(chan);
@@ -877,6 +887,8 @@ GCS_MAVLINK_Plane::data_stream_send(void)
         send_message(MSG_EKF_STATUS_REPORT);
         send_message(MSG_GIMBAL_REPORT);
         send_message(MSG_VIBRATION);
+        send_message(MSG_SCHED_STATS);
+        send_message(MSG_FFT_PEAKS);
     }
 
     if (plane.gcs_out_of_time) return;
@@ -11,6 +11,9 @@ parser.add_option("--create-checked-logs", action='store_true', default=False, h
 parser.add_option("--tolerance-euler", type=float, default=3, help="tolerance for euler angles in degrees");
 parser.add_option("--tolerance-pos", type=float, default=2, help="tolerance for position angles in meters");
 parser.add_option("--tolerance-vel", type=float, default=2, help="tolerance for velocity in meters/second");
+parser.add_option("--start-time", type=float, default=0, help="log time in seconds to start replaying from");
+parser.add_option("--end-time", type=float, default=0, help="log time in seconds to stop replaying at");
+parser.add_option("--jobs", type=int, default=1, help="number of logs to replay concurrently");
 
 opts, args = parser.parse_args()
 
@@ -27,13 +30,18 @@ def run_cmd(cmd, dir=".", show=False, output=False, checkfail=True):
         return call(cmd, shell=True, cwd=dir)
 
 def run_replay(logfile):
-    '''run Replay on one logfile'''
+    '''run Replay on one logfile, or a space separated list of logfiles in batch mode'''
     print("Processing %s" % logfile)
-    cmd = "./Replay.elf -- --check %s --tolerance-euler=%f --tolerance-pos=%f --tolerance-vel=%f " % (
-        logfile,
+    cmd = "./Replay.elf -- --check --tolerance-euler=%f --tolerance-pos=%f --tolerance-vel=%f " % (
         opts.tolerance_euler,
         opts.tolerance_pos,
         opts.tolerance_vel)
+    if opts.start_time > 0:
+        cmd += "--start-time=%f " % opts.start_time
+    if opts.end_time > 0:
+        cmd += "--end-time=%f " % opts.end_time
+    # logs must come last as Replay stops parsing options at the first log
+    cmd += logfile
     run_cmd(cmd, checkfail=False)
 
 def get_log_list():
@@ -150,8 +158,12 @@ def check_logs():
         print(ex)
         pass
 
-    for logfile in log_list:
-        run_replay(logfile)
+    if opts.jobs > 1:
+        # Replay runs each log in its own process and merges the results
+        run_replay("--batch-jobs=%u %s" % (opts.jobs, " ".join(log_list)))
+    else:
+        for logfile in log_list:
+            run_replay(logfile)
 
     create_html_results()
 
@@ -1,26 +1,225 @@
 #include "DataFlashFileReader.h"
 
+#include <DataFlash/DataFlash_Compress.h>
+
 #include <fcntl.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
 
+DataFlashFileReader::~DataFlashFileReader()
+{
+    for (uint16_t i=0; i<ARRAY_SIZE(index); i++) {
+        free(index[i].offsets);
+    }
+    if (decompressed != nullptr) {
+        free(decompressed);
+    } else if (mapped != nullptr) {
+        munmap((void *)mapped, mapped_len);
+    }
+}
+
+/*
+  map the whole log into memory. This avoids a read() syscall per
+  message and allows random access for indexing and seeking
+ */
 bool DataFlashFileReader::open_log(const char *logfile)
 {
-    fd = ::open(logfile, O_RDONLY|O_CLOEXEC);
+    int fd = ::open(logfile, O_RDONLY|O_CLOEXEC);
     if (fd == -1) {
         return false;
     }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    mapped_len = st.st_size;
+    read_ofs = 0;
+    if (mapped_len == 0) {
+        ::close(fd);
+        return true;
+    }
+    void *p = mmap(nullptr, mapped_len, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        mapped_len = 0;
+        return false;
+    }
+    madvise(p, mapped_len, MADV_SEQUENTIAL);
+
+    if (mapped_len >= sizeof(struct log_compressed_file_header) &&
+        memcmp(p, DATAFLASH_COMPRESS_MAGIC, strlen(DATAFLASH_COMPRESS_MAGIC)) == 0) {
+        const bool ret = decompress_log((const uint8_t *)p, mapped_len);
+        munmap(p, st.st_size);
+        return ret;
+    }
+
+    mapped = (const uint8_t *)p;
+    return true;
+}
+
+/*
+  expand a block compressed log into memory, after which it is read
+  exactly like a plain log. Decoding stops at the first damaged or
+  truncated block, keeping everything before it
+ */
+bool DataFlashFileReader::decompress_log(const uint8_t *src, size_t len)
+{
+    struct log_compressed_file_header fh;
+    memcpy(&fh, src, sizeof(fh));
+    if (fh.version != DATAFLASH_COMPRESS_VERSION) {
+        ::printf("Unsupported compressed log version %u\n", (unsigned)fh.version);
+        return false;
+    }
+
+    // first pass to size the output
+    size_t total = 0;
+    size_t ofs = sizeof(fh);
+    struct log_compressed_block_header bh;
+    while (ofs + sizeof(bh) <= len) {
+        memcpy(&bh, &src[ofs], sizeof(bh));
+        const uint32_t payload = bh.comp_len ? bh.comp_len : bh.raw_len;
+        if (bh.sync1 != DATAFLASH_COMPRESS_SYNC1 || bh.sync2 != DATAFLASH_COMPRESS_SYNC2 ||
+            ofs + sizeof(bh) + payload > len) {
+            break;
+        }
+        total += bh.raw_len;
+        ofs += sizeof(bh) + payload;
+    }
+
+    decompressed = (uint8_t *)malloc(total > 0 ? total : 1);
+    if (decompressed == nullptr) {
+        ::printf("Out of memory decompressing log\n");
+        return false;
+    }
+
+    size_t out = 0;
+    ofs = sizeof(fh);
+    while (out < total) {
+        memcpy(&bh, &src[ofs], sizeof(bh));
+        const uint8_t *payload = &src[ofs + sizeof(bh)];
+        if (bh.comp_len == 0) {
+            memcpy(&decompressed[out], payload, bh.raw_len);
+            ofs += sizeof(bh) + bh.raw_len;
+        } else {
+            const int32_t n = DataFlash_Compressor::decompress(payload, bh.comp_len,
+                                                               &decompressed[out], bh.raw_len);
+            if (n != bh.raw_len) {
+                ::printf("Corrupt compressed block at offset %lu\n", (unsigned long)ofs);
+                break;
+            }
+            ofs += sizeof(bh) + bh.comp_len;
+        }
+        out += bh.raw_len;
+    }
+
+    ::printf("Decompressed log %lu -> %lu bytes\n", (unsigned long)len, (unsigned long)out);
+    mapped = decompressed;
+    mapped_len = out;
+    return true;
+}
+
+/*
+  return the size in bytes of a log field type character
+ */
+static uint8_t field_type_size(char type)
+{
+    switch (type) {
+    case 'b':
+    case 'B':
+    case 'M':
+        return 1;
+    case 'c':
+    case 'C':
+    case 'h':
+    case 'H':
+        return 2;
+    case 'e':
+    case 'E':
+    case 'f':
+    case 'i':
+    case 'I':
+    case 'L':
+    case 'n':
+        return 4;
+    case 'd':
+    case 'q':
+    case 'Q':
+        return 8;
+    case 'N':
+        return 16;
+    case 'Z':
+    case 'a':
+        return 64;
+    }
+    return 0;
+}
+
+/*
+  store a format and resolve the offset of its timestamp field once,
+  so per-message time lookups need no string compares
+ */
+void DataFlashFileReader::set_format(const struct log_Format &f)
+{
+    memcpy(&formats[f.type], &f, sizeof(formats[f.type]));
+
+    struct time_field &tf = time_fields[f.type];
+    tf.offset = 0;
+    tf.is_ms = false;
+
+    char labels[sizeof(f.labels)+1] {};
+    memcpy(labels, f.labels, sizeof(f.labels));
+    char *saveptr = nullptr;
+    uint16_t ofs = 3; // 3 bytes for the header
+    uint8_t i = 0;
+    for (char *label = strtok_r(labels, ",", &saveptr);
+         label != nullptr && i < sizeof(f.format) && f.format[i] != 0;
+         label = strtok_r(nullptr, ",", &saveptr), i++) {
+        const char type = f.format[i];
+        if (type == 'Q' && strcmp(label, "TimeUS") == 0) {
+            tf.offset = ofs;
+            return;
+        }
+        if (type == 'I' && strcmp(label, "TimeMS") == 0) {
+            tf.offset = ofs;
+            tf.is_ms = true;
+            return;
+        }
+        const uint8_t size = field_type_size(type);
+        if (size == 0 || ofs + size > 255) {
+            return;
+        }
+        ofs += size;
+    }
+}
+
+bool DataFlashFileReader::message_time_us(const uint8_t *msg, uint64_t &time_us) const
+{
+    const struct time_field &tf = time_fields[msg[2]];
+    if (tf.offset == 0) {
+        return false;
+    }
+    if (tf.is_ms) {
+        uint32_t time_ms;
+        memcpy(&time_ms, &msg[tf.offset], sizeof(time_ms));
+        time_us = time_ms * 1000ULL;
+    } else {
+        memcpy(&time_us, &msg[tf.offset], sizeof(time_us));
+    }
     return true;
 }
 
 bool DataFlashFileReader::update(char type[5])
 {
-    uint8_t hdr[3];
-    if (::read(fd, hdr, 3) != 3) {
+    if (read_ofs + 3 > mapped_len) {
         return false;
     }
+    const uint8_t *hdr = &mapped[read_ofs];
     if (hdr[0] != HEAD_BYTE1 || hdr[1] != HEAD_BYTE2) {
         printf("bad log header\n");
         return false;
@@ -28,11 +227,12 @@ bool DataFlashFileReader::update(char type[5])
 
     if (hdr[2] == LOG_FORMAT_MSG) {
         struct log_Format f;
-        memcpy(&f, hdr, 3);
-        if (::read(fd, &f.type, sizeof(f)-3) != sizeof(f)-3) {
+        if (read_ofs + sizeof(f) > mapped_len) {
             return false;
         }
-        memcpy(&formats[f.type], &f, sizeof(formats[f.type]));
+        memcpy(&f, hdr, sizeof(f));
+        read_ofs += sizeof(f);
+        set_format(f);
         strncpy(type, "FMT", 3);
         type[3] = 0;
 
@@ -52,15 +252,198 @@ bool DataFlashFileReader::update(char type[5])
         exit(1);
     }
 
-    uint8_t msg[f.length];
+    if (read_ofs + f.length > mapped_len) {
+        return false;
+    }
 
-    memcpy(msg, hdr, 3);
-    if (::read(fd, &msg[3], f.length-3) != f.length-3) {
+    uint64_t time_us;
+    if (end_time_us != 0 && message_time_us(hdr, time_us) && time_us > end_time_us) {
         return false;
     }
 
+    // handlers may modify the message, so give them a copy rather
+    // than the read-only mapping
+    uint8_t msg[f.length];
+    memcpy(msg, hdr, f.length);
+    read_ofs += f.length;
+
     strncpy(type, f.name, 4);
     type[4] = 0;
 
     return handle_msg(f,msg);
 }
+
+bool DataFlashFileReader::index_add(uint8_t type, uint64_t offset)
+{
+    struct type_index &idx = index[type];
+    if (idx.count == idx.alloc) {
+        const uint32_t new_alloc = idx.alloc ? idx.alloc * 2 : 1024;
+        uint64_t *new_offsets = (uint64_t *)realloc(idx.offsets, new_alloc * sizeof(uint64_t));
+        if (new_offsets == nullptr) {
+            return false;
+        }
+        idx.offsets = new_offsets;
+        idx.alloc = new_alloc;
+    }
+    idx.offsets[idx.count++] = offset;
+    return true;
+}
+
+/*
+  single pass over the mapped log recording the offset of each
+  message, keyed by message type
+ */
+bool DataFlashFileReader::build_index(void)
+{
+    if (indexed) {
+        return true;
+    }
+    size_t ofs = 0;
+    while (ofs + 3 <= mapped_len) {
+        const uint8_t *hdr = &mapped[ofs];
+        if (hdr[0] != HEAD_BYTE1 || hdr[1] != HEAD_BYTE2) {
+            ::printf("bad log header at offset %lu\n", (unsigned long)ofs);
+            break;
+        }
+        uint16_t length;
+        if (hdr[2] == LOG_FORMAT_MSG) {
+            struct log_Format f;
+            if (ofs + sizeof(f) > mapped_len) {
+                break;
+            }
+            memcpy(&f, hdr, sizeof(f));
+            set_format(f);
+            length = sizeof(f);
+        } else {
+            length = formats[hdr[2]].length;
+            if (length == 0) {
+                ::printf("No format defined for type (%d)\n", hdr[2]);
+                break;
+            }
+            if (ofs + length > mapped_len) {
+                break;
+            }
+        }
+        if (!index_add(hdr[2], ofs)) {
+            ::printf("Out of memory indexing log\n");
+            return false;
+        }
+        ofs += length;
+    }
+    indexed = true;
+    return true;
+}
+
+const uint8_t *DataFlashFileReader::message_at(uint8_t type, uint32_t n) const
+{
+    if (n >= index[type].count) {
+        return nullptr;
+    }
+    return &mapped[index[type].offsets[n]];
+}
+
+/*
+  binary search for the first message of a type with a timestamp at
+  or after time_us. Timestamps are assumed to be monotonic within a
+  message type
+ */
+uint32_t DataFlashFileReader::first_at_or_after(uint8_t type, uint64_t time_us) const
+{
+    const struct type_index &idx = index[type];
+    uint32_t lo = 0;
+    uint32_t hi = idx.count;
+    while (lo < hi) {
+        const uint32_t mid = lo + (hi - lo) / 2;
+        uint64_t t;
+        if (!message_time_us(&mapped[idx.offsets[mid]], t)) {
+            return idx.count;
+        }
+        if (t < time_us) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/*
+  deliver, in log order, every FMT message and every message accepted
+  by seek_keep_type() which lies before offset
+ */
+bool DataFlashFileReader::replay_before(uint64_t offset)
+{
+    uint8_t types[256];
+    uint32_t cursor[256] {};
+    uint16_t num_types = 0;
+
+    types[num_types++] = LOG_FORMAT_MSG;
+    for (uint16_t t=0; t<ARRAY_SIZE(index); t++) {
+        if (t != LOG_FORMAT_MSG && index[t].count != 0 &&
+            t < LOGREADER_MAX_FORMATS && seek_keep_type(formats[t])) {
+            types[num_types++] = t;
+        }
+    }
+
+    while (true) {
+        int16_t best = -1;
+        uint64_t best_ofs = offset;
+        for (uint16_t i=0; i<num_types; i++) {
+            const struct type_index &idx = index[types[i]];
+            if (cursor[i] < idx.count && idx.offsets[cursor[i]] < best_ofs) {
+                best = i;
+                best_ofs = idx.offsets[cursor[i]];
+            }
+        }
+        if (best == -1) {
+            break;
+        }
+        cursor[best]++;
+
+        const uint8_t *hdr = &mapped[best_ofs];
+        if (hdr[2] == LOG_FORMAT_MSG) {
+            struct log_Format f;
+            memcpy(&f, hdr, sizeof(f));
+            set_format(f);
+            if (!handle_log_format_msg(f)) {
+                return false;
+            }
+            continue;
+        }
+        if (!done_format_msgs) {
+            done_format_msgs = true;
+            end_format_msgs();
+        }
+        const struct log_Format &f = formats[hdr[2]];
+        uint8_t msg[f.length];
+        memcpy(msg, hdr, f.length);
+        if (!handle_msg(f, msg)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool DataFlashFileReader::seek_time(uint64_t time_us)
+{
+    if (!build_index()) {
+        return false;
+    }
+
+    uint64_t target = mapped_len;
+    for (uint16_t t=0; t<ARRAY_SIZE(index); t++) {
+        if (t == LOG_FORMAT_MSG || time_fields[t].offset == 0) {
+            continue;
+        }
+        const uint32_t n = first_at_or_after(t, time_us);
+        if (n < index[t].count && index[t].offsets[n] < target) {
+            target = index[t].offsets[n];
+        }
+    }
+
+    if (!replay_before(target)) {
+        return false;
+    }
+    read_ofs = target;
+    return true;
+}
@@ -5,17 +5,77 @@
 class DataFlashFileReader
 {
 public:
+    DataFlashFileReader() {}
+    virtual ~DataFlashFileReader();
+
     bool open_log(const char *logfile);
     bool update(char type[5]);
 
+    /*
+      walk the whole log once, recording the offset of every message
+      by type. Must be called before seek_time() or message_at()
+     */
+    bool build_index(void);
+
+    // number of messages of the given type found by build_index()
+    uint32_t message_count(uint8_t type) const { return index[type].count; }
+
+    // pointer to the n'th message of the given type, or nullptr
+    const uint8_t *message_at(uint8_t type, uint32_t n) const;
+
+    /*
+      position the reader at the first timestamped message at or
+      after time_us. FMT messages (and any types accepted by
+      seek_keep_type()) before that point are delivered first
+     */
+    bool seek_time(uint64_t time_us);
+
+    // make update() return false once a message after time_us is seen
+    void set_end_time(uint64_t time_us) { end_time_us = time_us; }
+
+    // extract the timestamp of a message, false if it has none
+    bool message_time_us(const uint8_t *msg, uint64_t &time_us) const;
+
     virtual bool handle_log_format_msg(const struct log_Format &f) = 0;
     virtual bool handle_msg(const struct log_Format &f, uint8_t *msg) = 0;
 
 protected:
-    int fd = -1;
     bool done_format_msgs = false;
     virtual void end_format_msgs(void) {}
 
+    // messages of these types are replayed when seeking past them
+    virtual bool seek_keep_type(const struct log_Format &f) { return false; }
+
 #define LOGREADER_MAX_FORMATS 255 // must be >= highest MESSAGE
     struct log_Format formats[LOGREADER_MAX_FORMATS] {};
+
+private:
+    // the whole log, mapped read-only
+    const uint8_t *mapped = nullptr;
+    size_t mapped_len = 0;
+    size_t read_ofs = 0;
+
+    // set when the log was compressed and has been expanded into memory
+    uint8_t *decompressed = nullptr;
+    bool decompress_log(const uint8_t *src, size_t len);
+
+    uint64_t end_time_us = 0;
+
+    // offset of the timestamp within each message type, 0 if none
+    struct time_field {
+        uint8_t offset;
+        bool is_ms;
+    } time_fields[256] {};
+
+    struct type_index {
+        uint64_t *offsets;
+        uint32_t count;
+        uint32_t alloc;
+    } index[256] {};
+    bool indexed = false;
+
+    void set_format(const struct log_Format &f);
+    bool index_add(uint8_t type, uint64_t offset);
+    uint32_t first_at_or_after(uint8_t type, uint64_t time_us) const;
+    bool replay_before(uint64_t offset);
 };
@@ -308,6 +308,15 @@ bool LogReader::handle_msg(const struct log_Format &f, uint8_t *msg) {
     return true;
 }
 
+/*
+  parameters and vehicle identification messages are needed even when
+  seeking past the start of a log
+ */
+bool LogReader::seek_keep_type(const struct log_Format &f)
+{
+    return strncmp(f.name, "PARM", 4) == 0 || strncmp(f.name, "MSG", 4) == 0;
+}
+
 bool LogReader::wait_type(const char *wtype)
 {
     while (true) {
@@ -33,6 +33,7 @@ public:
 
 protected:
     virtual void end_format_msgs(void) override;
+    virtual bool seek_keep_type(const struct log_Format &f) override;
 
 private:
     AP_AHRS &ahrs;
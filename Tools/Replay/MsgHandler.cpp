@@ -33,6 +33,7 @@ uint8_t MsgHandler::size_for_type(char type)
 
 void MsgHandler::init_field_types()
 {
+    add_field_type('a', sizeof(int16_t[32]));
     add_field_type('b', sizeof(int8_t));
     add_field_type('c', sizeof(int16_t));
     add_field_type('d', sizeof(double));
@@ -54,12 +55,53 @@ void MsgHandler::init_field_types()
     add_field_type('Q', sizeof(uint64_t));
 }
 
+uint8_t MsgHandler::hash_label(const char *label)
+{
+    // FNV-1a
+    uint32_t h = 2166136261U;
+    while (*label) {
+        h ^= (uint8_t)*label++;
+        h *= 16777619U;
+    }
+    return h & (LOGREADER_FIELD_HASH_SIZE-1);
+}
+
+uint8_t MsgHandler::hash_label_ptr(const char *label)
+{
+    // Fibonacci hash of the pointer, the top 6 bits give the slot
+    const uint32_t p = (uint32_t)(uintptr_t)label;
+    return (p * 2654435761U) >> 26;
+}
+
 struct MsgHandler::format_field_info *MsgHandler::find_field_info(const char *label)
 {
-    for(uint8_t i=0; i<next_field; i++) {
-        if (streq(field_info[i].label, label)) {
-            return &field_info[i];
+    uint8_t h = hash_label_ptr(label);
+    while (label_cache[h].label != NULL) {
+        if (label_cache[h].label == label) {
+            return label_cache[h].info;
         }
+        h = (h + 1) & (LOGREADER_LABEL_CACHE_SIZE-1);
+    }
+
+    // first use of this label with this format
+    struct format_field_info *info = resolve_field_info(label);
+    if (label_cache_count < LOGREADER_LABEL_CACHE_SIZE-1) {
+        label_cache[h].label = label;
+        label_cache[h].info = info;
+        label_cache_count++;
+    }
+    return info;
+}
+
+struct MsgHandler::format_field_info *MsgHandler::resolve_field_info(const char *label)
+{
+    uint8_t h = hash_label(label);
+    while (field_hash[h] != 0) {
+        struct format_field_info &info = field_info[field_hash[h]-1];
+        if (streq(info.label, label)) {
+            return &info;
+        }
+        h = (h + 1) & (LOGREADER_FIELD_HASH_SIZE-1);
     }
     return NULL;
 }
@@ -77,6 +119,13 @@ void MsgHandler::add_field(const char *_label, uint8_t _type, uint8_t _offset,
     field_info[next_field].type = _type;
     field_info[next_field].offset = _offset;
     field_info[next_field].length = _length;
+
+    uint8_t h = hash_label(_label);
+    while (field_hash[h] != 0) {
+        h = (h + 1) & (LOGREADER_FIELD_HASH_SIZE-1);
+    }
+    field_hash[h] = next_field + 1;
+
     next_field++;
 }
 
@@ -58,9 +58,27 @@ private:
     struct format_field_info field_info[LOGREADER_MAX_FIELDS];
 
     uint8_t next_field;
+
+    // open-addressed hash of label to field_info index+1, built once
+    // per format to resolve each label the first time it is used
+#define LOGREADER_FIELD_HASH_SIZE 64 // power of two > LOGREADER_MAX_FIELDS
+    uint8_t field_hash[LOGREADER_FIELD_HASH_SIZE] {};
+    static uint8_t hash_label(const char *label);
     size_t size_for_type_table[52]; // maps field type (e.g. 'f') to e.g 4 bytes
 
+    // fields already resolved for this format, keyed on the caller's
+    // label pointer (always a string literal), so after the first
+    // message each field lookup is a table lookup with no string work
+#define LOGREADER_LABEL_CACHE_SIZE 64 // 1<<6, see hash_label_ptr()
+    struct label_cache_entry {
+        const char *label;
+        struct format_field_info *info; // NULL if not in this format
+    } label_cache[LOGREADER_LABEL_CACHE_SIZE] {};
+    uint8_t label_cache_count = 0;
+    static uint8_t hash_label_ptr(const char *label);
+
     struct format_field_info *find_field_info(const char *label);
+    struct format_field_info *resolve_field_info(const char *label);
 
     void parse_format_fields();
     void init_field_types();
@@ -31,6 +31,11 @@
 #include <SITL/SITL.h>
 #endif
 
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
 #define streq(x, y) (!strcmp(x, y))
 
 const AP_HAL::HAL& hal = AP_HAL::get_HAL();
@@ -153,6 +158,9 @@ void Replay::usage(void)
     ::printf("\t--logmatch         match logging rate to source\n");
     ::printf("\t--no-params        don't use parameters from the log\n");
     ::printf("\t--no-fpe           do not generate floating point exceptions\n");
+    ::printf("\t--start-time       seek to this log time (seconds) before replaying\n");
+    ::printf("\t--end-time         stop replaying at this log time (seconds)\n");
+    ::printf("\t--batch-jobs N     replay all given logs, N at a time, each in its own process\n");
 }
 
 
@@ -168,6 +176,10 @@ enum {
     OPT_NOPARAMS,
     OPT_PARAM_FILE,
     OPT_NO_FPE,
+    OPT_START_TIME,
+    OPT_END_TIME,
+    OPT_BATCH_JOBS,
+    OPT_BATCH_SUMMARY,
 };
 
 void Replay::flush_dataflash(void) {
@@ -202,7 +214,7 @@ const char **Replay::parse_list_from_string(const char *str_in)
     return ret;
 }
 
-void Replay::_parse_command_line(uint8_t argc, char * const argv[])
+void Replay::_parse_command_line(int argc, char * const argv[])
 {
     const struct GetOptLong::option options[] = {
         // name           has_arg flag   val
@@ -224,6 +236,10 @@ void Replay::_parse_command_line(uint8_t argc, char * const argv[])
         {"logmatch",        false,  0, OPT_LOGMATCH},
         {"no-params",       false,  0, OPT_NOPARAMS},
         {"no-fpe",          false,  0, OPT_NO_FPE},
+        {"start-time",      true,   0, OPT_START_TIME},
+        {"end-time",        true,   0, OPT_END_TIME},
+        {"batch-jobs",      true,   0, OPT_BATCH_JOBS},
+        {"batch-summary",   false,  0, OPT_BATCH_SUMMARY},
         {0, false, 0, 0}
     };
 
@@ -307,6 +323,22 @@ void Replay::_parse_command_line(uint8_t argc, char * const argv[])
             generate_fpe = false;
             break;
 
+        case OPT_START_TIME:
+            start_time_us = llround(MAX(atof(gopt.optarg), 0.0) * 1.0e6);
+            break;
+
+        case OPT_END_TIME:
+            end_time_us = llround(MAX(atof(gopt.optarg), 0.0) * 1.0e6);
+            break;
+
+        case OPT_BATCH_JOBS:
+            batch_jobs = constrain_int16(atoi(gopt.optarg), 1, 255);
+            break;
+
+        case OPT_BATCH_SUMMARY:
+            batch_summary = true;
+            break;
+
         case 'h':
         default:
             usage();
@@ -314,12 +346,18 @@ void Replay::_parse_command_line(uint8_t argc, char * const argv[])
         }
     }
 
+    batch_argc = gopt.optind;
+    batch_argv = argv;
+
 	argv += gopt.optind;
 	argc -= gopt.optind;
 
     if (argc > 0) {
         filename = argv[0];
     }
+
+    num_batch_logs = argc;
+    batch_logs = argv;
 }
 
 class IMUCounter : public DataFlashFileReader {
@@ -496,13 +534,18 @@ void Replay::setup()
 {
     ::printf("Starting\n");
 
-    uint8_t argc;
+    int argc;
     char * const *argv;
 
     hal.util->commandline_arguments(argc, argv);
 
     _parse_command_line(argc, argv);
 
+    if (batch_jobs > 0) {
+        // does not return
+        run_batch();
+    }
+
     if (!check_generate) {
         logreader.set_save_chek_messages(true);
     }
@@ -555,6 +598,17 @@ void Replay::setup()
     fprintf(ekf2f, "timestamp TimeMS AX AY AZ VWN VWE MN ME MD MX MY MZ\n");
     fprintf(ekf3f, "timestamp TimeMS IVN IVE IVD IPN IPE IPD IMX IMY IMZ IVT\n");
     fprintf(ekf4f, "timestamp TimeMS SV SP SH SMX SMY SMZ SVT OFN EFE FS DS\n");
+
+    if (start_time_us > 0) {
+        if (!logreader.seek_time(start_time_us)) {
+            ::printf("Failed to seek to %.6f seconds\n", start_time_us * 1.0e-6);
+            exit(1);
+        }
+        ::printf("Seeked to %.6f seconds\n", start_time_us * 1.0e-6);
+    }
+    if (end_time_us > 0) {
+        logreader.set_end_time(end_time_us);
+    }
 }
 
 void Replay::set_ins_update_rate(uint16_t _update_rate) {
@@ -787,6 +841,10 @@ void Replay::flush_and_exit()
 {
     flush_dataflash();
 
+    if (batch_summary) {
+        write_batch_summary();
+    }
+
     if (check_solution) {
         report_checks();
     }
@@ -865,6 +923,7 @@ void Replay::loop()
     _vehicle.EKF.getInnovations(velInnov, posInnov, magInnov, tasInnov);
     _vehicle.EKF.getVariances(velVar, posVar, hgtVar, magVar, tasVar, offset);
     _vehicle.EKF.getFilterFaults(faultStatus);
+    update_innovation_stats(velInnov, posInnov, magInnov);
     Vector3f inav_pos = _vehicle.inertial_nav.get_position() * 0.01f;
     float temp = degrees(ekf_euler.z);
 
@@ -1079,6 +1138,247 @@ void Replay::report_checks(void)
     }
 }
 
+/*
+  accumulate EKF innovation statistics for the batch summary
+ */
+void Replay::update_innovation_stats(const Vector3f &velInnov, const Vector3f &posInnov, const Vector3f &magInnov)
+{
+    const float vel = velInnov.length();
+    const float pos = posInnov.length();
+    const float mag = magInnov.length();
+    innov_stats.sum_sq_vel += sq(vel);
+    innov_stats.sum_sq_pos += sq(pos);
+    innov_stats.sum_sq_mag += sq(mag);
+    innov_stats.max_vel = MAX(innov_stats.max_vel, vel);
+    innov_stats.max_pos = MAX(innov_stats.max_pos, pos);
+    innov_stats.max_mag = MAX(innov_stats.max_mag, mag);
+    innov_stats.count++;
+}
+
+/*
+  write a one line summary of this replay for the batch parent to merge
+ */
+void Replay::write_batch_summary(void)
+{
+    FILE *f = fopen("replay_summary.txt", "w");
+    if (f == nullptr) {
+        return;
+    }
+    const float n = MAX(innov_stats.count, 1U);
+    fprintf(f, "%u\t%.3f\t%.3f\t%.3f\t%.3f\t%.3f\t%.3f\t%.3f\t%.3f\t%.3f\t%.3f\t%.3f\n",
+            (unsigned)innov_stats.count,
+            sqrtf(innov_stats.sum_sq_vel / n), innov_stats.max_vel,
+            sqrtf(innov_stats.sum_sq_pos / n), innov_stats.max_pos,
+            sqrtf(innov_stats.sum_sq_mag / n), innov_stats.max_mag,
+            check_result.max_roll_error,
+            check_result.max_pitch_error,
+            check_result.max_yaw_error,
+            check_result.max_pos_error,
+            check_result.max_vel_error);
+    fclose(f);
+}
+
+/*
+  working directory for one log of a batch replay
+ */
+static void batch_directory(char *dir, size_t len, uint32_t idx, const char *logfile)
+{
+    const char *base = strrchr(logfile, '/');
+    snprintf(dir, len, "replay_batch/%03u-%s", (unsigned)idx, base ? base+1 : logfile);
+}
+
+/*
+  a path made absolute against the current directory, or the path
+  unchanged if it can't be resolved (the child then reports the error)
+ */
+static const char *absolute_path(const char *path)
+{
+    char *abs = realpath(path, nullptr);
+    return abs ? abs : path;
+}
+
+/*
+  the arguments for a child: our own options minus the batch ones,
+  with room for the child's own three. The children run in their own
+  directories, so file arguments are made absolute. Returns the number
+  of arguments filled in
+ */
+uint32_t Replay::batch_child_options(const char **args)
+{
+    uint32_t n = 0;
+    args[n++] = "Replay";
+    args[n++] = "--";
+    for (uint32_t i=1; i<batch_argc; i++) {
+        if (streq(batch_argv[i], "--batch-jobs")) {
+            i++;
+            continue;
+        }
+        if (strncmp(batch_argv[i], "--batch-jobs=", 13) == 0) {
+            continue;
+        }
+        if (streq(batch_argv[i], "--param-file") && i+1 < batch_argc) {
+            args[n++] = batch_argv[i++];
+            args[n++] = absolute_path(batch_argv[i]);
+            continue;
+        }
+        if (strncmp(batch_argv[i], "--param-file=", 13) == 0) {
+            char *arg = nullptr;
+            if (asprintf(&arg, "--param-file=%s", absolute_path(&batch_argv[i][13])) == -1) {
+                arg = nullptr;
+            }
+            args[n++] = arg ? arg : batch_argv[i];
+            continue;
+        }
+        args[n++] = batch_argv[i];
+    }
+    return n;
+}
+
+/*
+  start a replay of one log in a child process. The child re-executes
+  this program, so it gets completely fresh HAL, parameter, vehicle
+  and EKF state, and runs in its own directory so its output files
+  don't collide with other children
+ */
+pid_t Replay::spawn_batch_child(const char **args, uint32_t num_opts, const char *logfile, uint32_t idx)
+{
+    char dir[PATH_MAX];
+    batch_directory(dir, sizeof(dir), idx, logfile);
+    mkdir("replay_batch", 0755);
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        ::fprintf(stderr, "Failed to create %s: %m\n", dir);
+        return -1;
+    }
+    char *path = realpath(logfile, nullptr);
+    if (path == nullptr) {
+        perror(logfile);
+        return -1;
+    }
+
+    // the options shared by all children, then the single log
+    args[num_opts] = "--batch-summary";
+    args[num_opts+1] = path;
+    args[num_opts+2] = nullptr;
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (chdir(dir) != 0) {
+            _exit(1);
+        }
+        int fd = open("replay.out", O_WRONLY|O_CREAT|O_TRUNC, 0644);
+        if (fd != -1) {
+            dup2(fd, STDOUT_FILENO);
+            dup2(fd, STDERR_FILENO);
+            close(fd);
+        }
+        execv("/proc/self/exe", (char * const *)args);
+        _exit(1);
+    }
+    free(path);
+    return pid;
+}
+
+/*
+  add the results of one finished child to the merged summary
+ */
+void Replay::merge_batch_results(uint32_t idx, const char *logfile, int status, FILE *summary)
+{
+    char dir[PATH_MAX];
+    char path[PATH_MAX];
+    char line[256];
+    batch_directory(dir, sizeof(dir), idx, logfile);
+
+    // keep replay_results.txt compatible with CheckLogs.py
+    snprintf(path, sizeof(path), "%s/replay_results.txt", dir);
+    FILE *f = fopen(path, "r");
+    if (f != nullptr) {
+        FILE *results = fopen("replay_results.txt", "a");
+        while (results != nullptr && fgets(line, sizeof(line), f)) {
+            fputs(line, results);
+        }
+        if (results != nullptr) {
+            fclose(results);
+        }
+        fclose(f);
+    }
+
+    const bool ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    snprintf(path, sizeof(path), "%s/replay_summary.txt", dir);
+    f = fopen(path, "r");
+    if (f != nullptr && fgets(line, sizeof(line), f)) {
+        fprintf(summary, "%s\t%s\t%s", logfile, ok ? "OK" : "FAIL", line);
+    } else {
+        fprintf(summary, "%s\t%s\n", logfile, WIFSIGNALED(status) ? "CRASH" : "FAIL");
+    }
+    if (f != nullptr) {
+        fclose(f);
+    }
+    ::printf("%s: %s\n", logfile, ok ? "OK" : "FAIL");
+}
+
+/*
+  replay many logs concurrently, batch_jobs at a time, then write a
+  merged summary of innovation and CHEK statistics
+ */
+void Replay::run_batch(void)
+{
+    if (num_batch_logs == 0) {
+        ::printf("No logs given for batch replay\n");
+        exit(1);
+    }
+    pid_t *pids = (pid_t *)calloc(num_batch_logs, sizeof(pid_t));
+    if (pids == nullptr) {
+        exit(1);
+    }
+    const char **args = (const char **)calloc(batch_argc + 4, sizeof(char *));
+    if (args == nullptr) {
+        exit(1);
+    }
+    const uint32_t num_opts = batch_child_options(args);
+
+    FILE *summary = xfopen("replay_batch_summary.txt", "w");
+    fprintf(summary, "Log\tResult\tSamples\tVelInnovRMS\tVelInnovMax\tPosInnovRMS\tPosInnovMax\tMagInnovRMS\tMagInnovMax\tRollErr\tPitchErr\tYawErr\tPosErr\tVelErr\n");
+
+    uint32_t next = 0;
+    uint32_t running = 0;
+    uint32_t failures = 0;
+    while (next < num_batch_logs || running > 0) {
+        if (running < batch_jobs && next < num_batch_logs) {
+            pids[next] = spawn_batch_child(args, num_opts, batch_logs[next], next);
+            if (pids[next] == -1) {
+                fprintf(summary, "%s\tFAIL\n", batch_logs[next]);
+                failures++;
+            } else {
+                running++;
+            }
+            next++;
+            continue;
+        }
+        int status;
+        pid_t pid = wait(&status);
+        if (pid == -1) {
+            break;
+        }
+        for (uint32_t i=0; i<next; i++) {
+            if (pids[i] == pid) {
+                running--;
+                merge_batch_results(i, batch_logs[i], status, summary);
+                if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                    failures++;
+                }
+                break;
+            }
+        }
+    }
+
+    fclose(summary);
+    free(pids);
+    free(args);
+    ::printf("Replayed %u logs, %u failed; summary in replay_batch_summary.txt\n",
+             (unsigned)num_batch_logs, (unsigned)failures);
+    exit(failures ? 1 : 0);
+}
+
 /*
   parse a parameter file line
  */
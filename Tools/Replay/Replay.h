@@ -142,6 +142,29 @@ private:
     bool logmatch = false;
     uint32_t output_counter = 0;
     uint64_t last_timestamp = 0;
+    uint64_t start_time_us = 0;
+    uint64_t end_time_us = 0;
+
+    // batch mode: number of logs replayed concurrently, and the logs
+    uint8_t batch_jobs = 0;
+    uint32_t batch_argc = 0;
+    char * const *batch_argv = nullptr;
+    uint32_t num_batch_logs = 0;
+    char * const *batch_logs = nullptr;
+    bool batch_summary = false;
+
+    /*
+      innovation statistics, summarised at the end of a batch replay
+     */
+    struct {
+        float sum_sq_vel;
+        float sum_sq_pos;
+        float sum_sq_mag;
+        float max_vel;
+        float max_pos;
+        float max_mag;
+        uint32_t count;
+    } innov_stats {};
 
     struct {
         float max_roll_error;
@@ -152,7 +175,7 @@ private:
         float max_vel_error;
     } check_result {};
 
-    void _parse_command_line(uint8_t argc, char * const argv[]);
+    void _parse_command_line(int argc, char * const argv[]);
 
     struct user_parameter {
         struct user_parameter *next;
@@ -177,6 +200,12 @@ private:
     void load_param_file(const char *filename);
     void set_signal_handlers(void);
     void flush_and_exit();
+    void update_innovation_stats(const Vector3f &velInnov, const Vector3f &posInnov, const Vector3f &magInnov);
+    void write_batch_summary(void);
+    uint32_t batch_child_options(const char **args);
+    pid_t spawn_batch_child(const char **args, uint32_t num_opts, const char *logfile, uint32_t idx);
+    void merge_batch_results(uint32_t idx, const char *logfile, int status, FILE *summary);
+    void run_batch(void);
 
     FILE *xfopen(const char *f, const char *mode);
 };
@@ -30,7 +30,12 @@
 
 #define VEHICLE_TIMEOUT_MS              5000   // if no updates in this time, drop it from the list
 #define ADSB_VEHICLE_LIST_SIZE_DEFAULT  25
+#if HAL_CPU_CLASS >= HAL_CPU_CLASS_1000
+#define ADSB_VEHICLE_LIST_SIZE_MAX      1000
+#else
 #define ADSB_VEHICLE_LIST_SIZE_MAX      100
+#endif
+#define ADSB_VEHICLE_INDEX_NONE         0xFFFF
 #define ADSB_CHAN_TIMEOUT_MS            15000
 
 #if APM_BUILD_TYPE(APM_BUILD_ArduPlane)
@@ -54,8 +59,8 @@ const AP_Param::GroupInfo AP_ADSB::var_info[] = {
 
     // @Param: LIST_MAX
     // @DisplayName: ADSB vehicle list size
-    // @Description: ADSB list size of nearest vehicles. Longer lists take longer to refresh with lower SRx_ADSB values.
-    // @Range: 1 100
+    // @Description: ADSB list size of nearest vehicles. Longer lists take longer to refresh with lower SRx_ADSB values. Boards with enough memory can track up to 1000 vehicles.
+    // @Range: 1 1000
     // @User: Advanced
     AP_GROUPINFO("LIST_MAX",   2, AP_ADSB, in_state.list_size_param, ADSB_VEHICLE_LIST_SIZE_DEFAULT),
 
@@ -127,14 +132,29 @@ void AP_ADSB::init(void)
             in_state.list_size_param.save();
         }
         in_state.list_size = in_state.list_size_param;
+
+        // at most one vehicle per hash bucket on average
+        uint8_t hash_bits = 1;
+        while ((1U<<hash_bits) < in_state.list_size) {
+            hash_bits++;
+        }
+        in_state.icao_hash_shift = 32 - hash_bits;
+
         in_state.vehicle_list = new adsb_vehicle_t[in_state.list_size];
+        in_state.icao_next = new uint16_t[in_state.list_size];
+        in_state.icao_hash = new uint16_t[1U<<hash_bits];
 
-        if (in_state.vehicle_list == nullptr) {
+        if (in_state.vehicle_list == nullptr ||
+            in_state.icao_next == nullptr ||
+            in_state.icao_hash == nullptr) {
             // dynamic RAM allocation of _vehicle_list[] failed, disable gracefully
             hal.console->printf("Unable to initialize ADS-B vehicle list\n");
+            deinit();
             _enabled.set_and_notify(0);
+            return;
         }
     }
+    memset(in_state.icao_hash, 0xFF, sizeof(uint16_t) << (32 - in_state.icao_hash_shift));
 
     furthest_vehicle_distance = 0;
     furthest_vehicle_index = 0;
@@ -153,6 +173,10 @@ void AP_ADSB::deinit(void)
         delete [] in_state.vehicle_list;
         in_state.vehicle_list = nullptr;
     }
+    delete [] in_state.icao_next;
+    in_state.icao_next = nullptr;
+    delete [] in_state.icao_hash;
+    in_state.icao_hash = nullptr;
 }
 
 /*
@@ -250,23 +274,29 @@ void AP_ADSB::update(void)
 
 /*
  * determine index and distance of furthest vehicle. This is
- * used to bump it off when a new closer aircraft is detected
+ * used to bump it off when a new closer aircraft is detected.
+ * Distances are compared squared, in lat/lng units scaled for our
+ * latitude, to keep trig and sqrt out of the loop over the list
  */
 void AP_ADSB::determine_furthest_aircraft(void)
 {
-    float max_distance = 0;
+    const float lng_scale = longitude_scale(_my_loc);
+    float max_distance_sq = 0;
     uint16_t max_distance_index = 0;
 
     for (uint16_t index = 0; index < in_state.vehicle_count; index++) {
-        float distance = _my_loc.get_distance(get_location(in_state.vehicle_list[index]));
-        if (max_distance < distance || index == 0) {
-            max_distance = distance;
+        const mavlink_adsb_vehicle_t &info = in_state.vehicle_list[index].info;
+        const float dlat = (float)(info.lat - _my_loc.lat);
+        const float dlng = (float)(info.lon - _my_loc.lng) * lng_scale;
+        const float distance_sq = sq(dlat) + sq(dlng);
+        if (max_distance_sq < distance_sq || index == 0) {
+            max_distance_sq = distance_sq;
             max_distance_index = index;
         }
     } // for index
 
     furthest_vehicle_index = max_distance_index;
-    furthest_vehicle_distance = max_distance;
+    furthest_vehicle_distance = sqrtf(max_distance_sq) * LOCATION_SCALING_FACTOR;
 }
 
 /*
@@ -295,8 +325,11 @@ void AP_ADSB::delete_vehicle(const uint16_t index)
             furthest_vehicle_distance = 0;
             furthest_vehicle_index = 0;
         }
+        icao_index_remove(index);
         if (index != (in_state.vehicle_count-1)) {
+            icao_index_remove(in_state.vehicle_count-1);
             in_state.vehicle_list[index] = in_state.vehicle_list[in_state.vehicle_count-1];
+            icao_index_add(index);
         }
         // TODO: is memset needed? When we decrement the index we essentially forget about it
         memset(&in_state.vehicle_list[in_state.vehicle_count-1], 0, sizeof(adsb_vehicle_t));
@@ -311,8 +344,11 @@ void AP_ADSB::delete_vehicle(const uint16_t index)
  */
 bool AP_ADSB::find_index(const adsb_vehicle_t &vehicle, uint16_t *index) const
 {
-    for (uint16_t i = 0; i < in_state.vehicle_count; i++) {
-        if (in_state.vehicle_list[i].info.ICAO_address == vehicle.info.ICAO_address) {
+    const uint32_t ICAO_address = vehicle.info.ICAO_address;
+    for (uint16_t i = in_state.icao_hash[icao_bucket(ICAO_address)];
+         i != ADSB_VEHICLE_INDEX_NONE;
+         i = in_state.icao_next[i]) {
+        if (in_state.vehicle_list[i].info.ICAO_address == ICAO_address) {
             *index = i;
             return true;
         }
@@ -320,6 +356,40 @@ bool AP_ADSB::find_index(const adsb_vehicle_t &vehicle, uint16_t *index) const
     return false;
 }
 
+/*
+ * hash an ICAO address to a bucket. Addresses are allocated in blocks
+ * per country, so multiply to spread them before taking the top bits
+ */
+uint16_t AP_ADSB::icao_bucket(const uint32_t ICAO_address) const
+{
+    return (ICAO_address * 2654435761U) >> in_state.icao_hash_shift;
+}
+
+/*
+ * link the vehicle at index into the bucket for its ICAO address
+ */
+void AP_ADSB::icao_index_add(const uint16_t index)
+{
+    uint16_t &head = in_state.icao_hash[icao_bucket(in_state.vehicle_list[index].info.ICAO_address)];
+    in_state.icao_next[index] = head;
+    head = index;
+}
+
+/*
+ * unlink the vehicle at index from the bucket for its ICAO address
+ */
+void AP_ADSB::icao_index_remove(const uint16_t index)
+{
+    uint16_t *p = &in_state.icao_hash[icao_bucket(in_state.vehicle_list[index].info.ICAO_address)];
+    while (*p != ADSB_VEHICLE_INDEX_NONE) {
+        if (*p == index) {
+            *p = in_state.icao_next[index];
+            return;
+        }
+        p = &in_state.icao_next[*p];
+    }
+}
+
 /*
  * Update the vehicle list. If the vehicle is already in the
  * list then it will update it, otherwise it will be added.
@@ -414,7 +484,12 @@ void AP_ADSB::handle_vehicle(const mavlink_message_t* packet)
 void AP_ADSB::set_vehicle(const uint16_t index, const adsb_vehicle_t &vehicle)
 {
     if (index < in_state.list_size) {
+        if (index < in_state.vehicle_count) {
+            // the slot may be taken over by a different vehicle
+            icao_index_remove(index);
+        }
         in_state.vehicle_list[index] = vehicle;
+        icao_index_add(index);
     }
 }
 
@@ -88,6 +88,11 @@ private:
     // return index of given vehicle if ICAO_ADDRESS matches. return -1 if no match
     bool find_index(const adsb_vehicle_t &vehicle, uint16_t *index) const;
 
+    // ICAO address hash chains over vehicle_list
+    uint16_t icao_bucket(uint32_t ICAO_address) const;
+    void icao_index_add(const uint16_t index);
+    void icao_index_remove(const uint16_t index);
+
     // remove a vehicle from the list
     void delete_vehicle(const uint16_t index);
 
@@ -125,6 +130,12 @@ private:
         uint16_t    list_size = 1; // start with tiny list, then change to param-defined size. This ensures it doesn't fail on start
         adsb_vehicle_t *vehicle_list = nullptr;
         uint16_t    vehicle_count;
+
+        // vehicle_list indexes chained by ICAO address, so a vehicle
+        // is found without scanning the list
+        uint16_t    *icao_hash = nullptr;   // first vehicle in each bucket
+        uint16_t    *icao_next = nullptr;   // next vehicle in the same bucket
+        uint8_t     icao_hash_shift;
         AP_Int32    list_radius;
 
         // streamrate stuff
@@ -0,0 +1,84 @@
+/*
+  ADSB_VEHICLE handling with synthetic traffic, as seen near a busy
+  airport. Each message updates one of state.range_x() targets in turn
+ */
+#include <AP_gbenchmark.h>
+
+#include <AP_ADSB/AP_ADSB.h>
+#include <AP_AHRS/AP_AHRS.h>
+#include <AP_Baro/AP_Baro.h>
+#include <AP_GPS/AP_GPS.h>
+#include <AP_InertialSensor/AP_InertialSensor.h>
+#include <AP_Math/pseudo_random.h>
+#include <GCS_MAVLink/GCS.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+/*
+  the AHRS an AP_ADSB needs to exist. With no GPS there is no own
+  position, so no target is dropped for being out of range
+ */
+class BenchVehicle {
+public:
+    AP_InertialSensor ins;
+    AP_Baro baro;
+    AP_GPS gps;
+    AP_AHRS_DCM ahrs {ins, baro, gps};
+};
+
+static BenchVehicle vehicle;
+
+#define FIRST_ICAO_ADDRESS 0x400000
+
+static void BM_ADSBVehicleUpdate(benchmark::State& state)
+{
+    const uint16_t num_targets = state.range_x();
+    AP_ADSB *adsb = new AP_ADSB(vehicle.ahrs);
+    mavlink_message_t *msgs = new mavlink_message_t[num_targets];
+
+    AP_Param::set_object_value(adsb, AP_ADSB::var_info, "ENABLE", 1);
+    AP_Param::set_object_value(adsb, AP_ADSB::var_info, "LIST_MAX", num_targets);
+    // allocate the vehicle list
+    adsb->update();
+
+    // targets spread over a 20km square, all addresses from one block
+    PseudoRandom prng(1);
+    for (uint16_t i = 0; i < num_targets; i++) {
+        mavlink_adsb_vehicle_t info {};
+        info.ICAO_address = FIRST_ICAO_ADDRESS + i;
+        info.lat = -353632610 + (int32_t)prng.next_below(1800000) - 900000;
+        info.lon = 1491652300 + (int32_t)prng.next_below(2200000) - 1100000;
+        info.altitude = 1000000 + prng.next_below(3000) * 1000;
+        info.heading = prng.next_below(36000);
+        info.hor_velocity = 5000 + prng.next_below(20000);
+        info.flags = ADSB_FLAGS_VALID_COORDS | ADSB_FLAGS_VALID_ALTITUDE |
+            ADSB_FLAGS_VALID_HEADING | ADSB_FLAGS_VALID_VELOCITY;
+        mavlink_msg_adsb_vehicle_encode(1, MAV_COMP_ID_ADSB, &msgs[i], &info);
+    }
+
+    // first pass fills the list
+    for (uint16_t i = 0; i < num_targets; i++) {
+        adsb->handle_message(MAVLINK_COMM_1, &msgs[i]);
+    }
+
+    uint16_t i = 0;
+    AP_ADSB::adsb_vehicle_t sample;
+    while (state.KeepRunning()) {
+        adsb->handle_message(MAVLINK_COMM_1, &msgs[i]);
+        // AP_Avoidance would take the samples
+        adsb->next_sample(sample);
+        if (++i == num_targets) {
+            i = 0;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    gbenchmark_escape(&sample);
+
+    delete[] msgs;
+    delete adsb;
+}
+
+/* number of targets */
+BENCHMARK(BM_ADSBVehicleUpdate)->Arg(25)->Arg(100)->Arg(1000);
+
+BENCHMARK_MAIN()
@@ -438,14 +438,29 @@ void AP_Avoidance::check_for_threats()
     // we always check all obstacles to see if they are threats since it
     // is most likely our own position and/or velocity have changed
     // determine the current most-serious-threat
+    const int8_t last_most_serious_threat = _current_most_serious_threat;
     _current_most_serious_threat = -1;
+    const float my_longitude_scale = longitude_scale(my_loc);
     for (uint8_t i=0; i<_obstacle_count; i++) {
 
         AP_Avoidance::Obstacle &obstacle = _obstacles[i];
         const uint32_t obstacle_age = AP_HAL::millis() - obstacle.timestamp_ms;
         debug("i=%d src_id=%d timestamp=%u age=%d", i, obstacle.src_id, obstacle.timestamp_ms, obstacle_age);
 
-        update_threat_level(my_loc, my_vel, obstacle);
+        // most obstacles around a busy airport are too far away to
+        // matter, only work out the closest approach for the others.
+        // A threat that has just moved out of reach is still updated
+        // and considered, so the GCS is sent the cleared messages for
+        // it with its final closest approach
+        const bool was_threat = obstacle.threat_level != MAV_COLLISION_THREAT_LEVEL_NONE ||
+                                i == last_most_serious_threat;
+        const bool out_of_reach = !was_threat &&
+            obstacle_out_of_reach(my_loc, my_vel, my_longitude_scale, obstacle);
+        if (out_of_reach) {
+            obstacle.threat_level = MAV_COLLISION_THREAT_LEVEL_NONE;
+        } else {
+            update_threat_level(my_loc, my_vel, obstacle);
+        }
         debug("   threat-level=%d", obstacle.threat_level);
 
         // ignore any really old data:
@@ -457,6 +472,10 @@ void AP_Avoidance::check_for_threats()
             continue;
         }
 
+        if (out_of_reach) {
+            continue;
+        }
+
         if (obstacle_is_more_serious_threat(obstacle)) {
             _current_most_serious_threat = i;
         }
@@ -466,6 +485,28 @@ void AP_Avoidance::check_for_threats()
     }
 }
 
+/*
+  return true if an obstacle can't come within the warn or fail
+  distance of us inside the longer of the two time horizons, even
+  flying straight at us. The closest approach is at least the current
+  distance less the distance the relative velocity covers in that time
+ */
+bool AP_Avoidance::obstacle_out_of_reach(const Location &my_loc,
+                                         const Vector3f &my_vel,
+                                         const float my_longitude_scale,
+                                         const AP_Avoidance::Obstacle &obstacle) const
+{
+    const uint32_t obstacle_age = AP_HAL::millis() - obstacle.timestamp_ms;
+    const uint32_t time_horizon = MAX(_warn_time_horizon.get(), _fail_time_horizon.get()) + obstacle_age/1000;
+    const float distance_limit = MAX(_warn_distance_xy.get(), (float)_fail_distance_xy.get());
+
+    const float dlat = (float)(obstacle._location.lat - my_loc.lat);
+    const float dlng = (float)(obstacle._location.lng - my_loc.lng) * my_longitude_scale;
+    const float distance = norm(dlat, dlng) * LOCATION_SCALING_FACTOR;
+    const float closing_speed = norm(obstacle._velocity.x - my_vel.x, obstacle._velocity.y - my_vel.y);
+
+    return distance - closing_speed * time_horizon > distance_limit;
+}
 
 AP_Avoidance::Obstacle *AP_Avoidance::most_serious_threat()
 {
@@ -161,6 +161,10 @@ private:
     uint32_t src_id_for_adsb_vehicle(AP_ADSB::adsb_vehicle_t vehicle) const;
 
     void check_for_threats();
+    bool obstacle_out_of_reach(const Location &my_loc,
+                               const Vector3f &my_vel,
+                               float my_longitude_scale,
+                               const AP_Avoidance::Obstacle &obstacle) const;
     void update_threat_level(const Location &my_loc,
                              const Vector3f &my_vel,
                              AP_Avoidance::Obstacle &obstacle);
@@ -43,6 +43,7 @@ namespace AP_HAL {
      */
     typedef void(*Proc)(void);
     FUNCTOR_TYPEDEF(MemberProc, void);
+    FUNCTOR_TYPEDEF(IndexedProc, void, uint8_t);
 
     /**
      * Global names for all of the existing SPI devices on all platforms.
@@ -60,4 +60,13 @@ public:
        optional function to stop clock at a given time, used by log replay
      */
     virtual void     stop_clock(uint64_t time_usec) {}
+
+    /**
+       optionally call proc(0) to proc(count-1) concurrently on
+       separate CPUs, returning once all of them have finished. The
+       calls must not share unprotected state. Returns false without
+       calling proc if the board can't do this, in which case the
+       caller should run them itself
+     */
+    virtual bool     run_parallel(AP_HAL::IndexedProc proc, uint8_t count) { return false; }
 };
@@ -74,7 +74,7 @@ public:
     /**
        return commandline arguments, if available
      */
-    virtual void commandline_arguments(uint8_t &argc, char * const *&argv) { argc = 0; }
+    virtual void commandline_arguments(int &argc, char * const *&argv) { argc = 0; }
 
     /*
         ToneAlarm Driver
@@ -0,0 +1,109 @@
+/*
+  compare the locked-by-caller ByteBuffer with the lock-free
+  SPSCByteBuffer, both from a single thread and with a producer thread
+  feeding the benchmark thread
+ */
+#include <AP_gbenchmark.h>
+
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <AP_HAL/utility/RingBuffer.h>
+#include <AP_HAL/utility/SPSCBuffer.h>
+
+#define BUFFER_SIZE 4096
+
+/*
+  write then read back a chunk of state.range_x() bytes
+ */
+template <class Buffer>
+static void BM_WriteRead(benchmark::State& state)
+{
+    Buffer buf(BUFFER_SIZE);
+    uint8_t chunk[1024] {};
+    const uint32_t len = state.range_x();
+
+    while (state.KeepRunning()) {
+        buf.write(chunk, len);
+        buf.read(chunk, len);
+        gbenchmark_escape(chunk);
+    }
+    state.SetBytesProcessed(int64_t(state.iterations()) * len);
+}
+
+BENCHMARK_TEMPLATE(BM_WriteRead, ByteBuffer)->Arg(1)->Arg(16)->Arg(256)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_WriteRead, SPSCByteBuffer)->Arg(1)->Arg(16)->Arg(256)->Arg(1024);
+
+/*
+  byte at a time, as the UART drivers are typically used
+ */
+template <class Buffer>
+static void BM_ReadByte(benchmark::State& state)
+{
+    Buffer buf(BUFFER_SIZE);
+    uint8_t chunk[64] {};
+
+    while (state.KeepRunning()) {
+        buf.write(chunk, sizeof(chunk));
+        uint8_t b;
+        while (buf.read_byte(&b)) {
+            gbenchmark_escape(&b);
+        }
+    }
+    state.SetBytesProcessed(int64_t(state.iterations()) * sizeof(chunk));
+}
+
+BENCHMARK_TEMPLATE(BM_ReadByte, ByteBuffer);
+BENCHMARK_TEMPLATE(BM_ReadByte, SPSCByteBuffer);
+
+template <class Buffer>
+struct producer_args {
+    Buffer *buf;
+    volatile bool stop;
+};
+
+template <class Buffer>
+static void *producer(void *arg)
+{
+    producer_args<Buffer> *args = (producer_args<Buffer> *)arg;
+    uint8_t chunk[256] {};
+    while (!args->stop) {
+        if (args->buf->write(chunk, sizeof(chunk)) == 0) {
+            sched_yield();
+        }
+    }
+    return nullptr;
+}
+
+/*
+  sustained throughput with another thread writing. ByteBuffer is
+  safe for this too as long as there is one reader and one writer, so
+  this measures the cost of the memory ordering and index handling
+ */
+template <class Buffer>
+static void BM_Threaded(benchmark::State& state)
+{
+    Buffer buf(BUFFER_SIZE);
+    producer_args<Buffer> args { &buf, false };
+    pthread_t thread;
+    pthread_create(&thread, nullptr, producer<Buffer>, &args);
+
+    uint8_t chunk[256];
+    int64_t bytes = 0;
+    while (state.KeepRunning()) {
+        const uint32_t n = buf.read(chunk, sizeof(chunk));
+        if (n == 0) {
+            sched_yield();
+        }
+        bytes += n;
+        gbenchmark_escape(chunk);
+    }
+    args.stop = true;
+    pthread_join(thread, nullptr);
+    state.SetBytesProcessed(bytes);
+}
+
+BENCHMARK_TEMPLATE(BM_Threaded, ByteBuffer);
+BENCHMARK_TEMPLATE(BM_Threaded, SPSCByteBuffer);
+
+BENCHMARK_MAIN()
@@ -68,6 +68,7 @@
 #define HAL_FLOW_PX4_MAX_FLOW_PIXEL 4
 #define HAL_FLOW_PX4_BOTTOM_FLOW_FEATURE_THRESHOLD 30
 #define HAL_FLOW_PX4_BOTTOM_FLOW_VALUE_THRESHOLD 5000
+#define HAL_FLOW_PX4_NUM_THREADS 2
 #define HAL_PARAM_DEFAULTS_PATH "/etc/arducopter/bebop.parm"
 #define HAL_RCOUT_BEBOP_BLDC_I2C_BUS 1
 #define HAL_RCOUT_BEBOP_BLDC_I2C_ADDR 0x08
@@ -140,6 +141,7 @@
 #define HAL_FLOW_PX4_MAX_FLOW_PIXEL 4
 #define HAL_FLOW_PX4_BOTTOM_FLOW_FEATURE_THRESHOLD 30
 #define HAL_FLOW_PX4_BOTTOM_FLOW_VALUE_THRESHOLD 5000
+#define HAL_FLOW_PX4_NUM_THREADS 2
 /* ELP-USBFHD01M-L21
  * focal length 2.1 mm, pixel size 3 um
  * 240x240 crop rescaled to 64x64 */
@@ -324,6 +326,21 @@
 #error "no Linux board subtype set"
 #endif
 
+// directory of the storage file. Replay overrides this with its
+// working directory, see AP_HAL_Linux/Storage.cpp
+#ifndef HAL_BOARD_STORAGE_DIRECTORY
+#if CONFIG_HAL_BOARD_SUBTYPE == HAL_BOARD_SUBTYPE_LINUX_BEBOP || CONFIG_HAL_BOARD_SUBTYPE == HAL_BOARD_SUBTYPE_LINUX_DISCO
+#define HAL_BOARD_STORAGE_DIRECTORY "/data/ftp/internal_000/APM"
+#else
+#define HAL_BOARD_STORAGE_DIRECTORY "/var/APM"
+#endif
+#endif
+
+#ifndef HAL_PARAM_SNAPSHOT_DIR
+// keep the parameter load snapshot next to the storage file
+#define HAL_PARAM_SNAPSHOT_DIR HAL_BOARD_STORAGE_DIRECTORY
+#endif
+
 #ifndef HAL_COMPASS_DEFAULT
 #define HAL_COMPASS_DEFAULT -1
 #endif
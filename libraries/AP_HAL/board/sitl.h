@@ -9,6 +9,7 @@
 #define HAL_BOARD_LOG_DIRECTORY "logs"
 #define HAL_BOARD_TERRAIN_DIRECTORY "terrain"
 #define HAL_PARAM_DEFAULTS_PATH "etc/defaults.parm"
+#define HAL_PARAM_SNAPSHOT_DIR "."
 #define HAL_INS_DEFAULT HAL_INS_HIL
 #define HAL_BARO_DEFAULT HAL_BARO_HIL
 #define HAL_COMPASS_DEFAULT HAL_COMPASS_HIL
@@ -0,0 +1,222 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "SPSCBuffer.h"
+
+/*
+  memory ordering:
+
+  - the producer writes data, then stores tail with release
+  - the consumer loads tail with acquire, so sees that data, reads it,
+    then stores head with release
+  - the producer loads head with acquire before reusing the space, so
+    the consumer's reads of it have finished
+
+  Each side reads its own index relaxed, as only it ever changes it.
+ */
+
+static uint32_t round_up_pow2(uint32_t n)
+{
+    uint32_t ret = 1;
+    while (ret < n) {
+        ret <<= 1;
+    }
+    return ret;
+}
+
+SPSCByteBuffer::SPSCByteBuffer(uint32_t _size) :
+    buf(nullptr),
+    size(0),
+    mask(0)
+{
+    set_size(_size);
+}
+
+SPSCByteBuffer::~SPSCByteBuffer(void)
+{
+    free(buf);
+}
+
+bool SPSCByteBuffer::set_size(uint32_t _size)
+{
+    clear();
+    if (_size == 0) {
+        free(buf);
+        buf = nullptr;
+        size = mask = 0;
+        return true;
+    }
+    _size = round_up_pow2(_size);
+    if (_size != size) {
+        free(buf);
+        buf = (uint8_t *)malloc(_size);
+        if (buf == nullptr) {
+            size = mask = 0;
+            return false;
+        }
+        size = _size;
+        mask = _size - 1;
+    }
+    return true;
+}
+
+void SPSCByteBuffer::clear(void)
+{
+    head.store(0, std::memory_order_relaxed);
+    tail.store(0, std::memory_order_relaxed);
+}
+
+uint32_t SPSCByteBuffer::available(void) const
+{
+    const uint32_t _head = head.load(std::memory_order_acquire);
+    return tail.load(std::memory_order_acquire) - _head;
+}
+
+uint32_t SPSCByteBuffer::space(void) const
+{
+    const uint32_t _tail = tail.load(std::memory_order_acquire);
+    return size - (_tail - head.load(std::memory_order_acquire));
+}
+
+uint8_t SPSCByteBuffer::reserve(IoVec vec[2], uint32_t len)
+{
+    const uint32_t _tail = tail.load(std::memory_order_relaxed);
+    const uint32_t free_space = size - (_tail - head.load(std::memory_order_acquire));
+    if (len > free_space) {
+        len = free_space;
+    }
+    if (len == 0) {
+        return 0;
+    }
+
+    const uint32_t ofs = _tail & mask;
+    const uint32_t n = size - ofs;
+    vec[0].data = &buf[ofs];
+    if (len <= n) {
+        vec[0].len = len;
+        return 1;
+    }
+    vec[0].len = n;
+    vec[1].data = buf;
+    vec[1].len = len - n;
+    return 2;
+}
+
+bool SPSCByteBuffer::commit(uint32_t len)
+{
+    const uint32_t _tail = tail.load(std::memory_order_relaxed);
+    if (len > size - (_tail - head.load(std::memory_order_acquire))) {
+        return false;
+    }
+    tail.store(_tail + len, std::memory_order_release);
+    return true;
+}
+
+uint32_t SPSCByteBuffer::write(const uint8_t *data, uint32_t len)
+{
+    IoVec vec[2];
+    const uint8_t n_vec = reserve(vec, len);
+    uint32_t ret = 0;
+    for (uint8_t i = 0; i < n_vec; i++) {
+        memcpy(vec[i].data, data + ret, vec[i].len);
+        ret += vec[i].len;
+    }
+    commit(ret);
+    return ret;
+}
+
+uint8_t SPSCByteBuffer::peekiovec(IoVec vec[2], uint32_t len)
+{
+    const uint32_t _head = head.load(std::memory_order_relaxed);
+    const uint32_t avail = tail.load(std::memory_order_acquire) - _head;
+    if (len > avail) {
+        len = avail;
+    }
+    if (len == 0) {
+        return 0;
+    }
+
+    const uint32_t ofs = _head & mask;
+    const uint32_t n = size - ofs;
+    vec[0].data = &buf[ofs];
+    if (len <= n) {
+        vec[0].len = len;
+        return 1;
+    }
+    vec[0].len = n;
+    vec[1].data = buf;
+    vec[1].len = len - n;
+    return 2;
+}
+
+const uint8_t *SPSCByteBuffer::readptr(uint32_t &available_bytes)
+{
+    const uint32_t _head = head.load(std::memory_order_relaxed);
+    const uint32_t avail = tail.load(std::memory_order_acquire) - _head;
+    const uint32_t ofs = _head & mask;
+    available_bytes = avail < size - ofs ? avail : size - ofs;
+    return available_bytes ? &buf[ofs] : nullptr;
+}
+
+uint32_t SPSCByteBuffer::peekbytes(uint8_t *data, uint32_t len)
+{
+    IoVec vec[2];
+    const uint8_t n_vec = peekiovec(vec, len);
+    uint32_t ret = 0;
+    for (uint8_t i = 0; i < n_vec; i++) {
+        memcpy(data + ret, vec[i].data, vec[i].len);
+        ret += vec[i].len;
+    }
+    return ret;
+}
+
+bool SPSCByteBuffer::advance(uint32_t n)
+{
+    const uint32_t _head = head.load(std::memory_order_relaxed);
+    if (n > tail.load(std::memory_order_acquire) - _head) {
+        return false;
+    }
+    head.store(_head + n, std::memory_order_release);
+    return true;
+}
+
+uint32_t SPSCByteBuffer::read(uint8_t *data, uint32_t len)
+{
+    const uint32_t ret = peekbytes(data, len);
+    advance(ret);
+    return ret;
+}
+
+bool SPSCByteBuffer::read_byte(uint8_t *data)
+{
+    const uint32_t _head = head.load(std::memory_order_relaxed);
+    if (data == nullptr || tail.load(std::memory_order_acquire) == _head) {
+        return false;
+    }
+    *data = buf[_head & mask];
+    head.store(_head + 1, std::memory_order_release);
+    return true;
+}
+
+int16_t SPSCByteBuffer::peek(uint32_t ofs) const
+{
+    const uint32_t _head = head.load(std::memory_order_relaxed);
+    if (ofs >= tail.load(std::memory_order_acquire) - _head) {
+        return -1;
+    }
+    return buf[(_head + ofs) & mask];
+}
+
+bool SPSCByteBuffer::update(const uint8_t *data, uint32_t len)
+{
+    IoVec vec[2];
+    if (len > available()) {
+        return false;
+    }
+    const uint8_t n_vec = peekiovec(vec, len);
+    for (uint8_t i = 0; i < n_vec; i++) {
+        memcpy(vec[i].data, data, vec[i].len);
+        data += vec[i].len;
+    }
+    return true;
+}
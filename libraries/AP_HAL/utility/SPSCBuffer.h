@@ -0,0 +1,174 @@
+#pragma once
+
+#include <atomic>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "RingBuffer.h"
+
+/*
+ * Lock-free circular buffer of bytes for exactly one producer thread
+ * and one consumer thread.
+ *
+ * The producer owns the tail index and the consumer owns the head
+ * index. Both are free running and only reduced modulo the size when
+ * used as an offset, so the size must be a power of two (set_size()
+ * rounds up) and the whole buffer can be used. Each side publishes its
+ * index with a release store after touching the data, and loads the
+ * other side's index with an acquire load before touching the data, so
+ * no locking is needed between the two.
+ *
+ * Methods are marked with the side they may be called from. Several
+ * threads may share one side only if they serialise with a lock of
+ * their own. clear() and set_size() are not thread safe.
+ */
+class SPSCByteBuffer {
+public:
+    typedef ByteBuffer::IoVec IoVec;
+
+    SPSCByteBuffer(uint32_t size);
+    ~SPSCByteBuffer(void);
+
+    // number of bytes available to be read. From the producer this
+    // may be out of date, and can only be too high
+    uint32_t available(void) const;
+
+    // number of bytes space available to write. From the consumer
+    // this may be out of date, and can only be too high
+    uint32_t space(void) const;
+
+    // true if available() is zero
+    bool empty(void) const { return available() == 0; }
+
+    // return size of ringbuffer
+    uint32_t get_size(void) const { return size; }
+
+    // set size of ringbuffer, rounded up to a power of two. Not
+    // thread safe
+    bool set_size(uint32_t size);
+
+    // discard the buffer content. Not thread safe
+    void clear(void);
+
+    // producer: write bytes, returning the number written
+    uint32_t write(const uint8_t *data, uint32_t len);
+
+    // producer: fill out vec with up to len bytes of free space as one
+    // or two contiguous parts, returning the number of parts. The
+    // space is made readable by commit()
+    uint8_t reserve(IoVec vec[2], uint32_t len);
+
+    // producer: publish len bytes previously reserved
+    bool commit(uint32_t len);
+
+    // consumer: read bytes, returning the number read
+    uint32_t read(uint8_t *data, uint32_t len);
+
+    // consumer: read one byte, false if empty
+    bool read_byte(uint8_t *data);
+
+    // consumer: peek one byte without advancing the read pointer.
+    // Return byte or -1 if none available
+    int16_t peek(uint32_t ofs) const;
+
+    // consumer: read len bytes without advancing the read pointer
+    uint32_t peekbytes(uint8_t *data, uint32_t len);
+
+    // consumer: fill out vec with up to len readable bytes as one or
+    // two contiguous parts, returning the number of parts
+    uint8_t peekiovec(IoVec vec[2], uint32_t len);
+
+    // consumer: pointer to, and length of, the contiguous readable
+    // region at the read pointer
+    const uint8_t *readptr(uint32_t &available_bytes);
+
+    // consumer: discard n bytes
+    bool advance(uint32_t n);
+
+    // consumer: overwrite bytes at the read pointer
+    bool update(const uint8_t *data, uint32_t len);
+
+private:
+    uint8_t *buf;
+    uint32_t size;
+    uint32_t mask;
+
+    // keep the two indexes on separate cache lines so the producer and
+    // consumer do not keep stealing the line from each other
+    uint8_t _pad0[64];
+    std::atomic<uint32_t> head{0}; // total bytes read
+    uint8_t _pad1[64];
+    std::atomic<uint32_t> tail{0}; // total bytes written
+    uint8_t _pad2[64];
+};
+
+/*
+  lock-free ring buffer of objects of fixed size, for one producer and
+  one consumer. There is no push_force() as only the consumer may
+  discard objects
+ */
+template <class T>
+class SPSCObjectBuffer {
+public:
+    SPSCObjectBuffer(uint32_t _size) : buffer(_size * sizeof(T)) {}
+
+    // consumer: number of objects available to be read
+    uint32_t available(void) const {
+        return buffer.available() / sizeof(T);
+    }
+
+    // producer: number of objects that could be written
+    uint32_t space(void) const {
+        return buffer.space() / sizeof(T);
+    }
+
+    bool empty(void) const {
+        return buffer.empty();
+    }
+
+    // producer: push one object
+    bool push(const T &object) {
+        return push(&object, 1) == 1;
+    }
+
+    // producer: push up to n objects, returning the number pushed
+    uint32_t push(const T *objects, uint32_t n) {
+        const uint32_t n_space = space();
+        if (n > n_space) {
+            n = n_space;
+        }
+        return buffer.write((const uint8_t *)objects, n * sizeof(T)) / sizeof(T);
+    }
+
+    // consumer: throw away an object
+    bool pop(void) {
+        return buffer.advance(sizeof(T));
+    }
+
+    // consumer: pop earliest object off the queue
+    bool pop(T &object) {
+        return pop(&object, 1) == 1;
+    }
+
+    // consumer: pop up to n objects, returning the number popped
+    uint32_t pop(T *objects, uint32_t n) {
+        const uint32_t n_avail = available();
+        if (n > n_avail) {
+            n = n_avail;
+        }
+        return buffer.read((uint8_t *)objects, n * sizeof(T)) / sizeof(T);
+    }
+
+    // consumer: copy an object out without advancing the read pointer
+    bool peek(T &object) {
+        return buffer.peekbytes((uint8_t*)&object, sizeof(T)) == sizeof(T);
+    }
+
+    // consumer: update the object at the front of the queue
+    bool update(const T &object) {
+        return buffer.update((const uint8_t*)&object, sizeof(T));
+    }
+
+private:
+    SPSCByteBuffer buffer;
+};
@@ -0,0 +1,226 @@
+/*
+  stress tests for the lock-free SPSC ring buffers. A producer and a
+  consumer thread push a known sequence through a small buffer using
+  all the different access methods, and the consumer checks nothing is
+  lost, duplicated or reordered
+ */
+#include <AP_gtest.h>
+
+#include <pthread.h>
+#include <sched.h>
+#include <AP_Common/AP_Common.h>
+#include <AP_HAL/utility/SPSCBuffer.h>
+#include <AP_Math/AP_Math.h>
+#include <AP_Math/pseudo_random.h>
+
+// bytes pushed through the buffer in each stress test
+#define STRESS_BYTES (4*1024*1024UL)
+
+static uint8_t seq_byte(uint32_t n)
+{
+    return (n * 7) ^ (n >> 11);
+}
+
+TEST(SPSCByteBufferTest, Basic)
+{
+    SPSCByteBuffer buf(10);
+    // rounded up to a power of two, all of which is usable
+    EXPECT_EQ(16U, buf.get_size());
+    EXPECT_EQ(16U, buf.space());
+    EXPECT_TRUE(buf.empty());
+
+    uint8_t data[20];
+    for (uint8_t i=0; i<sizeof(data); i++) {
+        data[i] = i;
+    }
+    EXPECT_EQ(16U, buf.write(data, sizeof(data)));
+    EXPECT_EQ(0U, buf.space());
+    EXPECT_EQ(16U, buf.available());
+    EXPECT_EQ(3, buf.peek(3));
+    EXPECT_EQ(-1, buf.peek(16));
+
+    uint8_t out[20];
+    EXPECT_EQ(10U, buf.read(out, 10));
+    EXPECT_EQ(0, memcmp(data, out, 10));
+
+    // now wraps around the end
+    EXPECT_EQ(10U, buf.write(data, 10));
+    SPSCByteBuffer::IoVec vec[2];
+    EXPECT_EQ(2, buf.peekiovec(vec, 16));
+    EXPECT_EQ(6U, vec[0].len);
+    EXPECT_EQ(10U, vec[1].len);
+    EXPECT_EQ(10, vec[0].data[0]);
+    EXPECT_EQ(0, vec[1].data[0]);
+
+    uint32_t n;
+    const uint8_t *p = buf.readptr(n);
+    EXPECT_EQ(6U, n);
+    EXPECT_EQ(10, p[0]);
+    EXPECT_TRUE(buf.advance(n));
+    EXPECT_FALSE(buf.advance(11));
+    uint8_t b;
+    EXPECT_TRUE(buf.read_byte(&b));
+    EXPECT_EQ(0, b);
+
+    buf.clear();
+    EXPECT_TRUE(buf.empty());
+    EXPECT_FALSE(buf.read_byte(&b));
+}
+
+static void *byte_producer(void *arg)
+{
+    SPSCByteBuffer &buf = *(SPSCByteBuffer *)arg;
+    PseudoRandom prng(1);
+    uint32_t n = 0;
+    uint8_t chunk[300];
+    while (n < STRESS_BYTES) {
+        const uint32_t len = MIN(prng.next_below(sizeof(chunk)) + 1, STRESS_BYTES - n);
+        if (prng.next_below(2)) {
+            for (uint32_t i=0; i<len; i++) {
+                chunk[i] = seq_byte(n + i);
+            }
+            const uint32_t written = buf.write(chunk, len);
+            if (written == 0) {
+                // let the consumer run on single core machines
+                sched_yield();
+            }
+            n += written;
+        } else {
+            SPSCByteBuffer::IoVec vec[2];
+            const uint8_t n_vec = buf.reserve(vec, len);
+            uint32_t written = 0;
+            for (uint8_t v=0; v<n_vec; v++) {
+                for (uint32_t i=0; i<vec[v].len; i++) {
+                    vec[v].data[i] = seq_byte(n + written++);
+                }
+            }
+            EXPECT_TRUE(buf.commit(written));
+            if (written == 0) {
+                sched_yield();
+            }
+            n += written;
+        }
+    }
+    return nullptr;
+}
+
+TEST(SPSCByteBufferTest, Stress)
+{
+    SPSCByteBuffer buf(256);
+    pthread_t thread;
+    ASSERT_EQ(0, pthread_create(&thread, nullptr, byte_producer, &buf));
+
+    PseudoRandom prng(2);
+    uint32_t n = 0;
+    uint32_t errors = 0;
+    uint8_t chunk[300];
+    while (n < STRESS_BYTES) {
+        uint32_t len = 0;
+        switch (prng.next_below(4)) {
+        case 0:
+            len = buf.read(chunk, prng.next_below(sizeof(chunk)) + 1);
+            break;
+        case 1: {
+            const uint8_t *p = buf.readptr(len);
+            if (len != 0) {
+                memcpy(chunk, p, MIN(len, sizeof(chunk)));
+                len = MIN(len, sizeof(chunk));
+                EXPECT_TRUE(buf.advance(len));
+            }
+            break;
+        }
+        case 2: {
+            SPSCByteBuffer::IoVec vec[2];
+            const uint8_t n_vec = buf.peekiovec(vec, sizeof(chunk));
+            for (uint8_t v=0; v<n_vec; v++) {
+                memcpy(&chunk[len], vec[v].data, vec[v].len);
+                len += vec[v].len;
+            }
+            EXPECT_TRUE(buf.advance(len));
+            break;
+        }
+        case 3:
+            if (buf.read_byte(&chunk[0])) {
+                len = 1;
+            }
+            break;
+        }
+        if (len == 0) {
+            sched_yield();
+        }
+        for (uint32_t i=0; i<len; i++) {
+            if (chunk[i] != seq_byte(n + i)) {
+                errors++;
+            }
+        }
+        n += len;
+    }
+    pthread_join(thread, nullptr);
+
+    EXPECT_EQ(0U, errors);
+    EXPECT_EQ(STRESS_BYTES, n);
+    EXPECT_TRUE(buf.empty());
+}
+
+// deliberately not a power of two in size, so objects wrap
+struct PACKED test_object {
+    uint32_t seq;
+    uint32_t check;
+    uint8_t pad[5];
+};
+
+static void *object_producer(void *arg)
+{
+    SPSCObjectBuffer<test_object> &buf = *(SPSCObjectBuffer<test_object> *)arg;
+    test_object objs[8];
+    const uint32_t count = STRESS_BYTES / sizeof(test_object);
+    uint32_t n = 0;
+    while (n < count) {
+        const uint32_t len = MIN((n % ARRAY_SIZE(objs)) + 1, count - n);
+        for (uint32_t i=0; i<len; i++) {
+            objs[i].seq = n + i;
+            objs[i].check = ~(n + i);
+        }
+        const uint32_t pushed = buf.push(objs, len);
+        if (pushed == 0) {
+            sched_yield();
+        }
+        n += pushed;
+    }
+    return nullptr;
+}
+
+TEST(SPSCObjectBufferTest, Stress)
+{
+    SPSCObjectBuffer<test_object> buf(20);
+    pthread_t thread;
+    ASSERT_EQ(0, pthread_create(&thread, nullptr, object_producer, &buf));
+
+    const uint32_t count = STRESS_BYTES / sizeof(test_object);
+    uint32_t n = 0;
+    uint32_t errors = 0;
+    test_object objs[5];
+    while (n < count) {
+        uint32_t len;
+        if (n & 1) {
+            len = buf.pop(objs[0]) ? 1 : 0;
+        } else {
+            len = buf.pop(objs, ARRAY_SIZE(objs));
+        }
+        if (len == 0) {
+            sched_yield();
+        }
+        for (uint32_t i=0; i<len; i++) {
+            if (objs[i].seq != n + i || objs[i].check != ~(n + i)) {
+                errors++;
+            }
+        }
+        n += len;
+    }
+    pthread_join(thread, nullptr);
+
+    EXPECT_EQ(0U, errors);
+    EXPECT_TRUE(buf.empty());
+}
+
+AP_GTEST_MAIN()
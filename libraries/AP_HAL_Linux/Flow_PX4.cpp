@@ -39,13 +39,23 @@
 #include <AP_HAL/AP_HAL.h>
 #if CONFIG_HAL_BOARD_SUBTYPE == HAL_BOARD_SUBTYPE_LINUX_BEBOP ||\
     CONFIG_HAL_BOARD_SUBTYPE == HAL_BOARD_SUBTYPE_LINUX_MINLURE ||\
-    CONFIG_HAL_BOARD_SUBTYPE == HAL_BOARD_SUBTYPE_LINUX_BBBMINI
+    CONFIG_HAL_BOARD_SUBTYPE == HAL_BOARD_SUBTYPE_LINUX_BBBMINI ||\
+    CONFIG_HAL_BOARD_SUBTYPE == HAL_BOARD_SUBTYPE_LINUX_NONE
 #include "Flow_PX4.h"
 
 #include <cmath>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define FLOW_PX4_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define FLOW_PX4_NEON 1
+#endif
 
 extern const AP_HAL::HAL& hal;
 
@@ -54,12 +64,19 @@ using namespace Linux;
 Flow_PX4::Flow_PX4(uint32_t width, uint32_t bytesperline,
                    uint32_t max_flow_pixel,
                    float bottom_flow_feature_threshold,
-                   float bottom_flow_value_threshold) :
+                   float bottom_flow_value_threshold,
+                   uint8_t num_threads, int thread_priority) :
     _width(width),
     _bytesperline(bytesperline),
     _search_size(max_flow_pixel),
     _bottom_flow_feature_threshold(bottom_flow_feature_threshold),
-    _bottom_flow_value_threshold(bottom_flow_value_threshold)
+    _bottom_flow_value_threshold(bottom_flow_value_threshold),
+    _image1(nullptr),
+    _image2(nullptr),
+    _num_threads(num_threads > 0 ? num_threads : 1),
+    _workers(nullptr),
+    _exit(false),
+    _next_row(0)
 {
     /* _pixlo is _search_size + 1 because if we need to evaluate
      * the subpixels up/left of the first pixel, the index
@@ -76,6 +93,38 @@ Flow_PX4::Flow_PX4(uint32_t width, uint32_t bytesperline,
      */
     _num_blocks = _width / (2 * _search_size + 3);
     _pixstep = ceil(((float)(_pixhi - _pixlo)) / _num_blocks);
+    /* the same pattern positions are used in both directions */
+    _num_rows = (_pixhi - _pixlo + _pixstep - 1) / _pixstep;
+
+    _results = new block_result[_num_rows * _num_rows];
+
+    if (_num_threads > 1) {
+        pthread_barrier_init(&_start_barrier, nullptr, _num_threads);
+        pthread_barrier_init(&_done_barrier, nullptr, _num_threads);
+        _workers = new Thread*[_num_threads - 1];
+        for (uint8_t t = 0; t < _num_threads - 1; t++) {
+            _workers[t] = new Thread(FUNCTOR_BIND_MEMBER(&Flow_PX4::_worker, void));
+            _workers[t]->start("flow", thread_priority > 0 ? SCHED_FIFO : SCHED_OTHER,
+                               thread_priority);
+        }
+    }
+}
+
+Flow_PX4::~Flow_PX4()
+{
+    if (_num_threads > 1) {
+        /* release the workers with nothing to do */
+        _exit = true;
+        pthread_barrier_wait(&_start_barrier);
+        for (uint8_t t = 0; t < _num_threads - 1; t++) {
+            _workers[t]->join();
+            delete _workers[t];
+        }
+        delete[] _workers;
+        pthread_barrier_destroy(&_start_barrier);
+        pthread_barrier_destroy(&_done_barrier);
+    }
+    delete[] _results;
 }
 
 /**
@@ -86,12 +135,12 @@ Flow_PX4::Flow_PX4(uint32_t width, uint32_t bytesperline,
  * @param offX x coordinate of upper left corner of 8x8 pattern in image
  * @param offY y coordinate of upper left corner of 8x8 pattern in image
  */
-static inline uint32_t compute_diff(uint8_t *image, uint16_t offx, uint16_t offy,
+static inline uint32_t compute_diff(const uint8_t *image, uint16_t offx, uint16_t offy,
                                     uint16_t row_size, uint8_t window_size)
 {
     /* calculate position in image buffer */
     /* we calc only the 4x4 pattern */
-    uint16_t off = (offy + 2) * row_size + (offx + 2);
+    uint32_t off = (offy + 2) * row_size + (offx + 2);
     uint32_t acc = 0;
     unsigned int i;
 
@@ -120,59 +169,71 @@ static inline uint32_t compute_diff(uint8_t *image, uint16_t offx, uint16_t offy
 /**
  * @brief Compute SAD of two pixel windows.
  *
- * @param image1 ...
- * @param image2 ...
- * @param off1X x coordinate of upper left corner of pattern in image1
- * @param off1Y y coordinate of upper left corner of pattern in image1
- * @param off2X x coordinate of upper left corner of pattern in image2
- * @param off2Y y coordinate of upper left corner of pattern in image2
+ * @param image1 upper left corner of pattern in image1
+ * @param image2 upper left corner of pattern in image2
  */
-static inline uint32_t compute_sad(uint8_t *image1, uint8_t *image2,
-                                   uint16_t off1x, uint16_t off1y,
-                                   uint16_t off2x, uint16_t off2y,
-                                   uint16_t row_size, uint16_t window_size)
+uint32_t Flow_PX4::compute_sad_scalar(const uint8_t *image1, const uint8_t *image2,
+                                      uint16_t row_size, uint16_t window_size)
 {
-    /* calculate position in image buffer
-     * off1 for image1 and off2 for image2
-     */
-    uint16_t off1 = off1y * row_size + off1x;
-    uint16_t off2 = off2y * row_size + off2x;
     unsigned int i,j;
     uint32_t acc = 0;
 
     for (i = 0; i < window_size; i++) {
         for (j = 0; j < window_size; j++) {
-            acc += abs(image1[off1 + i + j*row_size] -
-                       image2[off2 + i + j*row_size]);
+            acc += abs(image1[i + j*row_size] -
+                       image2[i + j*row_size]);
         }
     }
     return acc;
 }
 
+uint32_t Flow_PX4::compute_sad(const uint8_t *image1, const uint8_t *image2,
+                               uint16_t row_size, uint16_t window_size)
+{
+#if FLOW_PX4_SSE2
+    if (window_size == 8) {
+        /* two rows of 8 pixels per register */
+        __m128i acc = _mm_setzero_si128();
+        for (uint8_t j = 0; j < 8; j += 2) {
+            const __m128i a = _mm_unpacklo_epi64(
+                _mm_loadl_epi64((const __m128i *)&image1[j*row_size]),
+                _mm_loadl_epi64((const __m128i *)&image1[(j+1)*row_size]));
+            const __m128i b = _mm_unpacklo_epi64(
+                _mm_loadl_epi64((const __m128i *)&image2[j*row_size]),
+                _mm_loadl_epi64((const __m128i *)&image2[(j+1)*row_size]));
+            acc = _mm_add_epi32(acc, _mm_sad_epu8(a, b));
+        }
+        return _mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+    }
+#elif FLOW_PX4_NEON
+    if (window_size == 8) {
+        uint16x8_t acc = vdupq_n_u16(0);
+        for (uint8_t j = 0; j < 8; j++) {
+            acc = vabal_u8(acc, vld1_u8(&image1[j*row_size]),
+                           vld1_u8(&image2[j*row_size]));
+        }
+        const uint64x2_t sum = vpaddlq_u32(vpaddlq_u16(acc));
+        return vgetq_lane_u64(sum, 0) + vgetq_lane_u64(sum, 1);
+    }
+#endif
+    return compute_sad_scalar(image1, image2, row_size, window_size);
+}
+
 /**
  * @brief Compute SAD distances of subpixel shift of two pixel patterns.
  *
- * @param image1 ...
- * @param image2 ...
- * @param off1X x coordinate of upper left corner of pattern in image1
- * @param off1Y y coordinate of upper left corner of pattern in image1
- * @param off2X x coordinate of upper left corner of pattern in image2
- * @param off2Y y coordinate of upper left corner of pattern in image2
+ * @param image1 upper left corner of pattern in image1
+ * @param image2 upper left corner of pattern in image2
  * @param acc array to store SAD distances for shift in every direction
  */
-static inline uint32_t compute_subpixel(uint8_t *image1, uint8_t *image2,
-                                        uint16_t off1x, uint16_t off1y,
-                                        uint16_t off2x, uint16_t off2y,
-                                        uint32_t *acc, uint16_t row_size,
-                                        uint16_t window_size)
+void Flow_PX4::compute_subpixel_scalar(const uint8_t *image1, const uint8_t *image2,
+                                       uint32_t acc[8], uint16_t row_size,
+                                       uint16_t window_size)
 {
-    /* calculate position in image buffer */
-    uint16_t off1 = off1y * row_size + off1x; // image1
-    uint16_t off2 = off2y * row_size + off2x; // image2
     uint8_t sub[8];
     uint16_t i, j, k;
 
-    memset(acc, 0, window_size * sizeof(uint32_t));
+    memset(acc, 0, 8 * sizeof(uint32_t));
 
     for (i = 0; i < window_size; i++) {
         for (j = 0; j < window_size; j++) {
@@ -192,87 +253,179 @@ static inline uint32_t compute_subpixel(uint8_t *image1, uint8_t *image2,
              * the pixel down from it, and the pixel down on
              * the right. etc...
              */
-            sub[0] = (image2[off2 + i + j*row_size] +
-                      image2[off2 + i + 1 + j*row_size])/2;
+            sub[0] = (image2[i + j*row_size] +
+                      image2[i + 1 + j*row_size])/2;
 
-            sub[1] = (image2[off2 + i + j*row_size] +
-                      image2[off2 + i + 1 + j*row_size] +
-                      image2[off2 + i + (j+1)*row_size] +
-                      image2[off2 + i + 1 + (j+1)*row_size])/4;
+            sub[1] = (image2[i + j*row_size] +
+                      image2[i + 1 + j*row_size] +
+                      image2[i + (j+1)*row_size] +
+                      image2[i + 1 + (j+1)*row_size])/4;
 
-            sub[2] = (image2[off2 + i + j*row_size] +
-                      image2[off2 + i + 1 + (j+1)*row_size])/2;
+            sub[2] = (image2[i + j*row_size] +
+                      image2[i + 1 + (j+1)*row_size])/2;
 
-            sub[3] = (image2[off2 + i + j*row_size] +
-                      image2[off2 + i - 1 + j*row_size] +
-                      image2[off2 + i - 1 + (j+1)*row_size] +
-                      image2[off2 + i + (j+1)*row_size])/4;
+            sub[3] = (image2[i + j*row_size] +
+                      image2[i - 1 + j*row_size] +
+                      image2[i - 1 + (j+1)*row_size] +
+                      image2[i + (j+1)*row_size])/4;
 
-            sub[4] = (image2[off2 + i + j*row_size] +
-                      image2[off2 + i - 1 + (j+1)*row_size])/2;
+            sub[4] = (image2[i + j*row_size] +
+                      image2[i - 1 + (j+1)*row_size])/2;
 
-            sub[5] = (image2[off2 + i + j*row_size] +
-                      image2[off2 + i - 1 + j*row_size] +
-                      image2[off2 + i - 1 + (j-1)*row_size] +
-                      image2[off2 + i + (j-1)*row_size])/4;
+            sub[5] = (image2[i + j*row_size] +
+                      image2[i - 1 + j*row_size] +
+                      image2[i - 1 + (j-1)*row_size] +
+                      image2[i + (j-1)*row_size])/4;
 
-            sub[6] = (image2[off2 + i + j*row_size] +
-                      image2[off2 + i + (j-1)*row_size])/2;
+            sub[6] = (image2[i + j*row_size] +
+                      image2[i + (j-1)*row_size])/2;
 
-            sub[7] = (image2[off2 + i + j*row_size] +
-                      image2[off2 + i + 1 + j*row_size] +
-                      image2[off2 + i + (j-1)*row_size] +
-                      image2[off2 + i + 1 + (j-1)*row_size])/4;
+            sub[7] = (image2[i + j*row_size] +
+                      image2[i + 1 + j*row_size] +
+                      image2[i + (j-1)*row_size] +
+                      image2[i + 1 + (j-1)*row_size])/4;
 
             for (k = 0; k < 8; k++) {
-                acc[k] += abs(image1[off1 + i + j*row_size] - sub[k]);
+                acc[k] += abs(image1[i + j*row_size] - sub[k]);
             }
         }
     }
+}
 
-    return 0;
+void Flow_PX4::compute_subpixel(const uint8_t *image1, const uint8_t *image2,
+                                uint32_t acc[8], uint16_t row_size,
+                                uint16_t window_size)
+{
+#if FLOW_PX4_SSE2
+    if (window_size == 8) {
+        /* a row of 8 pixels at a time, widened to 16 bits so the
+         * means are truncated the same way as the scalar version.
+         * The means are narrowed again to use psadbw for the sums */
+        const __m128i zero = _mm_setzero_si128();
+        __m128i sums[8];
+        for (uint8_t k = 0; k < 8; k++) {
+            sums[k] = zero;
+        }
+#define LOAD16(p) _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(p)), zero)
+        for (uint8_t j = 0; j < 8; j++) {
+            const uint8_t *row = &image2[j*row_size];
+            const __m128i c  = LOAD16(row);
+            const __m128i r  = LOAD16(row + 1);
+            const __m128i l  = LOAD16(row - 1);
+            const __m128i u  = LOAD16(row - row_size);
+            const __m128i ur = LOAD16(row - row_size + 1);
+            const __m128i ul = LOAD16(row - row_size - 1);
+            const __m128i d  = LOAD16(row + row_size);
+            const __m128i dr = LOAD16(row + row_size + 1);
+            const __m128i dl = LOAD16(row + row_size - 1);
+            const __m128i cr = _mm_add_epi16(c, r);
+            const __m128i cl = _mm_add_epi16(c, l);
+            __m128i sub[8];
+            sub[0] = _mm_srli_epi16(cr, 1);
+            sub[1] = _mm_srli_epi16(_mm_add_epi16(cr, _mm_add_epi16(d, dr)), 2);
+            sub[2] = _mm_srli_epi16(_mm_add_epi16(c, dr), 1);
+            sub[3] = _mm_srli_epi16(_mm_add_epi16(cl, _mm_add_epi16(dl, d)), 2);
+            sub[4] = _mm_srli_epi16(_mm_add_epi16(c, dl), 1);
+            sub[5] = _mm_srli_epi16(_mm_add_epi16(cl, _mm_add_epi16(ul, u)), 2);
+            sub[6] = _mm_srli_epi16(_mm_add_epi16(c, u), 1);
+            sub[7] = _mm_srli_epi16(_mm_add_epi16(cr, _mm_add_epi16(u, ur)), 2);
+            const __m128i p1 = _mm_loadl_epi64((const __m128i *)&image1[j*row_size]);
+            for (uint8_t k = 0; k < 8; k++) {
+                sums[k] = _mm_add_epi32(sums[k], _mm_sad_epu8(p1, _mm_packus_epi16(sub[k], zero)));
+            }
+        }
+#undef LOAD16
+        for (uint8_t k = 0; k < 8; k++) {
+            acc[k] = _mm_cvtsi128_si32(sums[k]);
+        }
+        return;
+    }
+#elif FLOW_PX4_NEON
+    if (window_size == 8) {
+        /* vhadd_u8 truncates like the scalar version, and the 4 pixel
+         * means are summed in 16 bits */
+        uint16x8_t sums[8];
+        for (uint8_t k = 0; k < 8; k++) {
+            sums[k] = vdupq_n_u16(0);
+        }
+        for (uint8_t j = 0; j < 8; j++) {
+            const uint8_t *row = &image2[j*row_size];
+            const uint8x8_t c  = vld1_u8(row);
+            const uint8x8_t r  = vld1_u8(row + 1);
+            const uint8x8_t l  = vld1_u8(row - 1);
+            const uint8x8_t u  = vld1_u8(row - row_size);
+            const uint8x8_t ur = vld1_u8(row - row_size + 1);
+            const uint8x8_t ul = vld1_u8(row - row_size - 1);
+            const uint8x8_t d  = vld1_u8(row + row_size);
+            const uint8x8_t dr = vld1_u8(row + row_size + 1);
+            const uint8x8_t dl = vld1_u8(row + row_size - 1);
+            const uint16x8_t cr = vaddl_u8(c, r);
+            const uint16x8_t cl = vaddl_u8(c, l);
+            uint8x8_t sub[8];
+            sub[0] = vhadd_u8(c, r);
+            sub[1] = vshrn_n_u16(vaddq_u16(cr, vaddl_u8(d, dr)), 2);
+            sub[2] = vhadd_u8(c, dr);
+            sub[3] = vshrn_n_u16(vaddq_u16(cl, vaddl_u8(dl, d)), 2);
+            sub[4] = vhadd_u8(c, dl);
+            sub[5] = vshrn_n_u16(vaddq_u16(cl, vaddl_u8(ul, u)), 2);
+            sub[6] = vhadd_u8(c, u);
+            sub[7] = vshrn_n_u16(vaddq_u16(cr, vaddl_u8(u, ur)), 2);
+            const uint8x8_t p1 = vld1_u8(&image1[j*row_size]);
+            for (uint8_t k = 0; k < 8; k++) {
+                sums[k] = vabal_u8(sums[k], p1, sub[k]);
+            }
+        }
+        for (uint8_t k = 0; k < 8; k++) {
+            const uint64x2_t sum = vpaddlq_u32(vpaddlq_u16(sums[k]));
+            acc[k] = vgetq_lane_u64(sum, 0) + vgetq_lane_u64(sum, 1);
+        }
+        return;
+    }
+#endif
+    compute_subpixel_scalar(image1, image2, acc, row_size, window_size);
 }
 
-uint8_t Flow_PX4::compute_flow(uint8_t *image1, uint8_t *image2,
-                               uint32_t delta_time, float *pixel_flow_x,
-                               float *pixel_flow_y)
+/*
+ * match the patterns of each block row handed out by _next_row,
+ * storing a result per block. Runs on the calling thread and the
+ * workers at the same time
+ */
+void Flow_PX4::_compute_rows()
 {
-    /* constants */
     const int16_t winmin = -_search_size;
     const int16_t winmax = _search_size;
-    uint16_t i, j;
-    uint32_t acc[2*_search_size];
-    int8_t dirsx[_num_blocks*_num_blocks];
-    int8_t dirsy[_num_blocks*_num_blocks];
-    uint8_t subdirs[_num_blocks*_num_blocks];
-    float meanflowx = 0.0f;
-    float meanflowy = 0.0f;
-    uint16_t meancount = 0;
-    float histflowx = 0.0f;
-    float histflowy = 0.0f;
+    const uint16_t window_size = 2 * _search_size;
+    uint32_t acc[8];
+    uint32_t row;
+
+    while ((row = __atomic_fetch_add(&_next_row, 1, __ATOMIC_RELAXED)) < _num_rows) {
+        const uint16_t j = _pixlo + row * _pixstep;
+        block_result *results = &_results[row * _num_rows];
+
+        for (uint8_t col = 0; col < _num_rows; col++) {
+            const uint16_t i = _pixlo + col * _pixstep;
+            block_result &result = results[col];
+            result.valid = false;
 
-    /* iterate over all patterns
-     */
-    for (j = _pixlo; j < _pixhi; j += _pixstep) {
-        for (i = _pixlo; i < _pixhi; i += _pixstep) {
             /* test pixel if it is suitable for flow tracking */
-            uint32_t diff = compute_diff(image1, i, j, (uint16_t) _bytesperline,
+            uint32_t diff = compute_diff(_image1, i, j, (uint16_t) _bytesperline,
                                          _search_size);
             if (diff < _bottom_flow_feature_threshold) {
                 continue;
             }
 
+            const uint8_t *pattern = &_image1[j * _bytesperline + i];
             uint32_t dist = 0xFFFFFFFF; // set initial distance to "infinity"
             int8_t sumx = 0;
             int8_t sumy = 0;
             int8_t ii, jj;
 
             for (jj = winmin; jj <= winmax; jj++) {
+                const uint8_t *search = &_image2[(j + jj) * _bytesperline + i];
                 for (ii = winmin; ii <= winmax; ii++) {
-                    uint32_t temp_dist = compute_sad(image1, image2, i, j,
-                                                     i + ii, j + jj,
+                    uint32_t temp_dist = compute_sad(pattern, search + ii,
                                                      (uint16_t)_bytesperline,
-                                                     2 * _search_size);
+                                                     window_size);
                     if (temp_dist < dist) {
                         sumx = ii;
                         sumy = jj;
@@ -283,57 +436,96 @@ uint8_t Flow_PX4::compute_flow(uint8_t *image1, uint8_t *image2,
 
             /* acceptance SAD distance threshold */
             if (dist < _bottom_flow_value_threshold) {
-                meanflowx += (float)sumx;
-                meanflowy += (float) sumy;
-
-                compute_subpixel(image1, image2, i, j, i + sumx, j + sumy,
-                                 acc, (uint16_t) _bytesperline,
-                                 2 * _search_size);
+                compute_subpixel(pattern,
+                                 &_image2[(j + sumy) * _bytesperline + i + sumx],
+                                 acc, (uint16_t) _bytesperline, window_size);
                 uint32_t mindist = dist; // best SAD until now
                 uint8_t mindir = 8; // direction 8 for no direction
-                for (uint8_t k = 0; k < 2 * _search_size; k++) {
+                for (uint8_t k = 0; k < 8; k++) {
                     if (acc[k] < mindist) {
                         // SAD becomes better in direction k
                         mindist = acc[k];
                         mindir = k;
                     }
                 }
-                dirsx[meancount] = sumx;
-                dirsy[meancount] = sumy;
-                subdirs[meancount] = mindir;
-                meancount++;
+                result.valid = true;
+                result.dirx = sumx;
+                result.diry = sumy;
+                result.subdir = mindir;
             }
         }
     }
+}
+
+void Flow_PX4::_worker()
+{
+    while (true) {
+        pthread_barrier_wait(&_start_barrier);
+        if (_exit) {
+            return;
+        }
+        _compute_rows();
+        pthread_barrier_wait(&_done_barrier);
+    }
+}
+
+uint8_t Flow_PX4::compute_flow(uint8_t *image1, uint8_t *image2,
+                               uint32_t delta_time, float *pixel_flow_x,
+                               float *pixel_flow_y)
+{
+    float histflowx = 0.0f;
+    float histflowy = 0.0f;
+    uint16_t meancount = 0;
+
+    /* iterate over all patterns, sharing the block rows out between
+     * the threads. The barriers also order the memory accesses
+     */
+    _image1 = image1;
+    _image2 = image2;
+    _next_row = 0;
+    if (_num_threads > 1) {
+        pthread_barrier_wait(&_start_barrier);
+    }
+    _compute_rows();
+    if (_num_threads > 1) {
+        pthread_barrier_wait(&_done_barrier);
+    }
+
+    for (uint16_t h = 0; h < _num_rows * _num_rows; h++) {
+        if (_results[h].valid) {
+            meancount++;
+        }
+    }
 
     /* evaluate flow calculation */
     if (meancount > _num_blocks * _num_blocks / 2) {
-        meanflowx /= meancount;
-        meanflowy /= meancount;
-
         /* use average of accepted flow values */
         uint32_t meancount_x = 0;
         uint32_t meancount_y = 0;
 
-        for (uint16_t h = 0; h < meancount; h++) {
+        for (uint16_t h = 0; h < _num_rows * _num_rows; h++) {
+            const block_result &result = _results[h];
+            if (!result.valid) {
+                continue;
+            }
             float subdirx = 0.0f;
-            if (subdirs[h] == 0 || subdirs[h] == 1 || subdirs[h] == 7) {
+            if (result.subdir == 0 || result.subdir == 1 || result.subdir == 7) {
                 subdirx = 0.5f;
             }
-            if (subdirs[h] == 3 || subdirs[h] == 4 || subdirs[h] == 5) {
+            if (result.subdir == 3 || result.subdir == 4 || result.subdir == 5) {
                 subdirx = -0.5f;
             }
-            histflowx += (float)dirsx[h] + subdirx;
+            histflowx += (float)result.dirx + subdirx;
             meancount_x++;
 
             float subdiry = 0.0f;
-            if (subdirs[h] == 5 || subdirs[h] == 6 || subdirs[h] == 7) {
+            if (result.subdir == 5 || result.subdir == 6 || result.subdir == 7) {
                 subdiry = -0.5f;
             }
-            if (subdirs[h] == 1 || subdirs[h] == 2 || subdirs[h] == 3) {
+            if (result.subdir == 1 || result.subdir == 2 || result.subdir == 3) {
                 subdiry = 0.5f;
             }
-            histflowy += (float)dirsy[h] + subdiry;
+            histflowy += (float)result.diry + subdiry;
             meancount_y++;
         }
 
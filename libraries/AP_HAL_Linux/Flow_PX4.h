@@ -15,6 +15,11 @@
 #pragma once
 
 #include "AP_HAL_Linux.h"
+#include "Thread.h"
+
+#ifndef HAL_FLOW_PX4_NUM_THREADS
+#define HAL_FLOW_PX4_NUM_THREADS 1
+#endif
 
 namespace Linux {
 
@@ -23,10 +28,39 @@ public:
     Flow_PX4(uint32_t width, uint32_t bytesperline,
              uint32_t max_flow_pixel,
              float bottom_flow_feature_threshold,
-             float bottom_flow_value_threshold);
+             float bottom_flow_value_threshold,
+             uint8_t num_threads = 1, int thread_priority = 0);
+    ~Flow_PX4();
     uint8_t compute_flow(uint8_t *image1, uint8_t *image2, uint32_t delta_time,
                          float *pixel_flow_x, float *pixel_flow_y);
+
+    /*
+     * block matching kernels. compute_sad() and compute_subpixel() use
+     * SSE2 or NEON for 8x8 windows where available, the _scalar
+     * versions are the reference they are tested against
+     */
+    static uint32_t compute_sad(const uint8_t *image1, const uint8_t *image2,
+                                uint16_t row_size, uint16_t window_size);
+    static uint32_t compute_sad_scalar(const uint8_t *image1, const uint8_t *image2,
+                                       uint16_t row_size, uint16_t window_size);
+    static void compute_subpixel(const uint8_t *image1, const uint8_t *image2,
+                                 uint32_t acc[8], uint16_t row_size,
+                                 uint16_t window_size);
+    static void compute_subpixel_scalar(const uint8_t *image1, const uint8_t *image2,
+                                        uint32_t acc[8], uint16_t row_size,
+                                        uint16_t window_size);
+
 private:
+    struct block_result {
+        bool valid;
+        int8_t dirx;
+        int8_t diry;
+        uint8_t subdir;
+    };
+
+    void _compute_rows();
+    void _worker();
+
     uint32_t _width;
     uint32_t _search_size;
     uint32_t _bytesperline;
@@ -36,6 +70,21 @@ private:
     uint16_t _pixhi;
     uint16_t _pixstep;
     uint8_t  _num_blocks;
+    uint8_t  _num_rows;
+
+    /* frame being worked on, and a result per block */
+    const uint8_t *_image1;
+    const uint8_t *_image2;
+    block_result *_results;
+
+    /* block rows are handed out to the calling thread and the workers
+     * one at a time */
+    uint8_t _num_threads;
+    Thread **_workers;
+    pthread_barrier_t _start_barrier;
+    pthread_barrier_t _done_barrier;
+    volatile bool _exit;
+    uint32_t _next_row;
 };
 
 }
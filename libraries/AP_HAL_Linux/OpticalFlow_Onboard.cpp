@@ -115,6 +115,7 @@ void OpticalFlow_Onboard::init(AP_HAL::OpticalFlow::Gyro_Cb get_gyro)
                               &_sizeimage)) {
         AP_HAL::panic("OpticalFlow_Onboard: couldn't set video format");
     }
+    _camera_bytesperline = _bytesperline;
 
     if (_format != V4L2_PIX_FMT_NV12 && _format != V4L2_PIX_FMT_GREY &&
         _format != V4L2_PIX_FMT_YUYV) {
@@ -157,6 +158,21 @@ void OpticalFlow_Onboard::init(AP_HAL::OpticalFlow::Gyro_Cb get_gyro)
         }
     }
 
+    /* frames needing any conversion are converted to 8bpp frames of
+     * _width x _height in the frame pool, which compute_flow() then reads */
+    if (_format == V4L2_PIX_FMT_YUYV || _shrink_by_software ||
+        _crop_by_software) {
+        _bytesperline = _width;
+        _frame_pool = (uint8_t *)malloc(2 * _width * _height);
+        if (!_frame_pool) {
+            AP_HAL::panic("OpticalFlow_Onboard: couldn't allocate frame pool\n");
+        }
+        _frame_pool_index = 0;
+    }
+
+    _perf_convert = hal.util->perf_alloc(AP_HAL::Util::PC_ELAPSED, "optflow_convert");
+    _perf_flow = hal.util->perf_alloc(AP_HAL::Util::PC_ELAPSED, "optflow_flow");
+
     if (!_videoin->allocate_buffers(nbufs)) {
         AP_HAL::panic("OpticalFlow_Onboard: couldn't allocate video buffers");
     }
@@ -167,7 +183,9 @@ void OpticalFlow_Onboard::init(AP_HAL::OpticalFlow::Gyro_Cb get_gyro)
     _flow = new Flow_PX4(_width, _bytesperline,
                          HAL_FLOW_PX4_MAX_FLOW_PIXEL,
                          HAL_FLOW_PX4_BOTTOM_FLOW_FEATURE_THRESHOLD,
-                         HAL_FLOW_PX4_BOTTOM_FLOW_VALUE_THRESHOLD);
+                         HAL_FLOW_PX4_BOTTOM_FLOW_VALUE_THRESHOLD,
+                         HAL_FLOW_PX4_NUM_THREADS,
+                         OPTICAL_FLOW_ONBOARD_RTPRIO);
 
     /* Create the thread that will be waiting for frames
      * Initialize thread and mutex */
@@ -232,40 +250,12 @@ void OpticalFlow_Onboard::_run_optflow()
     Vector3f gyro_rate;
     Vector2f flow_rate;
     VideoIn::Frame video_frame;
-    uint32_t convert_buffer_size = 0, output_buffer_size = 0;
-    uint32_t crop_left = 0, crop_top = 0;
-    uint32_t shrink_scale = 0, shrink_width = 0, shrink_height = 0;
-    uint32_t shrink_width_offset = 0, shrink_height_offset = 0;
-    uint8_t *convert_buffer = nullptr, *output_buffer = nullptr;
+    uint32_t left = 0, top = 0;
+    uint32_t selection_width = _width, selection_height = _height;
+    uint32_t shrink_scale = 1;
+    const uint32_t frame_size = _width * _height;
     uint8_t qual;
 
-    if (_format == V4L2_PIX_FMT_YUYV) {
-        if (_shrink_by_software || _crop_by_software) {
-            convert_buffer_size = _camera_output_width * _camera_output_height;
-        } else {
-            convert_buffer_size = _width * _height;
-        }
-
-        convert_buffer = (uint8_t *)malloc(convert_buffer_size);
-        if (!convert_buffer) {
-            AP_HAL::panic("OpticalFlow_Onboard: couldn't allocate conversion buffer\n");
-        }
-    }
-
-    if (_shrink_by_software || _crop_by_software) {
-        output_buffer_size = HAL_OPTFLOW_ONBOARD_OUTPUT_WIDTH *
-            HAL_OPTFLOW_ONBOARD_OUTPUT_HEIGHT;
-
-        output_buffer = (uint8_t *)malloc(output_buffer_size);
-        if (!output_buffer) {
-            if (convert_buffer) {
-                free(convert_buffer);
-            }
-
-            AP_HAL::panic("OpticalFlow_Onboard: couldn't allocate crop buffer\n");
-        }
-    }
-
     if (_shrink_by_software) {
         if (_camera_output_width > _camera_output_height) {
             shrink_scale = (uint32_t) _camera_output_height /
@@ -275,58 +265,41 @@ void OpticalFlow_Onboard::_run_optflow()
                 HAL_OPTFLOW_ONBOARD_OUTPUT_WIDTH;
         }
 
-        shrink_width = HAL_OPTFLOW_ONBOARD_OUTPUT_WIDTH * shrink_scale;
-        shrink_height = HAL_OPTFLOW_ONBOARD_OUTPUT_HEIGHT * shrink_scale;
+        selection_width = HAL_OPTFLOW_ONBOARD_OUTPUT_WIDTH * shrink_scale;
+        selection_height = HAL_OPTFLOW_ONBOARD_OUTPUT_HEIGHT * shrink_scale;
 
-        shrink_width_offset = (_camera_output_width - shrink_width) / 2;
-        shrink_height_offset = (_camera_output_height - shrink_height) / 2;
+        left = (_camera_output_width - selection_width) / 2;
+        top = (_camera_output_height - selection_height) / 2;
     } else if (_crop_by_software) {
-        crop_left = _camera_output_width / 2 -
+        left = _camera_output_width / 2 -
            HAL_OPTFLOW_ONBOARD_OUTPUT_WIDTH / 2;
-        crop_top = _camera_output_height / 2 -
+        top = _camera_output_height / 2 -
            HAL_OPTFLOW_ONBOARD_OUTPUT_HEIGHT / 2;
     }
 
     while(true) {
         /* wait for next frame to come */
         if (!_videoin->get_frame(video_frame)) {
-            if (convert_buffer) {
-               free(convert_buffer);
-            }
-
-            if (output_buffer) {
-               free(output_buffer);
-            }
-
             AP_HAL::panic("OpticalFlow_Onboard: couldn't get frame\n");
         }
 
-        if (_format == V4L2_PIX_FMT_YUYV) {
-            VideoIn::yuyv_to_grey((uint8_t *)video_frame.data,
-                convert_buffer_size * 2, convert_buffer);
-
-            memset(video_frame.data, 0, convert_buffer_size * 2);
-            memcpy(video_frame.data, convert_buffer, convert_buffer_size);
-        }
-
-        if (_shrink_by_software) {
-            /* shrink_8bpp() will shrink a selected area using the offsets,
-             * therefore, we don't need the crop. */
-            VideoIn::shrink_8bpp((uint8_t *)video_frame.data, output_buffer,
-                                 _camera_output_width, _camera_output_height,
-                                 shrink_width_offset, shrink_width,
-                                 shrink_height_offset, shrink_height,
-                                 shrink_scale, shrink_scale);
-            memset(video_frame.data, 0, _camera_output_width * _camera_output_height);
-            memcpy(video_frame.data, output_buffer, output_buffer_size);
-        } else if (_crop_by_software) {
-            VideoIn::crop_8bpp((uint8_t *)video_frame.data, output_buffer,
-                               _camera_output_width,
-                               crop_left, HAL_OPTFLOW_ONBOARD_OUTPUT_WIDTH,
-                               crop_top, HAL_OPTFLOW_ONBOARD_OUTPUT_HEIGHT);
-
-            memset(video_frame.data, 0, _camera_output_width * _camera_output_height);
-            memcpy(video_frame.data, output_buffer, output_buffer_size);
+        if (_frame_pool) {
+            /* crop, shrink and greyscale in one pass straight into the
+             * pool, after which the camera buffer isn't needed any more.
+             * shrink_scale is 1 when only cropping. */
+            uint8_t *frame = &_frame_pool[_frame_pool_index * frame_size];
+
+            hal.util->perf_begin(_perf_convert);
+            VideoIn::crop_shrink_8bpp((const uint8_t *)video_frame.data,
+                                      frame, _format, _camera_bytesperline,
+                                      left, selection_width,
+                                      top, selection_height,
+                                      shrink_scale, shrink_scale);
+            hal.util->perf_end(_perf_convert);
+
+            _videoin->put_frame(video_frame);
+            video_frame.data = frame;
+            _frame_pool_index ^= 1;
         }
 
         /* if it is at least the second frame we receive
@@ -347,7 +320,7 @@ void OpticalFlow_Onboard::_run_optflow()
                 | O_APPEND, S_IRUSR | S_IWUSR | S_IRGRP |
                 S_IWGRP | S_IROTH | S_IWOTH);
 	    if (fd != -1) {
-	        write(fd, video_frame.data, _sizeimage);
+	        write(fd, video_frame.data, _frame_pool ? frame_size : _sizeimage);
 #ifdef OPTICALFLOW_ONBOARD_RECORD_METADATAS
             struct PACKED {
                 uint32_t timestamp;
@@ -364,11 +337,13 @@ void OpticalFlow_Onboard::_run_optflow()
         /* compute gyro data and video frames
          * get flow rate to send it to the opticalflow driver
          */
+        hal.util->perf_begin(_perf_flow);
         qual = _flow->compute_flow((uint8_t*)_last_video_frame.data,
                                    (uint8_t *)video_frame.data,
                                    video_frame.timestamp -
                                    _last_video_frame.timestamp,
                                    &flow_rate.x, &flow_rate.y);
+        hal.util->perf_end(_perf_flow);
 
         /* fill data frame for upper layers */
         pthread_mutex_lock(&_mutex);
@@ -388,18 +363,13 @@ void OpticalFlow_Onboard::_run_optflow()
         _data_available = true;
         pthread_mutex_unlock(&_mutex);
 
-        /* give the last frame back to the video input driver */
-        _videoin->put_frame(_last_video_frame);
+        /* give the last frame back to the video input driver, unless
+         * it was converted and given back already */
+        if (!_frame_pool) {
+            _videoin->put_frame(_last_video_frame);
+        }
         _last_video_frame = video_frame;
         _last_gyro_rate = gyro_rate;
     }
-
-    if (convert_buffer) {
-        free(convert_buffer);
-    }
-
-    if (output_buffer) {
-        free(output_buffer);
-    }
 }
 #endif
@@ -52,7 +52,14 @@ private:
     uint32_t _height;
     uint32_t _format;
     uint32_t _bytesperline;
+    uint32_t _camera_bytesperline;
     uint32_t _sizeimage;
+    /* converted frames, used in turn so the last one is kept for
+     * compute_flow() while the camera buffers go back to the driver */
+    uint8_t *_frame_pool = nullptr;
+    uint8_t _frame_pool_index;
+    AP_HAL::Util::perf_counter_t _perf_convert;
+    AP_HAL::Util::perf_counter_t _perf_flow;
     float _pixel_flow_x_integral;
     float _pixel_flow_y_integral;
     float _gyro_x_integral;
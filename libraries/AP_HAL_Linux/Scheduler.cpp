@@ -465,8 +465,112 @@ bool Scheduler::SchedulerThread::_run()
     return PeriodicThread::_run();
 }
 
+/*
+  start enough pinned worker threads for run_parallel() to run count
+  procs in addition to the calling thread
+ */
+bool Scheduler::_start_parallel_workers(uint8_t count)
+{
+    if (_num_cpus == 0) {
+        _num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (_num_cpus < 2 || count > LINUX_SCHEDULER_MAX_PARALLEL_WORKERS) {
+        return false;
+    }
+
+    while (_num_parallel_workers < count) {
+        ParallelWorker &worker = _parallel_worker[_num_parallel_workers];
+        char name[16];
+        snprintf(name, sizeof(name), "ap-parallel-%u", _num_parallel_workers);
+        worker.sched = this;
+        worker.index = _num_parallel_workers;
+        worker.set_stack_size(256 * 1024);
+        if (!worker.start(name, SCHED_FIFO, APM_LINUX_MAIN_PRIORITY)) {
+            return false;
+        }
+        _num_parallel_workers++;
+    }
+    return true;
+}
+
+bool Scheduler::ParallelWorker::_run()
+{
+    // the calling thread is left free to float, workers take the other CPUs
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET((index + 1) % sched->_num_cpus, &cpus);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+
+    sched->_parallel_worker_loop(index);
+    return true;
+}
+
+void Scheduler::_parallel_worker_loop(uint8_t index)
+{
+    const uint8_t proc_index = index + 1;
+
+    pthread_mutex_lock(&_parallel_mutex);
+    uint32_t generation = 0;
+    while (true) {
+        while (generation == _parallel_generation && !_parallel_exit) {
+            pthread_cond_wait(&_parallel_start, &_parallel_mutex);
+        }
+        if (_parallel_exit) {
+            break;
+        }
+        generation = _parallel_generation;
+        if (proc_index >= _parallel_count) {
+            continue;
+        }
+        AP_HAL::IndexedProc proc = _parallel_proc;
+        pthread_mutex_unlock(&_parallel_mutex);
+
+        proc(proc_index);
+
+        pthread_mutex_lock(&_parallel_mutex);
+        if (--_parallel_pending == 0) {
+            pthread_cond_signal(&_parallel_done);
+        }
+    }
+    pthread_mutex_unlock(&_parallel_mutex);
+}
+
+bool Scheduler::run_parallel(AP_HAL::IndexedProc proc, uint8_t count)
+{
+    if (count < 2 || !_start_parallel_workers(count - 1)) {
+        return false;
+    }
+
+    pthread_mutex_lock(&_parallel_mutex);
+    _parallel_proc = proc;
+    _parallel_count = count;
+    _parallel_pending = count - 1;
+    _parallel_generation++;
+    pthread_cond_broadcast(&_parallel_start);
+    pthread_mutex_unlock(&_parallel_mutex);
+
+    proc(0);
+
+    // wait for all of the workers before returning
+    pthread_mutex_lock(&_parallel_mutex);
+    while (_parallel_pending != 0) {
+        pthread_cond_wait(&_parallel_done, &_parallel_mutex);
+    }
+    pthread_mutex_unlock(&_parallel_mutex);
+
+    return true;
+}
+
 void Scheduler::teardown()
 {
+    pthread_mutex_lock(&_parallel_mutex);
+    _parallel_exit = true;
+    pthread_cond_broadcast(&_parallel_start);
+    pthread_mutex_unlock(&_parallel_mutex);
+    for (uint8_t i = 0; i < _num_parallel_workers; i++) {
+        _parallel_worker[i].join();
+    }
+
     _timer_thread.stop();
     _io_thread.stop();
     _rcin_thread.stop();
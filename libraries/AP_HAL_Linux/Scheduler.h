@@ -9,6 +9,7 @@
 #define LINUX_SCHEDULER_MAX_TIMER_PROCS 10
 #define LINUX_SCHEDULER_MAX_TIMESLICED_PROCS 10
 #define LINUX_SCHEDULER_MAX_IO_PROCS 10
+#define LINUX_SCHEDULER_MAX_PARALLEL_WORKERS 3
 
 #define AP_LINUX_SENSORS_STACK_SIZE  256 * 1024
 #define AP_LINUX_SENSORS_SCHED_POLICY  SCHED_FIFO
@@ -50,6 +51,8 @@ public:
 
     void microsleep(uint32_t usec);
 
+    bool run_parallel(AP_HAL::IndexedProc proc, uint8_t count) override;
+
     void teardown();
 
 private:
@@ -66,8 +69,28 @@ private:
         Scheduler &_sched;
     };
 
+    /*
+      worker thread for run_parallel(), pinned to its own CPU. Worker
+      n runs proc(n+1) while the calling thread runs proc(0)
+     */
+    class ParallelWorker : public Thread {
+    public:
+        ParallelWorker()
+            : Thread(nullptr)
+        { }
+
+        Scheduler *sched;
+        uint8_t index;
+
+    protected:
+        bool _run() override;
+    };
+
     void _wait_all_threads();
 
+    bool _start_parallel_workers(uint8_t count);
+    void _parallel_worker_loop(uint8_t index);
+
     void     _debug_stack();
 
     AP_HAL::Proc _delay_cb;
@@ -116,6 +139,20 @@ private:
 
     Semaphore _timer_semaphore;
     Semaphore _io_semaphore;
+
+    ParallelWorker _parallel_worker[LINUX_SCHEDULER_MAX_PARALLEL_WORKERS];
+    uint8_t _num_parallel_workers;
+    int _num_cpus;
+
+    // protects the members below, which describe the current run_parallel() call
+    pthread_mutex_t _parallel_mutex = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t _parallel_start = PTHREAD_COND_INITIALIZER;
+    pthread_cond_t _parallel_done = PTHREAD_COND_INITIALIZER;
+    AP_HAL::IndexedProc _parallel_proc;
+    uint8_t _parallel_count;
+    uint8_t _parallel_pending;
+    uint32_t _parallel_generation;
+    bool _parallel_exit;
 };
 
 }
@@ -19,13 +19,12 @@ using namespace Linux;
  */
 
 // name the storage file after the sketch so you can use the same board
-// card for ArduCopter and ArduPlane
-#if CONFIG_HAL_BOARD_SUBTYPE == HAL_BOARD_SUBTYPE_LINUX_BEBOP || CONFIG_HAL_BOARD_SUBTYPE == HAL_BOARD_SUBTYPE_LINUX_DISCO
-#define STORAGE_DIR "/data/ftp/internal_000/APM"
-#elif APM_BUILD_TYPE(APM_BUILD_Replay)
+// card for ArduCopter and ArduPlane. Replay keeps it in its working
+// directory, so replays run side by side don't share one
+#if APM_BUILD_TYPE(APM_BUILD_Replay)
 #define STORAGE_DIR "."
 #else
-#define STORAGE_DIR "/var/APM"
+#define STORAGE_DIR HAL_BOARD_STORAGE_DIRECTORY
 #endif
 #define STORAGE_FILE STORAGE_DIR "/" SKETCHNAME ".stg"
 
@@ -89,24 +88,26 @@ void Storage::_storage_open(void)
         }
     }
     close(fd);
+    _perf_flush = hal.util->perf_alloc(AP_HAL::Util::PC_ELAPSED, "storage_flush");
     _initialised = true;
 }
 
 /*
-  mark some lines as dirty. Note that there is no attempt to avoid
-  the race condition between this code and the _timer_tick() code
-  below, which both update _dirty_mask. If we lose the race then the
-  result is that a line is written more than once, but it won't result
-  in a line not being written.
+  mark some lines as dirty. This and the flush in _timer_tick() both
+  update _dirty_mask, so it is only changed with atomic operations. A
+  line marked dirty while it is being written is written again on the
+  next tick.
  */
 void Storage::_mark_dirty(uint16_t loc, uint16_t length)
 {
-    uint16_t end = loc + length;
+    uint16_t end = loc + length - 1;
+    uint32_t mask = 0;
     for (uint8_t line=loc>>LINUX_STORAGE_LINE_SHIFT;
          line <= end>>LINUX_STORAGE_LINE_SHIFT;
          line++) {
-        _dirty_mask |= 1U << line;
+        mask |= 1U << line;
     }
+    __atomic_fetch_or(&_dirty_mask, mask, __ATOMIC_RELAXED);
 }
 
 void Storage::read_block(void *dst, uint16_t loc, size_t n)
@@ -127,6 +128,7 @@ void Storage::write_block(uint16_t loc, const void *src, size_t n)
         _storage_open();
         memcpy(&_buffer[loc], src, n);
         _mark_dirty(loc, n);
+        _bytes_changed += n;
     }
 }
 
@@ -136,6 +138,22 @@ void Storage::_timer_tick(void)
         return;
     }
 
+    hal.util->perf_begin(_perf_flush);
+#if HAL_LINUX_STORAGE_ATOMIC_WRITE
+    _flush_file();
+#else
+    _flush_lines();
+#endif
+    hal.util->perf_end(_perf_flush);
+}
+
+/*
+  write all the dirty lines in place, with one write for each run of
+  contiguous dirty lines, so a mission or parameter upload touching
+  every line is written in a single tick
+ */
+void Storage::_flush_lines(void)
+{
     if (_fd == -1) {
         _fd = open(STORAGE_FILE, O_WRONLY|O_CLOEXEC);
         if (_fd == -1) {
@@ -143,48 +161,66 @@ void Storage::_timer_tick(void)
         }
     }
 
-    // write out the first dirty set of lines. We don't write more
-    // than one to keep the latency of this call to a minimum
-    uint8_t i, n;
-    for (i=0; i<LINUX_STORAGE_NUM_LINES; i++) {
-        if (_dirty_mask & (1<<i)) {
-            break;
+    // lines marked dirty from now on are written on the next tick
+    const uint32_t dirty = __atomic_exchange_n(&_dirty_mask, 0, __ATOMIC_RELAXED);
+
+    uint8_t i = 0;
+    while (i < LINUX_STORAGE_NUM_LINES) {
+        if (!(dirty & (1U<<i))) {
+            i++;
+            continue;
         }
+        uint8_t n = 1;
+        while (i+n < LINUX_STORAGE_NUM_LINES && (dirty & (1U<<(i+n)))) {
+            n++;
+        }
+        const uint16_t ofs = i<<LINUX_STORAGE_LINE_SHIFT;
+        const ssize_t len = n<<LINUX_STORAGE_LINE_SHIFT;
+        if (pwrite(_fd, &_buffer[ofs], len, ofs) != len) {
+            // write error - likely EINTR. Try this line and the rest
+            // again on the next tick
+            __atomic_fetch_or(&_dirty_mask, dirty & ~((1U<<i)-1), __ATOMIC_RELAXED);
+            close(_fd);
+            _fd = -1;
+            return;
+        }
+        _bytes_written += len;
+        i += n;
+    }
+
+    if (_dirty_mask == 0 && fsync(_fd) != 0) {
+        close(_fd);
+        _fd = -1;
     }
-    if (i == LINUX_STORAGE_NUM_LINES) {
-        // this shouldn't be possible
+}
+
+/*
+  write all of storage to a temporary file and rename it over the
+  storage file once it is on disk
+ */
+void Storage::_flush_file(void)
+{
+    const uint32_t dirty = __atomic_exchange_n(&_dirty_mask, 0, __ATOMIC_RELAXED);
+
+    int fd = open(STORAGE_FILE ".tmp", O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, 0666);
+    if (fd == -1) {
+        __atomic_fetch_or(&_dirty_mask, dirty, __ATOMIC_RELAXED);
         return;
     }
-    uint32_t write_mask = (1U<<i);
-    // see how many lines to write
-    for (n=1; (i+n) < LINUX_STORAGE_NUM_LINES &&
-             n < (LINUX_STORAGE_MAX_WRITE>>LINUX_STORAGE_LINE_SHIFT); n++) {
-        if (!(_dirty_mask & (1<<(n+i)))) {
-            break;
-        }
-        // mark that line clean
-        write_mask |= (1<<(n+i));
+    bool ok = (write(fd, _buffer, sizeof(_buffer)) == sizeof(_buffer) &&
+               fsync(fd) == 0);
+    close(fd);
+    if (!ok || rename(STORAGE_FILE ".tmp", STORAGE_FILE) != 0) {
+        unlink(STORAGE_FILE ".tmp");
+        __atomic_fetch_or(&_dirty_mask, dirty, __ATOMIC_RELAXED);
+        return;
     }
+    _bytes_written += sizeof(_buffer);
 
-    /*
-      write the lines. This also updates _dirty_mask. Note that
-      because this is a SCHED_FIFO thread it will not be preempted
-      by the main task except during blocking calls. This means we
-      don't need a semaphore around the _dirty_mask updates.
-     */
-    if (lseek(_fd, i<<LINUX_STORAGE_LINE_SHIFT, SEEK_SET) == (i<<LINUX_STORAGE_LINE_SHIFT)) {
-        _dirty_mask &= ~write_mask;
-        if (write(_fd, &_buffer[i<<LINUX_STORAGE_LINE_SHIFT], n<<LINUX_STORAGE_LINE_SHIFT) != n<<LINUX_STORAGE_LINE_SHIFT) {
-            // write error - likely EINTR
-            _dirty_mask |= write_mask;
-            close(_fd);
-            _fd = -1;
-        }
-        if (_dirty_mask == 0) {
-            if (fsync(_fd) != 0) {
-                close(_fd);
-                _fd = -1;
-            }
-        }
+    // make the rename itself survive a power loss
+    fd = open(STORAGE_DIR, O_RDONLY|O_CLOEXEC);
+    if (fd != -1) {
+        fsync(fd);
+        close(fd);
     }
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+
 #include <AP_HAL/AP_HAL.h>
 
 #define LINUX_STORAGE_SIZE HAL_STORAGE_SIZE
@@ -8,12 +10,21 @@
 #define LINUX_STORAGE_LINE_SIZE (1<<LINUX_STORAGE_LINE_SHIFT)
 #define LINUX_STORAGE_NUM_LINES (LINUX_STORAGE_SIZE/LINUX_STORAGE_LINE_SIZE)
 
+/*
+  write all of storage to a new file and rename it over the old one
+  instead of updating the dirty lines in place, so a power loss can't
+  leave a line half written
+ */
+#ifndef HAL_LINUX_STORAGE_ATOMIC_WRITE
+#define HAL_LINUX_STORAGE_ATOMIC_WRITE 0
+#endif
+
 namespace Linux {
 
 class Storage : public AP_HAL::Storage
 {
 public:
-    Storage() : _fd(-1),_dirty_mask(0) { }
+    Storage() : _fd(-1),_dirty_mask(0),_bytes_changed(0),_bytes_written(0),_perf_flush(nullptr) { }
 
     static Storage *from(AP_HAL::Storage *storage) {
         return static_cast<Storage*>(storage);
@@ -31,14 +42,34 @@ public:
     void write_block(uint16_t dst, const void* src, size_t n);
 
     virtual void _timer_tick(void);
+
+    /*
+      bytes changed through write_block() and bytes written to the
+      storage file since boot. Their ratio is the write amplification,
+      where 1.0 would mean nothing was written twice
+     */
+    uint32_t bytes_changed(void) const { return _bytes_changed; }
+    uint32_t bytes_written(void) const { return _bytes_written; }
+    float write_amplification(void) const {
+        const uint32_t changed = _bytes_changed;
+        return changed ? (float)_bytes_written / changed : 0;
+    }
+
 protected:
     void _mark_dirty(uint16_t loc, uint16_t length);
+    void _flush_lines(void);
+    void _flush_file(void);
     virtual void _storage_create(void);
     virtual void _storage_open(void);
     int _fd;
     volatile bool _initialised;
     uint8_t _buffer[LINUX_STORAGE_SIZE];
     volatile uint32_t _dirty_mask;
+    // changed by the main thread, written by the IO thread and read by
+    // whoever reports them
+    std::atomic<uint32_t> _bytes_changed;
+    std::atomic<uint32_t> _bytes_written;
+    AP_HAL::Util::perf_counter_t _perf_flush;
 };
 
 }
@@ -423,7 +423,7 @@ bool UARTDriver::_write_pending_bytes(void)
             if (ret > 0)
                 _writebuf.advance(ret);
         } else {
-            ByteBuffer::IoVec vec[2];
+            SPSCByteBuffer::IoVec vec[2];
             const auto n_vec = _writebuf.peekiovec(vec, n);
             for (int i = 0; i < n_vec; i++) {
                 ret = _write_fd(vec[i].data, (uint16_t)vec[i].len);
@@ -461,7 +461,7 @@ void UARTDriver::_timer_tick(void)
 
     // try to fill the read buffer
     int ret;
-    ByteBuffer::IoVec vec[2];
+    SPSCByteBuffer::IoVec vec[2];
 
     const auto n_vec = _readbuf.reserve(vec, _readbuf.space());
     for (int i = 0; i < n_vec; i++) {
@@ -1,7 +1,7 @@
 #pragma once
 
 #include <AP_HAL/utility/OwnPtr.h>
-#include <AP_HAL/utility/RingBuffer.h>
+#include <AP_HAL/utility/SPSCBuffer.h>
 
 #include "AP_HAL_Linux.h"
 #include "SerialDevice.h"
@@ -71,9 +71,10 @@ protected:
     volatile bool _initialised;
 
     // we use in-task ring buffers to reduce the system call cost
-    // of ::read() and ::write() in the main loop
-    ByteBuffer _readbuf{0};
-    ByteBuffer _writebuf{0};
+    // of ::read() and ::write() in the main loop. The UART thread is
+    // the only producer of _readbuf and the only consumer of _writebuf
+    SPSCByteBuffer _readbuf{0};
+    SPSCByteBuffer _writebuf{0};
 
     virtual int _write_fd(const uint8_t *buf, uint16_t n);
     virtual int _read_fd(uint8_t *buf, uint16_t n);
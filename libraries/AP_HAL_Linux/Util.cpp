@@ -60,7 +60,7 @@ void Util::set_imu_target_temp(int8_t *target)
 /**
    return commandline arguments, if available
 */
-void Util::commandline_arguments(uint8_t &argc, char * const *&argv)
+void Util::commandline_arguments(int &argc, char * const *&argv)
 {
     argc = saved_argc;
     argv = saved_argv;
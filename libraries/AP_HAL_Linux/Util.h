@@ -36,7 +36,7 @@ public:
     /**
        return commandline arguments, if available
      */
-    void commandline_arguments(uint8_t &argc, char * const *&argv);
+    void commandline_arguments(int &argc, char * const *&argv);
 
     bool toneAlarm_init();
     void toneAlarm_set_tune(uint8_t tune);
@@ -20,7 +20,8 @@
 #include <AP_HAL/AP_HAL.h>
 #if CONFIG_HAL_BOARD_SUBTYPE == HAL_BOARD_SUBTYPE_LINUX_BEBOP ||\
     CONFIG_HAL_BOARD_SUBTYPE == HAL_BOARD_SUBTYPE_LINUX_MINLURE ||\
-    CONFIG_HAL_BOARD_SUBTYPE == HAL_BOARD_SUBTYPE_LINUX_BBBMINI
+    CONFIG_HAL_BOARD_SUBTYPE == HAL_BOARD_SUBTYPE_LINUX_BBBMINI ||\
+    CONFIG_HAL_BOARD_SUBTYPE == HAL_BOARD_SUBTYPE_LINUX_NONE
 #include "VideoIn.h"
 
 #include <errno.h>
@@ -39,6 +40,17 @@
 #include <time.h>
 #include <unistd.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define VIDEOIN_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define VIDEOIN_NEON 1
+#endif
+
+/* columns summed at a time by crop_shrink_8bpp() */
+#define VIDEOIN_SUM_COLUMNS 256
+
 extern const AP_HAL::HAL& hal;
 
 using namespace Linux;
@@ -265,10 +277,10 @@ void VideoIn::shrink_8bpp(uint8_t *buffer, uint8_t *new_buffer,
 
     /* selection offset */
     block_y = top * width;
-    block_position = left + block_y;
 
     for (i = 0; i < out_height; i++) {
         block_x = left;
+        block_position = block_x + block_y;
         for (j = 0; j < out_width; j++) {
             px = 0;
 
@@ -319,6 +331,115 @@ void VideoIn::yuyv_to_grey(uint8_t *buffer, uint32_t buffer_size,
     }
 }
 
+/*
+ * add count luma values of a row to sums
+ */
+void VideoIn::_add_luma_row(uint16_t *sums, const uint8_t *row,
+                            uint32_t count, bool yuyv)
+{
+    uint32_t i = 0;
+
+#if VIDEOIN_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    if (yuyv) {
+        /* the luma is the low byte of each 16 bit word */
+        const __m128i mask = _mm_set1_epi16(0x00ff);
+        for (; i + 8 <= count; i += 8) {
+            const __m128i px = _mm_and_si128(
+                _mm_loadu_si128((const __m128i *)&row[2 * i]), mask);
+            __m128i *s = (__m128i *)&sums[i];
+            _mm_storeu_si128(s, _mm_add_epi16(_mm_loadu_si128(s), px));
+        }
+    } else {
+        for (; i + 16 <= count; i += 16) {
+            const __m128i px = _mm_loadu_si128((const __m128i *)&row[i]);
+            __m128i *s = (__m128i *)&sums[i];
+            _mm_storeu_si128(s, _mm_add_epi16(_mm_loadu_si128(s),
+                                              _mm_unpacklo_epi8(px, zero)));
+            _mm_storeu_si128(s + 1, _mm_add_epi16(_mm_loadu_si128(s + 1),
+                                                  _mm_unpackhi_epi8(px, zero)));
+        }
+    }
+#elif VIDEOIN_NEON
+    if (yuyv) {
+        for (; i + 8 <= count; i += 8) {
+            const uint8x8x2_t px = vld2_u8(&row[2 * i]);
+            vst1q_u16(&sums[i], vaddw_u8(vld1q_u16(&sums[i]), px.val[0]));
+        }
+    } else {
+        for (; i + 16 <= count; i += 16) {
+            const uint8x16_t px = vld1q_u8(&row[i]);
+            vst1q_u16(&sums[i], vaddw_u8(vld1q_u16(&sums[i]),
+                                         vget_low_u8(px)));
+            vst1q_u16(&sums[i + 8], vaddw_u8(vld1q_u16(&sums[i + 8]),
+                                             vget_high_u8(px)));
+        }
+    }
+#endif
+
+    const uint32_t step = yuyv ? 2 : 1;
+    for (; i < count; i++) {
+        sums[i] += row[i * step];
+    }
+}
+
+void VideoIn::crop_shrink_8bpp(const uint8_t *buffer, uint8_t *new_buffer,
+                               uint32_t format, uint32_t bytesperline,
+                               uint32_t left, uint32_t selection_width,
+                               uint32_t top, uint32_t selection_height,
+                               uint32_t fx, uint32_t fy)
+{
+    /* a block must fit in the column sums, and a column of 257 rows of
+     * 255 is the most a uint16_t sum holds */
+    if (fx == 0 || fx > VIDEOIN_SUM_COLUMNS || fy == 0 || fy > 257) {
+        AP_HAL::panic("VideoIn: can't shrink by %ux%u\n",
+                      (unsigned)fx, (unsigned)fy);
+    }
+
+    const bool yuyv = format == V4L2_PIX_FMT_YUYV;
+    const uint32_t step = yuyv ? 2 : 1;
+    const uint32_t out_width = selection_width / fx;
+    const uint32_t out_height = selection_height / fy;
+    const uint32_t sum_width = out_width * fx;
+    const uint32_t fx_fy = fx * fy;
+    /* whole blocks of columns, so each output pixel is summed at once */
+    const uint32_t chunk = VIDEOIN_SUM_COLUMNS / fx * fx;
+    uint16_t sums[VIDEOIN_SUM_COLUMNS];
+
+    const uint8_t *row = buffer + top * bytesperline + left * step;
+
+    for (uint32_t i = 0; i < out_height; i++) {
+        for (uint32_t x = 0; x < sum_width; x += chunk) {
+            const uint32_t count = sum_width - x < chunk ? sum_width - x : chunk;
+
+            /* sum each column over the fy rows of the block... */
+            memset(sums, 0, count * sizeof(sums[0]));
+            for (uint32_t k = 0; k < fy; k++) {
+                _add_luma_row(sums, row + k * bytesperline + x * step,
+                              count, yuyv);
+            }
+
+            /* ...then the fx columns of each block */
+            uint8_t *out = new_buffer + x / fx;
+            if (fx_fy == 1) {
+                for (uint32_t j = 0; j < count; j++) {
+                    out[j] = sums[j];
+                }
+                continue;
+            }
+            for (uint32_t j = 0; j < count; j += fx) {
+                uint32_t px = 0;
+                for (uint32_t kk = 0; kk < fx; kk++) {
+                    px += sums[j + kk];
+                }
+                out[j / fx] = px / fx_fy;
+            }
+        }
+        row += fy * bytesperline;
+        new_buffer += out_width;
+    }
+}
+
 uint32_t VideoIn::_timeval_to_us(struct timeval& tv)
 {
     return (1.0e6 * tv.tv_sec + tv.tv_usec);
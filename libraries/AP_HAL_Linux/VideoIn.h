@@ -66,11 +66,26 @@ public:
     static void yuyv_to_grey(uint8_t *buffer, uint32_t buffer_size,
                              uint8_t *new_buffer);
 
+    /*
+     * Crop, shrink and convert to grey in a single pass over the frame,
+     * giving the same result as yuyv_to_grey() followed by shrink_8bpp().
+     * Only the luma of V4L2_PIX_FMT_YUYV frames is read, any other format
+     * is taken to start with an 8bpp luma plane. fx can be at most 256
+     * and fy at most 257.
+     */
+    static void crop_shrink_8bpp(const uint8_t *buffer, uint8_t *new_buffer,
+                                 uint32_t format, uint32_t bytesperline,
+                                 uint32_t left, uint32_t selection_width,
+                                 uint32_t top, uint32_t selection_height,
+                                 uint32_t fx, uint32_t fy);
+
 private:
     void _queue_buffer(int index);
     bool _set_streaming(bool enable);
     bool _dequeue_frame(Frame &frame);
     uint32_t _timeval_to_us(struct timeval& tv);
+    static void _add_luma_row(uint16_t *sums, const uint8_t *row,
+                              uint32_t count, bool yuyv);
     int _fd = -1;
     struct buffer *_buffers;
     unsigned int _nbufs;
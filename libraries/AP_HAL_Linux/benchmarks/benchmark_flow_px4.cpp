@@ -0,0 +1,118 @@
+#include <AP_gbenchmark.h>
+#include <AP_HAL/AP_HAL.h>
+#include <AP_Math/pseudo_random.h>
+
+#if CONFIG_HAL_BOARD_SUBTYPE == HAL_BOARD_SUBTYPE_LINUX_BEBOP ||\
+    CONFIG_HAL_BOARD_SUBTYPE == HAL_BOARD_SUBTYPE_LINUX_MINLURE ||\
+    CONFIG_HAL_BOARD_SUBTYPE == HAL_BOARD_SUBTYPE_LINUX_BBBMINI ||\
+    CONFIG_HAL_BOARD_SUBTYPE == HAL_BOARD_SUBTYPE_LINUX_NONE
+
+#include <AP_HAL_Linux/Flow_PX4.h>
+
+#define FRAME_WIDTH 64
+#define MARGIN 8
+
+/*
+ * two synthetic frames, the second being the first moved by (dx, dy)
+ * pixels. The texture is smoothed random noise so the blocks pass the
+ * feature threshold
+ */
+static void make_frames(uint8_t *image1, uint8_t *image2, uint32_t width,
+                        int dx, int dy)
+{
+    const uint32_t big_width = width + 2 * MARGIN;
+    uint8_t *big = (uint8_t *)malloc(big_width * big_width);
+    PseudoRandom prng(1);
+
+    for (uint32_t i = 0; i < big_width * big_width; i++) {
+        big[i] = prng.next_byte();
+    }
+    for (uint32_t y = 1; y < big_width - 1; y++) {
+        for (uint32_t x = 1; x < big_width - 1; x++) {
+            big[y * big_width + x] = (2 * big[y * big_width + x] +
+                                      big[y * big_width + x + 1] +
+                                      big[(y + 1) * big_width + x]) / 4;
+        }
+    }
+    for (uint32_t y = 0; y < width; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            image1[y * width + x] = big[(y + MARGIN) * big_width + x + MARGIN];
+            image2[y * width + x] = big[(y + MARGIN + dy) * big_width + x + MARGIN + dx];
+        }
+    }
+    free(big);
+}
+
+static void BM_FlowSAD(benchmark::State& state)
+{
+    uint8_t image1[FRAME_WIDTH * FRAME_WIDTH];
+    uint8_t image2[FRAME_WIDTH * FRAME_WIDTH];
+    make_frames(image1, image2, FRAME_WIDTH, 1, 2);
+
+    const uint8_t *pattern = &image1[20 * FRAME_WIDTH + 20];
+    const uint8_t *search = &image2[16 * FRAME_WIDTH + 16];
+    uint32_t sum = 0;
+    while (state.KeepRunning()) {
+        if (state.range_x()) {
+            sum += Linux::Flow_PX4::compute_sad(pattern, search, FRAME_WIDTH, 8);
+        } else {
+            sum += Linux::Flow_PX4::compute_sad_scalar(pattern, search, FRAME_WIDTH, 8);
+        }
+        gbenchmark_escape(&sum);
+    }
+}
+
+/* 0 for the scalar reference, 1 for the SIMD version */
+BENCHMARK(BM_FlowSAD)->Arg(0)->Arg(1);
+
+static void BM_FlowSubpixel(benchmark::State& state)
+{
+    uint8_t image1[FRAME_WIDTH * FRAME_WIDTH];
+    uint8_t image2[FRAME_WIDTH * FRAME_WIDTH];
+    make_frames(image1, image2, FRAME_WIDTH, 1, 2);
+
+    const uint8_t *pattern = &image1[20 * FRAME_WIDTH + 20];
+    const uint8_t *search = &image2[21 * FRAME_WIDTH + 22];
+    uint32_t acc[8];
+    while (state.KeepRunning()) {
+        if (state.range_x()) {
+            Linux::Flow_PX4::compute_subpixel(pattern, search, acc, FRAME_WIDTH, 8);
+        } else {
+            Linux::Flow_PX4::compute_subpixel_scalar(pattern, search, acc, FRAME_WIDTH, 8);
+        }
+        gbenchmark_escape(acc);
+    }
+}
+
+BENCHMARK(BM_FlowSubpixel)->Arg(0)->Arg(1);
+
+static void BM_ComputeFlow(benchmark::State& state)
+{
+    const uint32_t width = state.range_x();
+    uint8_t *image1 = (uint8_t *)malloc(width * width);
+    uint8_t *image2 = (uint8_t *)malloc(width * width);
+    if (!image1 || !image2) {
+        fprintf(stderr, "error: couldn't malloc frames\n");
+        free(image1);
+        free(image2);
+        return;
+    }
+    make_frames(image1, image2, width, 2, -1);
+
+    Linux::Flow_PX4 flow(width, width, 4, 30, 5000, state.range_y());
+    float flow_x, flow_y;
+    while (state.KeepRunning()) {
+        flow.compute_flow(image1, image2, 0, &flow_x, &flow_y);
+    }
+
+    free(image1);
+    free(image2);
+}
+
+/* frame width and number of threads */
+BENCHMARK(BM_ComputeFlow)
+    ->ArgPair(64, 1)->ArgPair(64, 2)
+    ->ArgPair(240, 1)->ArgPair(240, 2)->ArgPair(240, 4);
+#endif
+
+BENCHMARK_MAIN()
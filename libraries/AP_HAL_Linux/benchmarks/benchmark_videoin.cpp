@@ -2,7 +2,8 @@
 #include <AP_HAL/AP_HAL.h>
 
 #if CONFIG_HAL_BOARD_SUBTYPE == HAL_BOARD_SUBTYPE_LINUX_BEBOP ||\
-    CONFIG_HAL_BOARD_SUBTYPE == HAL_BOARD_SUBTYPE_LINUX_MINLURE
+    CONFIG_HAL_BOARD_SUBTYPE == HAL_BOARD_SUBTYPE_LINUX_MINLURE ||\
+    CONFIG_HAL_BOARD_SUBTYPE == HAL_BOARD_SUBTYPE_LINUX_NONE
 
 #include <AP_HAL_Linux/VideoIn.h>
 
@@ -62,6 +63,55 @@ static void BM_YuyvToGrey(benchmark::State& state)
 }
 
 BENCHMARK(BM_YuyvToGrey)->Arg(64 * 64)->Arg(320 * 240)->Arg(640 * 480);
+
+/*
+ * a 320x240 YUYV frame down to 64x64 grey, one step at a time as
+ * OpticalFlow_Onboard used to, or in a single pass
+ */
+static void BM_YuyvShrink(benchmark::State& state)
+{
+    const uint32_t width = 320;
+    const uint32_t height = 240;
+    const uint32_t scale = 3;
+    const uint32_t selection = 64 * scale;
+    const uint32_t left = (width - selection) / 2;
+    const uint32_t top = (height - selection) / 2;
+    uint8_t *buffer, *grey;
+    uint8_t new_buffer[64 * 64];
+
+    buffer = (uint8_t *)malloc(width * height * 2);
+    if (!buffer) {
+        fprintf(stderr, "error: couldn't malloc buffer\n");
+        return;
+    }
+
+    grey = (uint8_t *)malloc(width * height);
+    if (!grey) {
+        fprintf(stderr, "error: couldn't malloc grey\n");
+        free(buffer);
+        return;
+    }
+    memset(buffer, 0x80, width * height * 2);
+
+    while (state.KeepRunning()) {
+        if (state.range_x()) {
+            Linux::VideoIn::crop_shrink_8bpp(buffer, new_buffer,
+                V4L2_PIX_FMT_YUYV, width * 2, left, selection,
+                top, selection, scale, scale);
+        } else {
+            Linux::VideoIn::yuyv_to_grey(buffer, width * height * 2, grey);
+            Linux::VideoIn::shrink_8bpp(grey, new_buffer, width, height,
+                left, selection, top, selection, scale, scale);
+        }
+        gbenchmark_escape(new_buffer);
+    }
+
+    free(buffer);
+    free(grey);
+}
+
+/* 0 for yuyv_to_grey() and shrink_8bpp(), 1 for crop_shrink_8bpp() */
+BENCHMARK(BM_YuyvShrink)->Arg(0)->Arg(1);
 #endif
 
 BENCHMARK_MAIN()
@@ -0,0 +1,102 @@
+/*
+  check the SIMD block matching kernels give exactly the same results
+  as the scalar reference, and that compute_flow() finds a known shift
+  with and without worker threads
+ */
+#include <AP_gtest.h>
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_Math/pseudo_random.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+#if CONFIG_HAL_BOARD_SUBTYPE == HAL_BOARD_SUBTYPE_LINUX_BEBOP ||\
+    CONFIG_HAL_BOARD_SUBTYPE == HAL_BOARD_SUBTYPE_LINUX_MINLURE ||\
+    CONFIG_HAL_BOARD_SUBTYPE == HAL_BOARD_SUBTYPE_LINUX_BBBMINI ||\
+    CONFIG_HAL_BOARD_SUBTYPE == HAL_BOARD_SUBTYPE_LINUX_NONE
+
+#include <AP_HAL_Linux/Flow_PX4.h>
+
+using namespace Linux;
+
+#define WIDTH 64
+#define MARGIN 8
+
+TEST(FlowPX4Test, Kernels)
+{
+    uint8_t image1[WIDTH * WIDTH];
+    uint8_t image2[WIDTH * WIDTH];
+    PseudoRandom prng(1);
+
+    for (uint16_t n = 0; n < 1000; n++) {
+        for (uint16_t i = 0; i < sizeof(image1); i++) {
+            image1[i] = prng.next_byte();
+            image2[i] = prng.next_byte();
+        }
+        // leave a pixel around the windows for the subpixel means
+        const uint8_t *p1 = &image1[(1 + prng.next_below(50)) * WIDTH + 1 + prng.next_below(50)];
+        const uint8_t *p2 = &image2[(1 + prng.next_below(50)) * WIDTH + 1 + prng.next_below(50)];
+
+        EXPECT_EQ(Flow_PX4::compute_sad_scalar(p1, p2, WIDTH, 8),
+                  Flow_PX4::compute_sad(p1, p2, WIDTH, 8));
+
+        uint32_t acc[8], acc_scalar[8];
+        Flow_PX4::compute_subpixel(p1, p2, acc, WIDTH, 8);
+        Flow_PX4::compute_subpixel_scalar(p1, p2, acc_scalar, WIDTH, 8);
+        for (uint8_t k = 0; k < 8; k++) {
+            EXPECT_EQ(acc_scalar[k], acc[k]);
+        }
+    }
+}
+
+TEST(FlowPX4Test, ComputeFlow)
+{
+    const uint16_t big_width = WIDTH + 2 * MARGIN;
+    uint8_t big[big_width * big_width];
+    uint8_t image1[WIDTH * WIDTH];
+    uint8_t image2[WIDTH * WIDTH];
+    PseudoRandom prng(2);
+
+    // smoothed noise, so there are enough features to track
+    for (uint16_t i = 0; i < sizeof(big); i++) {
+        big[i] = prng.next_byte();
+    }
+    for (uint16_t y = 1; y < big_width - 1; y++) {
+        for (uint16_t x = 1; x < big_width - 1; x++) {
+            big[y * big_width + x] = (2 * big[y * big_width + x] +
+                                      big[y * big_width + x + 1] +
+                                      big[(y + 1) * big_width + x]) / 4;
+        }
+    }
+
+    Flow_PX4 flow1(WIDTH, WIDTH, 4, 30, 5000);
+    Flow_PX4 flow3(WIDTH, WIDTH, 4, 30, 5000, 3);
+
+    for (int8_t dy = -3; dy <= 3; dy++) {
+        for (int8_t dx = -3; dx <= 3; dx++) {
+            for (uint16_t y = 0; y < WIDTH; y++) {
+                for (uint16_t x = 0; x < WIDTH; x++) {
+                    image1[y * WIDTH + x] = big[(y + MARGIN) * big_width + x + MARGIN];
+                    image2[y * WIDTH + x] = big[(y + MARGIN + dy) * big_width + x + MARGIN + dx];
+                }
+            }
+            float x1, y1, x3, y3;
+            const uint8_t qual1 = flow1.compute_flow(image1, image2, 0, &x1, &y1);
+            const uint8_t qual3 = flow3.compute_flow(image1, image2, 0, &x3, &y3);
+
+            // the features in image2 are dx, dy pixels behind image1
+            EXPECT_GT(qual1, 128);
+            EXPECT_FLOAT_EQ(-dx, x1);
+            EXPECT_FLOAT_EQ(-dy, y1);
+
+            // splitting the work between threads changes nothing
+            EXPECT_EQ(qual1, qual3);
+            EXPECT_FLOAT_EQ(x1, x3);
+            EXPECT_FLOAT_EQ(y1, y3);
+        }
+    }
+}
+
+#endif
+
+AP_GTEST_MAIN()
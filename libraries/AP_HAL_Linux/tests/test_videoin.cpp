@@ -0,0 +1,103 @@
+/*
+  check the single pass crop/shrink/greyscale conversion gives the same
+  frames as converting, then shrinking or cropping, one step at a time
+ */
+#include <AP_gtest.h>
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_Math/pseudo_random.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+#if CONFIG_HAL_BOARD_SUBTYPE == HAL_BOARD_SUBTYPE_LINUX_BEBOP ||\
+    CONFIG_HAL_BOARD_SUBTYPE == HAL_BOARD_SUBTYPE_LINUX_MINLURE ||\
+    CONFIG_HAL_BOARD_SUBTYPE == HAL_BOARD_SUBTYPE_LINUX_BBBMINI ||\
+    CONFIG_HAL_BOARD_SUBTYPE == HAL_BOARD_SUBTYPE_LINUX_NONE
+
+#include <AP_HAL_Linux/VideoIn.h>
+
+using namespace Linux;
+
+#define OUT_SIZE 64
+
+static void fill_random(uint8_t *buffer, uint32_t size)
+{
+    PseudoRandom prng(size);
+    for (uint32_t i = 0; i < size; i++) {
+        buffer[i] = prng.next_byte();
+    }
+}
+
+/*
+ * shrink a width x height frame by scale, centred, as OpticalFlow_Onboard
+ * does, and compare with shrink_8bpp() of the greyscale frame
+ */
+static void check_shrink(uint32_t width, uint32_t height, uint32_t scale,
+                         uint32_t format)
+{
+    const uint32_t bpp = format == V4L2_PIX_FMT_YUYV ? 2 : 1;
+    const uint32_t sel_width = OUT_SIZE * scale;
+    const uint32_t sel_height = OUT_SIZE * scale;
+    const uint32_t left = (width - sel_width) / 2;
+    const uint32_t top = (height - sel_height) / 2;
+    uint8_t *frame = new uint8_t[width * height * bpp];
+    uint8_t *grey = new uint8_t[width * height];
+    uint8_t expected[OUT_SIZE * OUT_SIZE];
+    uint8_t fused[OUT_SIZE * OUT_SIZE];
+
+    fill_random(frame, width * height * bpp);
+    if (bpp == 2) {
+        VideoIn::yuyv_to_grey(frame, width * height * 2, grey);
+    } else {
+        memcpy(grey, frame, width * height);
+    }
+    VideoIn::shrink_8bpp(grey, expected, width, height,
+                         left, sel_width, top, sel_height, scale, scale);
+    VideoIn::crop_shrink_8bpp(frame, fused, format, width * bpp,
+                              left, sel_width, top, sel_height, scale, scale);
+
+    EXPECT_EQ(0, memcmp(expected, fused, sizeof(fused)))
+        << width << "x" << height << " scale " << scale << " bpp " << bpp;
+
+    delete[] frame;
+    delete[] grey;
+}
+
+TEST(VideoInTest, Shrink)
+{
+    check_shrink(320, 240, 3, V4L2_PIX_FMT_GREY);
+    check_shrink(320, 240, 3, V4L2_PIX_FMT_YUYV);
+    check_shrink(640, 480, 7, V4L2_PIX_FMT_GREY);
+    check_shrink(640, 480, 7, V4L2_PIX_FMT_YUYV);
+    check_shrink(160, 128, 2, V4L2_PIX_FMT_NV12);
+    check_shrink(1280, 720, 11, V4L2_PIX_FMT_YUYV);
+}
+
+TEST(VideoInTest, Crop)
+{
+    const uint32_t width = 320;
+    const uint32_t height = 240;
+    const uint32_t left = width / 2 - OUT_SIZE / 2;
+    const uint32_t top = height / 2 - OUT_SIZE / 2;
+    uint8_t frame[width * height * 2];
+    uint8_t grey[width * height];
+    uint8_t expected[OUT_SIZE * OUT_SIZE];
+    uint8_t fused[OUT_SIZE * OUT_SIZE];
+
+    fill_random(frame, sizeof(frame));
+
+    VideoIn::crop_8bpp(frame, expected, width, left, OUT_SIZE, top, OUT_SIZE);
+    VideoIn::crop_shrink_8bpp(frame, fused, V4L2_PIX_FMT_GREY, width,
+                              left, OUT_SIZE, top, OUT_SIZE, 1, 1);
+    EXPECT_EQ(0, memcmp(expected, fused, sizeof(fused)));
+
+    VideoIn::yuyv_to_grey(frame, sizeof(frame), grey);
+    VideoIn::crop_8bpp(grey, expected, width, left, OUT_SIZE, top, OUT_SIZE);
+    VideoIn::crop_shrink_8bpp(frame, fused, V4L2_PIX_FMT_YUYV, width * 2,
+                              left, OUT_SIZE, top, OUT_SIZE, 1, 1);
+    EXPECT_EQ(0, memcmp(expected, fused, sizeof(fused)));
+}
+
+#endif
+
+AP_GTEST_MAIN()
@@ -424,6 +424,18 @@ const AP_Param::GroupInfo AP_InertialSensor::var_info[] = {
     // @User: Advanced
     AP_GROUPINFO("FAST_SAMPLE",  36, AP_InertialSensor, _fast_sampling_mask,   0),
 
+    // @Group: NOTCH_
+    // @Path: ../Filter/NotchFilter.cpp
+    AP_SUBGROUPINFO(_notch_filter, "NOTCH_", 37, AP_InertialSensor, NotchFilterParams),
+
+    // @Group: FFT_
+    // @Path: SpectralAnalysis.cpp
+    AP_SUBGROUPINFO(_spectral, "FFT_", 38, AP_InertialSensor, SpectralAnalysis),
+
+    // @Group: BAT_
+    // @Path: BatchSampler.cpp
+    AP_SUBGROUPINFO(_batch_sampler, "BAT_", 39, AP_InertialSensor, BatchSampler),
+
     /*
       NOTE: parameter indexes have gaps above. When adding new
       parameters check for conflicts carefully
@@ -619,6 +631,26 @@ AP_InertialSensor::init(uint16_t sample_rate)
         _start_backends();
     }
 
+    // the spectral analysis runs at the raw rate of the sensor it watches
+    const uint8_t fft_instance = _spectral.instance();
+    if (fft_instance < INS_MAX_INSTANCES) {
+        if (_spectral.sensor() == SpectralAnalysis::SENSOR_ACCEL) {
+            _spectral.init(_accel_raw_sample_rates[fft_instance]);
+        } else {
+            _spectral.init(_gyro_raw_sample_rates[fft_instance]);
+        }
+    }
+
+    // and so does the batch sampler
+    const uint8_t batch_instance = _batch_sampler.instance();
+    if (batch_instance < INS_MAX_INSTANCES) {
+        if (_batch_sampler.sensor() == BatchSampler::SENSOR_ACCEL) {
+            _batch_sampler.init(_accel_raw_sample_rates[batch_instance]);
+        } else {
+            _batch_sampler.init(_gyro_raw_sample_rates[batch_instance]);
+        }
+    }
+
     // initialise accel scale if need be. This is needed as we can't
     // give non-zero default values for vectors in AP_Param
     for (uint8_t i=0; i<get_accel_count(); i++) {
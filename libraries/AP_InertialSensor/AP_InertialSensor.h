@@ -22,8 +22,13 @@
 #include <AP_HAL/AP_HAL.h>
 #include <AP_Math/AP_Math.h>
 #include <Filter/LowPassFilter2p.h>
+#include <Filter/BiquadFilterBank.h>
+#include <Filter/NotchFilter.h>
 #include <Filter/LowPassFilter.h>
 
+#include "BatchSampler.h"
+#include "SpectralAnalysis.h"
+
 class AP_InertialSensor_Backend;
 class AuxiliaryBus;
 
@@ -197,6 +202,12 @@ public:
     // get the accel filter rate in Hz
     uint8_t get_accel_filter_hz(void) const { return _accel_filter_cutoff; }
 
+    // set the throttle, from 0 to 1, for a gyro notch that follows the motor noise
+    void set_notch_throttle(float throttle) { _notch_throttle = throttle; }
+
+    // in flight spectral analysis of one sensor's raw samples
+    const SpectralAnalysis &get_spectral_analysis(void) const { return _spectral; }
+
     // pass in a pointer to DataFlash for raw data logging
     void set_dataflash(DataFlash_Class *dataflash) { _dataflash = dataflash; }
 
@@ -299,9 +310,12 @@ private:
     // time accumulator for delta velocity accumulator
     float _delta_velocity_acc_dt[INS_MAX_INSTANCES];
 
-    // Low Pass filters for gyro and accel
-    LowPassFilter2pVector3f _accel_filter[INS_MAX_INSTANCES];
-    LowPassFilter2pVector3f _gyro_filter[INS_MAX_INSTANCES];
+    // Low Pass filters for gyro and accel, one channel per instance
+    BiquadFilterBank3f<INS_MAX_INSTANCES> _accel_filter;
+    BiquadFilterBank3f<INS_MAX_INSTANCES> _gyro_filter;
+    // gyro notches, NotchFilterParams::max_harmonics channels per instance
+    BiquadFilterBank3f<INS_MAX_INSTANCES * NotchFilterParams::max_harmonics> _gyro_notch_filter;
+    float _notch_throttle;
     Vector3f _accel_filtered[INS_MAX_INSTANCES];
     Vector3f _gyro_filtered[INS_MAX_INSTANCES];
     bool _new_accel_data[INS_MAX_INSTANCES];
@@ -349,6 +363,15 @@ private:
     AP_Int8     _gyro_filter_cutoff;
     AP_Int8     _gyro_cal_timing;
 
+    // gyro notch filter
+    NotchFilterParams _notch_filter;
+
+    // spectral analysis of raw samples
+    SpectralAnalysis _spectral;
+
+    // batch logging of raw samples
+    BatchSampler _batch_sampler;
+
     // use for attitude, velocity, position estimates
     AP_Int8     _use[INS_MAX_INSTANCES];
 
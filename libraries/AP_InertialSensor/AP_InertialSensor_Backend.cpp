@@ -6,10 +6,14 @@
 
 const extern AP_HAL::HAL& hal;
 
+// samples filtered at a time by the burst notify functions
+#define INS_FILTER_BURST_MAX 8
+
 AP_InertialSensor_Backend::AP_InertialSensor_Backend(AP_InertialSensor &imu) :
     _imu(imu)
 {
     _sem = hal.util->new_semaphore();
+    memset(_last_notch, 0, sizeof(_last_notch));
 }
 
 void AP_InertialSensor_Backend::_rotate_and_correct_accel(uint8_t instance, Vector3f &accel) 
@@ -68,46 +72,84 @@ void AP_InertialSensor_Backend::_publish_gyro(uint8_t instance, const Vector3f &
 void AP_InertialSensor_Backend::_notify_new_gyro_raw_sample(uint8_t instance,
                                                             const Vector3f &gyro,
                                                             uint64_t sample_us)
+{
+    _notify_new_gyro_raw_samples(instance, &gyro, 1, sample_us);
+}
+
+/*
+  run a burst of samples through one channel of a filter bank,
+  restarting the filter after any output that is not finite, as the
+  filter is restarted when it is fed one sample at a time. samples and
+  filtered must not overlap, as a restart filters samples again
+ */
+template <uint8_t N>
+static void apply_filter(BiquadFilterBank3f<N> &filter, uint8_t channel,
+                         const Vector3f *samples, Vector3f *filtered, uint8_t n_samples)
+{
+    filter.apply(channel, samples, filtered, n_samples);
+    for (uint8_t i = 0; i < n_samples; i++) {
+        if (filtered[i].is_nan() || filtered[i].is_inf()) {
+            filter.reset(channel);
+            filter.apply(channel, &samples[i+1], &filtered[i+1], n_samples - (i+1));
+        }
+    }
+}
+
+void AP_InertialSensor_Backend::_notify_new_gyro_raw_samples(uint8_t instance,
+                                                             const Vector3f *gyro,
+                                                             uint8_t n_samples,
+                                                             uint64_t sample_us)
 {
     float dt;
 
-    if (_imu._gyro_raw_sample_rates[instance] <= 0) {
+    if (_imu._gyro_raw_sample_rates[instance] <= 0 || n_samples == 0) {
         return;
     }
 
     dt = 1.0f / _imu._gyro_raw_sample_rates[instance];
 
     // call gyro_sample hook if any
-    AP_Module::call_hook_gyro_sample(instance, dt, gyro);
-    
-    // compute delta angle
-    Vector3f delta_angle = (gyro + _imu._last_raw_gyro[instance]) * 0.5f * dt;
-
-    // compute coning correction
-    // see page 26 of:
-    // Tian et al (2010) Three-loop Integration of GPS and Strapdown INS with Coning and Sculling Compensation
-    // Available: http://www.sage.unsw.edu.au/snap/publications/tian_etal2010b.pdf
-    // see also examples/coning.py
-    Vector3f delta_coning = (_imu._delta_angle_acc[instance] +
-                             _imu._last_delta_angle[instance] * (1.0f / 6.0f));
-    delta_coning = delta_coning % delta_angle;
-    delta_coning *= 0.5f;
+    for (uint8_t i = 0; i < n_samples; i++) {
+        AP_Module::call_hook_gyro_sample(instance, dt, gyro[i]);
+    }
+
+    _imu._spectral.push_samples(SpectralAnalysis::SENSOR_GYRO, instance, gyro, n_samples);
+    _imu._batch_sampler.push_samples(BatchSampler::SENSOR_GYRO, instance, gyro, n_samples, sample_us);
 
     if (_sem->take(0)) {
-        // integrate delta angle accumulator
-        // the angles and coning corrections are accumulated separately in the
-        // referenced paper, but in simulation little difference was found between
-        // integrating together and integrating separately (see examples/coning.py)
-        _imu._delta_angle_acc[instance] += delta_angle + delta_coning;
-        _imu._delta_angle_acc_dt[instance] += dt;
-
-        // save previous delta angle for coning correction
-        _imu._last_delta_angle[instance] = delta_angle;
-        _imu._last_raw_gyro[instance] = gyro;
-
-        _imu._gyro_filtered[instance] = _imu._gyro_filter[instance].apply(gyro);
-        if (_imu._gyro_filtered[instance].is_nan() || _imu._gyro_filtered[instance].is_inf()) {
-            _imu._gyro_filter[instance].reset();
+        for (uint8_t i = 0; i < n_samples; i++) {
+            // compute delta angle
+            Vector3f delta_angle = (gyro[i] + _imu._last_raw_gyro[instance]) * 0.5f * dt;
+
+            // compute coning correction
+            // see page 26 of:
+            // Tian et al (2010) Three-loop Integration of GPS and Strapdown INS with Coning and Sculling Compensation
+            // Available: http://www.sage.unsw.edu.au/snap/publications/tian_etal2010b.pdf
+            // see also examples/coning.py
+            Vector3f delta_coning = (_imu._delta_angle_acc[instance] +
+                                     _imu._last_delta_angle[instance] * (1.0f / 6.0f));
+            delta_coning = delta_coning % delta_angle;
+            delta_coning *= 0.5f;
+
+            // integrate delta angle accumulator
+            // the angles and coning corrections are accumulated separately in the
+            // referenced paper, but in simulation little difference was found between
+            // integrating together and integrating separately (see examples/coning.py)
+            _imu._delta_angle_acc[instance] += delta_angle + delta_coning;
+            _imu._delta_angle_acc_dt[instance] += dt;
+
+            // save previous delta angle for coning correction
+            _imu._last_delta_angle[instance] = delta_angle;
+            _imu._last_raw_gyro[instance] = gyro[i];
+        }
+
+        Vector3f notched[INS_FILTER_BURST_MAX];
+        Vector3f filtered[INS_FILTER_BURST_MAX];
+        for (uint8_t i = 0; i < n_samples; i += INS_FILTER_BURST_MAX) {
+            const uint8_t n = MIN(n_samples - i, INS_FILTER_BURST_MAX);
+            const Vector3f *samples = apply_gyro_notch(instance, &gyro[i], notched, n);
+            apply_filter(_imu._gyro_filter, instance, samples, filtered, n);
+            _imu._gyro_filtered[instance] = filtered[n-1];
         }
         _imu._new_gyro_data[instance] = true;
         _sem->give();
@@ -116,16 +158,57 @@ void AP_InertialSensor_Backend::_notify_new_gyro_raw_sample(uint8_t instance,
     DataFlash_Class *dataflash = get_dataflash();
     if (dataflash != nullptr) {
         uint64_t now = AP_HAL::micros64();
-        struct log_GYRO pkt = {
-            LOG_PACKET_HEADER_INIT((uint8_t)(LOG_GYR1_MSG+instance)),
-            time_us   : now,
-            sample_us : sample_us?sample_us:now,
-            GyrX      : gyro.x,
-            GyrY      : gyro.y,
-            GyrZ      : gyro.z
-        };
-        dataflash->WriteBlock(&pkt, sizeof(pkt));
+        for (uint8_t i = 0; i < n_samples; i++) {
+            struct log_GYRO pkt = {
+                LOG_PACKET_HEADER_INIT((uint8_t)(LOG_GYR1_MSG+instance)),
+                time_us   : now,
+                sample_us : sample_us?sample_us:now,
+                GyrX      : gyro[i].x,
+                GyrY      : gyro[i].y,
+                GyrZ      : gyro[i].z
+            };
+            dataflash->WriteBlock(&pkt, sizeof(pkt));
+        }
+    }
+}
+
+/*
+  the notches of an instance run one after the other ahead of the low
+  pass filter, skipping the harmonics that are not in use
+ */
+const Vector3f *AP_InertialSensor_Backend::apply_gyro_notch(uint8_t instance, const Vector3f *in,
+                                                            Vector3f *out, uint8_t n_samples)
+{
+    if (!_imu._notch_filter.enabled()) {
+        return in;
+    }
+
+    const uint8_t first = instance * NotchFilterParams::max_harmonics;
+    uint8_t active = 0;
+    for (uint8_t h = 0; h < NotchFilterParams::max_harmonics; h++) {
+        if (!is_zero(_imu._gyro_notch_filter.get_cutoff_freq(first + h))) {
+            active++;
+        }
     }
+    if (active == 0) {
+        return in;
+    }
+
+    // alternate between two buffers, starting with the one that leaves
+    // the last notch writing to out
+    Vector3f tmp[INS_FILTER_BURST_MAX];
+    Vector3f *dest = (active & 1) ? out : tmp;
+    const Vector3f *samples = in;
+    for (uint8_t h = 0; h < NotchFilterParams::max_harmonics; h++) {
+        const uint8_t channel = first + h;
+        if (is_zero(_imu._gyro_notch_filter.get_cutoff_freq(channel))) {
+            continue;
+        }
+        apply_filter(_imu._gyro_notch_filter, channel, samples, dest, n_samples);
+        samples = dest;
+        dest = (dest == out) ? tmp : out;
+    }
+    return out;
 }
 
 /*
@@ -169,31 +252,50 @@ void AP_InertialSensor_Backend::_notify_new_accel_raw_sample(uint8_t instance,
                                                              const Vector3f &accel,
                                                              uint64_t sample_us,
                                                              bool fsync_set)
+{
+    _notify_new_accel_raw_samples(instance, &accel, 1, sample_us, &fsync_set);
+}
+
+void AP_InertialSensor_Backend::_notify_new_accel_raw_samples(uint8_t instance,
+                                                              const Vector3f *accel,
+                                                              uint8_t n_samples,
+                                                              uint64_t sample_us,
+                                                              const bool *fsync_set)
 {
     float dt;
 
-    if (_imu._accel_raw_sample_rates[instance] <= 0) {
+    if (_imu._accel_raw_sample_rates[instance] <= 0 || n_samples == 0) {
         return;
     }
 
     dt = 1.0f / _imu._accel_raw_sample_rates[instance];
 
-    // call gyro_sample hook if any
-    AP_Module::call_hook_accel_sample(instance, dt, accel, fsync_set);
-    
-    _imu.calc_vibration_and_clipping(instance, accel, dt);
+    for (uint8_t i = 0; i < n_samples; i++) {
+        // call gyro_sample hook if any
+        AP_Module::call_hook_accel_sample(instance, dt, accel[i], fsync_set != nullptr && fsync_set[i]);
+
+        _imu.calc_vibration_and_clipping(instance, accel[i], dt);
+    }
+
+    _imu._spectral.push_samples(SpectralAnalysis::SENSOR_ACCEL, instance, accel, n_samples);
+    _imu._batch_sampler.push_samples(BatchSampler::SENSOR_ACCEL, instance, accel, n_samples, sample_us);
 
     if (_sem->take(0)) {
         // delta velocity
-        _imu._delta_velocity_acc[instance] += accel * dt;
-        _imu._delta_velocity_acc_dt[instance] += dt;
-
-        _imu._accel_filtered[instance] = _imu._accel_filter[instance].apply(accel);
-        if (_imu._accel_filtered[instance].is_nan() || _imu._accel_filtered[instance].is_inf()) {
-            _imu._accel_filter[instance].reset();
+        for (uint8_t i = 0; i < n_samples; i++) {
+            _imu._delta_velocity_acc[instance] += accel[i] * dt;
+            _imu._delta_velocity_acc_dt[instance] += dt;
         }
 
-        _imu.set_accel_peak_hold(instance, _imu._accel_filtered[instance]);
+        Vector3f filtered[INS_FILTER_BURST_MAX];
+        for (uint8_t i = 0; i < n_samples; i += INS_FILTER_BURST_MAX) {
+            const uint8_t n = MIN(n_samples - i, INS_FILTER_BURST_MAX);
+            apply_filter(_imu._accel_filter, instance, &accel[i], filtered, n);
+            for (uint8_t j = 0; j < n; j++) {
+                _imu.set_accel_peak_hold(instance, filtered[j]);
+            }
+            _imu._accel_filtered[instance] = filtered[n-1];
+        }
 
         _imu._new_accel_data[instance] = true;
         _sem->give();
@@ -202,15 +304,17 @@ void AP_InertialSensor_Backend::_notify_new_accel_raw_sample(uint8_t instance,
     DataFlash_Class *dataflash = get_dataflash();
     if (dataflash != nullptr) {
         uint64_t now = AP_HAL::micros64();
-        struct log_ACCEL pkt = {
-            LOG_PACKET_HEADER_INIT((uint8_t)(LOG_ACC1_MSG+instance)),
-            time_us   : now,
-            sample_us : sample_us?sample_us:now,
-            AccX      : accel.x,
-            AccY      : accel.y,
-            AccZ      : accel.z
-        };
-        dataflash->WriteBlock(&pkt, sizeof(pkt));
+        for (uint8_t i = 0; i < n_samples; i++) {
+            struct log_ACCEL pkt = {
+                LOG_PACKET_HEADER_INIT((uint8_t)(LOG_ACC1_MSG+instance)),
+                time_us   : now,
+                sample_us : sample_us?sample_us:now,
+                AccX      : accel[i].x,
+                AccY      : accel[i].y,
+                AccZ      : accel[i].z
+            };
+            dataflash->WriteBlock(&pkt, sizeof(pkt));
+        }
     }
 }
 
@@ -280,13 +384,48 @@ void AP_InertialSensor_Backend::update_gyro(uint8_t instance)
 
     // possibly update filter frequency
     if (_last_gyro_filter_hz[instance] != _gyro_filter_cutoff()) {
-        _imu._gyro_filter[instance].set_cutoff_frequency(_gyro_raw_sample_rate(instance), _gyro_filter_cutoff());
+        _imu._gyro_filter.set_cutoff_frequency(instance, _gyro_raw_sample_rate(instance), _gyro_filter_cutoff());
         _last_gyro_filter_hz[instance] = _gyro_filter_cutoff();
     }
 
+    update_gyro_notch(instance);
+
     _sem->give();
 }
 
+/*
+  the notch centre can move every loop when it follows the throttle, so
+  the coefficients are recomputed here rather than on a parameter change
+ */
+void AP_InertialSensor_Backend::update_gyro_notch(uint8_t instance)
+{
+    const NotchFilterParams &notch = _imu._notch_filter;
+    const float center_hz = notch.enabled() ? notch.center_freq_hz(_imu._notch_throttle) : 0;
+    const uint8_t harmonics = notch.enabled() ? notch.harmonics() : 0;
+
+    if (is_equal(center_hz, _last_notch[instance].center_hz) &&
+        is_equal(notch.bandwidth_hz(), _last_notch[instance].bandwidth_hz) &&
+        is_equal(notch.attenuation_dB(), _last_notch[instance].attenuation_dB) &&
+        harmonics == _last_notch[instance].harmonics) {
+        return;
+    }
+
+    for (uint8_t h = 0; h < NotchFilterParams::max_harmonics; h++) {
+        BiquadFilterBankBase::biquad_params params;
+        // harmonics not in use are left with zero coefficients and skipped
+        NotchFilter<float>::compute_params(_gyro_raw_sample_rate(instance),
+                                           (harmonics & (1U<<h)) ? center_hz * (h+1) : 0,
+                                           notch.bandwidth_hz() * (h+1),
+                                           notch.attenuation_dB(), params);
+        _imu._gyro_notch_filter.set_params(instance * NotchFilterParams::max_harmonics + h, params);
+    }
+
+    _last_notch[instance].center_hz = center_hz;
+    _last_notch[instance].bandwidth_hz = notch.bandwidth_hz();
+    _last_notch[instance].attenuation_dB = notch.attenuation_dB();
+    _last_notch[instance].harmonics = harmonics;
+}
+
 /*
   common accel update function for all backends
  */
@@ -303,7 +442,7 @@ void AP_InertialSensor_Backend::update_accel(uint8_t instance)
     
     // possibly update filter frequency
     if (_last_accel_filter_hz[instance] != _accel_filter_cutoff()) {
-        _imu._accel_filter[instance].set_cutoff_frequency(_accel_raw_sample_rate(instance), _accel_filter_cutoff());
+        _imu._accel_filter.set_cutoff_frequency(instance, _accel_raw_sample_rate(instance), _accel_filter_cutoff());
         _last_accel_filter_hz[instance] = _accel_filter_cutoff();
     }
 
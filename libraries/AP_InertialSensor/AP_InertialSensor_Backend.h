@@ -109,6 +109,10 @@ protected:
     // be rotated and corrected (_rotate_and_correct_gyro)
     void _notify_new_gyro_raw_sample(uint8_t instance, const Vector3f &accel, uint64_t sample_us=0);
 
+    // the same for a burst of samples, such as one FIFO read, which are
+    // filtered together with the semaphore taken once
+    void _notify_new_gyro_raw_samples(uint8_t instance, const Vector3f *gyro, uint8_t n_samples, uint64_t sample_us=0);
+
     // rotate accel vector, scale, offset and publish
     void _publish_accel(uint8_t instance, const Vector3f &accel);
 
@@ -118,6 +122,10 @@ protected:
     // be rotated and corrected (_rotate_and_correct_accel)
     void _notify_new_accel_raw_sample(uint8_t instance, const Vector3f &accel, uint64_t sample_us=0, bool fsync_set=false);
 
+    // the same for a burst of samples. fsync_set may be nullptr
+    void _notify_new_accel_raw_samples(uint8_t instance, const Vector3f *accel, uint8_t n_samples,
+                                       uint64_t sample_us=0, const bool *fsync_set=nullptr);
+
     // set accelerometer max absolute offset for calibration
     void _set_accel_max_abs_offset(uint8_t instance, float offset);
 
@@ -173,6 +181,21 @@ protected:
     int8_t _last_accel_filter_hz[INS_MAX_INSTANCES];
     int8_t _last_gyro_filter_hz[INS_MAX_INSTANCES];
 
+    // gyro notch settings the coefficients were last computed for
+    struct {
+        float center_hz;
+        float bandwidth_hz;
+        float attenuation_dB;
+        uint8_t harmonics;
+    } _last_notch[INS_MAX_INSTANCES];
+
+    // recompute the gyro notch coefficients if the notch has moved
+    void update_gyro_notch(uint8_t instance);
+
+    // run a burst of gyro samples through the notches of an instance,
+    // returning in or out, whichever holds the result
+    const Vector3f *apply_gyro_notch(uint8_t instance, const Vector3f *in, Vector3f *out, uint8_t n_samples);
+
     void set_gyro_orientation(uint8_t instance, enum Rotation rotation) {
         _imu._gyro_orientation[instance] = rotation;
     }
@@ -413,32 +413,35 @@ bool AP_InertialSensor_MPU9250::_data_ready(uint8_t int_status)
 
 void AP_InertialSensor_MPU9250::_accumulate(uint8_t *samples, uint8_t n_samples)
 {
+    Vector3f accel[MPU9250_MAX_FIFO_SAMPLES];
+    Vector3f gyro[MPU9250_MAX_FIFO_SAMPLES];
+
     for (uint8_t i = 0; i < n_samples; i++) {
         uint8_t *data = samples + MPU9250_SAMPLE_SIZE * i;
-        Vector3f accel, gyro;
 
-        accel = Vector3f(int16_val(data, 1),
-                         int16_val(data, 0),
-                         -int16_val(data, 2));
-        accel *= MPU9250_ACCEL_SCALE_1G;
+        accel[i] = Vector3f(int16_val(data, 1),
+                            int16_val(data, 0),
+                            -int16_val(data, 2));
+        accel[i] *= MPU9250_ACCEL_SCALE_1G;
 
         float temp = int16_val(data, 3);
         temp = temp/340 + 36.53;
         _last_temp = temp;
         
-        gyro = Vector3f(int16_val(data, 5),
-                        int16_val(data, 4),
-                        -int16_val(data, 6));
-        gyro *= GYRO_SCALE;
-
-        _rotate_and_correct_accel(_accel_instance, accel);
-        _rotate_and_correct_gyro(_gyro_instance, gyro);
+        gyro[i] = Vector3f(int16_val(data, 5),
+                           int16_val(data, 4),
+                           -int16_val(data, 6));
+        gyro[i] *= GYRO_SCALE;
 
-        _notify_new_accel_raw_sample(_accel_instance, accel, AP_HAL::micros64());
-        _notify_new_gyro_raw_sample(_gyro_instance, gyro);
+        _rotate_and_correct_accel(_accel_instance, accel[i]);
+        _rotate_and_correct_gyro(_gyro_instance, gyro[i]);
 
         _temp_filtered = _temp_filter.apply(temp);
     }
+
+    // the whole FIFO read goes through the filters at once
+    _notify_new_accel_raw_samples(_accel_instance, accel, n_samples, AP_HAL::micros64());
+    _notify_new_gyro_raw_samples(_gyro_instance, gyro, n_samples);
 }
 
 void AP_InertialSensor_MPU9250::_accumulate_fast_sampling(uint8_t *samples, uint8_t n_samples)
@@ -0,0 +1,249 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "BatchSampler.h"
+
+#include <DataFlash/DataFlash.h>
+
+#include "AP_InertialSensor.h"
+
+extern const AP_HAL::HAL& hal;
+
+// log buffer space a batch leaves free for everything else
+#define INS_BATCH_LOG_MARGIN 2048
+
+// ISBD messages written each time the IO process runs
+#define INS_BATCH_MSGS_PER_RUN 2
+
+const AP_Param::GroupInfo BatchSampler::var_info[] = {
+    // @Param: ENABLE
+    // @DisplayName: Batch sampling enable
+    // @Description: Enable logging batches of raw IMU samples at the full sensor rate. This option takes effect on the next reboot
+    // @Values: 0:Disabled,1:Enabled
+    // @User: Advanced
+    AP_GROUPINFO_FLAGS("ENABLE", 1, BatchSampler, _enable, 0, AP_PARAM_FLAG_ENABLE),
+
+    // @Param: SENSOR
+    // @DisplayName: Batch sampling sensor
+    // @Description: Whether the gyro or the accel is sampled. This option takes effect on the next reboot
+    // @Values: 0:Gyro,1:Accel
+    // @User: Advanced
+    AP_GROUPINFO("SENSOR", 2, BatchSampler, _sensor, SENSOR_GYRO),
+
+    // @Param: IMU
+    // @DisplayName: Batch sampling IMU
+    // @Description: Which IMU is sampled, counting from zero. This option takes effect on the next reboot
+    // @Range: 0 2
+    // @User: Advanced
+    AP_GROUPINFO("IMU", 3, BatchSampler, _instance, 0),
+
+    // @Param: CNT
+    // @DisplayName: Batch sampling count
+    // @Description: Number of samples in each batch, rounded down to a multiple of 32. Each sample takes 6 bytes of RAM. This option takes effect on the next reboot
+    // @Range: 256 8192
+    // @User: Advanced
+    AP_GROUPINFO("CNT", 4, BatchSampler, _count, 1024),
+
+    // @Param: TRIG
+    // @DisplayName: Batch sampling trigger
+    // @Description: When a batch is taken. Continuous takes a new batch as soon as the last one is logged, arming takes one batch each time the vehicle arms and vibration takes batches while the vibration of the IMU is over INS_BAT_VIBE
+    // @Values: 0:Continuous,1:Arming,2:Vibration
+    // @User: Advanced
+    AP_GROUPINFO("TRIG", 5, BatchSampler, _trigger, TRIGGER_CONTINUOUS),
+
+    // @Param: VIBE
+    // @DisplayName: Batch sampling vibration threshold
+    // @Description: Vibration level of the IMU that starts a batch when INS_BAT_TRIG is vibration
+    // @Units: m/s/s
+    // @Range: 5 100
+    // @User: Advanced
+    AP_GROUPINFO("VIBE", 6, BatchSampler, _vibe_threshold, 30),
+
+    AP_GROUPEND
+};
+
+BatchSampler::BatchSampler(void) :
+    _state(STATE_IDLE),
+    _sample_rate_hz(0),
+    _sample_count(0),
+    _running(false),
+    _data(nullptr),
+    _multiplier(1),
+    _fill_count(0),
+    _start_us(0),
+    _batch_seqno(0),
+    _msgs_written(0),
+    _header_written(false),
+    _last_armed(false)
+{
+    AP_Param::setup_object_defaults(this, var_info);
+}
+
+void BatchSampler::init(uint16_t sample_rate_hz)
+{
+    if (!enabled() || _running || sample_rate_hz == 0) {
+        return;
+    }
+
+    const uint16_t count = constrain_int16(_count, samples_per_msg * 8, 8192);
+    _sample_count = count - count % samples_per_msg;
+    _data = new int16_t[_sample_count * 3];
+    if (_data == nullptr) {
+        hal.console->printf("BatchSampler: no memory for %u samples\n", (unsigned)_sample_count);
+        return;
+    }
+
+    // scaled to the usual full range of the sensor
+    if (_sensor == SENSOR_ACCEL) {
+        _multiplier = INT16_MAX / (16 * GRAVITY_MSS);
+    } else {
+        _multiplier = INT16_MAX / radians(2000);
+    }
+
+    _sample_rate_hz = sample_rate_hz;
+    hal.scheduler->register_io_process(FUNCTOR_BIND_MEMBER(&BatchSampler::io_timer, void));
+    _running = true;
+}
+
+/*
+  sample_us is the time of the last sample, or zero for now
+ */
+void BatchSampler::push_samples(enum Sensor sensor, uint8_t instance, const Vector3f *samples,
+                                uint8_t n_samples, uint64_t sample_us)
+{
+    if (!_running || sensor != _sensor || instance != _instance ||
+        _state != STATE_CAPTURING) {
+        return;
+    }
+
+    const uint64_t last_us = sample_us ? sample_us : AP_HAL::micros64();
+    for (uint8_t i = 0; i < n_samples; i++) {
+        if (_fill_count == 0) {
+            _start_us = last_us - (n_samples - 1 - i) * 1000000ULL / _sample_rate_hz;
+        }
+        const Vector3f s = samples[i] * _multiplier;
+        _data[_fill_count] = constrain_float(s.x, INT16_MIN, INT16_MAX);
+        _data[_sample_count + _fill_count] = constrain_float(s.y, INT16_MIN, INT16_MAX);
+        _data[2 * _sample_count + _fill_count] = constrain_float(s.z, INT16_MIN, INT16_MAX);
+        if (++_fill_count == _sample_count) {
+            _state = STATE_WRITING;
+            return;
+        }
+    }
+}
+
+void BatchSampler::io_timer(void)
+{
+    switch (_state) {
+    case STATE_IDLE:
+        if (triggered()) {
+            _fill_count = 0;
+            _state = STATE_CAPTURING;
+        }
+        break;
+    case STATE_CAPTURING:
+        break;
+    case STATE_WRITING:
+        write_batch();
+        break;
+    }
+}
+
+bool BatchSampler::triggered(void)
+{
+    DataFlash_Class *dataflash = DataFlash_Class::instance();
+    if (dataflash == nullptr || !dataflash->logging_started()) {
+        return false;
+    }
+
+    // arming is only noticed once the log has started, which may be
+    // because of the arming
+    const bool armed = hal.util->get_soft_armed();
+    const bool just_armed = armed && !_last_armed;
+    _last_armed = armed;
+
+    switch (_trigger) {
+    case TRIGGER_ARMING:
+        return just_armed;
+    case TRIGGER_VIBRATION: {
+        const AP_InertialSensor *ins = AP_InertialSensor::get_instance();
+        return ins != nullptr && ins->get_vibration_levels(_instance).length() > _vibe_threshold;
+    }
+    case TRIGGER_CONTINUOUS:
+    default:
+        return true;
+    }
+}
+
+/*
+  write the header and then a few ISBD messages of the batch each run,
+  leaving the rest for a later run when the log buffer is busy
+ */
+void BatchSampler::write_batch(void)
+{
+    DataFlash_Class *dataflash = DataFlash_Class::instance();
+    if (dataflash == nullptr || !dataflash->logging_started()) {
+        // the log stopped under the batch
+        _msgs_written = 0;
+        _header_written = false;
+        _state = STATE_IDLE;
+        return;
+    }
+
+    const uint64_t now = AP_HAL::micros64();
+    if (!_header_written) {
+        if (dataflash->bufferspace_available() < sizeof(log_ISBH) + INS_BATCH_LOG_MARGIN) {
+            return;
+        }
+        struct log_ISBH pkt = {
+            LOG_PACKET_HEADER_INIT(LOG_ISBH_MSG),
+            time_us        : now,
+            seqno          : _batch_seqno,
+            sensor_type    : (uint8_t)_sensor,
+            instance       : (uint8_t)_instance,
+            multiplier     : _multiplier,
+            sample_count   : _sample_count,
+            sample_us      : _start_us,
+            sample_rate_hz : (float)_sample_rate_hz
+        };
+        dataflash->WriteBlock(&pkt, sizeof(pkt));
+        _header_written = true;
+    }
+
+    const uint16_t num_msgs = _sample_count / samples_per_msg;
+    for (uint8_t i = 0; i < INS_BATCH_MSGS_PER_RUN && _msgs_written < num_msgs; i++) {
+        if (dataflash->bufferspace_available() < sizeof(log_ISBD) + INS_BATCH_LOG_MARGIN) {
+            return;
+        }
+        const uint16_t ofs = _msgs_written * samples_per_msg;
+        struct log_ISBD pkt = {
+            LOG_PACKET_HEADER_INIT(LOG_ISBD_MSG),
+            time_us   : now,
+            isb_seqno : _batch_seqno,
+            seqno     : _msgs_written
+        };
+        memcpy(pkt.x, &_data[ofs], sizeof(pkt.x));
+        memcpy(pkt.y, &_data[_sample_count + ofs], sizeof(pkt.y));
+        memcpy(pkt.z, &_data[2 * _sample_count + ofs], sizeof(pkt.z));
+        dataflash->WriteBlock(&pkt, sizeof(pkt));
+        _msgs_written++;
+    }
+
+    if (_msgs_written == num_msgs) {
+        _batch_seqno++;
+        _msgs_written = 0;
+        _header_written = false;
+        _state = STATE_IDLE;
+    }
+}
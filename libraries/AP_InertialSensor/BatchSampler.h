@@ -0,0 +1,103 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <atomic>
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_Math/AP_Math.h>
+#include <AP_Param/AP_Param.h>
+
+/*
+  batches of raw samples of one gyro or accel at the full backend
+  rate. The backend fills a buffer in RAM as fast as it samples, then
+  the IO thread writes the batch to DataFlash a few blocks at a time,
+  only while the log buffer has room to spare, so a batch costs the
+  log none of the space it needs for the vehicle's own messages
+ */
+class BatchSampler {
+public:
+    enum Sensor {
+        SENSOR_GYRO  = 0,
+        SENSOR_ACCEL = 1,
+    };
+
+    enum Trigger {
+        // a new batch as soon as the last one is written
+        TRIGGER_CONTINUOUS = 0,
+        // one batch each time the vehicle arms
+        TRIGGER_ARMING     = 1,
+        // batches while the vibration of the IMU is over INS_BAT_VIBE
+        TRIGGER_VIBRATION  = 2,
+    };
+
+    // samples in each ISBD log message
+    static const uint8_t samples_per_msg = 32;
+
+    BatchSampler(void);
+
+    bool enabled(void) const { return _enable != 0; }
+    uint8_t sensor(void) const { return _sensor; }
+    uint8_t instance(void) const { return _instance; }
+
+    // allocate the buffer and start the IO process if enabled, for the
+    // raw sample rate of the chosen sensor
+    void init(uint16_t sample_rate_hz);
+
+    // raw samples from a backend, called in the backend's thread
+    void push_samples(enum Sensor sensor, uint8_t instance, const Vector3f *samples,
+                      uint8_t n_samples, uint64_t sample_us);
+
+    static const struct AP_Param::GroupInfo var_info[];
+
+private:
+    AP_Int8 _enable;
+    AP_Int8 _sensor;
+    AP_Int8 _instance;
+    AP_Int16 _count;
+    AP_Int8 _trigger;
+    AP_Float _vibe_threshold;
+
+    enum State {
+        // waiting for the trigger
+        STATE_IDLE,
+        // the backend is filling the buffer
+        STATE_CAPTURING,
+        // the IO thread is writing the buffer out
+        STATE_WRITING,
+    };
+    std::atomic<uint8_t> _state;
+
+    uint16_t _sample_rate_hz;
+    uint16_t _sample_count;
+    bool _running;
+
+    // scaled samples, each axis a run of _sample_count values
+    int16_t *_data;
+    float _multiplier;
+    uint16_t _fill_count;
+    // time of the first sample of the batch
+    uint64_t _start_us;
+
+    // owned by the IO thread
+    uint16_t _batch_seqno;
+    uint16_t _msgs_written;
+    bool _header_written;
+    bool _last_armed;
+
+    void io_timer(void);
+    bool triggered(void);
+    void write_batch(void);
+};
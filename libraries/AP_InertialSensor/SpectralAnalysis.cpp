@@ -0,0 +1,204 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "SpectralAnalysis.h"
+
+#include <DataFlash/DataFlash.h>
+
+extern const AP_HAL::HAL& hal;
+
+const AP_Param::GroupInfo SpectralAnalysis::var_info[] = {
+    // @Param: ENABLE
+    // @DisplayName: Spectral analysis enable
+    // @Description: Enable the in flight spectral analysis of raw IMU samples. This option takes effect on the next reboot
+    // @Values: 0:Disabled,1:Enabled
+    // @User: Advanced
+    AP_GROUPINFO_FLAGS("ENABLE", 1, SpectralAnalysis, _enable, 0, AP_PARAM_FLAG_ENABLE),
+
+    // @Param: SENSOR
+    // @DisplayName: Spectral analysis sensor
+    // @Description: Whether the gyro or the accel is analysed. This option takes effect on the next reboot
+    // @Values: 0:Gyro,1:Accel
+    // @User: Advanced
+    AP_GROUPINFO("SENSOR", 2, SpectralAnalysis, _sensor, SENSOR_GYRO),
+
+    // @Param: IMU
+    // @DisplayName: Spectral analysis IMU
+    // @Description: Which IMU is analysed, counting from zero. This option takes effect on the next reboot
+    // @Range: 0 2
+    // @User: Advanced
+    AP_GROUPINFO("IMU", 3, SpectralAnalysis, _instance, 0),
+
+    // @Param: WINDOW
+    // @DisplayName: Spectral analysis window
+    // @Description: Number of samples in each FFT. Longer windows resolve frequencies more finely but are slower to follow changes. Rounded down to a power of two. This option takes effect on the next reboot
+    // @Values: 32:32,64:64,128:128,256:256,512:512,1024:1024
+    // @User: Advanced
+    AP_GROUPINFO("WINDOW", 4, SpectralAnalysis, _window_size, 256),
+
+    // @Param: MINHZ
+    // @DisplayName: Spectral analysis minimum frequency
+    // @Description: Peaks below this frequency are ignored, to leave out the motion of the vehicle
+    // @Units: Hz
+    // @Range: 5 200
+    // @User: Advanced
+    AP_GROUPINFO("MINHZ", 5, SpectralAnalysis, _min_freq_hz, 20),
+
+    AP_GROUPEND
+};
+
+SpectralAnalysis::SpectralAnalysis(void) :
+    _sample_rate_hz(0),
+    _running(false),
+    _filling(0),
+    _fill_count(0),
+    _ready_window(0),
+    _window_ready(false),
+    _peaks_seq(0),
+    _axis_samples(nullptr),
+    _power(nullptr)
+{
+    AP_Param::setup_object_defaults(this, var_info);
+    _windows[0] = _windows[1] = nullptr;
+    _peaks.time_us = 0;
+}
+
+void SpectralAnalysis::init(uint16_t sample_rate_hz)
+{
+    if (!enabled() || _running || sample_rate_hz == 0) {
+        return;
+    }
+
+    if (!_fft.init(constrain_int16(_window_size, RealFFT::min_size, RealFFT::max_size))) {
+        hal.console->printf("SpectralAnalysis: no memory for FFT\n");
+        return;
+    }
+    const uint16_t size = _fft.size();
+    _windows[0] = new Vector3f[size];
+    _windows[1] = new Vector3f[size];
+    _axis_samples = new float[size];
+    _power = new float[_fft.num_bins()];
+    if (_windows[0] == nullptr || _windows[1] == nullptr ||
+        _axis_samples == nullptr || _power == nullptr) {
+        hal.console->printf("SpectralAnalysis: no memory for %u samples\n", (unsigned)size);
+        delete[] _windows[0];
+        delete[] _windows[1];
+        delete[] _axis_samples;
+        delete[] _power;
+        _windows[0] = _windows[1] = nullptr;
+        _axis_samples = _power = nullptr;
+        return;
+    }
+
+    _sample_rate_hz = sample_rate_hz;
+    hal.scheduler->register_io_process(FUNCTOR_BIND_MEMBER(&SpectralAnalysis::io_timer, void));
+    _running = true;
+}
+
+/*
+  a window that fills while the IO thread is still busy with the last
+  one is dropped, so every window analysed is a contiguous run of samples
+ */
+void SpectralAnalysis::push_samples(enum Sensor sensor, uint8_t instance,
+                                    const Vector3f *samples, uint8_t n_samples)
+{
+    if (!_running || sensor != _sensor || instance != _instance) {
+        return;
+    }
+
+    Vector3f *window = _windows[_filling];
+    for (uint8_t i = 0; i < n_samples; i++) {
+        window[_fill_count++] = samples[i];
+        if (_fill_count < _fft.size()) {
+            continue;
+        }
+        _fill_count = 0;
+        if (!_window_ready) {
+            _ready_window = _filling;
+            _window_ready = true;
+            _filling ^= 1;
+            window = _windows[_filling];
+        }
+    }
+}
+
+void SpectralAnalysis::io_timer(void)
+{
+    if (!_window_ready) {
+        return;
+    }
+    analyse(_windows[_ready_window]);
+    _window_ready = false;
+}
+
+/*
+  a copy of the peaks from a single window. The copy is retried if
+  the IO thread published a new window while it was being taken
+ */
+bool SpectralAnalysis::get_peaks(struct peaks &latest) const
+{
+    for (uint8_t tries = 0; tries < 3; tries++) {
+        const uint32_t seq = _peaks_seq;
+        if (seq & 1) {
+            continue;
+        }
+        latest = _peaks;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (_peaks_seq == seq) {
+            return seq != 0;
+        }
+    }
+    return false;
+}
+
+void SpectralAnalysis::analyse(const Vector3f *window)
+{
+    const uint16_t size = _fft.size();
+    const uint16_t num_bins = _fft.num_bins();
+    const float bin_width_hz = _sample_rate_hz / (float)size;
+    const uint16_t first_bin = constrain_int16(ceilf(_min_freq_hz / bin_width_hz), 1, num_bins - 1);
+
+    struct peaks latest;
+    for (uint8_t axis = 0; axis < 3; axis++) {
+        for (uint16_t i = 0; i < size; i++) {
+            _axis_samples[i] = window[i][axis];
+        }
+        _fft.power_spectrum(_axis_samples, _power);
+        float energy;
+        const float bin = RealFFT::find_peak(_power, num_bins, first_bin, energy);
+        latest.freq_hz[axis] = bin * bin_width_hz;
+        latest.energy[axis] = energy;
+    }
+    latest.time_us = AP_HAL::micros64();
+    _peaks_seq++;
+    _peaks = latest;
+    _peaks_seq++;
+
+    DataFlash_Class *dataflash = DataFlash_Class::instance();
+    if (dataflash != nullptr) {
+        struct log_FFT pkt = {
+            LOG_PACKET_HEADER_INIT(LOG_FFT_MSG),
+            time_us  : latest.time_us,
+            sensor   : (uint8_t)_sensor,
+            instance : (uint8_t)_instance,
+            freq_x   : latest.freq_hz.x,
+            freq_y   : latest.freq_hz.y,
+            freq_z   : latest.freq_hz.z,
+            energy_x : latest.energy.x,
+            energy_y : latest.energy.y,
+            energy_z : latest.energy.z
+        };
+        dataflash->WriteBlock(&pkt, sizeof(pkt));
+    }
+}
@@ -0,0 +1,94 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <atomic>
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_Math/AP_Math.h>
+#include <AP_Math/fft.h>
+#include <AP_Param/AP_Param.h>
+
+/*
+  spectrum of the raw samples of one gyro or accel. The backend fills
+  windows of samples and the IO thread transforms them, finding the
+  strongest peak on each axis, so vibration can be watched and notches
+  tuned in flight without logging raw samples
+ */
+class SpectralAnalysis {
+public:
+    enum Sensor {
+        SENSOR_GYRO  = 0,
+        SENSOR_ACCEL = 1,
+    };
+
+    SpectralAnalysis(void);
+
+    bool enabled(void) const { return _enable != 0; }
+    uint8_t sensor(void) const { return _sensor; }
+    uint8_t instance(void) const { return _instance; }
+
+    // allocate the buffers and start the IO process if enabled, for the
+    // raw sample rate of the chosen sensor
+    void init(uint16_t sample_rate_hz);
+
+    // raw samples from a backend, called in the backend's thread
+    void push_samples(enum Sensor sensor, uint8_t instance, const Vector3f *samples, uint8_t n_samples);
+
+    struct peaks {
+        // when the window was analysed, zero until the first one
+        uint64_t time_us;
+        Vector3f freq_hz;
+        // mean square of the peak on each axis
+        Vector3f energy;
+    };
+
+    // the strongest peak on each axis in the latest window. Returns
+    // false until a window has been analysed, or if the IO thread kept
+    // replacing the peaks while they were being copied
+    bool get_peaks(struct peaks &latest) const;
+
+    static const struct AP_Param::GroupInfo var_info[];
+
+private:
+    AP_Int8 _enable;
+    AP_Int8 _sensor;
+    AP_Int8 _instance;
+    AP_Int16 _window_size;
+    AP_Float _min_freq_hz;
+
+    RealFFT _fft;
+    uint16_t _sample_rate_hz;
+    bool _running;
+
+    // the backend fills one window while the IO thread analyses the other
+    Vector3f *_windows[2];
+    uint8_t _filling;
+    uint16_t _fill_count;
+    uint8_t _ready_window;
+    std::atomic<bool> _window_ready;
+
+    // one axis of a window, and its spectrum
+    float *_axis_samples;
+    float *_power;
+
+    // written by the IO thread and read by others, odd while a write
+    // is under way
+    std::atomic<uint32_t> _peaks_seq;
+    struct peaks _peaks;
+
+    void io_timer(void);
+    void analyse(const Vector3f *window);
+};
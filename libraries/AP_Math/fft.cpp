@@ -0,0 +1,188 @@
+/*
+ * This file is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "AP_Math.h"
+#include "fft.h"
+
+const uint16_t RealFFT::min_size;
+const uint16_t RealFFT::max_size;
+
+RealFFT::~RealFFT()
+{
+    free_tables();
+}
+
+void RealFFT::free_tables(void)
+{
+    delete[] _window;
+    delete[] _cos;
+    delete[] _sin;
+    delete[] _bit_reverse;
+    delete[] _re;
+    delete[] _im;
+    _window = _cos = _sin = _re = _im = nullptr;
+    _bit_reverse = nullptr;
+    _size = 0;
+}
+
+bool RealFFT::init(uint16_t size)
+{
+    uint16_t n = min_size;
+    while (n * 2 <= size && n * 2 <= max_size) {
+        n *= 2;
+    }
+
+    free_tables();
+
+    const uint16_t half = n / 2;
+    _window = new float[n];
+    _cos = new float[half];
+    _sin = new float[half];
+    _bit_reverse = new uint16_t[half];
+    _re = new float[half];
+    _im = new float[half];
+    if (_window == nullptr || _cos == nullptr || _sin == nullptr ||
+        _bit_reverse == nullptr || _re == nullptr || _im == nullptr) {
+        free_tables();
+        return false;
+    }
+    _size = n;
+
+    float window_sum = 0;
+    for (uint16_t i = 0; i < n; i++) {
+        _window[i] = 0.5f * (1.0f - cosf(2 * M_PI * i / n));
+        window_sum += _window[i];
+    }
+    // a sine of amplitude A on a bin centre comes out of the transform
+    // as A * window_sum / 2
+    _window_scale = 2.0f / sq(window_sum);
+
+    for (uint16_t k = 0; k < half; k++) {
+        _cos[k] = cosf(2 * M_PI * k / n);
+        _sin[k] = sinf(2 * M_PI * k / n);
+    }
+
+    uint8_t bits = 0;
+    while ((1U << bits) < half) {
+        bits++;
+    }
+    for (uint16_t i = 0; i < half; i++) {
+        uint16_t r = 0;
+        for (uint8_t b = 0; b < bits; b++) {
+            if (i & (1U << b)) {
+                r |= 1U << (bits - 1 - b);
+            }
+        }
+        _bit_reverse[i] = r;
+    }
+
+    return true;
+}
+
+/*
+  in place radix 2 decimation in time FFT of the size/2 points in _re
+  and _im, which are already in bit reversed order
+ */
+void RealFFT::complex_fft(void)
+{
+    const uint16_t m = _size / 2;
+
+    for (uint16_t len = 2; len <= m; len <<= 1) {
+        const uint16_t half_len = len / 2;
+        const uint16_t step = _size / len;
+        for (uint16_t i = 0; i < m; i += len) {
+            for (uint16_t j = 0; j < half_len; j++) {
+                const float wr = _cos[j * step];
+                const float wi = -_sin[j * step];
+                const uint16_t a = i + j;
+                const uint16_t b = a + half_len;
+                const float tr = _re[b] * wr - _im[b] * wi;
+                const float ti = _re[b] * wi + _im[b] * wr;
+                _re[b] = _re[a] - tr;
+                _im[b] = _im[a] - ti;
+                _re[a] += tr;
+                _im[a] += ti;
+            }
+        }
+    }
+}
+
+void RealFFT::power_spectrum(const float *samples, float *power)
+{
+    const uint16_t m = _size / 2;
+
+    // even samples as the real part, odd samples as the imaginary part
+    for (uint16_t k = 0; k < m; k++) {
+        const uint16_t r = _bit_reverse[k];
+        _re[r] = samples[2*k] * _window[2*k];
+        _im[r] = samples[2*k+1] * _window[2*k+1];
+    }
+
+    complex_fft();
+
+    /*
+      split into the transforms of the even and odd samples, E and O,
+      using the symmetry of the transform of a real sequence, then
+      X[k] = E[k] + O[k] * exp(-2*pi*i*k/size)
+     */
+    for (uint16_t k = 0; k <= m; k++) {
+        const uint16_t k1 = (k == m) ? 0 : k;
+        const uint16_t k2 = (k == 0) ? 0 : m - k;
+        const float zr = _re[k1];
+        const float zi = _im[k1];
+        const float cr = _re[k2];
+        const float ci = -_im[k2];
+
+        const float er = 0.5f * (zr + cr);
+        const float ei = 0.5f * (zi + ci);
+        const float or_ = 0.5f * (zi - ci);
+        const float oi = -0.5f * (zr - cr);
+
+        const float wr = (k == m) ? -1.0f : _cos[k];
+        const float wi = (k == m) ? 0.0f : -_sin[k];
+        const float xr = er + or_ * wr - oi * wi;
+        const float xi = ei + or_ * wi + oi * wr;
+
+        power[k] = (sq(xr) + sq(xi)) * _window_scale;
+    }
+}
+
+float RealFFT::find_peak(const float *power, uint16_t num_bins, uint16_t first_bin,
+                         float &peak_power)
+{
+    uint16_t peak = 0;
+    peak_power = 0;
+    for (uint16_t i = first_bin; i < num_bins; i++) {
+        if (power[i] > peak_power) {
+            peak_power = power[i];
+            peak = i;
+        }
+    }
+    if (peak_power <= 0) {
+        return 0;
+    }
+
+    // the fit is on magnitudes, which suits the shape of the Hann window's peak
+    float offset = 0;
+    if (peak > 0 && peak < num_bins - 1) {
+        const float a = sqrtf(power[peak-1]);
+        const float b = sqrtf(power[peak]);
+        const float c = sqrtf(power[peak+1]);
+        const float denom = a - 2 * b + c;
+        if (denom < 0) {
+            offset = 0.5f * (a - c) / denom;
+        }
+    }
+    return peak + offset;
+}
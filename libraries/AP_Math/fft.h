@@ -0,0 +1,69 @@
+/*
+ * This file is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <stdint.h>
+
+/*
+  FFT of a window of real samples, with a Hann window applied first.
+  The size is a power of two fixed at init(). The real input is packed
+  into a complex FFT of half the size, which is then split into the
+  spectrum of the real signal
+ */
+class RealFFT {
+public:
+    static const uint16_t min_size = 16;
+    static const uint16_t max_size = 1024;
+
+    ~RealFFT();
+
+    // allocate the tables for a size, which is rounded down to a power
+    // of two. Returns false if there is not the memory
+    bool init(uint16_t size);
+
+    uint16_t size(void) const { return _size; }
+
+    // number of bins in the spectrum, from 0Hz to the Nyquist frequency
+    uint16_t num_bins(void) const { return _size / 2 + 1; }
+
+    /*
+      window and transform size() samples, leaving num_bins() values in
+      power. A sine centred on a bin gives its mean square, half the
+      square of its amplitude, in that bin
+     */
+    void power_spectrum(const float *samples, float *power);
+
+    /*
+      the largest bin of a spectrum at or above first_bin, with its
+      position refined between bins by fitting a parabola through it
+      and its neighbours
+     */
+    static float find_peak(const float *power, uint16_t num_bins, uint16_t first_bin,
+                           float &peak_power);
+
+private:
+    uint16_t _size = 0;
+    float _window_scale;
+    float *_window = nullptr;
+    // cos and sin of 2*pi*k/size, for k from 0 to size/2-1
+    float *_cos = nullptr;
+    float *_sin = nullptr;
+    uint16_t *_bit_reverse = nullptr;
+    float *_re = nullptr;
+    float *_im = nullptr;
+
+    void free_tables(void);
+    void complex_fft(void);
+};
@@ -0,0 +1,52 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <stdint.h>
+
+/*
+  small linear congruential generator for tests and benchmarks. The
+  sequence depends only on the seed, so failures can be reproduced on
+  any board. Not suitable for anything that needs real randomness.
+ */
+class PseudoRandom {
+public:
+    PseudoRandom(uint32_t seed) : _state(seed) {}
+
+    // next 32 bit value. The low bits have short periods, so prefer the
+    // helpers below to taking a modulus of this
+    uint32_t next(void) {
+        _state = _state * 1664525U + 1013904223U;
+        return _state;
+    }
+
+    // uniform byte
+    uint8_t next_byte(void) {
+        return next() >> 24;
+    }
+
+    // uniform integer from 0 to n-1
+    uint32_t next_below(uint32_t n) {
+        return ((uint64_t)next() * n) >> 32;
+    }
+
+    // uniform float from -1 up to, but not including, 1
+    float next_float(void) {
+        return (int32_t)next() * (1.0f / 2147483648.0f);
+    }
+
+private:
+    uint32_t _state;
+};
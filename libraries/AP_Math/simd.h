@@ -0,0 +1,92 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+/*
+  minimal portable 4 wide float vector type. Maps onto SSE on x86
+  and NEON on ARM, with a plain scalar implementation for everything
+  else so callers need no conditional code of their own.
+
+  Loads and stores are unaligned, so any float array may be used.
+ */
+
+#if defined(__SSE__)
+#define AP_SIMD_SSE 1
+#define AP_SIMD_NEON 0
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define AP_SIMD_SSE 0
+#define AP_SIMD_NEON 1
+#include <arm_neon.h>
+#else
+#define AP_SIMD_SSE 0
+#define AP_SIMD_NEON 0
+#endif
+
+#if AP_SIMD_SSE
+
+typedef __m128 simd_float4;
+
+static inline simd_float4 simd_load4(const float *p) { return _mm_loadu_ps(p); }
+static inline void simd_store4(float *p, simd_float4 v) { _mm_storeu_ps(p, v); }
+static inline simd_float4 simd_splat4(float f) { return _mm_set1_ps(f); }
+static inline simd_float4 simd_add4(simd_float4 a, simd_float4 b) { return _mm_add_ps(a, b); }
+static inline simd_float4 simd_sub4(simd_float4 a, simd_float4 b) { return _mm_sub_ps(a, b); }
+static inline simd_float4 simd_mul4(simd_float4 a, simd_float4 b) { return _mm_mul_ps(a, b); }
+// acc + a*b
+static inline simd_float4 simd_madd4(simd_float4 acc, simd_float4 a, simd_float4 b) { return _mm_add_ps(acc, _mm_mul_ps(a, b)); }
+
+#elif AP_SIMD_NEON
+
+typedef float32x4_t simd_float4;
+
+static inline simd_float4 simd_load4(const float *p) { return vld1q_f32(p); }
+static inline void simd_store4(float *p, simd_float4 v) { vst1q_f32(p, v); }
+static inline simd_float4 simd_splat4(float f) { return vdupq_n_f32(f); }
+static inline simd_float4 simd_add4(simd_float4 a, simd_float4 b) { return vaddq_f32(a, b); }
+static inline simd_float4 simd_sub4(simd_float4 a, simd_float4 b) { return vsubq_f32(a, b); }
+static inline simd_float4 simd_mul4(simd_float4 a, simd_float4 b) { return vmulq_f32(a, b); }
+// acc + a*b
+static inline simd_float4 simd_madd4(simd_float4 acc, simd_float4 a, simd_float4 b) { return vmlaq_f32(acc, a, b); }
+
+#else
+
+struct simd_float4 {
+    float v[4];
+};
+
+static inline simd_float4 simd_load4(const float *p) { return simd_float4{{p[0], p[1], p[2], p[3]}}; }
+static inline void simd_store4(float *p, simd_float4 a) { p[0] = a.v[0]; p[1] = a.v[1]; p[2] = a.v[2]; p[3] = a.v[3]; }
+static inline simd_float4 simd_splat4(float f) { return simd_float4{{f, f, f, f}}; }
+static inline simd_float4 simd_add4(simd_float4 a, simd_float4 b)
+{
+    return simd_float4{{a.v[0]+b.v[0], a.v[1]+b.v[1], a.v[2]+b.v[2], a.v[3]+b.v[3]}};
+}
+static inline simd_float4 simd_sub4(simd_float4 a, simd_float4 b)
+{
+    return simd_float4{{a.v[0]-b.v[0], a.v[1]-b.v[1], a.v[2]-b.v[2], a.v[3]-b.v[3]}};
+}
+static inline simd_float4 simd_mul4(simd_float4 a, simd_float4 b)
+{
+    return simd_float4{{a.v[0]*b.v[0], a.v[1]*b.v[1], a.v[2]*b.v[2], a.v[3]*b.v[3]}};
+}
+// acc + a*b
+static inline simd_float4 simd_madd4(simd_float4 acc, simd_float4 a, simd_float4 b)
+{
+    return simd_float4{{acc.v[0]+a.v[0]*b.v[0], acc.v[1]+a.v[1]*b.v[1],
+                        acc.v[2]+a.v[2]*b.v[2], acc.v[3]+a.v[3]*b.v[3]}};
+}
+
+#endif
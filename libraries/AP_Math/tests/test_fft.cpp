@@ -0,0 +1,93 @@
+#include "math_test.h"
+#include <AP_Math/fft.h>
+#include <AP_Math/pseudo_random.h>
+
+#define SAMPLE_FREQ 1000.0f
+
+/*
+  power spectrum by a direct DFT of the windowed samples, scaled as
+  RealFFT scales it
+ */
+static void dft_power(const float *samples, uint16_t n, float *power)
+{
+    float window[RealFFT::max_size];
+    float window_sum = 0;
+    for (uint16_t i = 0; i < n; i++) {
+        window[i] = 0.5f * (1.0f - cosf(2 * M_PI * i / n));
+        window_sum += window[i];
+    }
+    for (uint16_t k = 0; k <= n / 2; k++) {
+        double re = 0, im = 0;
+        for (uint16_t i = 0; i < n; i++) {
+            re += samples[i] * window[i] * cos(2 * M_PI * k * i / n);
+            im -= samples[i] * window[i] * sin(2 * M_PI * k * i / n);
+        }
+        power[k] = (re * re + im * im) * 2 / (window_sum * window_sum);
+    }
+}
+
+TEST(RealFFTTest, MatchesDFT)
+{
+    for (uint16_t n = RealFFT::min_size; n <= 256; n *= 2) {
+        RealFFT fft;
+        ASSERT_TRUE(fft.init(n));
+        EXPECT_EQ(n, fft.size());
+        EXPECT_EQ(n / 2 + 1, fft.num_bins());
+
+        float samples[256];
+        PseudoRandom prng(n);
+        for (uint16_t i = 0; i < n; i++) {
+            samples[i] = prng.next_float() + 0.3f;
+        }
+
+        float power[129];
+        float expected[129];
+        fft.power_spectrum(samples, power);
+        dft_power(samples, n, expected);
+        for (uint16_t k = 0; k <= n / 2; k++) {
+            EXPECT_NEAR(expected[k], power[k], 1.0e-4f * MAX(1.0f, expected[k])) << "size " << n << " bin " << k;
+        }
+    }
+}
+
+TEST(RealFFTTest, Size)
+{
+    RealFFT fft;
+
+    // rounded down to a power of two, within the limits
+    EXPECT_TRUE(fft.init(200));
+    EXPECT_EQ(128, fft.size());
+    EXPECT_TRUE(fft.init(5));
+    EXPECT_EQ(RealFFT::min_size, fft.size());
+    EXPECT_TRUE(fft.init(60000));
+    EXPECT_EQ(RealFFT::max_size, fft.size());
+}
+
+TEST(RealFFTTest, SinePeak)
+{
+    RealFFT fft;
+    ASSERT_TRUE(fft.init(256));
+
+    const float freqs[] { 47.0f, 83.3f, 151.9f, 312.5f };
+    for (uint8_t f = 0; f < ARRAY_SIZE(freqs); f++) {
+        float samples[256];
+        for (uint16_t i = 0; i < 256; i++) {
+            const float t = i / SAMPLE_FREQ;
+            samples[i] = 2.0f * sinf(2 * M_PI * freqs[f] * t) + 0.2f * sinf(2 * M_PI * 7 * t);
+        }
+
+        float power[129];
+        float peak_power;
+        fft.power_spectrum(samples, power);
+
+        // skip the low frequency motion below 20Hz
+        const float bin = RealFFT::find_peak(power, fft.num_bins(), 20 * 256 / SAMPLE_FREQ, peak_power);
+        const float bin_width = SAMPLE_FREQ / 256;
+        EXPECT_NEAR(freqs[f], bin * bin_width, 0.25f * bin_width);
+        // the mean square of an amplitude 2 sine is 2, less the scalloping loss between bins
+        EXPECT_GT(peak_power, 1.0f);
+        EXPECT_LE(peak_power, 2.01f);
+    }
+}
+
+AP_GTEST_MAIN()
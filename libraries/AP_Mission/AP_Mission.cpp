@@ -40,6 +40,10 @@ void AP_Mission::init()
     // command list will be cleared if they do not match
     check_eeprom_version();
 
+#if AP_MISSION_CMD_CACHE_ENABLED
+    init_cmd_cache();
+#endif
+
     // prevent an easy programming error, this will be optimised out
     if (sizeof(union Content) != 12) {
         AP_HAL::panic("AP_Mission Content must be 12 bytes");
@@ -285,6 +289,12 @@ bool AP_Mission::get_next_nav_cmd(uint16_t start_index, Mission_Command& cmd)
 
     // search until the end of the mission command list
     while(cmd_index < (unsigned)_cmd_total) {
+        // skip over "do" commands
+        cmd_index = next_nav_or_jump_index(cmd_index);
+        if (cmd_index >= (unsigned)_cmd_total) {
+            break;
+        }
+
         // get next command
         if (!get_next_cmd(cmd_index, cmd, false)) {
             // no more commands so return failure
@@ -444,31 +454,41 @@ bool AP_Mission::read_cmd_from_storage(uint16_t index, Mission_Command& cmd) con
         cmd.id = MAV_CMD_NAV_WAYPOINT;
         cmd.p1 = 0;
         cmd.content.location = _ahrs.get_home();
+#if AP_MISSION_CMD_CACHE_ENABLED
+    }else if (_cmd_cache != nullptr && index < num_commands_max()) {
+        cmd = _cmd_cache[index];
+#endif
     }else{
-        // Find out proper location in memory by using the start_byte position + the index
-        // we can load a command, we don't process it yet
-        // read WP position
-        uint16_t pos_in_storage = 4 + (index * AP_MISSION_EEPROM_COMMAND_SIZE);
-
-        uint8_t b1 = _storage.read_byte(pos_in_storage);
-        if (b1 == 0) {
-            cmd.id = _storage.read_uint16(pos_in_storage+1);
-            cmd.p1 = _storage.read_uint16(pos_in_storage+3);
-            _storage.read_block(cmd.content.bytes, pos_in_storage+5, 10);
-        } else {
-            cmd.id = b1;
-            cmd.p1 = _storage.read_uint16(pos_in_storage+1);
-            _storage.read_block(cmd.content.bytes, pos_in_storage+3, 12);
-        }
-
-        // set command's index to it's position in eeprom
-        cmd.index = index;
+        decode_cmd_from_storage(index, cmd);
     }
 
     // return success
     return true;
 }
 
+/// decode_cmd_from_storage - decode command from its packed form in storage
+void AP_Mission::decode_cmd_from_storage(uint16_t index, Mission_Command& cmd) const
+{
+    // Find out proper location in memory by using the start_byte position + the index
+    // we can load a command, we don't process it yet
+    // read WP position
+    uint16_t pos_in_storage = 4 + (index * AP_MISSION_EEPROM_COMMAND_SIZE);
+
+    uint8_t b1 = _storage.read_byte(pos_in_storage);
+    if (b1 == 0) {
+        cmd.id = _storage.read_uint16(pos_in_storage+1);
+        cmd.p1 = _storage.read_uint16(pos_in_storage+3);
+        _storage.read_block(cmd.content.bytes, pos_in_storage+5, 10);
+    } else {
+        cmd.id = b1;
+        cmd.p1 = _storage.read_uint16(pos_in_storage+1);
+        _storage.read_block(cmd.content.bytes, pos_in_storage+3, 12);
+    }
+
+    // set command's index to it's position in eeprom
+    cmd.index = index;
+}
+
 /// write_cmd_to_storage - write a command to storage
 ///     index is used to calculate the storage location
 ///     true is returned if successful
@@ -494,6 +514,16 @@ bool AP_Mission::write_cmd_to_storage(uint16_t index, Mission_Command& cmd)
         _storage.write_block(pos_in_storage+5, cmd.content.bytes, 10);
     }
 
+#if AP_MISSION_CMD_CACHE_ENABLED
+    if (_cmd_cache != nullptr) {
+        // decode what was stored rather than copying cmd, so the cache
+        // matches storage exactly
+        _cmd_cache[index] = {};
+        decode_cmd_from_storage(index, _cmd_cache[index]);
+        _cmd_cache_total = AP_MISSION_CMD_INDEX_NONE;
+    }
+#endif
+
     // remember when the mission last changed
     _last_change_time_ms = AP_HAL::millis();
 
@@ -1309,6 +1339,17 @@ bool AP_Mission::advance_current_nav_cmd()
 
     // search until we find next nav command or reach end of command list
     while (!_flags.nav_cmd_loaded) {
+        if (_flags.do_cmd_loaded) {
+            // the "do" commands before the next nav or jump command would
+            // only be counted against max_loops, so skip them
+            uint16_t next_index = next_nav_or_jump_index(cmd_index);
+            if (next_index - cmd_index > max_loops) {
+                return false;
+            }
+            max_loops -= next_index - cmd_index;
+            cmd_index = next_index;
+        }
+
         // get next command
         if (!get_next_cmd(cmd_index, cmd, true)) {
             return false;
@@ -1574,6 +1615,67 @@ void AP_Mission::check_eeprom_version()
     }
 }
 
+/// next_nav_or_jump_index - returns the index of the first "navigation" or do-jump command at or after index
+///     the "do" and "conditional" commands before it can be skipped when searching for a "navigation" command
+///     returns index if this isn't known
+uint16_t AP_Mission::next_nav_or_jump_index(uint16_t index)
+{
+#if AP_MISSION_CMD_CACHE_ENABLED
+    if (_cmd_cache_next_stop != nullptr) {
+        update_cmd_cache_next_stop();
+        if (index < _cmd_cache_total) {
+            return _cmd_cache_next_stop[index];
+        }
+    }
+#endif
+    return index;
+}
+
+#if AP_MISSION_CMD_CACHE_ENABLED
+/// init_cmd_cache - allocate the command cache and fill it from storage
+void AP_Mission::init_cmd_cache()
+{
+    if (_cmd_cache != nullptr) {
+        return;
+    }
+    const uint16_t count = num_commands_max();
+    _cmd_cache = new Mission_Command[count]();
+    _cmd_cache_next_stop = new uint16_t[count];
+    if (_cmd_cache == nullptr || _cmd_cache_next_stop == nullptr) {
+        // run from storage
+        delete[] _cmd_cache;
+        delete[] _cmd_cache_next_stop;
+        _cmd_cache = nullptr;
+        _cmd_cache_next_stop = nullptr;
+        return;
+    }
+    for (uint16_t i=0; i<count; i++) {
+        decode_cmd_from_storage(i, _cmd_cache[i]);
+    }
+    _cmd_cache_total = AP_MISSION_CMD_INDEX_NONE;
+}
+
+/// update_cmd_cache_next_stop - rebuild the next nav or do-jump index after the mission has changed
+///     _cmd_total is a parameter so may change without a command being written
+void AP_Mission::update_cmd_cache_next_stop()
+{
+    const uint16_t total = MIN((uint16_t)_cmd_total, num_commands_max());
+    if (total == _cmd_cache_total) {
+        return;
+    }
+    uint16_t next_stop = total;
+    for (int32_t i=total-1; i>=0; i--) {
+        // command #0 is home which is always a waypoint
+        const Mission_Command &cmd = _cmd_cache[i];
+        if (i == 0 || is_nav_cmd(cmd) || cmd.id == MAV_CMD_DO_JUMP) {
+            next_stop = i;
+        }
+        _cmd_cache_next_stop[i] = next_stop;
+    }
+    _cmd_cache_total = total;
+}
+#endif
+
 /*
   return total number of commands that can fit in storage space
  */
@@ -37,6 +37,17 @@
 
 #define AP_MISSION_RESTART_DEFAULT          0       // resume the mission from the last command run by default
 
+/*
+  keep a decoded copy of every command in RAM, so reading a command
+  doesn't go through storage, along with the index of the next
+  navigation or do-jump command after each one. It costs about 20
+  bytes per command, so is only enabled by default on boards with
+  plenty of memory
+ */
+#ifndef AP_MISSION_CMD_CACHE_ENABLED
+#define AP_MISSION_CMD_CACHE_ENABLED (HAL_CPU_CLASS >= HAL_CPU_CLASS_1000)
+#endif
+
 /// @class    AP_Mission
 /// @brief    Object managing Mission
 class AP_Mission {
@@ -269,6 +280,11 @@ public:
         _prev_nav_cmd_index(AP_MISSION_CMD_INDEX_NONE),
         _prev_nav_cmd_wp_index(AP_MISSION_CMD_INDEX_NONE),
         _last_change_time_ms(0)
+#if AP_MISSION_CMD_CACHE_ENABLED
+        ,_cmd_cache(nullptr),
+        _cmd_cache_next_stop(nullptr),
+        _cmd_cache_total(AP_MISSION_CMD_INDEX_NONE)
+#endif
     {
         // load parameter defaults
         AP_Param::setup_object_defaults(this, var_info);
@@ -482,6 +498,22 @@ private:
     /// command list will be cleared if they do not match
     void check_eeprom_version();
 
+    /// decode_cmd_from_storage - decode command from its packed form in storage
+    void decode_cmd_from_storage(uint16_t index, Mission_Command& cmd) const;
+
+    /// next_nav_or_jump_index - returns the index of the first "navigation" or do-jump command at or after index
+    ///     the "do" and "conditional" commands before it can be skipped when searching for a "navigation" command
+    ///     returns index if this isn't known
+    uint16_t next_nav_or_jump_index(uint16_t index);
+
+#if AP_MISSION_CMD_CACHE_ENABLED
+    /// init_cmd_cache - allocate the command cache and fill it from storage
+    void init_cmd_cache();
+
+    /// update_cmd_cache_next_stop - rebuild the next nav or do-jump index after the mission has changed
+    void update_cmd_cache_next_stop();
+#endif
+
     // references to external libraries
     const AP_AHRS&   _ahrs;      // used only for home position
 
@@ -509,4 +541,13 @@ private:
 
     // last time that mission changed
     uint32_t _last_change_time_ms;
+
+#if AP_MISSION_CMD_CACHE_ENABLED
+    // decoded copy of each command in storage, kept up to date by write_cmd_to_storage()
+    Mission_Command *_cmd_cache;
+    // index of the first nav or do-jump command at or after each command
+    uint16_t *_cmd_cache_next_stop;
+    // number of commands _cmd_cache_next_stop was built for, AP_MISSION_CMD_INDEX_NONE when it needs rebuilding
+    uint16_t _cmd_cache_total;
+#endif
 };
@@ -491,6 +491,14 @@ const AP_Param::GroupInfo NavEKF2::var_info[] = {
     // @User: Advanced
     AP_GROUPINFO("TERR_GRAD", 43, NavEKF2, _terrGradMax, 0.1f),
 
+    // @Param: PARALLEL
+    // @DisplayName: Run EKF cores in parallel
+    // @Description: When enabled, each EKF core is updated on its own CPU on boards that support it, so that multiple IMUs cost the time of one. Has no effect on boards with a single CPU.
+    // @Values: 0:Disabled,1:Enabled
+    // @User: Advanced
+    // @RebootRequired: True
+    AP_GROUPINFO("PARALLEL", 44, NavEKF2, _parallelCores, 0),
+
     AP_GROUPEND
 };
 
@@ -639,17 +647,24 @@ void NavEKF2::UpdateFilter(void)
     
     const AP_InertialSensor &ins = _ahrs->get_ins();
 
-    for (uint8_t i=0; i<num_cores; i++) {
-        // if the previous core has only recently finished a new state prediction cycle, then
-        // don't start a new cycle to allow time for fusion operations to complete if the update
-        // rate is higher than 200Hz
-        bool statePredictEnabled;
-        if ((i > 0) && (core[i-1].getFramesSincePredict() < 2) && (ins.get_sample_rate() > 200)) {
-            statePredictEnabled = false;
-        } else {
-            statePredictEnabled = true;
+    // when each core has its own CPU there is no need to stagger
+    // their state predictions, so they all predict when they can
+    const bool ran_parallel = _parallelCores && num_cores > 1 &&
+        hal.scheduler->run_parallel(FUNCTOR_BIND_MEMBER(&NavEKF2::UpdateCore, void, uint8_t), num_cores);
+
+    if (!ran_parallel) {
+        for (uint8_t i=0; i<num_cores; i++) {
+            // if the previous core has only recently finished a new state prediction cycle, then
+            // don't start a new cycle to allow time for fusion operations to complete if the update
+            // rate is higher than 200Hz
+            bool statePredictEnabled;
+            if ((i > 0) && (core[i-1].getFramesSincePredict() < 2) && (ins.get_sample_rate() > 200)) {
+                statePredictEnabled = false;
+            } else {
+                statePredictEnabled = true;
+            }
+            core[i].UpdateFilter(statePredictEnabled);
         }
-        core[i].UpdateFilter(statePredictEnabled);
     }
 
     // If the current core selected has a bad fault score or is unhealthy, switch to a healthy core with the lowest fault score
@@ -675,6 +690,12 @@ void NavEKF2::UpdateFilter(void)
     check_log_write();
 }
 
+// update a single core, called on a worker thread by run_parallel()
+void NavEKF2::UpdateCore(uint8_t i)
+{
+    core[i].UpdateFilter(true);
+}
+
 // Check basic filter health metrics and return a consolidated health status
 bool NavEKF2::healthy(void) const
 {
@@ -290,6 +290,9 @@ public:
     bool have_ekf_logging(void) const { return logging.enabled && _logging_mask != 0; }
     
 private:
+    // update a single core
+    void UpdateCore(uint8_t i);
+
     uint8_t num_cores; // number of allocated cores
     uint8_t primary;   // current primary core
     NavEKF2_core *core = nullptr;
@@ -341,6 +344,7 @@ private:
     AP_Int8 _tauVelPosOutput;       // Time constant of output complementary filter : csec (centi-seconds)
     AP_Int8 _useRngSwHgt;           // Maximum valid range of the range finder in metres
     AP_Float _terrGradMax;          // Maximum terrain gradient below the vehicle
+    AP_Int8 _parallelCores;         // Update each core on its own CPU where the board supports it
 
     // Tuning parameters
     const float gpsNEVelVarAccScale;    // Scale factor applied to NE velocity measurement variance due to manoeuvre acceleration
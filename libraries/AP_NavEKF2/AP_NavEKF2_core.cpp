@@ -874,6 +874,56 @@ void NavEKF2_core::CovariancePrediction()
         zeroCols(P,22,23);
     }
 
+#if EK2_VECTORISED_COVARIANCE
+    predictCovarianceVectorised(daxNoise, dayNoise, dazNoise, dvxNoise, dvyNoise, dvzNoise);
+#else
+    predictCovarianceSymbolic(daxNoise, dayNoise, dazNoise, dvxNoise, dvyNoise, dvzNoise);
+#endif
+
+    // add the general state process noise variances
+    for (uint8_t i=0; i<=stateIndexLim; i++)
+    {
+        nextP[i][i] = nextP[i][i] + processNoise[i];
+    }
+
+    // if the total position variance exceeds 1e4 (100m), then stop covariance
+    // growth by setting the predicted to the previous values
+    // This prevent an ill conditioned matrix from occurring for long periods
+    // without GPS
+    if ((P[6][6] + P[7][7]) > 1e4f)
+    {
+        for (uint8_t i=6; i<=7; i++)
+        {
+            for (uint8_t j=0; j<=stateIndexLim; j++)
+            {
+                nextP[i][j] = P[i][j];
+                nextP[j][i] = P[j][i];
+            }
+        }
+    }
+
+    // copy covariances to output
+    CopyCovariances();
+
+    // constrain diagonals to prevent ill-conditioning
+    ConstrainVariances();
+
+    hal.util->perf_end(_perf_CovariancePrediction);
+}
+
+/*
+  calculate nextP = F*P*transpose(F) + G*Q*transpose(G) using the
+  symbolically derived equations. The SF, SG, SQ and SPP intermediate
+  variables must already have been set by CovariancePrediction()
+*/
+void NavEKF2_core::predictCovarianceSymbolic(float daxNoise, float dayNoise, float dazNoise,
+                                             float dvxNoise, float dvyNoise, float dvzNoise)
+{
+    const float q0 = stateStruct.quat[0];
+    const float q1 = stateStruct.quat[1];
+    const float q2 = stateStruct.quat[2];
+    const float q3 = stateStruct.quat[3];
+
     nextP[0][0] = daxNoise*SQ[3] + SPP[5]*(P[0][0]*SPP[5] - P[1][0]*SPP[4] + P[9][0]*SPP[22] + P[12][0]*SPP[18] + P[2][0]*(2*q1*SF[3] - 2*q2*SF[4] - 2*q3*SF[5] + 2*q0*SF[9])) - SPP[4]*(P[0][1]*SPP[5] - P[1][1]*SPP[4] + P[9][1]*SPP[22] + P[12][1]*SPP[18] + P[2][1]*(2*q1*SF[3] - 2*q2*SF[4] - 2*q3*SF[5] + 2*q0*SF[9])) + SPP[8]*(P[0][2]*SPP[5] + P[2][2]*SPP[8] + P[9][2]*SPP[22] + P[12][2]*SPP[18] - P[1][2]*(2*q0*SF[6] - 2*q3*SF[7] - 2*q1*SF[10] + 2*q2*SF[12])) + SPP[22]*(P[0][9]*SPP[5] - P[1][9]*SPP[4] + P[9][9]*SPP[22] + P[12][9]*SPP[18] + P[2][9]*(2*q1*SF[3] - 2*q2*SF[4] - 2*q3*SF[5] + 2*q0*SF[9])) + SPP[18]*(P[0][12]*SPP[5] - P[1][12]*SPP[4] + P[9][12]*SPP[22] + P[12][12]*SPP[18] + P[2][12]*(2*q1*SF[3] - 2*q2*SF[4] - 2*q3*SF[5] + 2*q0*SF[9]));
     nextP[0][1] = SPP[6]*(P[0][1]*SPP[5] - P[1][1]*SPP[4] + P[2][1]*SPP[8] + P[9][1]*SPP[22] + P[12][1]*SPP[18]) - SPP[2]*(P[0][0]*SPP[5] - P[1][0]*SPP[4] + P[2][0]*SPP[8] + P[9][0]*SPP[22] + P[12][0]*SPP[18]) + SPP[22]*(P[0][10]*SPP[5] - P[1][10]*SPP[4] + P[2][10]*SPP[8] + P[9][10]*SPP[22] + P[12][10]*SPP[18]) + SPP[17]*(P[0][13]*SPP[5] - P[1][13]*SPP[4] + P[2][13]*SPP[8] + P[9][13]*SPP[22] + P[12][13]*SPP[18]) - (2*q0*SF[5] - 2*q1*SF[4] - 2*q2*SF[3] + 2*q3*SF[9])*(P[0][2]*SPP[5] - P[1][2]*SPP[4] + P[2][2]*SPP[8] + P[9][2]*SPP[22] + P[12][2]*SPP[18]);
     nextP[1][1] = dayNoise*SQ[3] - SPP[2]*(P[1][0]*SPP[6] - P[0][0]*SPP[2] - P[2][0]*SPP[9] + P[10][0]*SPP[22] + P[13][0]*SPP[17]) + SPP[6]*(P[1][1]*SPP[6] - P[0][1]*SPP[2] - P[2][1]*SPP[9] + P[10][1]*SPP[22] + P[13][1]*SPP[17]) - SPP[9]*(P[1][2]*SPP[6] - P[0][2]*SPP[2] - P[2][2]*SPP[9] + P[10][2]*SPP[22] + P[13][2]*SPP[17]) + SPP[22]*(P[1][10]*SPP[6] - P[0][10]*SPP[2] - P[2][10]*SPP[9] + P[10][10]*SPP[22] + P[13][10]*SPP[17]) + SPP[17]*(P[1][13]*SPP[6] - P[0][13]*SPP[2] - P[2][13]*SPP[9] + P[10][13]*SPP[22] + P[13][13]*SPP[17]);
@@ -1189,36 +1239,102 @@ void NavEKF2_core::CovariancePrediction()
             nextP[colIndex][rowIndex] = nextP[rowIndex][colIndex];
         }
     }
+}
 
-    // add the general state process noise variances
-    for (uint8_t i=0; i<=stateIndexLim; i++)
-    {
-        nextP[i][i] = nextP[i][i] + processNoise[i];
+/*
+  calculate nextP = F*P*transpose(F) + G*Q*transpose(G), exploiting the
+  structure of the state transition matrix F. Only rows 0 to 8 (angle
+  error, velocity and position) differ from the identity and each has
+  at most five non-zero elements, so F*P is formed from a few scaled
+  row additions using 4 wide SIMD operations. Only the top left 9x9
+  block then needs further work, the rest is copied from F*P or P.
+  This gives the same result as predictCovarianceSymbolic() to within
+  floating point rounding.
+*/
+void NavEKF2_core::predictCovarianceVectorised(float daxNoise, float dayNoise, float dazNoise,
+                                               float dvxNoise, float dvyNoise, float dvzNoise)
+{
+    const uint8_t n = stateIndexLim + 1;
+    const float q0 = stateStruct.quat[0];
+    const float q1 = stateStruct.quat[1];
+    const float q2 = stateStruct.quat[2];
+    const float q3 = stateStruct.quat[3];
+
+    // non-zero elements of rows 0 to 8 of the state transition matrix,
+    // padded with zeros so that every row has five
+    struct sparse_row {
+        uint8_t col[5];
+        float val[5];
+    };
+    const sparse_row F[9] = {
+        { { 0, 1, 2,  9, 12 }, { SPP[5], -SPP[4], SPP[8], SPP[22], SPP[18] } },
+        { { 0, 1, 2, 10, 13 }, { -SPP[2], SPP[6], -SPP[9], SPP[22], SPP[17] } },
+        { { 0, 1, 2, 11, 14 }, { SPP[14], -SPP[3], SPP[13], SPP[22], SPP[16] } },
+        { { 3, 0, 1, 2, 15 }, { 1.0f, SPP[1], SPP[19], SPP[15], -SPP[21] } },
+        { { 4, 0, 1, 2, 15 }, { 1.0f, SPP[20], SPP[12], SPP[11], SF[22] } },
+        { { 5, 0, 1, 2, 15 }, { 1.0f, -SPP[7], SPP[10], SPP[0], SF[20] } },
+        { { 6, 3, 0, 0, 0 }, { 1.0f, dt, 0.0f, 0.0f, 0.0f } },
+        { { 7, 4, 0, 0, 0 }, { 1.0f, dt, 0.0f, 0.0f, 0.0f } },
+        { { 8, 5, 0, 0, 0 }, { 1.0f, dt, 0.0f, 0.0f, 0.0f } },
+    };
+
+    // rows 0 to 8 of F*P. Rows of P are 24 floats, so each is six vectors
+    float FP[9][24];
+    for (uint8_t i=0; i<9; i++) {
+        const sparse_row &row = F[i];
+        for (uint8_t k=0; k<24; k+=4) {
+            simd_float4 sum = simd_mul4(simd_splat4(row.val[0]), simd_load4(&P[row.col[0]][k]));
+            for (uint8_t j=1; j<5; j++) {
+                sum = simd_madd4(sum, simd_splat4(row.val[j]), simd_load4(&P[row.col[j]][k]));
+            }
+            simd_store4(&FP[i][k], sum);
+        }
     }
 
-    // if the total position variance exceeds 1e4 (100m), then stop covariance
-    // growth by setting the predicted to the previous values
-    // This prevent an ill conditioned matrix from occurring for long periods
-    // without GPS
-    if ((P[6][6] + P[7][7]) > 1e4f)
-    {
-        for (uint8_t i=6; i<=7; i++)
-        {
-            for (uint8_t j=0; j<=stateIndexLim; j++)
-            {
-                nextP[i][j] = P[i][j];
-                nextP[j][i] = P[j][i];
+    // the top right block is F*P and the top left block is
+    // F*P*transpose(F), of which only the upper triangle is needed
+    for (uint8_t i=0; i<9; i++) {
+        for (uint8_t k=0; k<24; k+=4) {
+            simd_store4(&nextP[i][k], simd_load4(&FP[i][k]));
+        }
+        for (uint8_t j=i; j<9; j++) {
+            const sparse_row &row = F[j];
+            float sum = 0.0f;
+            for (uint8_t k=0; k<5; k++) {
+                sum += FP[i][row.col[k]] * row.val[k];
             }
+            nextP[i][j] = sum;
         }
     }
 
-    // copy covariances to output
-    CopyCovariances();
-
-    // constrain diagonals to prevent ill-conditioning
-    ConstrainVariances();
+    // rows 9 and above of F are the identity, so the bottom right block
+    // is copied from P and the bottom left block is the transpose of F*P
+    for (uint8_t i=9; i<n; i++) {
+        for (uint8_t k=0; k<24; k+=4) {
+            simd_store4(&nextP[i][k], simd_load4(&P[i][k]));
+        }
+        for (uint8_t j=0; j<9; j++) {
+            nextP[i][j] = FP[j][i];
+        }
+    }
 
-    hal.util->perf_end(_perf_CovariancePrediction);
+    // add the delta angle and delta velocity noise, G*Q*transpose(G)
+    nextP[0][0] += daxNoise*SQ[3];
+    nextP[1][1] += dayNoise*SQ[3];
+    nextP[2][2] += dazNoise*SQ[3];
+    nextP[3][3] += dvyNoise*sq(SQ[6] - 2*q0*q3) + dvzNoise*sq(SQ[5] + 2*q0*q2) + dvxNoise*sq(SG[1] + SG[2] - SG[3] - SQ[7]);
+    nextP[3][4] += SQ[2];
+    nextP[3][5] += SQ[1];
+    nextP[4][4] += dvxNoise*sq(SQ[6] + 2*q0*q3) + dvzNoise*sq(SQ[4] - 2*q0*q1) + dvyNoise*sq(SG[1] - SG[2] + SG[3] - SQ[7]);
+    nextP[4][5] += SQ[0];
+    nextP[5][5] += dvxNoise*sq(SQ[5] - 2*q0*q2) + dvyNoise*sq(SQ[4] + 2*q0*q1) + dvzNoise*sq(SG[1] - SG[2] - SG[3] + SQ[7]);
+
+    // copy the upper triangle of the top left block to the lower triangle
+    for (uint8_t i=1; i<9; i++) {
+        for (uint8_t j=0; j<i; j++) {
+            nextP[i][j] = nextP[j][i];
+        }
+    }
 }
 
 // zero specified range of rows in the state covariance matrix
@@ -22,11 +22,17 @@
 
 #define EK2_DISABLE_INTERRUPTS 0
 
+// use the sparse covariance prediction rather than the symbolic
+// equations when the CPU has 4 wide float vector instructions
+#ifndef EK2_VECTORISED_COVARIANCE
+#define EK2_VECTORISED_COVARIANCE (AP_SIMD_SSE || AP_SIMD_NEON)
+#endif
 
 #include <AP_Math/AP_Math.h>
 #include "AP_NavEKF2.h"
 #include <stdio.h>
 #include <AP_Math/vectorN.h>
+#include <AP_Math/simd.h>
 #include <AP_NavEKF2/AP_NavEKF2_Buffer.h>
 
 // GPS pre-flight check bit locations
@@ -48,6 +54,9 @@ class AP_AHRS;
 
 class NavEKF2_core
 {
+    friend class NavEKF2_core_Bench;
+    friend class NavEKF2_core_Test;
+
 public:
     // Constructor
     NavEKF2_core(void);
@@ -415,6 +424,14 @@ private:
     // calculate the predicted state covariance matrix
     void CovariancePrediction();
 
+    // calculate nextP from P using the symbolically derived equations
+    void predictCovarianceSymbolic(float daxNoise, float dayNoise, float dazNoise,
+                                   float dvxNoise, float dvyNoise, float dvzNoise);
+
+    // calculate nextP from P using the sparsity of the state transition matrix
+    void predictCovarianceVectorised(float daxNoise, float dayNoise, float dazNoise,
+                                     float dvxNoise, float dvyNoise, float dvzNoise);
+
     // force symmetry on the state covariance matrix
     void ForceSymmetry();
 
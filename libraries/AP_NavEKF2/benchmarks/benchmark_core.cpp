@@ -0,0 +1,281 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+  Benchmarks for the NavEKF2 prediction and fusion steps.
+
+  Each step is run from the same snapshot of a core that has been
+  initialised to a level, slowly moving vehicle with representative
+  sensor samples. The snapshot is restored before every call so that
+  the fusion steps always take the same path through the code, which
+  means the timings include copying the covariance matrix and states
+  back (about 2.4kB).
+ */
+#include <AP_gbenchmark.h>
+
+#include <AP_AHRS/AP_AHRS.h>
+#include <AP_Baro/AP_Baro.h>
+#include <AP_GPS/AP_GPS.h>
+#include <AP_InertialSensor/AP_InertialSensor.h>
+#include <AP_NavEKF/AP_NavEKF.h>
+#include <AP_NavEKF2/AP_NavEKF2.h>
+#include <AP_NavEKF2/AP_NavEKF2_core.h>
+#include <AP_RangeFinder/AP_RangeFinder.h>
+#include <AP_SerialManager/AP_SerialManager.h>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+/*
+  the sensor and AHRS objects a NavEKF2 frontend needs to exist
+ */
+class BenchVehicle {
+public:
+    AP_InertialSensor ins;
+    AP_Baro baro;
+    AP_GPS gps;
+    AP_SerialManager serial_manager;
+    RangeFinder rng {serial_manager};
+    NavEKF EKF {&ahrs, baro, rng};
+    NavEKF2 EKF2 {&ahrs, baro, rng};
+    AP_AHRS_NavEKF ahrs {ins, baro, gps, rng, EKF, EKF2};
+};
+
+static BenchVehicle vehicle;
+
+/*
+  count CPU cycles with the kernel's hardware counters, where allowed
+ */
+class CycleCounter {
+public:
+    CycleCounter()
+    {
+#if defined(__linux__)
+        struct perf_event_attr attr {};
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CPU_CYCLES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        _fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+    }
+
+    ~CycleCounter()
+    {
+#if defined(__linux__)
+        if (_fd != -1) {
+            close(_fd);
+        }
+#endif
+    }
+
+    void start()
+    {
+#if defined(__linux__)
+        if (_fd != -1) {
+            ioctl(_fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(_fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    // stop counting and label the benchmark with cycles per iteration
+    void stop(benchmark::State &state)
+    {
+#if defined(__linux__)
+        uint64_t cycles = 0;
+        if (_fd == -1) {
+            return;
+        }
+        ioctl(_fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(_fd, &cycles, sizeof(cycles)) != sizeof(cycles) ||
+            state.iterations() == 0) {
+            return;
+        }
+        char label[32];
+        snprintf(label, sizeof(label), "%.0f cycles",
+                 (double)cycles / state.iterations());
+        state.SetLabel(label);
+#endif
+    }
+
+private:
+    int _fd = -1;
+};
+
+/*
+  drive the private prediction and fusion steps of a core
+ */
+class NavEKF2_core_Bench {
+public:
+    NavEKF2_core_Bench()
+    {
+        core.setup_core(&vehicle.EKF2, 0, 0);
+        core.InitialiseVariables();
+
+        // level, pointing north-east, moving slowly north at 10m height
+        core.stateStruct.quat.from_euler(0.02f, -0.03f, radians(45));
+        core.stateStruct.velocity = Vector3f(1.5f, 0.2f, -0.1f);
+        core.stateStruct.position = Vector3f(12.0f, -4.0f, -10.0f);
+        core.stateStruct.gyro_bias.zero();
+        core.stateStruct.gyro_scale = Vector3f(1.0f, 1.0f, 1.0f);
+        core.stateStruct.accel_zbias = 0.0f;
+        core.stateStruct.earth_magfield = Vector3f(0.22f, 0.01f, 0.42f);
+        core.stateStruct.body_magfield.zero();
+        core.stateStruct.wind_vel = Vector2f(2.0f, -1.0f);
+        core.CovarianceInit();
+
+        // allow all states to be estimated
+        core.inhibitWindStates = false;
+        core.inhibitMagStates = false;
+        core.inhibitGndState = false;
+        core.tiltAlignComplete = true;
+        core.yawAlignComplete = true;
+        core.PV_AidingMode = NavEKF2_core::AID_ABSOLUTE;
+        core.stateStruct.quat.inverse().rotation_matrix(core.prevTnb);
+
+        // one IMU sample at 400Hz
+        core.imuDataDelayed.delAng = Vector3f(0.0001f, -0.0002f, 0.0003f);
+        core.imuDataDelayed.delVel = Vector3f(0.001f, 0.002f, -GRAVITY_MSS * 0.0025f);
+        core.imuDataDelayed.delAngDT = 0.0025f;
+        core.imuDataDelayed.delVelDT = 0.0025f;
+        core.dtIMUavg = 0.0025f;
+
+        // GPS and baro samples close to the predicted states
+        core.gpsDataDelayed.vel = Vector3f(1.6f, 0.15f, -0.05f);
+        core.gpsDataDelayed.pos = Vector2f(12.3f, -4.2f);
+        core.gpsDataDelayed.hgt = 10.2f;
+        core.hgtMea = 10.1f;
+        core.activeHgtSource = HGT_SOURCE_BARO;
+
+        // magnetometer sample close to the predicted field
+        core.magDataDelayed.mag = Vector3f(0.16f, -0.15f, 0.42f);
+
+        core.tasDataDelayed.tas = 3.0f;
+
+        // optical flow sample consistent with 1.5m/s at 10m
+        core.ofDataDelayed.flowRadXYcomp = Vector2f(0.02f, -0.15f);
+        core.ofDataDelayed.body_offset = &zero_offset;
+        core.ofDataDelayed.bodyRadXYZ.zero();
+        core.terrainState = 0.0f;
+        core.rngOnGnd = 0.1f;
+
+        memcpy(&snapshot_states, &core.statesArray, sizeof(snapshot_states));
+        memcpy(&snapshot_P, &core.P, sizeof(snapshot_P));
+
+        // set the covariance prediction intermediate variables
+        core.CovariancePrediction();
+        restore();
+    }
+
+    // return to the initial snapshot
+    void restore()
+    {
+        memcpy(&core.statesArray, &snapshot_states, sizeof(snapshot_states));
+        memcpy(&core.P, &snapshot_P, sizeof(snapshot_P));
+    }
+
+    void covariance_prediction()
+    {
+        restore();
+        core.CovariancePrediction();
+    }
+
+    // just the nextP calculation, using each of the implementations.
+    // The SF, SG, SQ and SPP intermediates come from the constructor
+    void predict_symbolic()
+    {
+        core.predictCovarianceSymbolic(da_noise, da_noise, da_noise, dv_noise, dv_noise, dv_noise);
+    }
+
+    void predict_vectorised()
+    {
+        core.predictCovarianceVectorised(da_noise, da_noise, da_noise, dv_noise, dv_noise, dv_noise);
+    }
+
+    void fuse_vel_pos_ned()
+    {
+        restore();
+        core.fuseVelData = true;
+        core.fusePosData = true;
+        core.fuseHgtData = true;
+        core.FuseVelPosNED();
+    }
+
+    void fuse_magnetometer()
+    {
+        restore();
+        for (core.mag_state.obsIndex = 0; core.mag_state.obsIndex <= 2; core.mag_state.obsIndex++) {
+            core.FuseMagnetometer();
+        }
+    }
+
+    void fuse_airspeed()
+    {
+        restore();
+        core.FuseAirspeed();
+    }
+
+    void fuse_optflow()
+    {
+        restore();
+        core.FuseOptFlow();
+    }
+
+private:
+    NavEKF2_core core;
+    NavEKF2_core::Vector28 snapshot_states;
+    NavEKF2_core::Matrix24 snapshot_P;
+    const Vector3f zero_offset;
+    const float da_noise = sq(0.0025f * 1.5e-2f);
+    const float dv_noise = sq(0.0025f * 6.0e-1f);
+};
+
+static NavEKF2_core_Bench *get_bench()
+{
+    static NavEKF2_core_Bench *bench = new NavEKF2_core_Bench();
+    return bench;
+}
+
+#define EKF2_BENCHMARK(name, method)                      \
+    static void name(benchmark::State &state)             \
+    {                                                     \
+        NavEKF2_core_Bench *bench = get_bench();          \
+        CycleCounter counter;                             \
+        counter.start();                                  \
+        while (state.KeepRunning()) {                     \
+            bench->method();                              \
+            gbenchmark_clobber();                         \
+        }                                                 \
+        counter.stop(state);                              \
+    }                                                     \
+    BENCHMARK(name)
+
+EKF2_BENCHMARK(BM_EKF2_CovariancePrediction, covariance_prediction);
+EKF2_BENCHMARK(BM_EKF2_PredictSymbolic, predict_symbolic);
+EKF2_BENCHMARK(BM_EKF2_PredictVectorised, predict_vectorised);
+EKF2_BENCHMARK(BM_EKF2_FuseVelPosNED, fuse_vel_pos_ned);
+EKF2_BENCHMARK(BM_EKF2_FuseMagnetometer, fuse_magnetometer);
+EKF2_BENCHMARK(BM_EKF2_FuseAirspeed, fuse_airspeed);
+EKF2_BENCHMARK(BM_EKF2_FuseOptFlow, fuse_optflow);
+
+BENCHMARK_MAIN()
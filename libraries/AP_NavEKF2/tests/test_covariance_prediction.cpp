@@ -0,0 +1,130 @@
+/*
+  check that the vectorised covariance prediction gives the same
+  result as the symbolically derived equations
+ */
+#include <AP_gtest.h>
+
+#include <AP_AHRS/AP_AHRS.h>
+#include <AP_Baro/AP_Baro.h>
+#include <AP_GPS/AP_GPS.h>
+#include <AP_InertialSensor/AP_InertialSensor.h>
+#include <AP_Math/pseudo_random.h>
+#include <AP_NavEKF/AP_NavEKF.h>
+#include <AP_NavEKF2/AP_NavEKF2.h>
+#include <AP_NavEKF2/AP_NavEKF2_core.h>
+#include <AP_RangeFinder/AP_RangeFinder.h>
+#include <AP_SerialManager/AP_SerialManager.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+class TestVehicle {
+public:
+    AP_InertialSensor ins;
+    AP_Baro baro;
+    AP_GPS gps;
+    AP_SerialManager serial_manager;
+    RangeFinder rng {serial_manager};
+    NavEKF EKF {&ahrs, baro, rng};
+    NavEKF2 EKF2 {&ahrs, baro, rng};
+    AP_AHRS_NavEKF ahrs {ins, baro, gps, rng, EKF, EKF2};
+};
+
+static TestVehicle vehicle;
+
+class NavEKF2_core_Test {
+public:
+    NavEKF2_core_Test()
+    {
+        core.setup_core(&vehicle.EKF2, 0, 0);
+        core.InitialiseVariables();
+    }
+
+    /*
+      set up a random attitude, IMU sample and positive definite
+      covariance matrix, then run both forms of the prediction and
+      return the largest difference relative to the size of the
+      covariances involved
+     */
+    float compare(uint32_t seed, uint8_t stateIndexLim)
+    {
+        PseudoRandom prng(seed);
+        core.stateIndexLim = stateIndexLim;
+        core.inhibitMagStates = stateIndexLim < 21;
+        core.inhibitWindStates = stateIndexLim < 23;
+
+        core.stateStruct.quat.from_euler(prng.next_float() * 0.5f,
+                                         prng.next_float() * 0.5f,
+                                         prng.next_float() * M_PI);
+        core.stateStruct.gyro_bias = Vector3f(prng.next_float(), prng.next_float(), prng.next_float()) * 1.0e-4f;
+        core.stateStruct.gyro_scale = Vector3f(1, 1, 1) + Vector3f(prng.next_float(), prng.next_float(), prng.next_float()) * 0.01f;
+        core.stateStruct.accel_zbias = prng.next_float() * 1.0e-3f;
+        core.imuDataDelayed.delAng = Vector3f(prng.next_float(), prng.next_float(), prng.next_float()) * 0.01f;
+        core.imuDataDelayed.delVel = Vector3f(prng.next_float(), prng.next_float(), prng.next_float() - GRAVITY_MSS) * 0.0025f;
+        core.imuDataDelayed.delAngDT = 0.0025f;
+        core.imuDataDelayed.delVelDT = 0.0025f;
+
+        // P = A*transpose(A) scaled by typical state uncertainties
+        static const float sigma[24] = {
+            0.1f, 0.1f, 0.1f, 0.5f, 0.5f, 0.5f, 5.0f, 5.0f, 5.0f,
+            1e-4f, 1e-4f, 1e-4f, 1e-3f, 1e-3f, 1e-3f, 1e-3f,
+            0.05f, 0.05f, 0.05f, 0.05f, 0.05f, 0.05f, 1.0f, 1.0f
+        };
+        float A[24][24];
+        for (uint8_t i=0; i<24; i++) {
+            for (uint8_t j=0; j<24; j++) {
+                A[i][j] = sigma[i] * prng.next_float();
+            }
+        }
+        for (uint8_t i=0; i<24; i++) {
+            for (uint8_t j=0; j<24; j++) {
+                float sum = 0;
+                for (uint8_t k=0; k<24; k++) {
+                    sum += A[i][k] * A[j][k];
+                }
+                core.P[i][j] = sum;
+            }
+        }
+
+        // sets the SF, SG, SQ and SPP intermediate variables
+        NavEKF2_core::Matrix24 P;
+        memcpy(&P, &core.P, sizeof(P));
+        core.CovariancePrediction();
+        memcpy(&core.P, &P, sizeof(P));
+
+        // default gyro and accel noise at 400Hz
+        const float daNoise = sq(core.dt * 1.5e-2f);
+        const float dvNoise = sq(core.dt * 6.0e-1f);
+
+        core.predictCovarianceSymbolic(daNoise, daNoise, daNoise, dvNoise, dvNoise, dvNoise);
+        NavEKF2_core::Matrix24 expected;
+        memcpy(&expected, &core.nextP, sizeof(expected));
+
+        core.predictCovarianceVectorised(daNoise, daNoise, daNoise, dvNoise, dvNoise, dvNoise);
+
+        float max_error = 0;
+        for (uint8_t i=0; i<=stateIndexLim; i++) {
+            for (uint8_t j=0; j<=stateIndexLim; j++) {
+                const float scale = sqrtf(expected[i][i] * expected[j][j]);
+                const float error = fabsf(core.nextP[i][j] - expected[i][j]) / scale;
+                max_error = MAX(max_error, error);
+            }
+        }
+        return max_error;
+    }
+
+private:
+    NavEKF2_core core;
+};
+
+TEST(NavEKF2Test, VectorisedCovariancePrediction)
+{
+    NavEKF2_core_Test test;
+    const uint8_t limits[] = { 15, 21, 23 };
+    for (uint32_t seed=1; seed<=100; seed++) {
+        for (uint8_t i=0; i<ARRAY_SIZE(limits); i++) {
+            EXPECT_LT(test.compare(seed, limits[i]), 1.0e-5f);
+        }
+    }
+}
+
+AP_GTEST_MAIN()
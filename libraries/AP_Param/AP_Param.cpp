@@ -105,6 +105,10 @@ void AP_Param::erase_all(void)
 
     // add a sentinal directly after the header
     write_sentinal(sizeof(struct EEPROM_header));
+
+#if AP_PARAM_INDEX_ENABLED
+    storage_map_invalidate();
+#endif
 }
 
 /* the 'group_id' of a element of a group is the 18 bit identifier
@@ -457,6 +461,17 @@ const struct AP_Param::Info *AP_Param::find_var_info(uint32_t *
                                                      struct GroupNesting        &group_nesting,
                                                      uint8_t *                  idx) const
 {
+#if AP_PARAM_INDEX_ENABLED
+    const struct index_entry *entry = find_index_entry(this);
+    if (entry != nullptr) {
+        const struct AP_Param::Info *info = find_var_info_token(entry->token, group_element, group_ret, group_nesting, idx);
+        if (info != nullptr) {
+            return info;
+        }
+        group_nesting.level = 0;
+    }
+#endif
+
     group_ret = nullptr;
     
     for (uint16_t i=0; i<_num_vars; i++) {
@@ -589,6 +604,11 @@ bool AP_Param::is_sentinal(const Param_header &phdr)
 // if the sentinal isn't found either, the offset is set to 0xFFFF
 bool AP_Param::scan(const AP_Param::Param_header *target, uint16_t *pofs)
 {
+#if AP_PARAM_INDEX_ENABLED
+    if (_storage_map_valid || build_storage_map()) {
+        return scan_indexed(target, pofs);
+    }
+#endif
     struct Param_header phdr;
     uint16_t ofs = sizeof(AP_Param::EEPROM_header);
     while (ofs < _storage.size()) {
@@ -740,6 +760,12 @@ AP_Param::find_group(const char *name, uint16_t vindex, ptrdiff_t group_offset,
 AP_Param *
 AP_Param::find(const char *name, enum ap_var_type *ptype)
 {
+#if AP_PARAM_INDEX_ENABLED
+    AP_Param *ap = find_indexed(name, ptype);
+    if (ap != nullptr) {
+        return ap;
+    }
+#endif
     for (uint16_t i=0; i<_num_vars; i++) {
         uint8_t type = _var_info[i].type;
         if (type == AP_PARAM_GROUP) {
@@ -792,11 +818,24 @@ AP_Param::find_def_value_ptr(const char *name)
     return &info->def_value;
 }
 
-// Find a variable by index. Note that this is quite slow.
+// Find a variable by index. Note that this is quite slow without the
+// parameter index.
 //
 AP_Param *
 AP_Param::find_by_index(uint16_t idx, enum ap_var_type *ptype, ParamToken *token)
 {
+#if AP_PARAM_INDEX_ENABLED
+    if (index_ready()) {
+        if (idx >= _index_count) {
+            return nullptr;
+        }
+        *token = _index[idx].token;
+        if (ptype != nullptr) {
+            *ptype = (enum ap_var_type)_index[idx].type;
+        }
+        return _index[idx].ap;
+    }
+#endif
     AP_Param *ap;
     uint16_t count=0;
     for (ap=AP_Param::first(token, ptype);
@@ -949,7 +988,7 @@ bool AP_Param::save(bool force_save)
 
     if (phdr.type == AP_PARAM_INT8 && ginfo != nullptr && (ginfo->flags & AP_PARAM_FLAG_ENABLE)) {
         // clear cached parameter count
-        _parameter_count = 0;
+        invalidate_count();
     }
     
     char name[AP_MAX_NAME_SIZE+1];
@@ -1000,6 +1039,9 @@ bool AP_Param::save(bool force_save)
     write_sentinal(ofs + sizeof(phdr) + type_size((enum ap_var_type)phdr.type));
     eeprom_write_check(ap, ofs+sizeof(phdr), type_size((enum ap_var_type)phdr.type));
     eeprom_write_check(&phdr, ofs, sizeof(phdr));
+#if AP_PARAM_INDEX_ENABLED
+    storage_map_add(phdr, ofs);
+#endif
 
     send_parameter(name, (enum ap_var_type)phdr.type, idx);
     return true;
@@ -1229,12 +1271,31 @@ bool AP_Param::load_all(void)
     }
 #endif
 
+#if AP_PARAM_SNAPSHOT_ENABLED
+    if (load_snapshot()) {
+        invalidate_count();
+        return true;
+    }
+
+    // record where everything is loaded to for the next boot
+    struct snapshot_record *records = new snapshot_record[snapshot_max_records()];
+    uint16_t num_records = 0;
+#endif
+
     while (ofs < _storage.size()) {
         _storage.read_block(&phdr, ofs, sizeof(phdr));
         // note that this is an || not an && for robustness
         // against power off while adding a variable
         if (is_sentinal(phdr)) {
-            // we've reached the sentinal
+            // we've reached the sentinal. Loaded values may have
+            // changed which parameters are visible
+            invalidate_count();
+#if AP_PARAM_SNAPSHOT_ENABLED
+            if (records != nullptr) {
+                save_snapshot(records, num_records);
+            }
+            delete[] records;
+#endif
             return true;
         }
 
@@ -1245,10 +1306,17 @@ bool AP_Param::load_all(void)
         if (info != nullptr) {
             _storage.read_block(ptr, ofs+sizeof(phdr), type_size((enum ap_var_type)phdr.type));
         }
+#if AP_PARAM_SNAPSHOT_ENABLED
+        snapshot_add(records, num_records, phdr, info, ptr);
+#endif
 
         ofs += type_size((enum ap_var_type)phdr.type) + sizeof(phdr);
     }
 
+#if AP_PARAM_SNAPSHOT_ENABLED
+    delete[] records;
+#endif
+
     // we didn't find the sentinal
     Debug("no sentinal in load_all");
     return false;
@@ -1269,6 +1337,10 @@ void AP_Param::load_object_from_eeprom(const void *object_pointer, const struct
         hal.console->printf("ERROR: Unable to find param pointer\n");
         return;
     }
+
+    // the parameters of a newly allocated object need adding to
+    // the count and index
+    invalidate_count();
     
     for (uint8_t i=0; group_info[i].type != AP_PARAM_NONE; i++) {
         if (group_info[i].type == AP_PARAM_GROUP) {
@@ -1837,6 +1909,11 @@ void AP_Param::send_parameter(const char *name, enum ap_var_type var_type, uint8
 uint16_t AP_Param::count_parameters(void)
 {
     // if we haven't cached the parameter count yet...
+#if AP_PARAM_INDEX_ENABLED
+    if (0 == _parameter_count) {
+        build_index();
+    }
+#endif
     if (0 == _parameter_count) {
         AP_Param  *vp;
         AP_Param::ParamToken token;
@@ -31,6 +31,30 @@
 
 #define AP_MAX_NAME_SIZE 16
 
+/*
+  keep an index of the parameter tree and of the parameter storage so
+  lookups by name, index and pointer and saves don't need to walk all
+  the parameters. It costs a few tens of bytes per parameter, so is
+  only enabled by default on boards with plenty of memory
+ */
+#ifndef AP_PARAM_INDEX_ENABLED
+#define AP_PARAM_INDEX_ENABLED (HAL_CPU_CLASS >= HAL_CPU_CLASS_1000)
+#endif
+
+/*
+  remember where each variable in storage was loaded to, so the next
+  load_all() can load every parameter with one storage read and
+  without searching var_info. Boards enable this by giving a
+  directory for the snapshot file
+ */
+#ifndef AP_PARAM_SNAPSHOT_ENABLED
+#ifdef HAL_PARAM_SNAPSHOT_DIR
+#define AP_PARAM_SNAPSHOT_ENABLED 1
+#else
+#define AP_PARAM_SNAPSHOT_ENABLED 0
+#endif
+#endif
+
 /*
   flags for variables in var_info and group tables
  */
@@ -346,7 +370,20 @@ public:
     // count of parameters in tree
     static uint16_t count_parameters(void);
 
-    static void set_hide_disabled_groups(bool value) { _hide_disabled_groups = value; }
+    static void set_hide_disabled_groups(bool value) {
+        _hide_disabled_groups = value;
+        invalidate_count();
+    }
+
+    // forget the cached parameter count, and the parameter index, as
+    // the set of visible parameters may have changed
+    static void invalidate_count(void) { _parameter_count = 0; }
+
+#if AP_PARAM_SNAPSHOT_ENABLED
+    // remove the load_all() snapshot, so the next load_all() walks
+    // all of storage and writes a new one
+    static void remove_snapshot(void);
+#endif
 
 private:
     /// EEPROM header
@@ -475,6 +512,77 @@ private:
 
     // send a parameter to all GCS instances
     void send_parameter(const char *name, enum ap_var_type param_header_type, uint8_t idx) const;
+
+#if AP_PARAM_INDEX_ENABLED
+    /*
+      index of the scalar parameters, in the same order as
+      first()/next_scalar(). It is rebuilt whenever the parameter
+      count needs to be recalculated
+     */
+    struct index_entry {
+        AP_Param *ap;
+        ParamToken token;
+        uint32_t name_hash;
+        uint8_t type;
+    };
+    static struct index_entry *_index;
+    static uint16_t *_index_by_name;    // entries sorted by name_hash
+    static uint16_t *_index_by_ptr;     // entries sorted by ap
+    static uint16_t _index_count;
+
+    /*
+      location of every variable in storage, sorted by header, and the
+      offset of the sentinal
+     */
+    struct storage_entry {
+        uint32_t id;
+        uint16_t ofs;
+    };
+    static struct storage_entry *_storage_map;
+    static uint16_t _storage_map_count;
+    static uint16_t _storage_map_size;
+    static uint16_t _storage_end;
+    static bool _storage_map_valid;
+
+    static uint32_t name_hash(const char *name);
+    static uint32_t storage_id(const Param_header &phdr);
+    static void free_index(void);
+    static void build_index(void);
+    static bool index_ready(void);
+    static AP_Param *find_indexed(const char *name, enum ap_var_type *ptype);
+    static const struct index_entry *find_index_entry(const AP_Param *ap);
+    static bool build_storage_map(void);
+    static bool scan_indexed(const Param_header *target, uint16_t *pofs);
+    static void storage_map_add(const Param_header &phdr, uint16_t ofs);
+    static void storage_map_invalidate(void);
+    static int compare_by_name(const void *a, const void *b);
+    static int compare_by_ptr(const void *a, const void *b);
+    static int compare_storage(const void *a, const void *b);
+#endif
+
+#if AP_PARAM_SNAPSHOT_ENABLED
+    /*
+      one record per variable in storage, in storage order, giving
+      where it was loaded to as an offset from its top level variable
+     */
+    struct snapshot_record {
+        Param_header phdr;
+        uint32_t offset;
+        uint16_t vindex;
+        uint16_t spare;
+    };
+
+    static uint32_t layout_hash(void);
+    static uint32_t layout_hash_group(uint32_t h, const struct GroupInfo *group_info);
+    static bool group_has_pointer(const struct GroupInfo *group_info);
+    static bool snapshot_needs_lookup(uint16_t key);
+    static uint16_t snapshot_max_records(void);
+    static void snapshot_add(struct snapshot_record *records, uint16_t &count,
+                             const Param_header &phdr, const struct Info *info, const void *ptr);
+    static bool read_snapshot(struct snapshot_record *&records, uint16_t &count);
+    static bool load_snapshot(void);
+    static void save_snapshot(const struct snapshot_record *records, uint16_t count);
+#endif
     
     static StorageAccess        _storage;
     static uint16_t             _num_vars;
@@ -0,0 +1,349 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+  indexes over the parameter tree and parameter storage
+
+  Without these finding a parameter by name or index walks every
+  parameter, and saving one walks every var_info entry and then every
+  header in storage, which makes a full parameter download or a burst
+  of parameter sets quadratic in the number of parameters.
+
+  The tree index is built from one first()/next_scalar() walk whenever
+  the parameter count is recalculated. The storage map is built from
+  one walk of storage on first use and kept up to date as variables
+  are added. Anything not found in an index falls back to the full
+  search, so hidden parameters and parameters of objects allocated
+  after the index was built are still found.
+ */
+
+#include "AP_Param.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if AP_PARAM_INDEX_ENABLED
+
+struct AP_Param::index_entry *AP_Param::_index;
+uint16_t *AP_Param::_index_by_name;
+uint16_t *AP_Param::_index_by_ptr;
+uint16_t AP_Param::_index_count;
+
+struct AP_Param::storage_entry *AP_Param::_storage_map;
+uint16_t AP_Param::_storage_map_count;
+uint16_t AP_Param::_storage_map_size;
+uint16_t AP_Param::_storage_end;
+bool AP_Param::_storage_map_valid;
+
+// FNV-1a hash of a parameter name
+uint32_t AP_Param::name_hash(const char *name)
+{
+    uint32_t h = 2166136261U;
+    while (*name) {
+        h = (h ^ (uint8_t)*name++) * 16777619U;
+    }
+    return h;
+}
+
+// pack a storage header into a single sortable value
+uint32_t AP_Param::storage_id(const Param_header &phdr)
+{
+    return (((uint32_t)get_key(phdr)) << 23) | (((uint32_t)phdr.type) << 18) | phdr.group_element;
+}
+
+int AP_Param::compare_by_name(const void *a, const void *b)
+{
+    const uint16_t i1 = *(const uint16_t *)a;
+    const uint16_t i2 = *(const uint16_t *)b;
+    const uint32_t h1 = _index[i1].name_hash;
+    const uint32_t h2 = _index[i2].name_hash;
+    if (h1 != h2) {
+        return h1 < h2 ? -1 : 1;
+    }
+    // keep equal hashes in tree order so the first match wins, as in find()
+    return (int)i1 - (int)i2;
+}
+
+int AP_Param::compare_by_ptr(const void *a, const void *b)
+{
+    const uint16_t i1 = *(const uint16_t *)a;
+    const uint16_t i2 = *(const uint16_t *)b;
+    const ptrdiff_t p1 = (ptrdiff_t)_index[i1].ap;
+    const ptrdiff_t p2 = (ptrdiff_t)_index[i2].ap;
+    if (p1 != p2) {
+        return p1 < p2 ? -1 : 1;
+    }
+    return (int)i1 - (int)i2;
+}
+
+int AP_Param::compare_storage(const void *a, const void *b)
+{
+    const struct storage_entry *e1 = (const struct storage_entry *)a;
+    const struct storage_entry *e2 = (const struct storage_entry *)b;
+    if (e1->id != e2->id) {
+        return e1->id < e2->id ? -1 : 1;
+    }
+    return (int)e1->ofs - (int)e2->ofs;
+}
+
+void AP_Param::free_index(void)
+{
+    delete[] _index;
+    delete[] _index_by_name;
+    delete[] _index_by_ptr;
+    _index = nullptr;
+    _index_by_name = nullptr;
+    _index_by_ptr = nullptr;
+    _index_count = 0;
+}
+
+/*
+  walk the parameter tree, setting _parameter_count and building the
+  index. If there isn't the memory for the index only the count is set
+ */
+void AP_Param::build_index(void)
+{
+    free_index();
+
+    ParamToken token;
+    enum ap_var_type type;
+    uint16_t count = 0;
+    AP_Param *ap = first(&token, &type);
+    do {
+        count++;
+    } while (nullptr != (ap = next_scalar(&token, &type)));
+    _parameter_count = count;
+
+    _index = new index_entry[count];
+    _index_by_name = new uint16_t[count];
+    _index_by_ptr = new uint16_t[count];
+    if (_index == nullptr || _index_by_name == nullptr || _index_by_ptr == nullptr) {
+        free_index();
+        return;
+    }
+
+    uint16_t n = 0;
+    for (ap = first(&token, &type);
+         ap != nullptr && n < count;
+         ap = next_scalar(&token, &type)) {
+        struct index_entry &e = _index[n];
+        e.ap = ap;
+        e.token = token;
+        e.type = type;
+        char name[AP_MAX_NAME_SIZE+1];
+        ap->copy_name_token(token, name, sizeof(name), true);
+        name[AP_MAX_NAME_SIZE] = 0;
+        e.name_hash = name_hash(name);
+        _index_by_name[n] = n;
+        _index_by_ptr[n] = n;
+        n++;
+    }
+    _index_count = n;
+
+    qsort(_index_by_name, n, sizeof(_index_by_name[0]), compare_by_name);
+    qsort(_index_by_ptr, n, sizeof(_index_by_ptr[0]), compare_by_ptr);
+}
+
+// return true if the index is up to date, rebuilding it if needed
+bool AP_Param::index_ready(void)
+{
+    if (_var_info == nullptr) {
+        return false;
+    }
+    if (_parameter_count == 0) {
+        build_index();
+    }
+    return _index != nullptr && _index_count == _parameter_count;
+}
+
+/*
+  find a scalar parameter by its exact name. Returns nullptr if it is
+  not in the index
+ */
+AP_Param *AP_Param::find_indexed(const char *name, enum ap_var_type *ptype)
+{
+    if (!index_ready()) {
+        return nullptr;
+    }
+    const uint32_t h = name_hash(name);
+
+    // find the first entry with this hash
+    uint16_t lo = 0, hi = _index_count;
+    while (lo < hi) {
+        const uint16_t mid = (lo + hi) / 2;
+        if (_index[_index_by_name[mid]].name_hash < h) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    for (; lo < _index_count && _index[_index_by_name[lo]].name_hash == h; lo++) {
+        const struct index_entry &e = _index[_index_by_name[lo]];
+        char name2[AP_MAX_NAME_SIZE+1];
+        e.ap->copy_name_token(e.token, name2, sizeof(name2), true);
+        name2[AP_MAX_NAME_SIZE] = 0;
+        if (strncmp(name, name2, AP_MAX_NAME_SIZE) == 0) {
+            *ptype = (enum ap_var_type)e.type;
+            return e.ap;
+        }
+    }
+    return nullptr;
+}
+
+/*
+  find the index entry for a parameter by pointer. The first element
+  of a Vector3f shares its address with the vector
+ */
+const struct AP_Param::index_entry *AP_Param::find_index_entry(const AP_Param *ap)
+{
+    if (!index_ready()) {
+        return nullptr;
+    }
+    uint16_t lo = 0, hi = _index_count;
+    while (lo < hi) {
+        const uint16_t mid = (lo + hi) / 2;
+        if ((ptrdiff_t)_index[_index_by_ptr[mid]].ap < (ptrdiff_t)ap) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo < _index_count && _index[_index_by_ptr[lo]].ap == ap) {
+        return &_index[_index_by_ptr[lo]];
+    }
+    return nullptr;
+}
+
+void AP_Param::storage_map_invalidate(void)
+{
+    delete[] _storage_map;
+    _storage_map = nullptr;
+    _storage_map_count = 0;
+    _storage_map_size = 0;
+    _storage_map_valid = false;
+}
+
+/*
+  walk storage recording where each variable is and where the sentinal
+  is. As in scan(), the first copy of a variable is the one used
+ */
+bool AP_Param::build_storage_map(void)
+{
+    storage_map_invalidate();
+
+    // first count the variables
+    struct Param_header phdr;
+    uint16_t count = 0;
+    uint16_t ofs = sizeof(AP_Param::EEPROM_header);
+    _storage_end = 0xFFFF;
+    while (ofs < _storage.size()) {
+        _storage.read_block(&phdr, ofs, sizeof(phdr));
+        if (is_sentinal(phdr)) {
+            _storage_end = ofs;
+            break;
+        }
+        count++;
+        ofs += type_size((enum ap_var_type)phdr.type) + sizeof(phdr);
+    }
+
+    // leave room for variables saved later
+    _storage_map_size = count + 32;
+    _storage_map = new storage_entry[_storage_map_size];
+    if (_storage_map == nullptr) {
+        _storage_map_size = 0;
+        return false;
+    }
+
+    ofs = sizeof(AP_Param::EEPROM_header);
+    while (_storage_map_count < count) {
+        _storage.read_block(&phdr, ofs, sizeof(phdr));
+        struct storage_entry &e = _storage_map[_storage_map_count++];
+        e.id = storage_id(phdr);
+        e.ofs = ofs;
+        ofs += type_size((enum ap_var_type)phdr.type) + sizeof(phdr);
+    }
+    qsort(_storage_map, _storage_map_count, sizeof(_storage_map[0]), compare_storage);
+
+    // drop later duplicates
+    uint16_t n = 0;
+    for (uint16_t i=0; i<_storage_map_count; i++) {
+        if (n == 0 || _storage_map[n-1].id != _storage_map[i].id) {
+            _storage_map[n++] = _storage_map[i];
+        }
+    }
+    _storage_map_count = n;
+    _storage_map_valid = true;
+    return true;
+}
+
+/*
+  equivalent of scan() using the storage map
+ */
+bool AP_Param::scan_indexed(const Param_header *target, uint16_t *pofs)
+{
+    const uint32_t id = storage_id(*target);
+    uint16_t lo = 0, hi = _storage_map_count;
+    while (lo < hi) {
+        const uint16_t mid = (lo + hi) / 2;
+        if (_storage_map[mid].id < id) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo < _storage_map_count && _storage_map[lo].id == id) {
+        *pofs = _storage_map[lo].ofs;
+        return true;
+    }
+    *pofs = _storage_end;
+    return false;
+}
+
+/*
+  record a variable just written at the old sentinal position
+ */
+void AP_Param::storage_map_add(const Param_header &phdr, uint16_t ofs)
+{
+    if (!_storage_map_valid) {
+        return;
+    }
+    if (_storage_map_count == _storage_map_size) {
+        const uint16_t new_size = _storage_map_size + 32;
+        struct storage_entry *new_map = new storage_entry[new_size];
+        if (new_map == nullptr) {
+            // fall back to scanning storage
+            storage_map_invalidate();
+            return;
+        }
+        memcpy(new_map, _storage_map, sizeof(_storage_map[0]) * _storage_map_count);
+        delete[] _storage_map;
+        _storage_map = new_map;
+        _storage_map_size = new_size;
+    }
+
+    const uint32_t id = storage_id(phdr);
+    uint16_t i = _storage_map_count;
+    while (i > 0 && _storage_map[i-1].id > id) {
+        _storage_map[i] = _storage_map[i-1];
+        i--;
+    }
+    _storage_map[i].id = id;
+    _storage_map[i].ofs = ofs;
+    _storage_map_count++;
+    _storage_end = ofs + sizeof(phdr) + type_size((enum ap_var_type)phdr.type);
+}
+
+#endif // AP_PARAM_INDEX_ENABLED
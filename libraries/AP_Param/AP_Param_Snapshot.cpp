@@ -0,0 +1,321 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+  snapshot of where load_all() puts each variable in storage
+
+  load_all() reads storage one header at a time and searches var_info
+  for each one, so boot time grows with the number of parameters. The
+  snapshot file lists every header in storage in order, with the
+  var_info entry and offset it was loaded to. On the next boot all of
+  the parameter storage is read in one block, every header is checked
+  against the snapshot and the values are copied straight to the
+  variables.
+
+  The values always come from storage, so saving a parameter doesn't
+  make the snapshot stale. Adding a variable to storage, erasing it,
+  or a firmware with a different var_info layout does, and then
+  load_all() falls back to the full walk and writes a new snapshot.
+
+  Variables in objects reached through a pointer may not exist yet,
+  or be somewhere else, so those are looked up with find_by_header()
+  on each boot.
+ */
+
+#include "AP_Param.h"
+
+#if AP_PARAM_SNAPSHOT_ENABLED
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <AP_Vehicle/AP_Vehicle_Type.h>
+
+// Replay keeps its storage, and so its snapshot, in its working directory
+#if APM_BUILD_TYPE(APM_BUILD_Replay)
+#define SNAPSHOT_DIR "."
+#else
+#define SNAPSHOT_DIR HAL_PARAM_SNAPSHOT_DIR
+#endif
+#define SNAPSHOT_FILE SNAPSHOT_DIR "/" SKETCHNAME ".psn"
+
+#define SNAPSHOT_MAGIC 0x4E535041 // "APSN"
+#define SNAPSHOT_VERSION 1
+
+// record vindex values for variables that aren't loaded directly
+#define SNAPSHOT_SKIP   0xFFFF  // not in var_info
+#define SNAPSHOT_LOOKUP 0xFFFE  // behind a pointer, use find_by_header()
+
+#define FNV_INIT 2166136261U
+
+struct snapshot_header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+    uint32_t layout_hash;
+    uint32_t check;     // hash of the records
+};
+
+// FNV-1a hash of a block of memory
+static uint32_t hash_add(uint32_t h, const void *data, uint32_t len)
+{
+    const uint8_t *b = (const uint8_t *)data;
+    while (len--) {
+        h = (h ^ *b++) * 16777619U;
+    }
+    return h;
+}
+
+uint32_t AP_Param::layout_hash_group(uint32_t h, const struct GroupInfo *group_info)
+{
+    for (uint8_t i=0; group_info[i].type != AP_PARAM_NONE; i++) {
+        const struct GroupInfo &g = group_info[i];
+        h = hash_add(h, &g.type, sizeof(g.type));
+        h = hash_add(h, &g.idx, sizeof(g.idx));
+        h = hash_add(h, &g.offset, sizeof(g.offset));
+        h = hash_add(h, &g.flags, sizeof(g.flags));
+        if (g.type == AP_PARAM_GROUP) {
+            h = layout_hash_group(h, g.group_info);
+        }
+    }
+    // mark the end of the group, so moving a variable in or out of
+    // a group changes the hash
+    const uint8_t end = AP_PARAM_NONE;
+    return hash_add(h, &end, sizeof(end));
+}
+
+/*
+  hash everything in var_info that decides which variable a header
+  in storage is loaded to. Names and defaults don't matter here
+ */
+uint32_t AP_Param::layout_hash(void)
+{
+    uint32_t h = FNV_INIT;
+    const uint8_t revision = k_EEPROM_revision;
+    h = hash_add(h, &revision, sizeof(revision));
+    for (uint16_t i=0; i<_num_vars; i++) {
+        const struct Info &info = _var_info[i];
+        h = hash_add(h, &info.type, sizeof(info.type));
+        h = hash_add(h, &info.key, sizeof(info.key));
+        h = hash_add(h, &info.flags, sizeof(info.flags));
+        if (info.type == AP_PARAM_GROUP) {
+            h = layout_hash_group(h, info.group_info);
+        }
+    }
+    return h;
+}
+
+bool AP_Param::group_has_pointer(const struct GroupInfo *group_info)
+{
+    for (uint8_t i=0; group_info[i].type != AP_PARAM_NONE; i++) {
+        if (group_info[i].type != AP_PARAM_GROUP) {
+            continue;
+        }
+        if ((group_info[i].flags & AP_PARAM_FLAG_POINTER) ||
+            group_has_pointer(group_info[i].group_info)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+  return true if the variables stored with this key may be reached
+  through a pointer, so can't be loaded with a fixed offset
+ */
+bool AP_Param::snapshot_needs_lookup(uint16_t key)
+{
+    for (uint16_t i=0; i<_num_vars; i++) {
+        const struct Info &info = _var_info[i];
+        if (info.key != key) {
+            continue;
+        }
+        if ((info.flags & AP_PARAM_FLAG_POINTER) ||
+            (info.type == AP_PARAM_GROUP && group_has_pointer(info.group_info))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// the most variables that fit in parameter storage
+uint16_t AP_Param::snapshot_max_records(void)
+{
+    return (_storage.size() - sizeof(EEPROM_header)) / (sizeof(Param_header) + 1);
+}
+
+/*
+  record where load_all() put the variable for one header
+ */
+void AP_Param::snapshot_add(struct snapshot_record *records, uint16_t &count,
+                            const Param_header &phdr, const struct Info *info, const void *ptr)
+{
+    if (records == nullptr || count >= snapshot_max_records()) {
+        return;
+    }
+    struct snapshot_record &r = records[count++];
+    r.phdr = phdr;
+    r.offset = 0;
+    r.spare = 0;
+    if (snapshot_needs_lookup(get_key(phdr))) {
+        r.vindex = SNAPSHOT_LOOKUP;
+    } else if (info == nullptr) {
+        r.vindex = SNAPSHOT_SKIP;
+    } else {
+        r.vindex = info - _var_info;
+        r.offset = (ptrdiff_t)ptr - (ptrdiff_t)info->ptr;
+    }
+}
+
+/*
+  read and check the snapshot file. The caller frees the records
+ */
+bool AP_Param::read_snapshot(struct snapshot_record *&records, uint16_t &count)
+{
+    int fd = ::open(SNAPSHOT_FILE, O_RDONLY|O_CLOEXEC);
+    if (fd == -1) {
+        return false;
+    }
+
+    struct snapshot_header hdr;
+    records = nullptr;
+    bool ok = (::read(fd, &hdr, sizeof(hdr)) == sizeof(hdr) &&
+               hdr.magic == SNAPSHOT_MAGIC &&
+               hdr.version == SNAPSHOT_VERSION &&
+               hdr.count <= snapshot_max_records() &&
+               hdr.layout_hash == layout_hash());
+    if (ok) {
+        const ssize_t len = hdr.count * sizeof(records[0]);
+        records = new snapshot_record[hdr.count + 1];
+        ok = (records != nullptr &&
+              ::read(fd, records, len) == len &&
+              hash_add(FNV_INIT, records, len) == hdr.check);
+    }
+    ::close(fd);
+
+    if (!ok) {
+        delete[] records;
+        records = nullptr;
+        return false;
+    }
+    count = hdr.count;
+    return true;
+}
+
+/*
+  load all variables using the snapshot, returning false if it is
+  missing or doesn't match what is in storage
+ */
+bool AP_Param::load_snapshot(void)
+{
+    struct snapshot_record *records;
+    uint16_t count;
+    if (!read_snapshot(records, count)) {
+        return false;
+    }
+
+    // the records must cover storage exactly, up to the sentinal
+    uint32_t end = sizeof(EEPROM_header);
+    bool ok = true;
+    for (uint16_t i=0; i<count && ok; i++) {
+        end += sizeof(Param_header) + type_size((enum ap_var_type)records[i].phdr.type);
+        ok = (records[i].vindex < _num_vars ||
+              records[i].vindex == SNAPSHOT_SKIP ||
+              records[i].vindex == SNAPSHOT_LOOKUP);
+    }
+    if (!ok || end + sizeof(Param_header) > _storage.size()) {
+        delete[] records;
+        return false;
+    }
+
+    // one read for all of it
+    const uint16_t len = end + sizeof(Param_header);
+    uint8_t *buf = new uint8_t[len];
+    if (buf == nullptr || !_storage.read_block(buf, 0, len)) {
+        delete[] buf;
+        delete[] records;
+        return false;
+    }
+
+    uint16_t ofs = sizeof(EEPROM_header);
+    for (uint16_t i=0; i<count && ok; i++) {
+        ok = memcmp(&buf[ofs], &records[i].phdr, sizeof(Param_header)) == 0;
+        ofs += sizeof(Param_header) + type_size((enum ap_var_type)records[i].phdr.type);
+    }
+    Param_header phdr;
+    memcpy(&phdr, &buf[ofs], sizeof(phdr));
+    if (!ok || !is_sentinal(phdr)) {
+        delete[] buf;
+        delete[] records;
+        return false;
+    }
+
+    ofs = sizeof(EEPROM_header);
+    for (uint16_t i=0; i<count; i++) {
+        const struct snapshot_record &r = records[i];
+        const uint8_t size = type_size((enum ap_var_type)r.phdr.type);
+        void *ptr = nullptr;
+        if (r.vindex == SNAPSHOT_LOOKUP) {
+            if (find_by_header(r.phdr, &ptr) == nullptr) {
+                ptr = nullptr;
+            }
+        } else if (r.vindex != SNAPSHOT_SKIP) {
+            ptr = (void *)((ptrdiff_t)_var_info[r.vindex].ptr + r.offset);
+        }
+        if (ptr != nullptr) {
+            memcpy(ptr, &buf[ofs + sizeof(Param_header)], size);
+        }
+        ofs += sizeof(Param_header) + size;
+    }
+
+    delete[] buf;
+    delete[] records;
+    return true;
+}
+
+/*
+  write the snapshot after a full load_all(). It goes to a temporary
+  file first so an interrupted write can't replace a good snapshot
+ */
+void AP_Param::save_snapshot(const struct snapshot_record *records, uint16_t count)
+{
+    struct snapshot_header hdr {};
+    hdr.magic = SNAPSHOT_MAGIC;
+    hdr.version = SNAPSHOT_VERSION;
+    hdr.count = count;
+    hdr.layout_hash = layout_hash();
+    const ssize_t len = count * sizeof(records[0]);
+    hdr.check = hash_add(FNV_INIT, records, len);
+
+    int fd = ::open(SNAPSHOT_FILE ".tmp", O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, 0644);
+    if (fd == -1) {
+        return;
+    }
+    const bool ok = (::write(fd, &hdr, sizeof(hdr)) == sizeof(hdr) &&
+                     ::write(fd, records, len) == len);
+    ::close(fd);
+    if (!ok || ::rename(SNAPSHOT_FILE ".tmp", SNAPSHOT_FILE) != 0) {
+        ::unlink(SNAPSHOT_FILE ".tmp");
+    }
+}
+
+void AP_Param::remove_snapshot(void)
+{
+    ::unlink(SNAPSHOT_FILE);
+}
+
+#endif // AP_PARAM_SNAPSHOT_ENABLED
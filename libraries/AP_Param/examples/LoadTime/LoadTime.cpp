@@ -0,0 +1,146 @@
+//
+// Time AP_Param::load_all() with and without the load snapshot
+//
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_Math/AP_Math.h>
+#include <AP_Param/AP_Param.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+#define NUM_BLOCKS 10
+#define NUM_RUNS 20
+
+/*
+  a block of parameters, repeated to give a parameter count close to
+  that of a vehicle
+ */
+class ParamBlock {
+public:
+    ParamBlock() {
+        AP_Param::setup_object_defaults(this, var_info);
+    }
+
+    static const struct AP_Param::GroupInfo var_info[];
+
+    AP_Float f[32];
+    AP_Int16 i[16];
+};
+
+#define BLOCK_FLOAT(n) AP_GROUPINFO("F" #n, n, ParamBlock, f[n], 0)
+#define BLOCK_INT(n)   AP_GROUPINFO("I" #n, 32+n, ParamBlock, i[n], 0)
+
+const AP_Param::GroupInfo ParamBlock::var_info[] = {
+    BLOCK_FLOAT(0),  BLOCK_FLOAT(1),  BLOCK_FLOAT(2),  BLOCK_FLOAT(3),
+    BLOCK_FLOAT(4),  BLOCK_FLOAT(5),  BLOCK_FLOAT(6),  BLOCK_FLOAT(7),
+    BLOCK_FLOAT(8),  BLOCK_FLOAT(9),  BLOCK_FLOAT(10), BLOCK_FLOAT(11),
+    BLOCK_FLOAT(12), BLOCK_FLOAT(13), BLOCK_FLOAT(14), BLOCK_FLOAT(15),
+    BLOCK_FLOAT(16), BLOCK_FLOAT(17), BLOCK_FLOAT(18), BLOCK_FLOAT(19),
+    BLOCK_FLOAT(20), BLOCK_FLOAT(21), BLOCK_FLOAT(22), BLOCK_FLOAT(23),
+    BLOCK_FLOAT(24), BLOCK_FLOAT(25), BLOCK_FLOAT(26), BLOCK_FLOAT(27),
+    BLOCK_FLOAT(28), BLOCK_FLOAT(29), BLOCK_FLOAT(30), BLOCK_FLOAT(31),
+    BLOCK_INT(0),    BLOCK_INT(1),    BLOCK_INT(2),    BLOCK_INT(3),
+    BLOCK_INT(4),    BLOCK_INT(5),    BLOCK_INT(6),    BLOCK_INT(7),
+    BLOCK_INT(8),    BLOCK_INT(9),    BLOCK_INT(10),   BLOCK_INT(11),
+    BLOCK_INT(12),   BLOCK_INT(13),   BLOCK_INT(14),   BLOCK_INT(15),
+    AP_GROUPEND
+};
+
+static ParamBlock blocks[NUM_BLOCKS];
+
+#define BLOCK(n) { AP_PARAM_GROUP, "B" #n "_", n, &blocks[n], {group_info : ParamBlock::var_info} }
+
+static const AP_Param::Info var_info[] = {
+    BLOCK(0), BLOCK(1), BLOCK(2), BLOCK(3),
+    BLOCK(4), BLOCK(5), BLOCK(6), BLOCK(7),
+    BLOCK(8), BLOCK(9),
+    AP_VAREND
+};
+
+static AP_Param param_loader(var_info);
+
+// time one load_all() in microseconds
+static uint32_t time_load_all(void)
+{
+    const uint32_t start_us = AP_HAL::micros();
+    AP_Param::load_all();
+    return AP_HAL::micros() - start_us;
+}
+
+void setup(void)
+{
+    hal.console->println("AP_Param load_all() timing");
+
+    if (!AP_Param::setup()) {
+        AP_HAL::panic("Bad parameter table");
+    }
+
+    // give every parameter a value in storage
+    for (uint8_t b=0; b<NUM_BLOCKS; b++) {
+        for (uint8_t n=0; n<ARRAY_SIZE(blocks[b].f); n++) {
+            blocks[b].f[n].set_and_save(b*100 + n + 0.5f);
+        }
+        for (uint8_t n=0; n<ARRAY_SIZE(blocks[b].i); n++) {
+            blocks[b].i[n].set_and_save(b*100 + n);
+        }
+    }
+    hal.console->printf("%u parameters\n", (unsigned)AP_Param::count_parameters());
+
+#if AP_PARAM_SNAPSHOT_ENABLED
+    uint32_t walk_us = 0;
+    uint32_t snapshot_us = 0;
+    for (uint8_t run=0; run<NUM_RUNS; run++) {
+        // the first load walks storage and writes the snapshot, the
+        // second uses it
+        AP_Param::remove_snapshot();
+        walk_us += time_load_all();
+        snapshot_us += time_load_all();
+    }
+    walk_us /= NUM_RUNS;
+    snapshot_us /= NUM_RUNS;
+    hal.console->printf("full walk: %6uus (including writing the snapshot)\n", (unsigned)walk_us);
+    hal.console->printf("snapshot:  %6uus\n", (unsigned)snapshot_us);
+    if (snapshot_us > 0) {
+        hal.console->printf("speedup:   %6.1fx\n", (double)walk_us / snapshot_us);
+    }
+#else
+    uint32_t walk_us = 0;
+    for (uint8_t run=0; run<NUM_RUNS; run++) {
+        walk_us += time_load_all();
+    }
+    hal.console->printf("full walk: %6uus\n", (unsigned)(walk_us / NUM_RUNS));
+    hal.console->println("the load snapshot is not enabled on this board");
+#endif
+
+    // check the values survived the round trip
+    for (uint8_t b=0; b<NUM_BLOCKS; b++) {
+        for (uint8_t n=0; n<ARRAY_SIZE(blocks[b].f); n++) {
+            blocks[b].f[n].set(0);
+        }
+        for (uint8_t n=0; n<ARRAY_SIZE(blocks[b].i); n++) {
+            blocks[b].i[n].set(0);
+        }
+    }
+    AP_Param::load_all();
+    uint16_t errors = 0;
+    for (uint8_t b=0; b<NUM_BLOCKS; b++) {
+        for (uint8_t n=0; n<ARRAY_SIZE(blocks[b].f); n++) {
+            if (!is_equal(blocks[b].f[n].get(), b*100 + n + 0.5f)) {
+                errors++;
+            }
+        }
+        for (uint8_t n=0; n<ARRAY_SIZE(blocks[b].i); n++) {
+            if (blocks[b].i[n] != b*100 + n) {
+                errors++;
+            }
+        }
+    }
+    hal.console->printf("%u errors\n", (unsigned)errors);
+}
+
+void loop(void)
+{
+    hal.scheduler->delay(1000);
+}
+
+AP_HAL_MAIN();
@@ -38,7 +38,7 @@ int8_t AP_Scheduler::current_task = -1;
 const AP_Param::GroupInfo AP_Scheduler::var_info[] = {
     // @Param: DEBUG
     // @DisplayName: Scheduler debug level
-    // @Description: Set to non-zero to enable scheduler debug messages. When set to show "Slips" the scheduler will display a message whenever a scheduled task is delayed due to too much CPU load. When set to ShowOverruns the scheduled will display a message whenever a task takes longer than the limit promised in the task table.
+    // @Description: Set to non-zero to enable scheduler debug messages. When set to show "Slips" the scheduler will display a message whenever a scheduled task is delayed due to too much CPU load. When set to ShowOverruns the scheduled will display a message whenever a task takes longer than the limit promised in the task table. When non-zero the run time statistics of each task are also sent to the ground station as DEBUG_VECT messages named after the task.
     // @Values: 0:Disabled,2:ShowSlips,3:ShowOverruns
     // @User: Advanced
     AP_GROUPINFO("DEBUG",    0, AP_Scheduler, _debug, 0),
@@ -76,6 +76,9 @@ void AP_Scheduler::init(const AP_Scheduler::Task *tasks, uint8_t num_tasks)
     _last_run = new uint16_t[_num_tasks];
     memset(_last_run, 0, sizeof(_last_run[0]) * _num_tasks);
     _tick_counter = 0;
+
+    _task_stats = new task_stats[_num_tasks];
+    reset_task_stats();
 }
 
 // one tick has passed
@@ -114,6 +117,9 @@ void AP_Scheduler::run(uint32_t time_available)
 
             if (dt >= interval_ticks*2) {
                 // we've slipped a whole run of this task!
+                if (_task_stats != nullptr && _task_stats[i].slips < UINT16_MAX) {
+                    _task_stats[i].slips++;
+                }
                 if (_debug > 1) {
                     ::printf("Scheduler slip task[%u-%s] (%u/%u/%u)\n",
                              (unsigned)i,
@@ -145,6 +151,8 @@ void AP_Scheduler::run(uint32_t time_available)
                 now = AP_HAL::micros();
                 uint32_t time_taken = now - _task_time_started;
 
+                update_task_stats(i, time_taken);
+
                 if (time_taken > _task_time_allowed) {
                     // the event overran!
                     if (_debug > 4) {
@@ -197,3 +205,85 @@ float AP_Scheduler::load_average(uint32_t tick_time_usec) const
     uint32_t used_time = tick_time_usec - (_spare_micros/_spare_ticks);
     return used_time / (float)tick_time_usec;
 }
+
+/*
+  start a new statistics window for all tasks. The histogram bucket
+  width is the smallest power of two that lets the buckets span twice
+  the task's time budget, so recording a run needs only a shift
+ */
+void AP_Scheduler::reset_task_stats(void)
+{
+    if (_task_stats == nullptr) {
+        return;
+    }
+    memset(_task_stats, 0, sizeof(_task_stats[0]) * _num_tasks);
+    for (uint8_t i=0; i<_num_tasks; i++) {
+        struct task_stats &stats = _task_stats[i];
+        stats.min_us = UINT16_MAX;
+        while ((AP_SCHEDULER_HIST_BUCKETS << stats.hist_shift) < 2U * _tasks[i].max_time_micros) {
+            stats.hist_shift++;
+        }
+    }
+}
+
+/*
+  record one run of a task
+ */
+void AP_Scheduler::update_task_stats(uint8_t i, uint32_t time_taken)
+{
+    if (_task_stats == nullptr) {
+        return;
+    }
+    struct task_stats &stats = _task_stats[i];
+    const uint16_t t = time_taken < UINT16_MAX ? time_taken : UINT16_MAX;
+
+    stats.count++;
+    stats.total_us += t;
+    if (t < stats.min_us) {
+        stats.min_us = t;
+    }
+    if (t > stats.max_us) {
+        stats.max_us = t;
+    }
+    if (time_taken > _tasks[i].max_time_micros && stats.overruns < UINT16_MAX) {
+        stats.overruns++;
+    }
+
+    uint32_t bucket = t >> stats.hist_shift;
+    if (bucket >= AP_SCHEDULER_HIST_BUCKETS) {
+        bucket = AP_SCHEDULER_HIST_BUCKETS - 1;
+    }
+    if (stats.hist[bucket] < UINT16_MAX) {
+        stats.hist[bucket]++;
+    }
+}
+
+const struct AP_Scheduler::task_stats *AP_Scheduler::get_task_stats(uint8_t i) const
+{
+    if (_task_stats == nullptr || i >= _num_tasks) {
+        return nullptr;
+    }
+    return &_task_stats[i];
+}
+
+/*
+  estimate the 99th percentile run time from the histogram, as the
+  upper edge of the bucket it falls in, limited to the longest run seen
+ */
+uint16_t AP_Scheduler::task_p99_us(uint8_t i) const
+{
+    const struct task_stats *stats = get_task_stats(i);
+    if (stats == nullptr || stats->count == 0) {
+        return 0;
+    }
+    const uint32_t limit = stats->count - stats->count / 100;
+    uint32_t sum = 0;
+    for (uint8_t b=0; b<AP_SCHEDULER_HIST_BUCKETS; b++) {
+        sum += stats->hist[b];
+        if (sum >= limit) {
+            const uint32_t edge = uint32_t(b+1) << stats->hist_shift;
+            return edge < stats->max_us ? edge : stats->max_us;
+        }
+    }
+    return stats->max_us;
+}
@@ -25,6 +25,11 @@
 
 #define AP_SCHEDULER_NAME_INITIALIZER(_name) .name = #_name,
 
+// number of buckets in the per-task run time histogram. The buckets
+// are sized so the histogram covers at least twice the task's
+// max_time_micros
+#define AP_SCHEDULER_HIST_BUCKETS 16U
+
 /*
   useful macro for creating scheduler task table
  */
@@ -63,6 +68,21 @@ public:
         uint16_t max_time_micros;
     };
 
+    /*
+      run time statistics for one task, accumulated from every run of
+      the task since the last call to reset_task_stats()
+     */
+    struct task_stats {
+        uint32_t count;         // number of runs
+        uint32_t total_us;      // sum of run times
+        uint16_t min_us;
+        uint16_t max_us;
+        uint16_t overruns;      // runs that took longer than max_time_micros
+        uint16_t slips;         // times a whole run of the task was missed
+        uint8_t hist_shift;     // log2 of the histogram bucket width in us
+        uint16_t hist[AP_SCHEDULER_HIST_BUCKETS];
+    };
+
     // initialise scheduler
     void init(const Task *tasks, uint8_t num_tasks);
 
@@ -78,7 +98,7 @@ public:
     uint16_t time_available_usec(void);
 
     // return debug parameter
-    uint8_t debug(void) { return _debug; }
+    uint8_t debug(void) const { return _debug; }
 
     // return load average, as a number between 0 and 1. 1 means
     // 100% load. Calculated from how much spare time we have at the
@@ -89,6 +109,21 @@ public:
     uint16_t get_loop_rate_hz(void) const {
         return _loop_rate_hz;
     }
+
+    // number of tasks in the task table
+    uint8_t num_tasks(void) const { return _num_tasks; }
+
+    // name of a task in the task table
+    const char *task_name(uint8_t i) const { return _tasks[i].name; }
+
+    // run time statistics for a task, or nullptr if not available
+    const struct task_stats *get_task_stats(uint8_t i) const;
+
+    // estimated 99th percentile run time of a task in microseconds
+    uint16_t task_p99_us(uint8_t i) const;
+
+    // start a new statistics window for all tasks
+    void reset_task_stats(void);
     
     static const struct AP_Param::GroupInfo var_info[];
 
@@ -129,4 +164,9 @@ private:
 
     // performance counters
     AP_HAL::Util::perf_counter_t *_perf_counters;
+
+    // per-task run time statistics
+    struct task_stats *_task_stats;
+
+    void update_task_stats(uint8_t i, uint32_t time_taken);
 };
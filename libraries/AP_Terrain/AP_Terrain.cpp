@@ -44,7 +44,7 @@ const AP_Param::GroupInfo AP_Terrain::var_info[] = {
 
     // @Param: SPACING
     // @DisplayName: Terrain grid spacing
-    // @Description: Distance between terrain grid points in meters. This controls the horizontal resolution of the terrain data that is stored on te SD card and requested from the ground station. If your GCS is using the worldwide SRTM database then a resolution of 100 meters is appropriate. Some parts of the world may have higher resolution data available, such as 30 meter data available in the SRTM database in the USA. The grid spacing also controls how much data is kept in memory during flight. A larger grid spacing will allow for a larger amount of data in memory. A grid spacing of 100 meters results in the vehicle keeping 12 grid squares in memory with each grid square having a size of 2.7 kilometers by 3.2 kilometers. Any additional grid squares are stored on the SD once they are fetched from the GCS and will be demand loaded as needed.
+    // @Description: Distance between terrain grid points in meters. This controls the horizontal resolution of the terrain data that is stored on te SD card and requested from the ground station. If your GCS is using the worldwide SRTM database then a resolution of 100 meters is appropriate. Some parts of the world may have higher resolution data available, such as 30 meter data available in the SRTM database in the USA. The grid spacing also controls how much data is kept in memory during flight. A larger grid spacing will allow for a larger amount of data in memory. A grid spacing of 100 meters results in the vehicle keeping 12 grid squares in memory (256 on boards with a 1GHz class CPU, which are Linux, QURT and SITL; the number is fixed in the firmware) with each grid square having a size of 2.7 kilometers by 3.2 kilometers. Any additional grid squares are stored on the SD once they are fetched from the GCS and will be demand loaded as needed.
     // @Units: meters
     // @Increment: 1
     // @User: Advanced
@@ -73,6 +73,11 @@ AP_Terrain::AP_Terrain(AP_AHRS &_ahrs, const AP_Mission &_mission, const AP_Rall
     memset(&home_loc, 0, sizeof(home_loc));
     memset(&disk_block, 0, sizeof(disk_block));
     memset(last_request_time_ms, 0, sizeof(last_request_time_ms));
+    memset(last_request, 0, sizeof(last_request));
+#if TERRAIN_MMAP_ENABLED
+    memset(maps, 0, sizeof(maps));
+    memset(&new_map, 0, sizeof(new_map));
+#endif
 }
 
 /*
@@ -108,6 +113,31 @@ bool AP_Terrain::height_amsl(const Location &loc, float &height, bool corrected)
     // find the grid
     const struct grid_block &grid = find_grid_cache(info).grid;
 
+    if (!grid_height(grid, info, height)) {
+        return false;
+    }
+
+    if (loc.lat == ahrs.get_home().lat &&
+        loc.lng == ahrs.get_home().lng) {
+        // remember home altitude as a special case
+        home_height = height;
+        home_loc = loc;
+    }
+
+    // apply correction which assumes home altitude is at terrain altitude
+    if (corrected) {
+        height += (ahrs.get_home().alt * 0.01f) - home_height;
+    }
+
+    return true;
+}
+
+
+/*
+  interpolate the height at a grid_info within a grid block
+ */
+bool AP_Terrain::grid_height(const struct grid_block &grid, const struct grid_info &info, float &height)
+{
     /*
       note that we rely on the one square overlap to ensure these
       calculations don't go past the end of the arrays
@@ -140,23 +170,56 @@ bool AP_Terrain::height_amsl(const Location &loc, float &height, bool corrected)
     float avg  = (1.0f-info.frac_y) * avg1 + info.frac_y * avg2;
 
     height = avg;
+    return true;
+}
 
-    if (loc.lat == ahrs.get_home().lat &&
-        loc.lng == ahrs.get_home().lng) {
-        // remember home altitude as a special case
-        home_height = height;
-        home_loc = loc;
+/*
+  find the terrain heights for a set of locations. Each grid block
+  that isn't in the cache is added to it in the DISKWAIT state, so
+  the disk reads and then any GCS requests for all of them get queued
+  in one go. Only half the cache is taken over by new blocks in one
+  call, so a long list can't push out the blocks it has just asked
+  for
+ */
+uint16_t AP_Terrain::height_amsl_batch(const Location *locs, uint16_t count, float *heights, bool *available)
+{
+    memset(available, 0, count*sizeof(available[0]));
+    if (enable == 0 || !allocate()) {
+        return 0;
     }
 
-    // apply correction which assumes home altitude is at terrain altitude
-    if (corrected) {
-        height += (ahrs.get_home().alt * 0.01f) - home_height;
-    }
+    uint16_t found = 0;
+    uint16_t new_blocks = 0;
+    int16_t last_idx = -1;
+    for (uint16_t i=0; i<count; i++) {
+        struct grid_info info;
+        calculate_grid_info(locs[i], info);
+
+        int16_t idx = last_idx;
+        if (idx == -1 ||
+            cache[idx].grid.lat != info.grid_lat ||
+            cache[idx].grid.lon != info.grid_lon) {
+            idx = find_cache_idx(info.grid_lat, info.grid_lon, grid_spacing);
+            if (idx != -1) {
+                cache_touch(idx);
+            } else if (new_blocks < cache_size/2) {
+                idx = &find_grid_cache(info) - cache;
+                new_blocks++;
+            } else {
+                // leave it for the next call
+                continue;
+            }
+            last_idx = idx;
+        }
 
-    return true;
+        if (grid_height(cache[idx].grid, info, heights[i])) {
+            available[i] = true;
+            found++;
+        }
+    }
+    return found;
 }
 
-
 /* 
    find difference between home terrain height and the terrain
    height at the current location in meters. A positive result
@@ -395,12 +458,35 @@ bool AP_Terrain::allocate(void)
     if (cache != nullptr) {
         return true;
     }
+    // hash buckets are a power of two, at least twice the cache size
+    uint16_t num_buckets = 1;
+    while (num_buckets < 2*TERRAIN_GRID_BLOCK_CACHE_SIZE) {
+        num_buckets <<= 1;
+    }
     cache = (struct grid_cache *)calloc(TERRAIN_GRID_BLOCK_CACHE_SIZE, sizeof(cache[0]));
-    if (cache == nullptr) {
+    cache_hash = (uint16_t *)calloc(num_buckets, sizeof(cache_hash[0]));
+    if (cache == nullptr || cache_hash == nullptr) {
+        free(cache);
+        free(cache_hash);
+        cache = nullptr;
+        cache_hash = nullptr;
         enable.set(0);
         GCS_MAVLINK::send_statustext_all(MAV_SEVERITY_CRITICAL, "Terrain: Allocation failed");
         return false;
     }
+    for (uint16_t i=0; i<num_buckets; i++) {
+        cache_hash[i] = TERRAIN_CACHE_NONE;
+    }
+    cache_hash_mask = num_buckets - 1;
+
+    // all entries start out empty and in the LRU list in index order
+    for (uint16_t i=0; i<TERRAIN_GRID_BLOCK_CACHE_SIZE; i++) {
+        cache[i].hash_next = TERRAIN_CACHE_NONE;
+        cache[i].lru_prev = i>0 ? i-1 : TERRAIN_CACHE_NONE;
+        cache[i].lru_next = i<TERRAIN_GRID_BLOCK_CACHE_SIZE-1 ? i+1 : TERRAIN_CACHE_NONE;
+    }
+    lru_head = 0;
+    lru_tail = TERRAIN_GRID_BLOCK_CACHE_SIZE-1;
     cache_size = TERRAIN_GRID_BLOCK_CACHE_SIZE;
     return true;
 }
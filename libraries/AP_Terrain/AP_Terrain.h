@@ -53,7 +53,50 @@
 #define TERRAIN_GRID_BLOCK_SIZE_Y (TERRAIN_GRID_MAVLINK_SIZE*TERRAIN_GRID_BLOCK_MUL_Y)
 
 // number of grid_blocks in the LRU memory cache
+#ifndef TERRAIN_GRID_BLOCK_CACHE_SIZE
+#if HAL_CPU_CLASS >= HAL_CPU_CLASS_1000
+#define TERRAIN_GRID_BLOCK_CACHE_SIZE 256
+#else
 #define TERRAIN_GRID_BLOCK_CACHE_SIZE 12
+#endif
+#endif
+
+// no cache entry, for the hash chains and LRU list
+#define TERRAIN_CACHE_NONE 0xFFFF
+
+/*
+  keep the terrain files memory mapped, so a grid_block that isn't in
+  the cache but is already in memory can be loaded straight away
+  instead of waiting for the IO timer
+ */
+#ifndef TERRAIN_MMAP_ENABLED
+#if CONFIG_HAL_BOARD == HAL_BOARD_LINUX
+#define TERRAIN_MMAP_ENABLED 1
+#elif CONFIG_HAL_BOARD == HAL_BOARD_SITL && defined(__linux__)
+#define TERRAIN_MMAP_ENABLED 1
+#else
+#define TERRAIN_MMAP_ENABLED 0
+#endif
+#endif
+
+// number of mission waypoints looked up together when pre-loading
+// terrain data. Each waypoint is 5 locations
+#ifndef TERRAIN_MISSION_BATCH
+#if HAL_CPU_CLASS >= HAL_CPU_CLASS_1000
+#define TERRAIN_MISSION_BATCH 32
+#else
+#define TERRAIN_MISSION_BATCH 4
+#endif
+#endif
+
+// number of mission points per waypoint
+#define TERRAIN_MISSION_POINTS 5
+
+// number of terrain files kept mapped
+#define TERRAIN_MMAP_FILES 4
+
+// largest terrain file to map, in bytes
+#define TERRAIN_MMAP_MAX_LENGTH (256*1024*1024UL)
 
 // format of grid on disk
 #define TERRAIN_GRID_FORMAT_VERSION 1
@@ -113,6 +156,17 @@ public:
      */
     bool height_amsl(const Location &loc, float &height, bool corrected);
 
+    /*
+      find the terrain heights in meters above sea level for a set of
+      locations. Grid blocks that aren't in memory are queued for a
+      disk read or GCS request together, rather than one per call.
+
+      available[i] is set when heights[i] is valid. Returns the
+      number of locations with a height. Call again later to pick up
+      the rest
+     */
+    uint16_t height_amsl_batch(const Location *locs, uint16_t count, float *heights, bool *available);
+
     /* 
        find difference between home terrain height and the terrain
        height at the current location in meters. A positive result
@@ -236,8 +290,12 @@ private:
 
         volatile enum GridCacheState state;
 
-        // the last time access was requested to this block, used for LRU
-        uint32_t last_access_ms;
+        // next entry in the same hash bucket
+        uint16_t hash_next;
+
+        // neighbours in the LRU list, most recently used first
+        uint16_t lru_prev;
+        uint16_t lru_next;
     };
 
     /*
@@ -277,6 +335,19 @@ private:
     */
     struct grid_cache &find_grid_cache(const struct grid_info &info);
 
+    /*
+      cache index of a grid, or -1 if it isn't in the cache
+     */
+    int16_t find_cache_idx(int32_t lat, int32_t lon, uint16_t spacing) const;
+
+    /*
+      hash index and LRU list maintenance
+     */
+    uint16_t grid_hash(int32_t lat, int32_t lon) const;
+    void cache_hash_insert(uint16_t idx);
+    void cache_hash_remove(uint16_t idx);
+    void cache_touch(uint16_t idx);
+
     /*
       calculate bit number in grid_block bitmap. This corresponds to a
       bit representing a 4x4 mavlink transmitted block
@@ -289,12 +360,23 @@ private:
     */
     bool check_bitmap(const struct grid_block &grid, uint8_t idx_x, uint8_t idx_y);
 
+    /*
+      interpolate the height at a grid_info within a grid block,
+      returning false if the grid block doesn't have all 4 heights
+    */
+    bool grid_height(const struct grid_block &grid, const struct grid_info &info, float &height);
+
     /*
       request any missing 4x4 grids from a block
     */
     bool request_missing(mavlink_channel_t chan, struct grid_cache &gcache);
     bool request_missing(mavlink_channel_t chan, const struct grid_info &info);
 
+    /*
+      check if the GCS has sent everything in the last request
+    */
+    bool last_request_answered(mavlink_channel_t chan) const;
+
     /*
       look for blocks that need to be read/written to disk
      */
@@ -310,6 +392,9 @@ private:
      */
     int16_t find_io_idx(enum GridCacheState state);
     uint16_t get_block_crc(struct grid_block &block);
+    bool check_block(struct grid_block &block, int32_t lat, int32_t lon);
+    uint16_t file_east_blocks(const struct grid_block &block) const;
+    uint32_t file_length(const struct grid_block &block, uint16_t east_blocks) const;
     void check_disk_read(void);
     void check_disk_write(void);
     void io_timer(void);
@@ -318,10 +403,20 @@ private:
     void write_block(void);
     void read_block(void);
 
+#if TERRAIN_MMAP_ENABLED
+    /*
+      memory mapped terrain files
+     */
+    void map_file(void);
+    void adopt_map(void);
+    bool load_from_map(struct grid_cache &gcache);
+#endif
+
     /*
       check for missing mission terrain data
      */
     void update_mission_data(void);
+    bool next_mission_waypoint(uint16_t &index, Location &loc) const;
 
     /*
       check for missing rally data
@@ -346,9 +441,36 @@ private:
     const AP_Rally &rally;
 
     // cache of grids in memory, LRU
-    uint8_t cache_size = 0;
+    uint16_t cache_size = 0;
     struct grid_cache *cache = nullptr;
 
+    // hash buckets of cache indexes, chained through hash_next
+    uint16_t *cache_hash = nullptr;
+    uint16_t cache_hash_mask;
+
+    // most and least recently used cache entries
+    uint16_t lru_head;
+    uint16_t lru_tail;
+
+#if TERRAIN_MMAP_ENABLED
+    struct terrain_map {
+        const uint8_t *data;
+        uint32_t length;
+        uint16_t spacing;
+        uint16_t east_blocks;
+        int8_t lat_degrees;
+        int16_t lon_degrees;
+        uint32_t last_access_ms;
+    };
+
+    // files mapped for the main thread
+    struct terrain_map maps[TERRAIN_MMAP_FILES];
+
+    // a file mapped by the IO thread, handed over to the main thread
+    // along with the next completed disk IO
+    struct terrain_map new_map;
+#endif
+
     // a grid_cache block waiting for disk IO
     enum DiskIoState {
         DiskIoIdle      = 0,
@@ -363,6 +485,13 @@ private:
     // last time we asked for more grids
     uint32_t last_request_time_ms[MAVLINK_COMM_NUM_BUFFERS];
 
+    // the last grids we asked for
+    struct terrain_request {
+        int32_t lat;
+        int32_t lon;
+        uint64_t mask;
+    } last_request[MAVLINK_COMM_NUM_BUFFERS];
+
     static const uint64_t bitmap_mask = (((uint64_t)1U)<<(TERRAIN_GRID_BLOCK_MUL_X*TERRAIN_GRID_BLOCK_MUL_Y)) - 1;
 
     // open file handle on degree file
@@ -391,12 +520,9 @@ private:
     bool have_current_loc_height;
     float last_current_loc_height;
 
-    // next mission command to check
+    // first mission command that hasn't been fully checked
     uint16_t next_mission_index;
 
-    // next mission position to check
-    uint8_t next_mission_pos;
-
     // last time the mission changed
     uint32_t last_mission_change_ms;
 
@@ -64,6 +64,9 @@ bool AP_Terrain::request_missing(mavlink_channel_t chan, struct grid_cache &gcac
      */
     mavlink_msg_terrain_request_send(chan, grid.lat, grid.lon, grid_spacing, bitmap_mask & ~grid.bitmap);
     last_request_time_ms[chan] = AP_HAL::millis();
+    last_request[chan].lat = grid.lat;
+    last_request[chan].lon = grid.lon;
+    last_request[chan].mask = bitmap_mask & ~grid.bitmap;
 
     return true;
 }
@@ -100,8 +103,10 @@ void AP_Terrain::send_request(mavlink_channel_t chan)
     // always send a terrain report
     send_terrain_report(chan, loc, true);
 
-    // did we request recently?
-    if (AP_HAL::millis() - last_request_time_ms[chan] < 2000) {
+    // did we request recently? Once the GCS has answered we can ask
+    // for the next set straight away
+    if (AP_HAL::millis() - last_request_time_ms[chan] < 2000 &&
+        !last_request_answered(chan)) {
         // too soon to request again
         return;
     }
@@ -145,6 +150,19 @@ void AP_Terrain::send_request(mavlink_channel_t chan)
     }
 }
 
+/*
+  check if the GCS has sent all of the grids in the last request
+ */
+bool AP_Terrain::last_request_answered(mavlink_channel_t chan) const
+{
+    const struct terrain_request &req = last_request[chan];
+    if (req.mask == 0) {
+        return false;
+    }
+    int16_t idx = find_cache_idx(req.lat, req.lon, grid_spacing);
+    return idx != -1 && (cache[idx].grid.bitmap & req.mask) == req.mask;
+}
+
 /*
   count bits in a uint64_t
 */
@@ -259,17 +277,11 @@ void AP_Terrain::handle_terrain_data(mavlink_message_t *msg)
     mavlink_terrain_data_t packet;
     mavlink_msg_terrain_data_decode(msg, &packet);
 
-    uint16_t i;
-    for (i=0; i<cache_size; i++) {
-        if (cache[i].grid.lat == packet.lat && 
-            cache[i].grid.lon == packet.lon && 
-            cache[i].grid.spacing == packet.grid_spacing &&
-            grid_spacing == packet.grid_spacing &&
-            packet.gridbit < 56) {
-            break;
-        }
+    if (grid_spacing != packet.grid_spacing || packet.gridbit >= 56) {
+        return;
     }
-    if (i == cache_size) {
+    int16_t i = find_cache_idx(packet.lat, packet.lon, packet.grid_spacing);
+    if (i == -1) {
         // we don't have that grid, ignore data
         return;
     }
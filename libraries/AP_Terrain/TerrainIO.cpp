@@ -32,6 +32,9 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <errno.h>
+#if TERRAIN_MMAP_ENABLED
+#include <sys/mman.h>
+#endif
 
 extern const AP_HAL::HAL& hal;
 
@@ -79,24 +82,22 @@ void AP_Terrain::schedule_disk_io(void)
 
     switch (disk_io_state) {
     case DiskIoIdle:
-        // look for a block that needs reading or writing
-        check_disk_read();
-        if (disk_io_state == DiskIoIdle) {
-            // still idle, check for writes
-            check_disk_write();            
-        }
         break;
         
     case DiskIoDoneRead: {
         // a read has completed
+#if TERRAIN_MMAP_ENABLED
+        adopt_map();
+#endif
         int16_t cache_idx = find_io_idx(GRID_CACHE_DISKWAIT);
         if (cache_idx != -1) {
             if (disk_block.block.bitmap != 0) {
-                // when bitmap is zero we read an empty block
+                // when bitmap is zero we read an empty block. The
+                // hash links stay as they are, as lat and lon match
                 cache[cache_idx].grid = disk_block.block;
             }
             cache[cache_idx].state = GRID_CACHE_VALID;
-            cache[cache_idx].last_access_ms = AP_HAL::millis();
+            cache_touch(cache_idx);
         }
         disk_io_state = DiskIoIdle;
         break;
@@ -104,6 +105,9 @@ void AP_Terrain::schedule_disk_io(void)
 
     case DiskIoDoneWrite: {
         // a write has completed
+#if TERRAIN_MMAP_ENABLED
+        adopt_map();
+#endif
         int16_t cache_idx = find_io_idx(GRID_CACHE_DIRTY);
         if (cache_idx != -1) {
             if (cache[cache_idx].grid.bitmap == disk_block.block.bitmap) {
@@ -120,6 +124,17 @@ void AP_Terrain::schedule_disk_io(void)
         // waiting for io_timer()
         break;
     }
+
+    if (disk_io_state == DiskIoIdle) {
+        // look for a block that needs reading or writing. This is
+        // done straight after finishing the last one so a queue of
+        // blocks is read at one per call
+        check_disk_read();
+        if (disk_io_state == DiskIoIdle) {
+            // still idle, check for writes
+            check_disk_write();            
+        }
+    }
 }
 
 
@@ -198,6 +213,10 @@ void AP_Terrain::open_file(void)
 
     file_lat_degrees = block.lat_degrees;
     file_lon_degrees = block.lon_degrees;
+
+#if TERRAIN_MMAP_ENABLED
+    map_file();
+#endif
 }
 
 /*
@@ -207,16 +226,7 @@ void AP_Terrain::seek_offset(void)
 {
     struct grid_block &block = disk_block.block;
     // work out how many longitude blocks there are at this latitude
-    Location loc1, loc2;
-    loc1.lat = block.lat_degrees*10*1000*1000L;
-    loc1.lng = block.lon_degrees*10*1000*1000L;
-    loc2.lat = block.lat_degrees*10*1000*1000L;
-    loc2.lng = (block.lon_degrees+1)*10*1000*1000L;
-
-    // shift another two blocks east to ensure room is available
-    location_offset(loc2, 0, 2*grid_spacing*TERRAIN_GRID_BLOCK_SIZE_Y);
-    Vector2f offset = location_diff(loc1, loc2);
-    uint16_t east_blocks = offset.y / (grid_spacing*TERRAIN_GRID_BLOCK_SIZE_Y);
+    uint16_t east_blocks = file_east_blocks(block);
 
     uint32_t file_offset = (east_blocks * block.grid_idx_x + 
                             block.grid_idx_y) * sizeof(union grid_io_block);
@@ -278,12 +288,7 @@ void AP_Terrain::read_block(void)
 
     ssize_t ret = ::read(fd, &disk_block, sizeof(disk_block));
     if (ret != sizeof(disk_block) || 
-        disk_block.block.lat != lat || 
-        disk_block.block.lon != lon ||
-        disk_block.block.bitmap == 0 ||
-        disk_block.block.spacing != grid_spacing ||
-        disk_block.block.version != TERRAIN_GRID_FORMAT_VERSION ||
-        disk_block.block.crc != get_block_crc(disk_block.block)) {
+        !check_block(disk_block.block, lat, lon)) {
 #if TERRAIN_DEBUG
         printf("read empty block at %ld %ld ret=%d\n",
                (long)lat,
@@ -346,4 +351,122 @@ void AP_Terrain::io_timer(void)
     }
 }
 
+#if TERRAIN_MMAP_ENABLED
+/*
+  map the file just opened by the IO thread. The mapping covers the
+  largest the file can grow to, so blocks written later are visible
+  through it too. The main thread picks it up with adopt_map()
+ */
+void AP_Terrain::map_file(void)
+{
+    const struct grid_block &block = disk_block.block;
+    if (new_map.data != nullptr) {
+        // the main thread hasn't taken the last one yet
+        return;
+    }
+    const uint16_t east_blocks = file_east_blocks(block);
+    const uint32_t length = file_length(block, east_blocks);
+    if (length > TERRAIN_MMAP_MAX_LENGTH) {
+        return;
+    }
+    void *data = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        return;
+    }
+    // start paging in what is on disk in the background
+    madvise(data, length, MADV_WILLNEED);
+
+    new_map.length = length;
+    new_map.spacing = grid_spacing;
+    new_map.east_blocks = east_blocks;
+    new_map.lat_degrees = block.lat_degrees;
+    new_map.lon_degrees = block.lon_degrees;
+    new_map.data = (const uint8_t *)data;
+}
+
+/*
+  take over a mapping made by the IO thread, replacing any older
+  mapping of the same file or else the least recently used one. Only
+  called from the main thread while it owns disk_block
+ */
+void AP_Terrain::adopt_map(void)
+{
+    if (new_map.data == nullptr) {
+        return;
+    }
+    uint8_t slot = 0;
+    for (uint8_t i=0; i<TERRAIN_MMAP_FILES; i++) {
+        if (maps[i].data != nullptr &&
+            maps[i].lat_degrees == new_map.lat_degrees &&
+            maps[i].lon_degrees == new_map.lon_degrees) {
+            slot = i;
+            break;
+        }
+        if (maps[i].data == nullptr ||
+            (maps[slot].data != nullptr && maps[i].last_access_ms < maps[slot].last_access_ms)) {
+            slot = i;
+        }
+    }
+    if (maps[slot].data != nullptr) {
+        munmap((void *)maps[slot].data, maps[slot].length);
+    }
+    maps[slot] = new_map;
+    maps[slot].last_access_ms = AP_HAL::millis();
+    new_map.data = nullptr;
+}
+
+/*
+  fill in a cache entry from a mapped file if the block is already in
+  memory. Pages that aren't resident would need a disk read, which
+  this thread mustn't wait for, so those are left to the IO timer
+ */
+bool AP_Terrain::load_from_map(struct grid_cache &gcache)
+{
+    const struct grid_block &grid = gcache.grid;
+    for (uint8_t i=0; i<TERRAIN_MMAP_FILES; i++) {
+        struct terrain_map &map = maps[i];
+        if (map.data == nullptr ||
+            map.lat_degrees != grid.lat_degrees ||
+            map.lon_degrees != grid.lon_degrees ||
+            map.spacing != grid_spacing) {
+            continue;
+        }
+        map.last_access_ms = AP_HAL::millis();
+
+        const uint32_t file_offset = (map.east_blocks * grid.grid_idx_x +
+                                      grid.grid_idx_y) * sizeof(union grid_io_block);
+        if (file_offset + sizeof(struct grid_block) > map.length) {
+            return false;
+        }
+        const uint8_t *data = &map.data[file_offset];
+
+        // check every page of the block is resident
+        const uintptr_t page_size = sysconf(_SC_PAGESIZE);
+        const uintptr_t start = (uintptr_t)data & ~(page_size-1);
+        const uintptr_t end = (uintptr_t)data + sizeof(struct grid_block);
+        unsigned char resident[4];
+        const uint8_t num_pages = (end - start + page_size - 1) / page_size;
+        if (num_pages > sizeof(resident) ||
+            mincore((void *)start, end - start, resident) != 0) {
+            return false;
+        }
+        for (uint8_t p=0; p<num_pages; p++) {
+            if ((resident[p] & 1) == 0) {
+                return false;
+            }
+        }
+
+        // copy it out so the IO thread can't change it while we check it
+        struct grid_block block;
+        memcpy(&block, data, sizeof(block));
+        if (!check_block(block, grid.lat, grid.lon)) {
+            return false;
+        }
+        gcache.grid = block;
+        return true;
+    }
+    return false;
+}
+#endif // TERRAIN_MMAP_ENABLED
+
 #endif // AP_TERRAIN_AVAILABLE
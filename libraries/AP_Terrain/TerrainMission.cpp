@@ -27,6 +27,26 @@
 
 extern const AP_HAL::HAL& hal;
 
+/*
+  find the next nav waypoint in the mission, starting at index
+ */
+bool AP_Terrain::next_mission_waypoint(uint16_t &index, Location &loc) const
+{
+    AP_Mission::Mission_Command cmd;
+    while (mission.read_cmd_from_storage(index, cmd)) {
+        // we only want nav waypoint commands. That should be enough to
+        // prefill the terrain data and makes many things much simpler
+        if ((cmd.id == MAV_CMD_NAV_WAYPOINT ||
+             cmd.id == MAV_CMD_NAV_SPLINE_WAYPOINT) &&
+            (cmd.content.location.lat != 0 || cmd.content.location.lng != 0)) {
+            loc = cmd.content.location;
+            return true;
+        }
+        index++;
+    }
+    return false;
+}
+
 /*
   check that we have fetched all mission terrain data
  */
@@ -36,7 +56,6 @@ void AP_Terrain::update_mission_data(void)
         last_mission_spacing != grid_spacing) {
         // the mission has changed - start again
         next_mission_index = 1;
-        next_mission_pos = 0;
         last_mission_change_ms = mission.last_change_time_ms();
         last_mission_spacing = grid_spacing;
     }
@@ -52,56 +71,52 @@ void AP_Terrain::update_mission_data(void)
         return;
     }
 
-    // don't do more than 20 waypoints at a time, to prevent too much
-    // CPU usage
-    for (uint8_t i=0; i<20; i++) {
-        // get next mission command
-        AP_Mission::Mission_Command cmd;
-        if (!mission.read_cmd_from_storage(next_mission_index, cmd)) {
-            // nothing more to do
-            next_mission_index = 0;
-            return;
+    /*
+      look up a batch of waypoints at once, so the grids for all of
+      them are fetched together rather than one waypoint at a time
+     */
+    Location locs[TERRAIN_MISSION_BATCH*TERRAIN_MISSION_POINTS];
+    float heights[TERRAIN_MISSION_BATCH*TERRAIN_MISSION_POINTS];
+    bool available[TERRAIN_MISSION_BATCH*TERRAIN_MISSION_POINTS];
+    uint16_t wp_index[TERRAIN_MISSION_BATCH];
+    uint8_t num_wp = 0;
+    uint16_t index = next_mission_index;
+
+    while (num_wp < TERRAIN_MISSION_BATCH) {
+        Location *points = &locs[num_wp*TERRAIN_MISSION_POINTS];
+        if (!next_mission_waypoint(index, points[0])) {
+            break;
         }
-
-        // we only want nav waypoint commands. That should be enough to
-        // prefill the terrain data and makes many things much simpler
-        while ((cmd.id != MAV_CMD_NAV_WAYPOINT &&
-                cmd.id != MAV_CMD_NAV_SPLINE_WAYPOINT) ||
-               (cmd.content.location.lat == 0 && cmd.content.location.lng == 0)) {
-            next_mission_index++;
-            if (!mission.read_cmd_from_storage(next_mission_index, cmd)) {
-                // nothing more to do
-                next_mission_index = 0;
-                next_mission_pos = 0;
-                return;
-            }
+        // we will fetch 5 points around the waypoint. The point
+        // itself, and four at 10 grid spacings away at 45, 135, 225
+        // and 315 degrees
+        for (uint8_t i=1; i<TERRAIN_MISSION_POINTS; i++) {
+            points[i] = points[0];
+            location_update(points[i], 45+90*(i-1), grid_spacing.get() * 10);
         }
+        wp_index[num_wp++] = index++;
+    }
 
-        // we will fetch 5 points around the waypoint. Four at 10 grid
-        // spacings away at 45, 135, 225 and 315 degrees, and the
-        // point itself
-        if (next_mission_pos != 4) {
-            location_update(cmd.content.location, 45+90*next_mission_pos, grid_spacing.get() * 10);
-        }
+    if (num_wp == 0) {
+        // nothing more to do
+        next_mission_index = 0;
+        return;
+    }
 
-        // we have a mission command to check
-        float height;
-        if (!height_amsl(cmd.content.location, height, false)) {
-            // if we can't get data for a mission item then return and
-            // check again next time
-            return;
-        }
+    height_amsl_batch(locs, num_wp*TERRAIN_MISSION_POINTS, heights, available);
 
-        next_mission_pos++;
-        if (next_mission_pos == 5) {
+    // move past the waypoints that have all their data. If we can't
+    // get data for a mission item then check again next time
+    for (uint8_t w=0; w<num_wp; w++) {
+        for (uint8_t i=0; i<TERRAIN_MISSION_POINTS; i++) {
+            if (!available[w*TERRAIN_MISSION_POINTS+i]) {
+                return;
+            }
+        }
 #if TERRAIN_DEBUG
-            hal.console->printf("checked waypoint %u\n", (unsigned)next_mission_index);
+        hal.console->printf("checked waypoint %u\n", (unsigned)wp_index[w]);
 #endif
-
-            // move to next waypoint
-            next_mission_index++;
-            next_mission_pos = 0;
-        }
+        next_mission_index = wp_index[w] + 1;
     }
 }
 
@@ -129,25 +144,33 @@ void AP_Terrain::update_rally_data(void)
         return;
     }
 
-    while (true) {
-        // get next rally point
-        struct RallyLocation rp;
-        if (!rally.get_rally_point_with_index(next_rally_index, rp)) {
-            // nothing more to do
-            next_rally_index = 0;
-            return;
-        }
+    // get the next set of rally points
+    Location locs[TERRAIN_MISSION_BATCH];
+    float heights[TERRAIN_MISSION_BATCH];
+    bool available[TERRAIN_MISSION_BATCH];
+    uint8_t count = 0;
+    struct RallyLocation rp;
+    while (count < TERRAIN_MISSION_BATCH &&
+           rally.get_rally_point_with_index(next_rally_index+count, rp)) {
+        locs[count].lat = rp.lat;
+        locs[count].lng = rp.lng;
+        count++;
+    }
+
+    if (count == 0) {
+        // nothing more to do
+        next_rally_index = 0;
+        return;
+    }
 
-        Location loc;
-        loc.lat = rp.lat;
-        loc.lng = rp.lng;
-        float height;
-        if (!height_amsl(loc, height, false)) {
+    height_amsl_batch(locs, count, heights, available);
+
+    for (uint8_t i=0; i<count; i++) {
+        if (!available[i]) {
             // if we can't get data for a rally item then return and
             // check again next time
             return;
         }
-
 #if TERRAIN_DEBUG
         hal.console->printf("checked rally point %u\n", (unsigned)next_rally_index);
 #endif
@@ -112,29 +112,90 @@ void AP_Terrain::calculate_grid_info(const Location &loc, struct grid_info &info
 
 
 /*
-  find a grid structure given a grid_info
+  hash bucket for a grid
  */
-AP_Terrain::grid_cache &AP_Terrain::find_grid_cache(const struct grid_info &info)
+uint16_t AP_Terrain::grid_hash(int32_t lat, int32_t lon) const
 {
-    uint16_t oldest_i = 0;
+    uint32_t h = ((uint32_t)lat * 0x9E3779B1U) ^ ((uint32_t)lon * 0x85EBCA77U);
+    h ^= h >> 16;
+    return h & cache_hash_mask;
+}
 
-    // see if we have that grid
-    for (uint16_t i=0; i<cache_size; i++) {
-        if (cache[i].grid.lat == info.grid_lat && 
-            cache[i].grid.lon == info.grid_lon &&
-            cache[i].grid.spacing == grid_spacing) {
-            cache[i].last_access_ms = AP_HAL::millis();
-            return cache[i];
+void AP_Terrain::cache_hash_insert(uint16_t idx)
+{
+    uint16_t &head = cache_hash[grid_hash(cache[idx].grid.lat, cache[idx].grid.lon)];
+    cache[idx].hash_next = head;
+    head = idx;
+}
+
+void AP_Terrain::cache_hash_remove(uint16_t idx)
+{
+    uint16_t *p = &cache_hash[grid_hash(cache[idx].grid.lat, cache[idx].grid.lon)];
+    while (*p != TERRAIN_CACHE_NONE) {
+        if (*p == idx) {
+            *p = cache[idx].hash_next;
+            break;
         }
-        if (cache[i].last_access_ms < cache[oldest_i].last_access_ms) {
-            oldest_i = i;
+        p = &cache[*p].hash_next;
+    }
+    cache[idx].hash_next = TERRAIN_CACHE_NONE;
+}
+
+/*
+  move a cache entry to the head of the LRU list
+ */
+void AP_Terrain::cache_touch(uint16_t idx)
+{
+    if (idx == lru_head) {
+        return;
+    }
+    struct grid_cache &c = cache[idx];
+    // unlink, we know it isn't the head
+    cache[c.lru_prev].lru_next = c.lru_next;
+    if (c.lru_next != TERRAIN_CACHE_NONE) {
+        cache[c.lru_next].lru_prev = c.lru_prev;
+    } else {
+        lru_tail = c.lru_prev;
+    }
+    c.lru_prev = TERRAIN_CACHE_NONE;
+    c.lru_next = lru_head;
+    cache[lru_head].lru_prev = idx;
+    lru_head = idx;
+}
+
+/*
+  find the cache index of a grid
+ */
+int16_t AP_Terrain::find_cache_idx(int32_t lat, int32_t lon, uint16_t spacing) const
+{
+    for (uint16_t i = cache_hash[grid_hash(lat, lon)]; i != TERRAIN_CACHE_NONE; i = cache[i].hash_next) {
+        if (cache[i].grid.lat == lat &&
+            cache[i].grid.lon == lon &&
+            cache[i].grid.spacing == spacing) {
+            return i;
         }
     }
+    return -1;
+}
 
-    // Not found. Use the oldest grid and make it this grid,
-    // initially unpopulated
-    struct grid_cache &grid = cache[oldest_i];
-    memset(&grid, 0, sizeof(grid));
+/*
+  find a grid structure given a grid_info
+ */
+AP_Terrain::grid_cache &AP_Terrain::find_grid_cache(const struct grid_info &info)
+{
+    // see if we have that grid
+    int16_t idx = find_cache_idx(info.grid_lat, info.grid_lon, grid_spacing);
+    if (idx != -1) {
+        cache_touch(idx);
+        return cache[idx];
+    }
+
+    // Not found. Use the least recently used grid and make it this
+    // grid, initially unpopulated
+    idx = lru_tail;
+    cache_hash_remove(idx);
+    struct grid_cache &grid = cache[idx];
+    memset(&grid.grid, 0, sizeof(grid.grid));
 
     grid.grid.lat = info.grid_lat;
     grid.grid.lon = info.grid_lon;
@@ -144,10 +205,18 @@ AP_Terrain::grid_cache &AP_Terrain::find_grid_cache(const struct grid_info &info
     grid.grid.lat_degrees = info.lat_degrees;
     grid.grid.lon_degrees = info.lon_degrees;
     grid.grid.version = TERRAIN_GRID_FORMAT_VERSION;
-    grid.last_access_ms = AP_HAL::millis();
 
-    // mark as waiting for disk read
+    // mark as waiting for disk read, unless the block is already in
+    // memory in a mapped file
     grid.state = GRID_CACHE_DISKWAIT;
+#if TERRAIN_MMAP_ENABLED
+    if (load_from_map(grid)) {
+        grid.state = GRID_CACHE_VALID;
+    }
+#endif
+
+    cache_hash_insert(idx);
+    cache_touch(idx);
 
     return grid;
 }
@@ -187,4 +256,51 @@ uint16_t AP_Terrain::get_block_crc(struct grid_block &block)
     return ret;
 }
 
+/*
+  check a block read from a file is the one we asked for and is intact
+ */
+bool AP_Terrain::check_block(struct grid_block &block, int32_t lat, int32_t lon)
+{
+    return (block.lat == lat &&
+            block.lon == lon &&
+            block.bitmap != 0 &&
+            block.spacing == grid_spacing &&
+            block.version == TERRAIN_GRID_FORMAT_VERSION &&
+            block.crc == get_block_crc(block));
+}
+
+/*
+  work out how many longitude blocks there are at the latitude of a
+  block in its degree file
+ */
+uint16_t AP_Terrain::file_east_blocks(const struct grid_block &block) const
+{
+    Location loc1, loc2;
+    loc1.lat = block.lat_degrees*10*1000*1000L;
+    loc1.lng = block.lon_degrees*10*1000*1000L;
+    loc2.lat = block.lat_degrees*10*1000*1000L;
+    loc2.lng = (block.lon_degrees+1)*10*1000*1000L;
+
+    // shift another two blocks east to ensure room is available
+    location_offset(loc2, 0, 2*grid_spacing*TERRAIN_GRID_BLOCK_SIZE_Y);
+    Vector2f offset = location_diff(loc1, loc2);
+    return offset.y / (grid_spacing*TERRAIN_GRID_BLOCK_SIZE_Y);
+}
+
+/*
+  the largest size the degree file of a block can grow to
+ */
+uint32_t AP_Terrain::file_length(const struct grid_block &block, uint16_t east_blocks) const
+{
+    Location loc1, loc2;
+    loc1.lat = block.lat_degrees*10*1000*1000L;
+    loc1.lng = block.lon_degrees*10*1000*1000L;
+    loc2.lat = (block.lat_degrees+1)*10*1000*1000L;
+    loc2.lng = block.lon_degrees*10*1000*1000L;
+    Vector2f offset = location_diff(loc1, loc2);
+    uint32_t north_blocks = offset.x / (grid_spacing*TERRAIN_GRID_BLOCK_SPACING_X) + 2;
+    uint64_t length = (uint64_t)north_blocks * east_blocks * sizeof(union grid_io_block);
+    return MIN(length, UINT32_MAX);
+}
+
 #endif // AP_TERRAIN_AVAILABLE
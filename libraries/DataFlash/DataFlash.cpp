@@ -31,7 +31,14 @@ const AP_Param::GroupInfo DataFlash_Class::var_info[] = {
     // @Values: 0:Disabled,1:Enabled
     // @User: Standard
     AP_GROUPINFO("_REPLAY",  3, DataFlash_Class, _params.log_replay,       0),
-    
+
+    // @Param: _FILE_COMP
+    // @DisplayName: Compress DataFlash log files
+    // @Description: If LOG_FILE_COMP is set to 1 new log files are written as independently compressed blocks, typically making them 3 to 5 times smaller. Only Replay can read compressed logs: they are downloaded over MAVLink as they are stored, and ground stations and other log tools cannot decode them. Leave this disabled unless the logs are read with Replay. Takes effect from the next log
+    // @Values: 0:Disabled,1:Enabled
+    // @User: Advanced
+    AP_GROUPINFO("_FILE_COMP",  4, DataFlash_Class, _params.file_compress,       0),
+
     AP_GROUPEND
 };
 
@@ -89,6 +96,34 @@ void DataFlash_Class::WritePrioritisedBlock(const void *pBuffer, uint16_t size,
     FOR_EACH_BACKEND(WritePrioritisedBlock(pBuffer, size, is_critical));
 }
 
+void *DataFlash_Class::WriteReserve(uint16_t size, bool is_critical)
+{
+    if (_next_backend == 1) {
+        return backends[0]->WriteReserve(size, is_critical);
+    }
+    // with several backends the message is built once then copied to each
+    if (_next_backend == 0 || size > sizeof(_reserve_buf)) {
+        return nullptr;
+    }
+    if (_reserve_sem != nullptr && !_reserve_sem->take(1)) {
+        return nullptr;
+    }
+    _reserve_critical = is_critical;
+    return _reserve_buf;
+}
+
+void DataFlash_Class::WriteCommit(uint16_t size)
+{
+    if (_next_backend == 1) {
+        backends[0]->WriteCommit(size);
+        return;
+    }
+    WritePrioritisedBlock(_reserve_buf, size, _reserve_critical);
+    if (_reserve_sem != nullptr) {
+        _reserve_sem->give();
+    }
+}
+
 // change me to "DoTimeConsumingPreparations"?
 void DataFlash_Class::EraseAll() {
     FOR_EACH_BACKEND(EraseAll());
@@ -251,6 +286,18 @@ uint32_t DataFlash_Class::num_dropped() const
     return backends[0]->num_dropped();
 }
 
+uint32_t DataFlash_Class::bufferspace_available(void)
+{
+    if (_next_backend == 0) {
+        return 0;
+    }
+    uint32_t space = backends[0]->bufferspace_available();
+    for (uint8_t i=1; i<_next_backend; i++) {
+        space = MIN(space, backends[i]->bufferspace_available());
+    }
+    return space;
+}
+
 
 // end functions pass straight through to backend
 
@@ -392,6 +439,7 @@ int16_t DataFlash_Class::Log_Write_calc_msg_len(const char *fmt) const
     uint8_t len =  LOG_PACKET_HEADER_LEN;
     for (uint8_t i=0; i<strlen(fmt); i++) {
         switch(fmt[i]) {
+        case 'a' : len += sizeof(int16_t[32]); break;
         case 'b' : len += sizeof(int8_t); break;
         case 'c' : len += sizeof(int16_t); break;
         case 'd' : len += sizeof(double); break;
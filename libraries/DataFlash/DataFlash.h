@@ -40,6 +40,7 @@ enum DataFlash_Backend_Type {
 // fwd declarations to avoid include errors
 class AC_AttitudeControl;
 class AC_PosControl;
+class AP_Scheduler;
 
 class DataFlash_Class
 {
@@ -88,6 +89,15 @@ public:
     /* Write an *important* block of data at current offset */
     void WriteCriticalBlock(const void *pBuffer, uint16_t size);
 
+    /*
+      reserve space for a size byte message so that it can be built
+      in place, avoiding a copy when there is a single backend.
+      Returns nullptr if the message can't be logged. A non-null
+      return must be followed by WriteCommit() with the same size
+     */
+    void *WriteReserve(uint16_t size, bool is_critical=false);
+    void WriteCommit(uint16_t size);
+
     // high level interface
     uint16_t find_last_log() const;
     void get_log_boundaries(uint16_t log_num, uint16_t & start_page, uint16_t & end_page);
@@ -149,6 +159,7 @@ public:
                         const AC_AttitudeControl &attitude_control,
                         const AC_PosControl &pos_control);
     void Log_Write_Rally(const AP_Rally &rally);
+    void Log_Write_Scheduler_Stats(const AP_Scheduler &scheduler);
 
     void Log_Write(const char *name, const char *labels, const char *fmt, ...);
 
@@ -181,6 +192,9 @@ public:
     // number of blocks that have been dropped
     uint32_t num_dropped(void) const;
 
+    // bytes that can be written without dropping, the least of all backends
+    uint32_t bufferspace_available(void);
+
     // accesss to public parameters
     bool log_while_disarmed(void) const { return _params.log_disarmed != 0; }
     uint8_t log_replay(void) const { return _params.log_replay; }
@@ -194,6 +208,7 @@ public:
         AP_Int8 file_bufsize; // in kilobytes
         AP_Int8 log_disarmed;
         AP_Int8 log_replay;
+        AP_Int8 file_compress;
     } _params;
 
     const struct LogStructure *structure(uint16_t num) const;
@@ -222,8 +237,17 @@ private:
     DataFlash_Backend *backends[DATAFLASH_MAX_BACKENDS];
     const char *_firmware_string;
 
+    // staging for WriteReserve() when there are several backends,
+    // held by _reserve_sem from WriteReserve() until WriteCommit()
+    uint8_t _reserve_buf[256];
+    bool _reserve_critical;
+    AP_HAL::Semaphore *_reserve_sem = nullptr;
+
     void internal_error() const;
 
+    void Log_Write_IMU_instance(const AP_InertialSensor &ins, uint64_t time_us, uint8_t imu_instance, uint8_t type);
+    void Log_Write_IMUDT_instance(const AP_InertialSensor &ins, uint64_t time_us, uint8_t imu_instance, uint8_t type);
+
     /*
      * support for dynamic Log_Write; user-supplies name, format,
      * labels and values in a single function call.
@@ -62,6 +62,40 @@ void DataFlash_Backend::internal_error() {
 #endif
 }
 
+void DataFlash_Backend::Init()
+{
+    _writes_enabled = true;
+    if (_reserve_sem == nullptr) {
+        _reserve_sem = hal.util->new_semaphore();
+    }
+}
+
+/*
+  default reserve/commit, building the message in a staging buffer
+  and passing it to WritePrioritisedBlock()
+ */
+
+void *DataFlash_Backend::WriteReserve(uint16_t size, bool is_critical)
+{
+    if (size > sizeof(_reserve_buf)) {
+        return nullptr;
+    }
+    if (_reserve_sem != nullptr && !_reserve_sem->take(1)) {
+        return nullptr;
+    }
+    _reserve_critical = is_critical;
+    return _reserve_buf;
+}
+
+bool DataFlash_Backend::WriteCommit(uint16_t size)
+{
+    const bool ret = WritePrioritisedBlock(_reserve_buf, size, _reserve_critical);
+    if (_reserve_sem != nullptr) {
+        _reserve_sem->give();
+    }
+    return ret;
+}
+
 void DataFlash_Backend::set_mission(const AP_Mission *mission) {
     _startup_messagewriter->set_mission(mission);
 }
@@ -173,6 +207,12 @@ bool DataFlash_Backend::Log_Write(const uint8_t msg_type, va_list arg_list, bool
     for (uint8_t i=0; i<strlen(fmt); i++) {
         uint8_t charlen = 0;
         switch(fmt[i]) {
+        case 'a': {
+            const int16_t *tmp = va_arg(arg_list, const int16_t *);
+            memcpy(&buffer[offset], tmp, sizeof(int16_t[32]));
+            offset += sizeof(int16_t[32]);
+            break;
+        }
         case 'b': {
             int8_t tmp = va_arg(arg_list, int);
             memcpy(&buffer[offset], &tmp, sizeof(int8_t));
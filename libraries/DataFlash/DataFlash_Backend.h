@@ -37,6 +37,15 @@ public:
 
     virtual bool WritePrioritisedBlock(const void *pBuffer, uint16_t size, bool is_critical) = 0;
 
+    /*
+      reserve space for a size byte message, returning a pointer the
+      caller fills in before calling WriteCommit(), or nullptr if the
+      message can't be written. Backends which can hand out space in
+      their own buffer override these to save a copy
+     */
+    virtual void *WriteReserve(uint16_t size, bool is_critical);
+    virtual bool WriteCommit(uint16_t size);
+
     // high level interface
     virtual uint16_t find_last_log() = 0;
     virtual void get_log_boundaries(uint16_t log_num, uint16_t & start_page, uint16_t & end_page) = 0;
@@ -54,9 +63,7 @@ public:
     void EnableWrites(bool enable) { _writes_enabled = enable; }
     bool logging_started(void) const { return log_write_started; }
 
-    virtual void Init() {
-        _writes_enabled = true;
-    }
+    virtual void Init();
 
     void set_mission(const AP_Mission *mission);
 
@@ -155,6 +162,12 @@ protected:
     uint32_t _internal_errors;
     uint32_t _dropped;
 
+    // staging buffer for messages built with WriteReserve(), held by
+    // _reserve_sem from WriteReserve() until WriteCommit()
+    uint8_t _reserve_buf[256];
+    bool _reserve_critical;
+    AP_HAL::Semaphore *_reserve_sem = nullptr;
+
     // must be called when a new log is being started:
     virtual void start_new_log_reset_variables();
 
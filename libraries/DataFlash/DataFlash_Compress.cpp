@@ -0,0 +1,221 @@
+/*
+   DataFlash logging - block compressed log files
+
+   The compressor is a simple greedy LZ4 block encoder with a single
+   hash table of 4 byte sequences. Log data is full of repeated
+   headers, timestamps with equal high bytes and slowly changing
+   values, so even this finds most of the available matches while
+   costing little CPU on the IO thread.
+ */
+
+#include "DataFlash_Compress.h"
+
+#include <string.h>
+
+// LZ4 block format limits
+#define MIN_MATCH 4
+#define LAST_LITERALS 5     // the last 5 bytes are always literals
+#define MF_LIMIT 12         // a match may not start in the last 12 bytes
+#define MAX_OFFSET 65535
+
+static inline uint32_t read32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t hash4(uint32_t v)
+{
+    return (v * 2654435761U) >> (32 - DATAFLASH_COMPRESS_HASH_BITS);
+}
+
+/*
+  write an LZ4 length continuation, returning the new output position
+  or nullptr if it does not fit
+ */
+static uint8_t *write_length(uint8_t *op, const uint8_t *oend, uint32_t len)
+{
+    while (len >= 255) {
+        if (op >= oend) {
+            return nullptr;
+        }
+        *op++ = 255;
+        len -= 255;
+    }
+    if (op >= oend) {
+        return nullptr;
+    }
+    *op++ = len;
+    return op;
+}
+
+/*
+  emit one sequence of literals, optionally followed by a match. A
+  match_len of zero marks the final, literal only, sequence
+ */
+static uint8_t *write_sequence(uint8_t *op, const uint8_t *oend,
+                               const uint8_t *literals, uint32_t lit_len,
+                               uint16_t offset, uint32_t match_len)
+{
+    if (op >= oend) {
+        return nullptr;
+    }
+    uint8_t *token = op++;
+    *token = (lit_len < 15 ? lit_len : 15) << 4;
+    if (lit_len >= 15) {
+        op = write_length(op, oend, lit_len - 15);
+        if (op == nullptr) {
+            return nullptr;
+        }
+    }
+    if (op + lit_len > oend) {
+        return nullptr;
+    }
+    memcpy(op, literals, lit_len);
+    op += lit_len;
+
+    if (match_len == 0) {
+        return op;
+    }
+    if (op + 2 > oend) {
+        return nullptr;
+    }
+    *op++ = offset & 0xFF;
+    *op++ = offset >> 8;
+    const uint32_t ml = match_len - MIN_MATCH;
+    *token |= (ml < 15 ? ml : 15);
+    if (ml >= 15) {
+        op = write_length(op, oend, ml - 15);
+    }
+    return op;
+}
+
+/*
+  LZ4 compress a buffer. Returns the compressed length or 0 if it does
+  not fit in dst_len bytes
+ */
+uint32_t DataFlash_Compressor::compress(const uint8_t *src, uint32_t len, uint8_t *dst, uint32_t dst_len)
+{
+    uint8_t *op = dst;
+    const uint8_t *oend = dst + dst_len;
+    uint32_t anchor = 0;
+
+    if (len > MF_LIMIT) {
+        memset(_hash_table, 0, sizeof(_hash_table));
+        const uint32_t limit = len - MF_LIMIT;
+        const uint32_t match_limit = len - LAST_LITERALS;
+        uint32_t ip = 1;
+        while (ip < limit) {
+            const uint32_t v = read32(&src[ip]);
+            const uint32_t h = hash4(v);
+            const uint32_t ref = _hash_table[h];
+            _hash_table[h] = ip;
+            if (ip - ref > MAX_OFFSET || read32(&src[ref]) != v) {
+                ip++;
+                continue;
+            }
+            uint32_t match_len = MIN_MATCH;
+            while (ip + match_len < match_limit && src[ref + match_len] == src[ip + match_len]) {
+                match_len++;
+            }
+            op = write_sequence(op, oend, &src[anchor], ip - anchor, ip - ref, match_len);
+            if (op == nullptr) {
+                return 0;
+            }
+            ip += match_len;
+            anchor = ip;
+        }
+    }
+
+    op = write_sequence(op, oend, &src[anchor], len - anchor, 0, 0);
+    if (op == nullptr) {
+        return 0;
+    }
+    return op - dst;
+}
+
+uint32_t DataFlash_Compressor::compress_block(const uint8_t *src, uint16_t len, uint64_t time_us, uint8_t *dst)
+{
+    struct log_compressed_block_header hdr {};
+    hdr.sync1 = DATAFLASH_COMPRESS_SYNC1;
+    hdr.sync2 = DATAFLASH_COMPRESS_SYNC2;
+    hdr.raw_len = len;
+    hdr.time_us = time_us;
+
+    uint8_t *payload = dst + sizeof(hdr);
+    // only keep the compressed form if it is smaller
+    hdr.comp_len = compress(src, len, payload, len > 0 ? len - 1 : 0);
+    if (hdr.comp_len == 0) {
+        memcpy(payload, src, len);
+    }
+    memcpy(dst, &hdr, sizeof(hdr));
+    return sizeof(hdr) + (hdr.comp_len ? hdr.comp_len : len);
+}
+
+int32_t DataFlash_Compressor::decompress(const uint8_t *src, uint32_t src_len, uint8_t *dst, uint32_t dst_len)
+{
+    const uint8_t *ip = src;
+    const uint8_t *iend = src + src_len;
+    uint8_t *op = dst;
+    uint8_t *oend = dst + dst_len;
+
+    while (ip < iend) {
+        const uint8_t token = *ip++;
+
+        uint32_t lit_len = token >> 4;
+        if (lit_len == 15) {
+            uint8_t b;
+            do {
+                if (ip >= iend) {
+                    return -1;
+                }
+                b = *ip++;
+                lit_len += b;
+            } while (b == 255);
+        }
+        if (lit_len > (uint32_t)(iend - ip) || lit_len > (uint32_t)(oend - op)) {
+            return -1;
+        }
+        memcpy(op, ip, lit_len);
+        ip += lit_len;
+        op += lit_len;
+
+        if (ip == iend) {
+            // the last sequence has no match
+            break;
+        }
+
+        if (iend - ip < 2) {
+            return -1;
+        }
+        const uint16_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > op - dst) {
+            return -1;
+        }
+
+        uint32_t match_len = token & 0x0F;
+        if (match_len == 15) {
+            uint8_t b;
+            do {
+                if (ip >= iend) {
+                    return -1;
+                }
+                b = *ip++;
+                match_len += b;
+            } while (b == 255);
+        }
+        match_len += MIN_MATCH;
+        if (match_len > (uint32_t)(oend - op)) {
+            return -1;
+        }
+        // matches may overlap their own output, so copy bytewise
+        const uint8_t *match = op - offset;
+        for (uint32_t i=0; i<match_len; i++) {
+            op[i] = match[i];
+        }
+        op += match_len;
+    }
+    return op - dst;
+}
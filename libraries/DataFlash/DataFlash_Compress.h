@@ -0,0 +1,66 @@
+/*
+   DataFlash logging - block compressed log files
+
+   A compressed log starts with a log_compressed_file_header and is
+   followed by a sequence of blocks, each a log_compressed_block_header
+   and its payload. Every block is compressed on its own in the LZ4
+   block format, so it can be decoded without any earlier block, and
+   carries the time it was written to allow coarse seeking without
+   decompressing the whole file. Decompressing all the blocks in order
+   gives exactly the bytes of the equivalent uncompressed log,
+   including the FMT messages at its start.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <AP_Common/AP_Common.h>
+
+#define DATAFLASH_COMPRESS_MAGIC "APLZ"
+#define DATAFLASH_COMPRESS_VERSION 1
+
+#define DATAFLASH_COMPRESS_SYNC1 0x4C
+#define DATAFLASH_COMPRESS_SYNC2 0x5A
+
+// uncompressed bytes per block. Must be below 64k as the compressor
+// keeps positions in 16 bits
+#define DATAFLASH_COMPRESS_BLOCK_SIZE 16384U
+
+#define DATAFLASH_COMPRESS_HASH_BITS 12
+
+struct PACKED log_compressed_file_header {
+    char magic[4];
+    uint8_t version;
+    uint8_t reserved[3];
+};
+
+struct PACKED log_compressed_block_header {
+    uint8_t sync1, sync2;
+    uint16_t raw_len;
+    uint16_t comp_len;  // 0 if the block is stored uncompressed
+    uint64_t time_us;
+};
+
+// largest possible block, header included
+#define DATAFLASH_COMPRESS_MAX_FRAME (sizeof(struct log_compressed_block_header) + DATAFLASH_COMPRESS_BLOCK_SIZE)
+
+class DataFlash_Compressor
+{
+public:
+    /*
+      compress len bytes, at most DATAFLASH_COMPRESS_BLOCK_SIZE, into a
+      block with header at dst, which must have room for
+      DATAFLASH_COMPRESS_MAX_FRAME bytes. Returns the block length
+     */
+    uint32_t compress_block(const uint8_t *src, uint16_t len, uint64_t time_us, uint8_t *dst);
+
+    /*
+      decode an LZ4 block. Returns the number of bytes written to dst
+      or -1 if the data is corrupt or does not fit
+     */
+    static int32_t decompress(const uint8_t *src, uint32_t src_len, uint8_t *dst, uint32_t dst_len);
+
+private:
+    uint16_t _hash_table[1U<<DATAFLASH_COMPRESS_HASH_BITS];
+
+    uint32_t compress(const uint8_t *src, uint32_t len, uint8_t *dst, uint32_t dst_len);
+};
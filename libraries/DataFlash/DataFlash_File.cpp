@@ -35,6 +35,9 @@
 #elif !DATAFLASH_FILE_MINIMAL
 #include <sys/statfs.h>
 #endif
+#if CONFIG_HAL_BOARD == HAL_BOARD_LINUX
+#include <AP_HAL_Linux/Storage.h>
+#endif
 extern const AP_HAL::HAL& hal;
 
 #define MAX_LOG_FILES 500U
@@ -76,10 +79,24 @@ DataFlash_File::DataFlash_File(DataFlash_Class &front,
     _writebuf_chunk(4096),
 #endif
     _last_write_time(0),
+#if DATAFLASH_FILE_ASYNC
+    _async_available(false),
+    _last_async_flush(0),
+#endif
+    _stats_last_ms(0),
+    _stats_last_bytes(0),
+    _bytes_written(0),
+    _compressor(nullptr),
+    _comp_raw(nullptr),
+    _comp_frame(nullptr),
+    _comp_frame_len(0),
+    _comp_frame_ofs(0),
+    _compressing(false),
     _perf_write(hal.util->perf_alloc(AP_HAL::Util::PC_ELAPSED, "DF_write")),
     _perf_fsync(hal.util->perf_alloc(AP_HAL::Util::PC_ELAPSED, "DF_fsync")),
     _perf_errors(hal.util->perf_alloc(AP_HAL::Util::PC_COUNT, "DF_errors")),
-    _perf_overruns(hal.util->perf_alloc(AP_HAL::Util::PC_COUNT, "DF_overruns"))
+    _perf_overruns(hal.util->perf_alloc(AP_HAL::Util::PC_COUNT, "DF_overruns")),
+    _perf_compress(hal.util->perf_alloc(AP_HAL::Util::PC_ELAPSED, "DF_compress"))
 {}
 
 
@@ -145,7 +162,11 @@ void DataFlash_File::Init()
         return;
     }
 
-    hal.console->printf("DataFlash_File: buffer size=%u\n", (unsigned)bufsize);
+    hal.console->printf("DataFlash_File: buffer size=%u\n", (unsigned)_writebuf.get_size());
+
+#if DATAFLASH_FILE_ASYNC
+    _async_available = _async.init();
+#endif
 
     _initialised = true;
     hal.scheduler->register_io_process(FUNCTOR_BIND_MEMBER(&DataFlash_File::_io_timer, void));
@@ -182,6 +203,14 @@ bool DataFlash_File::log_exists(const uint16_t lognum) const
     return ret;
 }
 
+void DataFlash_File::periodic_1Hz(const uint32_t now)
+{
+    Log_Write_DF_File_Stats(now);
+#if CONFIG_HAL_BOARD == HAL_BOARD_LINUX
+    Log_Write_Storage_Stats();
+#endif
+}
+
 void DataFlash_File::periodic_fullrate(const uint32_t now)
 {
     DataFlash_Backend::push_log_blocks();
@@ -457,8 +486,12 @@ void DataFlash_File::EraseAll()
     }
 }
 
-/* Write a block of data at current offset */
-bool DataFlash_File::WritePrioritisedBlock(const void *pBuffer, uint16_t size, bool is_critical)
+/*
+  check a message of size bytes can be written now, taking the write
+  semaphore if so. The caller must give the semaphore back after
+  writing to _writebuf
+ */
+bool DataFlash_File::_write_begin(uint16_t size, bool is_critical)
 {
     if (_write_fd == -1 || !_initialised || _open_error || !_writes_enabled) {
         return false;
@@ -503,11 +536,50 @@ bool DataFlash_File::WritePrioritisedBlock(const void *pBuffer, uint16_t size, b
         return false;
     }
 
+    return true;
+}
+
+/* Write a block of data at current offset */
+bool DataFlash_File::WritePrioritisedBlock(const void *pBuffer, uint16_t size, bool is_critical)
+{
+    if (!_write_begin(size, is_critical)) {
+        return false;
+    }
     _writebuf.write((uint8_t*)pBuffer, size);
     semaphore->give();
     return true;
 }
 
+/*
+  hand out space directly in the write buffer. The write semaphore is
+  held until WriteCommit()
+ */
+void *DataFlash_File::WriteReserve(uint16_t size, bool is_critical)
+{
+    if (size > sizeof(_reserve_buf) || !_write_begin(size, is_critical)) {
+        return nullptr;
+    }
+    SPSCByteBuffer::IoVec vec[2];
+    if (_writebuf.reserve(vec, size) == 1) {
+        _reserve_in_place = true;
+        return vec[0].data;
+    }
+    // the message would wrap around the end of the buffer, so stage it
+    _reserve_in_place = false;
+    return _reserve_buf;
+}
+
+bool DataFlash_File::WriteCommit(uint16_t size)
+{
+    if (_reserve_in_place) {
+        _writebuf.commit(size);
+    } else {
+        _writebuf.write(_reserve_buf, size);
+    }
+    semaphore->give();
+    return true;
+}
+
 /*
   read a packet. The header bytes have already been read.
 */
@@ -761,6 +833,9 @@ void DataFlash_File::stop_logging(void)
         int fd = _write_fd;
         _write_fd = -1;
         log_write_started = false;
+#if DATAFLASH_FILE_ASYNC
+        _async.stop();
+#endif
         ::close(fd);
     }
 }
@@ -804,10 +879,10 @@ uint16_t DataFlash_File::start_new_log(void)
     if (fname == nullptr) {
         return 0xFFFF;
     }
-    _write_fd = ::open(fname, O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, 0666);
+    const int write_fd = ::open(fname, O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, 0666);
     _cached_oldest_log = 0;
 
-    if (_write_fd == -1) {
+    if (write_fd == -1) {
         _initialised = false;
         _open_error = true;
         int saved_errno = errno;
@@ -821,6 +896,28 @@ uint16_t DataFlash_File::start_new_log(void)
     free(fname);
     _write_offset = 0;
     _writebuf.clear();
+
+    // the compression setting only changes between logs. It is settled
+    // before the fd is published, as the IO thread starts writing as
+    // soon as it sees the fd
+    _compressing = _front._params.file_compress && _compress_init();
+    _comp_frame_ofs = 0;
+    _comp_frame_len = 0;
+    if (_compressing) {
+        // written ahead of the first block
+        struct log_compressed_file_header hdr {};
+        memcpy(hdr.magic, DATAFLASH_COMPRESS_MAGIC, sizeof(hdr.magic));
+        hdr.version = DATAFLASH_COMPRESS_VERSION;
+        memcpy(_comp_frame, &hdr, sizeof(hdr));
+        _comp_frame_len = sizeof(hdr);
+    }
+
+#if DATAFLASH_FILE_ASYNC
+    if (_async_available) {
+        _async.start(write_fd);
+    }
+#endif
+    _write_fd = write_fd;
     log_write_started = true;
 
     // now update lastlog.txt with the new log number
@@ -880,6 +977,21 @@ void DataFlash_File::LogReadProcess(const uint16_t list_entry,
     }
     _read_fd_log_num = log_num;
     _read_offset = 0;
+
+    struct log_compressed_file_header hdr;
+    if (::read(_read_fd, &hdr, sizeof(hdr)) == sizeof(hdr) &&
+        memcmp(hdr.magic, DATAFLASH_COMPRESS_MAGIC, sizeof(hdr.magic)) == 0) {
+        port->printf("Log %u is compressed, download it to read\n", (unsigned)log_num);
+        close(_read_fd);
+        _read_fd = -1;
+        return;
+    }
+    if (::lseek(_read_fd, 0, SEEK_SET) == (off_t)-1) {
+        close(_read_fd);
+        _read_fd = -1;
+        return;
+    }
+
     if (start_page != 0) {
         if (::lseek(_read_fd, start_page * DATAFLASH_PAGE_SIZE, SEEK_SET) == (off_t)-1) {
             close(_read_fd);
@@ -1000,7 +1112,8 @@ void DataFlash_File::flush(void)
 {
     uint32_t tnow = AP_HAL::micros();
     hal.scheduler->suspend_timer_procs();
-    while (_write_fd != -1 && _initialised && !_open_error && _writebuf.available()) {
+    while (_write_fd != -1 && _initialised && !_open_error &&
+           (_writebuf.available() || _comp_frame_ofs != _comp_frame_len)) {
         // convince the IO timer that it really is OK to write out
         // less than _writebuf_chunk bytes:
         if (tnow > 2000001) { // avoid resetting _last_write_time to 0
@@ -1009,18 +1122,105 @@ void DataFlash_File::flush(void)
         _io_timer();
     }
     hal.scheduler->resume_timer_procs();
+#if DATAFLASH_FILE_ASYNC
+    // push out the partial block held by the async writer. Anything
+    // logged after this is written synchronously
+    _async.stop();
+    if (_async.failed()) {
+        hal.util->perf_count(_perf_errors);
+        hal.console->printf("DataFlash_File: async write failed\n");
+        stop_logging();
+        _initialised = false;
+    }
+#endif
     if (_write_fd != -1) {
         ::fsync(_write_fd);
     }
 }
 #endif
 
+/*
+  allocate the buffers needed for compression the first time it is
+  used, so they cost nothing unless LOG_FILE_COMP is set
+ */
+bool DataFlash_File::_compress_init(void)
+{
+    if (_compressor != nullptr) {
+        return true;
+    }
+    _comp_raw = new uint8_t[DATAFLASH_COMPRESS_BLOCK_SIZE];
+    _comp_frame = new uint8_t[DATAFLASH_COMPRESS_MAX_FRAME];
+    DataFlash_Compressor *compressor = new DataFlash_Compressor;
+    if (_comp_raw == nullptr || _comp_frame == nullptr || compressor == nullptr) {
+        hal.console->printf("DataFlash_File: out of memory for compression\n");
+        delete [] _comp_raw;
+        delete [] _comp_frame;
+        delete compressor;
+        _comp_raw = nullptr;
+        _comp_frame = nullptr;
+        return false;
+    }
+    _compressor = compressor;
+    return true;
+}
+
+/*
+  check there is still room on the card every _free_space_check_interval,
+  stopping logging if not
+ */
+bool DataFlash_File::_check_free_space(uint32_t tnow)
+{
+    if (tnow - _free_space_last_check_time > _free_space_check_interval) {
+        _free_space_last_check_time = tnow;
+        if (disk_space_avail() < _free_space_min_avail) {
+            hal.console->printf("Out of space for logging\n");
+            stop_logging();
+            _open_error = true; // prevent logging starting again
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+  write directly to the log file, returning the number of bytes
+  written. Logging stops on error
+ */
+uint32_t DataFlash_File::_write_sync(const uint8_t *data, uint32_t len)
+{
+    ssize_t nwritten = ::write(_write_fd, data, len);
+    if (nwritten <= 0) {
+        hal.util->perf_count(_perf_errors);
+        close(_write_fd);
+        _write_fd = -1;
+        _initialised = false;
+        return 0;
+    }
+    _write_offset += nwritten;
+    _bytes_written += nwritten;
+    /*
+      the best strategy for minimizing corruption on microSD cards
+      seems to be to write in 4k chunks and fsync the file on each
+      chunk, ensuring the directory entry is updated after each
+      write.
+     */
+#if CONFIG_HAL_BOARD != HAL_BOARD_SITL && CONFIG_HAL_BOARD_SUBTYPE != HAL_BOARD_SUBTYPE_LINUX_NONE && CONFIG_HAL_BOARD != HAL_BOARD_QURT
+    ::fsync(_write_fd);
+#endif
+    return nwritten;
+}
+
 void DataFlash_File::_io_timer(void)
 {
     if (_write_fd == -1 || !_initialised || _open_error) {
         return;
     }
 
+    if (_compressing) {
+        _io_timer_compressed();
+        return;
+    }
+
     uint32_t nbytes = _writebuf.available();
     if (nbytes == 0) {
         return;
@@ -1032,16 +1232,17 @@ void DataFlash_File::_io_timer(void)
         // least once per 2 seconds if data is available
         return;
     }
-    if (tnow - _free_space_last_check_time > _free_space_check_interval) {
-        _free_space_last_check_time = tnow;
-        if (disk_space_avail() < _free_space_min_avail) {
-            hal.console->printf("Out of space for logging\n");
-            stop_logging();
-            _open_error = true; // prevent logging starting again
-            return;
-        }
+    if (!_check_free_space(tnow)) {
+        return;
     }
 
+#if DATAFLASH_FILE_ASYNC
+    if (_async.active()) {
+        _io_timer_async(tnow);
+        return;
+    }
+#endif
+
     hal.util->perf_begin(_perf_write);
 
     _last_write_time = tnow;
@@ -1062,27 +1263,167 @@ void DataFlash_File::_io_timer(void)
         }
     }
 
-    ssize_t nwritten = ::write(_write_fd, head, nbytes);
-    if (nwritten <= 0) {
+    _writebuf.advance(_write_sync(head, nbytes));
+    hal.util->perf_end(_perf_write);
+}
+
+/*
+  compress the buffered log data a block at a time. Each block is
+  written out in full before the next is taken from _writebuf, so a
+  block waiting to be written just holds up the ring buffer like
+  uncompressed data would
+ */
+void DataFlash_File::_io_timer_compressed(void)
+{
+    const uint32_t tnow = AP_HAL::micros();
+    if (_comp_frame_ofs == _comp_frame_len) {
+        uint32_t nbytes = _writebuf.available();
+        if (nbytes == 0) {
+            return;
+        }
+        if (nbytes < DATAFLASH_COMPRESS_BLOCK_SIZE &&
+            tnow - _last_write_time < 2000000UL) {
+            // compress full blocks, but at least once per 2 seconds
+            return;
+        }
+        if (!_check_free_space(tnow)) {
+            return;
+        }
+        hal.util->perf_begin(_perf_compress);
+        nbytes = _writebuf.read(_comp_raw, MIN(nbytes, DATAFLASH_COMPRESS_BLOCK_SIZE));
+        _comp_frame_len = _compressor->compress_block(_comp_raw, nbytes, AP_HAL::micros64(), _comp_frame);
+        _comp_frame_ofs = 0;
+        _last_write_time = tnow;
+        hal.util->perf_end(_perf_compress);
+    }
+
+    hal.util->perf_begin(_perf_write);
+    const uint8_t *data = &_comp_frame[_comp_frame_ofs];
+    const uint32_t len = _comp_frame_len - _comp_frame_ofs;
+#if DATAFLASH_FILE_ASYNC
+    if (_async.active()) {
+        _comp_frame_ofs += _write_async(data, len, tnow);
+        hal.util->perf_end(_perf_write);
+        return;
+    }
+#endif
+    _comp_frame_ofs += _write_sync(data, len);
+    hal.util->perf_end(_perf_write);
+}
+
+#if DATAFLASH_FILE_ASYNC
+/*
+  hand data to the async writer, returning the number of bytes
+  accepted. It only blocks on memcpy, so there is no need to limit
+  each call to a chunk
+ */
+uint32_t DataFlash_File::_write_async(const uint8_t *data, uint32_t len, uint32_t tnow)
+{
+    const uint32_t accepted = _async.write(data, len);
+    _write_offset += accepted;
+
+    // keep the file reasonably up to date in case of power loss
+    if (tnow - _last_async_flush > 2000000UL) {
+        _last_async_flush = tnow;
+        _async.flush_partial();
+    }
+
+    if (_async.failed()) {
         hal.util->perf_count(_perf_errors);
-        close(_write_fd);
-        _write_fd = -1;
+        hal.console->printf("DataFlash_File: async write failed\n");
+        stop_logging();
         _initialised = false;
-    } else {
-        _write_offset += nwritten;
-        _writebuf.advance(nwritten);
-        /*
-          the best strategy for minimizing corruption on microSD cards
-          seems to be to write in 4k chunks and fsync the file on each
-          chunk, ensuring the directory entry is updated after each
-          write.
-         */
-#if CONFIG_HAL_BOARD != HAL_BOARD_SITL && CONFIG_HAL_BOARD_SUBTYPE != HAL_BOARD_SUBTYPE_LINUX_NONE && CONFIG_HAL_BOARD != HAL_BOARD_QURT
-        ::fsync(_write_fd);
-#endif
+    }
+    return accepted;
+}
+
+void DataFlash_File::_io_timer_async(uint32_t tnow)
+{
+    hal.util->perf_begin(_perf_write);
+
+    _last_write_time = tnow;
+    // the ring buffer may wrap, so this can take two goes
+    for (uint8_t i=0; i<2 && _async.active(); i++) {
+        uint32_t size;
+        const uint8_t *head = _writebuf.readptr(size);
+        if (size == 0) {
+            break;
+        }
+        const uint32_t accepted = _write_async(head, size, tnow);
+        _writebuf.advance(accepted);
+        if (accepted < size) {
+            break;
+        }
     }
     hal.util->perf_end(_perf_write);
 }
+#endif
+
+/*
+  log the sustained write rate, dropped message count and buffer
+  state, to help choose LOG_FILE_BUFSIZE and check the card keeps up
+ */
+void DataFlash_File::Log_Write_DF_File_Stats(uint32_t now)
+{
+    uint64_t bytes_written = _bytes_written;
+    uint8_t in_flight = 0;
+    uint32_t max_latency_us = 0;
+#if DATAFLASH_FILE_ASYNC
+    if (_async.active()) {
+        DataFlash_File_Async::stats stats;
+        _async.get_stats(stats);
+        bytes_written += stats.bytes_written;
+        in_flight = stats.in_flight;
+        max_latency_us = stats.max_latency_us;
+    }
+#endif
+    if (_write_fd == -1 || !log_write_started) {
+        _stats_last_ms = 0;
+        return;
+    }
+    if (_stats_last_ms == 0 || bytes_written < _stats_last_bytes) {
+        // first call for this log
+        _stats_last_ms = now;
+        _stats_last_bytes = bytes_written;
+        return;
+    }
+    const float dt = (now - _stats_last_ms) * 0.001f;
+    struct log_DF_File_Stats pkt = {
+        LOG_PACKET_HEADER_INIT(LOG_DF_FILE_STATS),
+        timestamp : now,
+        dropped   : _dropped,
+        rate_kbs  : dt > 0 ? (bytes_written - _stats_last_bytes) / (1024.0f * dt) : 0,
+        in_flight : in_flight,
+        max_latency_us : max_latency_us,
+        buf_space : _writebuf.space()
+    };
+    _stats_last_ms = now;
+    _stats_last_bytes = bytes_written;
+    WriteBlock(&pkt, sizeof(pkt));
+}
+
+#if CONFIG_HAL_BOARD == HAL_BOARD_LINUX
+/*
+  log the bytes the storage file has been written for the bytes of
+  parameters and missions changed, to show what each change costs the
+  card
+ */
+void DataFlash_File::Log_Write_Storage_Stats(void)
+{
+    if (_write_fd == -1 || !log_write_started) {
+        return;
+    }
+    const Linux::Storage *storage = Linux::Storage::from(hal.storage);
+    struct log_Storage pkt = {
+        LOG_PACKET_HEADER_INIT(LOG_STORAGE_MSG),
+        time_us       : AP_HAL::micros64(),
+        bytes_changed : storage->bytes_changed(),
+        bytes_written : storage->bytes_written(),
+        amplification : storage->write_amplification()
+    };
+    WriteBlock(&pkt, sizeof(pkt));
+}
+#endif
 
 // this sensor is enabled if we should be logging at the moment
 bool DataFlash_File::logging_enabled() const
@@ -8,8 +8,12 @@
 
 #if HAL_OS_POSIX_IO
 
-#include <AP_HAL/utility/RingBuffer.h>
+#include <atomic>
+
+#include <AP_HAL/utility/SPSCBuffer.h>
 #include "DataFlash_Backend.h"
+#include "DataFlash_File_Async.h"
+#include "DataFlash_Compress.h"
 
 #if CONFIG_HAL_BOARD == HAL_BOARD_QURT
 /*
@@ -44,6 +48,8 @@ public:
 
     /* Write a block of data at current offset */
     bool WritePrioritisedBlock(const void *pBuffer, uint16_t size, bool is_critical);
+    void *WriteReserve(uint16_t size, bool is_critical) override;
+    bool WriteCommit(uint16_t size) override;
     uint32_t bufferspace_available();
 
     // high level interface
@@ -64,6 +70,7 @@ public:
 #if CONFIG_HAL_BOARD == HAL_BOARD_SITL || CONFIG_HAL_BOARD == HAL_BOARD_LINUX
     void flush(void);
 #endif
+    void periodic_1Hz(const uint32_t now) override;
     void periodic_fullrate(const uint32_t now);
 
     // this method is used when reporting system status over mavlink
@@ -71,7 +78,9 @@ public:
     bool logging_failed() const;
 
 private:
-    int _write_fd;
+    // set last in start_new_log(), so the IO thread sees the log fully
+    // set up once it sees the fd
+    std::atomic<int> _write_fd;
     int _read_fd;
     uint16_t _read_fd_log_num;
     uint32_t _read_offset;
@@ -106,10 +115,15 @@ private:
     const float min_avail_space_percent = 10.0f;
 #endif
     // write buffer
-    ByteBuffer _writebuf;
+    SPSCByteBuffer _writebuf;
     const uint16_t _writebuf_chunk;
     uint32_t _last_write_time;
 
+    // true if the current WriteReserve() space is in _writebuf
+    bool _reserve_in_place;
+
+    bool _write_begin(uint16_t size, bool is_critical);
+
     /* construct a file name given a log number. Caller must free. */
     char *_log_file_name(const uint16_t log_num) const;
     char *_lastlog_file_name() const;
@@ -119,6 +133,36 @@ private:
     void stop_logging(void);
 
     void _io_timer(void);
+    bool _check_free_space(uint32_t tnow);
+    uint32_t _write_sync(const uint8_t *data, uint32_t len);
+
+#if DATAFLASH_FILE_ASYNC
+    // batched aligned writes with several buffers in flight
+    DataFlash_File_Async _async;
+    bool _async_available;
+    uint32_t _last_async_flush;
+    void _io_timer_async(uint32_t tnow);
+    uint32_t _write_async(const uint8_t *data, uint32_t len, uint32_t tnow);
+#endif
+
+    // write rate and drop statistics for the DFS message
+    uint32_t _stats_last_ms;
+    uint64_t _stats_last_bytes;
+    uint64_t _bytes_written;
+    void Log_Write_DF_File_Stats(uint32_t now);
+#if CONFIG_HAL_BOARD == HAL_BOARD_LINUX
+    void Log_Write_Storage_Stats(void);
+#endif
+
+    // block compression, allocated when first used
+    DataFlash_Compressor *_compressor;
+    uint8_t *_comp_raw;
+    uint8_t *_comp_frame;
+    uint32_t _comp_frame_len;   // compressed block waiting to be written
+    uint32_t _comp_frame_ofs;   // how much of it has been written
+    bool _compressing;
+    bool _compress_init(void);
+    void _io_timer_compressed(void);
 
     uint32_t critical_message_reserved_space() const {
         // possibly make this a proportional to buffer size?
@@ -155,6 +199,7 @@ private:
     AP_HAL::Util::perf_counter_t  _perf_fsync;
     AP_HAL::Util::perf_counter_t  _perf_errors;
     AP_HAL::Util::perf_counter_t  _perf_overruns;
+    AP_HAL::Util::perf_counter_t  _perf_compress;
 };
 
 #endif // HAL_OS_POSIX_IO
@@ -0,0 +1,271 @@
+/*
+   DataFlash logging - asynchronous file writer for Linux
+
+   Data is gathered into DATAFLASH_ASYNC_BUFFER_SIZE buffers which are
+   written with io_submit() as they fill. Buffers are written at
+   aligned offsets so the file can be opened O_DIRECT, keeping log data
+   out of the page cache and letting the card see large sequential
+   writes. A write only ever covers whole blocks; a partial block at the
+   end of a buffer is carried over to the next one.
+ */
+
+#include "DataFlash_File_Async.h"
+
+#if DATAFLASH_FILE_ASYNC
+
+#include <AP_Math/AP_Math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+extern const AP_HAL::HAL& hal;
+
+/*
+  glibc has no wrappers for the kernel AIO calls
+ */
+static int io_setup(unsigned nr_events, aio_context_t *ctx)
+{
+    return syscall(__NR_io_setup, nr_events, ctx);
+}
+
+static int io_submit(aio_context_t ctx, long nr, struct iocb **iocbpp)
+{
+    return syscall(__NR_io_submit, ctx, nr, iocbpp);
+}
+
+static int io_getevents(aio_context_t ctx, long min_nr, long max_nr,
+                        struct io_event *events, struct timespec *timeout)
+{
+    return syscall(__NR_io_getevents, ctx, min_nr, max_nr, events, timeout);
+}
+
+bool DataFlash_File_Async::init(void)
+{
+    _sem = hal.util->new_semaphore();
+    if (_sem == nullptr) {
+        return false;
+    }
+    for (uint8_t i=0; i<DATAFLASH_ASYNC_NUM_BUFFERS; i++) {
+        void *p = nullptr;
+        if (posix_memalign(&p, DATAFLASH_ASYNC_ALIGN, DATAFLASH_ASYNC_BUFFER_SIZE) != 0) {
+            return false;
+        }
+        _buffers[i].data = (uint8_t *)p;
+    }
+    if (io_setup(DATAFLASH_ASYNC_NUM_BUFFERS, &_ctx) != 0) {
+        hal.console->printf("DataFlash_File: no AIO support (%s)\n", strerror(errno));
+        _ctx = 0;
+        return false;
+    }
+    return true;
+}
+
+bool DataFlash_File_Async::start(int fd)
+{
+    if (_ctx == 0 || !_sem->take(HAL_SEMAPHORE_BLOCK_FOREVER)) {
+        return false;
+    }
+    // not all filesystems support O_DIRECT. Kernel AIO still works
+    // without it, but may block in io_submit()
+    const int flags = fcntl(fd, F_GETFL);
+    if (flags == -1 || fcntl(fd, F_SETFL, flags | O_DIRECT) == -1) {
+        hal.console->printf("DataFlash_File: O_DIRECT not available\n");
+    }
+    for (uint8_t i=0; i<DATAFLASH_ASYNC_NUM_BUFFERS; i++) {
+        _buffers[i].len = 0;
+        _buffers[i].in_flight = false;
+    }
+    _fill = 0;
+    _fill_offset = 0;
+    _in_flight = 0;
+    _failed = false;
+    memset(&_stats, 0, sizeof(_stats));
+    _fd = fd;
+    _sem->give();
+    return true;
+}
+
+/*
+  collect completed writes. With min_events of zero this never
+  blocks. Returns false if the AIO context itself has failed
+ */
+bool DataFlash_File_Async::reap(uint8_t min_events)
+{
+    struct io_event events[DATAFLASH_ASYNC_NUM_BUFFERS];
+    struct timespec zero {};
+    const int n = io_getevents(_ctx, min_events, DATAFLASH_ASYNC_NUM_BUFFERS,
+                               events, min_events ? nullptr : &zero);
+    if (n < 0) {
+        if (errno == EINTR) {
+            return true;
+        }
+        _failed = true;
+        return false;
+    }
+    const uint32_t now = AP_HAL::micros();
+    for (int i=0; i<n; i++) {
+        struct buffer &b = _buffers[events[i].data];
+        if (events[i].res != (int64_t)b.cb.aio_nbytes) {
+            // error or short write, most likely out of space
+            _failed = true;
+        } else {
+            _stats.bytes_written += events[i].res;
+        }
+        _stats.max_latency_us = MAX(_stats.max_latency_us, now - b.submit_us);
+        b.in_flight = false;
+        _in_flight--;
+    }
+    return true;
+}
+
+/*
+  write the first len bytes of the fill buffer, a multiple of the
+  block size, and move anything after them into the next buffer. The
+  caller must check the next buffer is free
+ */
+bool DataFlash_File_Async::submit(uint32_t len)
+{
+    struct buffer &b = _buffers[_fill];
+    memset(&b.cb, 0, sizeof(b.cb));
+    b.cb.aio_data = _fill;
+    b.cb.aio_lio_opcode = IOCB_CMD_PWRITE;
+    b.cb.aio_fildes = _fd;
+    b.cb.aio_buf = (uint64_t)(uintptr_t)b.data;
+    b.cb.aio_nbytes = len;
+    b.cb.aio_offset = _fill_offset;
+
+    struct iocb *cbs[1] = { &b.cb };
+    if (io_submit(_ctx, 1, cbs) != 1) {
+        _failed = true;
+        return false;
+    }
+    b.submit_us = AP_HAL::micros();
+    b.in_flight = true;
+    _in_flight++;
+
+    const uint8_t next = (_fill + 1) % DATAFLASH_ASYNC_NUM_BUFFERS;
+    struct buffer &nb = _buffers[next];
+    nb.len = b.len - len;
+    memcpy(nb.data, &b.data[len], nb.len);
+    _fill_offset += len;
+    _fill = next;
+    return true;
+}
+
+uint32_t DataFlash_File_Async::write(const uint8_t *data, uint32_t len)
+{
+    if (!_sem->take_nonblocking()) {
+        return 0;
+    }
+    uint32_t accepted = 0;
+    if (_fd != -1) {
+        if (_in_flight != 0) {
+            reap(0);
+        }
+        while (accepted < len && !_failed) {
+            struct buffer &b = _buffers[_fill];
+            const uint32_t n = MIN(len - accepted, DATAFLASH_ASYNC_BUFFER_SIZE - b.len);
+            memcpy(&b.data[b.len], &data[accepted], n);
+            b.len += n;
+            accepted += n;
+            if (b.len < DATAFLASH_ASYNC_BUFFER_SIZE) {
+                break;
+            }
+            if (_buffers[(_fill + 1) % DATAFLASH_ASYNC_NUM_BUFFERS].in_flight ||
+                !submit(DATAFLASH_ASYNC_BUFFER_SIZE)) {
+                // all buffers busy, leave the rest with the caller
+                break;
+            }
+        }
+    }
+    _sem->give();
+    return accepted;
+}
+
+void DataFlash_File_Async::flush_partial(void)
+{
+    if (!_sem->take_nonblocking()) {
+        return;
+    }
+    if (_fd != -1 && !_failed) {
+        const uint32_t len = _buffers[_fill].len & ~(DATAFLASH_ASYNC_ALIGN-1);
+        if (len != 0 && !_buffers[(_fill + 1) % DATAFLASH_ASYNC_NUM_BUFFERS].in_flight) {
+            submit(len);
+        }
+    }
+    _sem->give();
+}
+
+void DataFlash_File_Async::poll(void)
+{
+    if (!_sem->take_nonblocking()) {
+        return;
+    }
+    if (_fd != -1 && _in_flight != 0) {
+        reap(0);
+    }
+    _sem->give();
+}
+
+void DataFlash_File_Async::stop(void)
+{
+    if (!_sem->take(HAL_SEMAPHORE_BLOCK_FOREVER)) {
+        return;
+    }
+    if (_fd == -1) {
+        _sem->give();
+        return;
+    }
+    // buffers must not be reused while the kernel may still read them
+    while (_in_flight != 0 && reap(_in_flight)) {
+    }
+
+    // O_DIRECT writes must be whole blocks, so pad the tail and then
+    // cut the file back to the real length
+    struct buffer &b = _buffers[_fill];
+    const uint64_t end = _fill_offset + b.len;
+    if (b.len != 0 && !_failed) {
+        const uint32_t padded = (b.len + DATAFLASH_ASYNC_ALIGN - 1) & ~(DATAFLASH_ASYNC_ALIGN-1);
+        memset(&b.data[b.len], 0, padded - b.len);
+        if (pwrite(_fd, b.data, padded, _fill_offset) == (ssize_t)padded) {
+            _stats.bytes_written += b.len;
+        } else {
+            _failed = true;
+        }
+        if (ftruncate(_fd, end) != 0) {
+            _failed = true;
+        }
+    }
+    b.len = 0;
+
+    // neither the AIO writes nor pwrite() move the file offset, so move
+    // it to the end of the data for the write() calls that follow
+    if (lseek(_fd, end, SEEK_SET) == -1) {
+        _failed = true;
+    }
+
+    const int flags = fcntl(_fd, F_GETFL);
+    if (flags != -1) {
+        fcntl(_fd, F_SETFL, flags & ~O_DIRECT);
+    }
+    ::fsync(_fd);
+    _fd = -1;
+    _sem->give();
+}
+
+void DataFlash_File_Async::get_stats(struct stats &s)
+{
+    if (!_sem->take(HAL_SEMAPHORE_BLOCK_FOREVER)) {
+        return;
+    }
+    s = _stats;
+    s.in_flight = _in_flight;
+    _stats.max_latency_us = 0;
+    _sem->give();
+}
+
+#endif // DATAFLASH_FILE_ASYNC
@@ -0,0 +1,97 @@
+/*
+   DataFlash logging - asynchronous file writer for Linux
+
+   Writes log data to an already open file using kernel AIO on
+   O_DIRECT, with several aligned buffers in flight at once. The IO
+   thread only ever copies into a buffer and submits it, so a slow SD
+   card no longer stalls it for the duration of each write() and
+   fsync().
+ */
+#pragma once
+
+#include <AP_HAL/AP_HAL.h>
+
+#if CONFIG_HAL_BOARD == HAL_BOARD_LINUX
+#define DATAFLASH_FILE_ASYNC 1
+#else
+#define DATAFLASH_FILE_ASYNC 0
+#endif
+
+#if DATAFLASH_FILE_ASYNC
+
+#include <linux/aio_abi.h>
+
+#define DATAFLASH_ASYNC_NUM_BUFFERS 4
+#define DATAFLASH_ASYNC_BUFFER_SIZE (64*1024UL)
+// O_DIRECT needs buffers, offsets and lengths aligned to the
+// filesystem block size. 4k covers everything we are likely to see
+#define DATAFLASH_ASYNC_ALIGN 4096UL
+
+class DataFlash_File_Async
+{
+public:
+    DataFlash_File_Async() {}
+
+    // allocate buffers and the AIO context, false if not supported
+    bool init(void);
+
+    // start writing at offset zero of a newly opened file
+    bool start(int fd);
+
+    // wait for outstanding writes, write out the remaining data and
+    // trim the block padding from the end of the file. The file is
+    // not closed, and is left positioned at the end of the data
+    void stop(void);
+
+    bool active(void) const { return _fd != -1; }
+
+    // true if a write has failed since start()
+    bool failed(void) const { return _failed; }
+
+    /*
+      copy up to len bytes towards the file, submitting buffers as they
+      fill. Returns the number of bytes accepted, which is less than len
+      when all buffers are in flight
+     */
+    uint32_t write(const uint8_t *data, uint32_t len);
+
+    // submit all whole blocks held in the current buffer
+    void flush_partial(void);
+
+    // reap completed writes without blocking
+    void poll(void);
+
+    struct stats {
+        uint64_t bytes_written;    // completed writes since start()
+        uint32_t max_latency_us;   // longest submit to completion time
+        uint8_t in_flight;         // buffers currently being written
+    };
+    // return statistics and reset the latency maximum
+    void get_stats(struct stats &s);
+
+private:
+    struct buffer {
+        uint8_t *data;
+        uint32_t len;
+        uint32_t submit_us;
+        bool in_flight;
+        struct iocb cb;
+    } _buffers[DATAFLASH_ASYNC_NUM_BUFFERS] {};
+
+    aio_context_t _ctx = 0;
+    AP_HAL::Semaphore *_sem = nullptr;
+    int _fd = -1;
+    bool _failed = false;
+
+    // buffer being filled, and the file offset it will be written to
+    uint8_t _fill = 0;
+    uint64_t _fill_offset = 0;
+
+    uint8_t _in_flight = 0;
+    struct stats _stats {};
+
+    bool submit(uint32_t len);
+    bool reap(uint8_t min_events);
+};
+
+#endif // DATAFLASH_FILE_ASYNC
@@ -10,6 +10,7 @@
 #include <AP_Motors/AP_Motors.h>
 #include <AC_AttitudeControl/AC_AttitudeControl.h>
 #include <AC_AttitudeControl/AC_PosControl.h>
+#include <AP_Scheduler/AP_Scheduler.h>
 
 #include "DataFlash.h"
 #include "DataFlash_SITL.h"
@@ -29,6 +30,10 @@ void DataFlash_Class::Init(const struct LogStructure *structures, uint8_t num_ty
     _num_types = num_types;
     _structures = structures;
 
+    if (_reserve_sem == nullptr) {
+        _reserve_sem = hal.util->new_semaphore();
+    }
+
     ;
 #if defined(HAL_BOARD_LOG_DIRECTORY)
     if (_params.backend_types == DATAFLASH_BACKEND_FILE ||
@@ -356,6 +361,17 @@ void DataFlash_Backend::_print_log_entry(uint8_t msg_type,
     for (uint8_t ofs=0, fmt_ofs=0; ofs<msg_len; fmt_ofs++) {
         char fmt = log_structure->format[fmt_ofs];
         switch (fmt) {
+        case 'a': {
+            port->printf("[");
+            for (uint8_t j=0; j<32; j++) {
+                int16_t v;
+                memcpy(&v, &pkt[ofs], sizeof(v));
+                port->printf(j==0?"%d":" %d", (int)v);
+                ofs += sizeof(v);
+            }
+            port->printf("]");
+            break;
+        }
         case 'b': {
             port->printf("%d", (int)pkt[ofs]);
             ofs += 1;
@@ -869,154 +885,97 @@ void DataFlash_Class::Log_Write_Baro(AP_Baro &baro, uint64_t time_us)
     }
 }
 
-// Write an raw accel/gyro data packet
+/*
+  write one raw accel/gyro IMU packet. This is logged at the main loop rate for each
+  IMU, so is built directly in the log buffer rather than copied in
+ */
+void DataFlash_Class::Log_Write_IMU_instance(const AP_InertialSensor &ins, uint64_t time_us, uint8_t imu_instance, uint8_t type)
+{
+    struct log_IMU *pkt = (struct log_IMU *)WriteReserve(sizeof(*pkt));
+    if (pkt == nullptr) {
+        return;
+    }
+    const Vector3f &gyro = ins.get_gyro(imu_instance);
+    const Vector3f &accel = ins.get_accel(imu_instance);
+    pkt->head1 = HEAD_BYTE1;
+    pkt->head2 = HEAD_BYTE2;
+    pkt->msgid = type;
+    pkt->time_us = time_us;
+    pkt->gyro_x = gyro.x;
+    pkt->gyro_y = gyro.y;
+    pkt->gyro_z = gyro.z;
+    pkt->accel_x = accel.x;
+    pkt->accel_y = accel.y;
+    pkt->accel_z = accel.z;
+    pkt->gyro_error = ins.get_gyro_error_count(imu_instance);
+    pkt->accel_error = ins.get_accel_error_count(imu_instance);
+    pkt->temperature = ins.get_temperature(imu_instance);
+    pkt->gyro_health = (uint8_t)ins.get_gyro_health(imu_instance);
+    pkt->accel_health = (uint8_t)ins.get_accel_health(imu_instance);
+    WriteCommit(sizeof(*pkt));
+}
+
 void DataFlash_Class::Log_Write_IMU(const AP_InertialSensor &ins)
 {
     uint64_t time_us = AP_HAL::micros64();
-    const Vector3f &gyro = ins.get_gyro(0);
-    const Vector3f &accel = ins.get_accel(0);
-    struct log_IMU pkt = {
-        LOG_PACKET_HEADER_INIT(LOG_IMU_MSG),
-        time_us : time_us,
-        gyro_x  : gyro.x,
-        gyro_y  : gyro.y,
-        gyro_z  : gyro.z,
-        accel_x : accel.x,
-        accel_y : accel.y,
-        accel_z : accel.z,
-        gyro_error  : ins.get_gyro_error_count(0),
-        accel_error : ins.get_accel_error_count(0),
-        temperature : ins.get_temperature(0),
-        gyro_health : (uint8_t)ins.get_gyro_health(0),
-        accel_health : (uint8_t)ins.get_accel_health(0)
-    };
-    WriteBlock(&pkt, sizeof(pkt));
+    Log_Write_IMU_instance(ins, time_us, 0, LOG_IMU_MSG);
     if (ins.get_gyro_count() < 2 && ins.get_accel_count() < 2) {
         return;
     }
-
-    const Vector3f &gyro2 = ins.get_gyro(1);
-    const Vector3f &accel2 = ins.get_accel(1);
-    struct log_IMU pkt2 = {
-        LOG_PACKET_HEADER_INIT(LOG_IMU2_MSG),
-        time_us : time_us,
-        gyro_x  : gyro2.x,
-        gyro_y  : gyro2.y,
-        gyro_z  : gyro2.z,
-        accel_x : accel2.x,
-        accel_y : accel2.y,
-        accel_z : accel2.z,
-        gyro_error  : ins.get_gyro_error_count(1),
-        accel_error : ins.get_accel_error_count(1),
-        temperature : ins.get_temperature(1),
-        gyro_health : (uint8_t)ins.get_gyro_health(1),
-        accel_health : (uint8_t)ins.get_accel_health(1)
-    };
-    WriteBlock(&pkt2, sizeof(pkt2));
+    Log_Write_IMU_instance(ins, time_us, 1, LOG_IMU2_MSG);
     if (ins.get_gyro_count() < 3 && ins.get_accel_count() < 3) {
         return;
     }
-    const Vector3f &gyro3 = ins.get_gyro(2);
-    const Vector3f &accel3 = ins.get_accel(2);
-    struct log_IMU pkt3 = {
-        LOG_PACKET_HEADER_INIT(LOG_IMU3_MSG),
-        time_us : time_us,
-        gyro_x  : gyro3.x,
-        gyro_y  : gyro3.y,
-        gyro_z  : gyro3.z,
-        accel_x : accel3.x,
-        accel_y : accel3.y,
-        accel_z : accel3.z,
-        gyro_error  : ins.get_gyro_error_count(2),
-        accel_error : ins.get_accel_error_count(2),
-        temperature : ins.get_temperature(2),
-        gyro_health : (uint8_t)ins.get_gyro_health(2),
-        accel_health : (uint8_t)ins.get_accel_health(2)
-    };
-    WriteBlock(&pkt3, sizeof(pkt3));
+    Log_Write_IMU_instance(ins, time_us, 2, LOG_IMU3_MSG);
 }
 
-// Write an accel/gyro delta time data packet
-void DataFlash_Class::Log_Write_IMUDT(const AP_InertialSensor &ins, uint64_t time_us, uint8_t imu_mask)
+// Write one accel/gyro delta time data packet, built in the log buffer
+void DataFlash_Class::Log_Write_IMUDT_instance(const AP_InertialSensor &ins, uint64_t time_us, uint8_t imu_instance, uint8_t type)
 {
-    float delta_t = ins.get_delta_time();
-    float delta_vel_t = ins.get_delta_velocity_dt(0);
-    float delta_ang_t = ins.get_delta_angle_dt(0);
+    struct log_IMUDT *pkt = (struct log_IMUDT *)WriteReserve(sizeof(*pkt));
+    if (pkt == nullptr) {
+        return;
+    }
     Vector3f delta_angle, delta_velocity;
-    ins.get_delta_angle(0, delta_angle);
-    ins.get_delta_velocity(0, delta_velocity);
+    if (!ins.get_delta_angle(imu_instance, delta_angle)) {
+        delta_angle.zero();
+    }
+    if (!ins.get_delta_velocity(imu_instance, delta_velocity)) {
+        delta_velocity.zero();
+    }
+    pkt->head1 = HEAD_BYTE1;
+    pkt->head2 = HEAD_BYTE2;
+    pkt->msgid = type;
+    pkt->time_us = time_us;
+    pkt->delta_time = ins.get_delta_time();
+    pkt->delta_vel_dt = ins.get_delta_velocity_dt(imu_instance);
+    pkt->delta_ang_dt = ins.get_delta_angle_dt(imu_instance);
+    pkt->delta_ang_x = delta_angle.x;
+    pkt->delta_ang_y = delta_angle.y;
+    pkt->delta_ang_z = delta_angle.z;
+    pkt->delta_vel_x = delta_velocity.x;
+    pkt->delta_vel_y = delta_velocity.y;
+    pkt->delta_vel_z = delta_velocity.z;
+    WriteCommit(sizeof(*pkt));
+}
 
-    struct log_IMUDT pkt = {
-        LOG_PACKET_HEADER_INIT(LOG_IMUDT_MSG),
-        time_us : time_us,
-        delta_time   : delta_t,
-        delta_vel_dt : delta_vel_t,
-        delta_ang_dt : delta_ang_t,
-        delta_ang_x  : delta_angle.x,
-        delta_ang_y  : delta_angle.y,
-        delta_ang_z  : delta_angle.z,
-        delta_vel_x  : delta_velocity.x,
-        delta_vel_y  : delta_velocity.y,
-        delta_vel_z  : delta_velocity.z
-    };
+// Write an accel/gyro delta time data packet
+void DataFlash_Class::Log_Write_IMUDT(const AP_InertialSensor &ins, uint64_t time_us, uint8_t imu_mask)
+{
     if (imu_mask & 1) {
-        WriteBlock(&pkt, sizeof(pkt));
+        Log_Write_IMUDT_instance(ins, time_us, 0, LOG_IMUDT_MSG);
     }
     if ((ins.get_gyro_count() < 2 && ins.get_accel_count() < 2) || !ins.use_gyro(1)) {
         return;
     }
-
-    delta_vel_t = ins.get_delta_velocity_dt(1);
-    delta_ang_t = ins.get_delta_angle_dt(1);
-    if (!ins.get_delta_angle(1, delta_angle)) {
-        delta_angle.zero();
-    }
-    if (!ins.get_delta_velocity(1, delta_velocity)) {
-        delta_velocity.zero();
-    }
-    struct log_IMUDT pkt2 = {
-        LOG_PACKET_HEADER_INIT(LOG_IMUDT2_MSG),
-        time_us     : time_us,
-        delta_time   : delta_t,
-        delta_vel_dt : delta_vel_t,
-        delta_ang_dt : delta_ang_t,
-        delta_ang_x  : delta_angle.x,
-        delta_ang_y  : delta_angle.y,
-        delta_ang_z  : delta_angle.z,
-        delta_vel_x  : delta_velocity.x,
-        delta_vel_y  : delta_velocity.y,
-        delta_vel_z  : delta_velocity.z
-    };
     if (imu_mask & 2) {
-        WriteBlock(&pkt2, sizeof(pkt2));
+        Log_Write_IMUDT_instance(ins, time_us, 1, LOG_IMUDT2_MSG);
     }
-
     if ((ins.get_gyro_count() < 3 && ins.get_accel_count() < 3) || !ins.use_gyro(2)) {
         return;
     }
-    delta_vel_t = ins.get_delta_velocity_dt(1);
-    delta_ang_t = ins.get_delta_angle_dt(2);
-    if (!ins.get_delta_angle(2, delta_angle)) {
-        delta_angle.zero();
-    }
-    if (!ins.get_delta_velocity(2, delta_velocity)) {
-        delta_velocity.zero();
-    }
-    struct log_IMUDT pkt3 = {
-        LOG_PACKET_HEADER_INIT(LOG_IMUDT3_MSG),
-        time_us     : time_us,
-        delta_time   : delta_t,
-        delta_vel_dt : delta_vel_t,
-        delta_ang_dt : delta_ang_t,
-        delta_ang_x  : delta_angle.x,
-        delta_ang_y  : delta_angle.y,
-        delta_ang_z  : delta_angle.z,
-        delta_vel_x  : delta_velocity.x,
-        delta_vel_y  : delta_velocity.y,
-        delta_vel_z  : delta_velocity.z
-    };
     if (imu_mask & 4) {
-        WriteBlock(&pkt3, sizeof(pkt3));
+        Log_Write_IMUDT_instance(ins, time_us, 2, LOG_IMUDT3_MSG);
     }
 }
 
@@ -1903,3 +1862,29 @@ void DataFlash_Class::Log_Write_Rally(const AP_Rally &rally)
         }
     }
 }
+
+// Write the run time statistics of each scheduler task
+void DataFlash_Class::Log_Write_Scheduler_Stats(const AP_Scheduler &scheduler)
+{
+    const uint64_t time_us = AP_HAL::micros64();
+    for (uint8_t i=0; i<scheduler.num_tasks(); i++) {
+        const struct AP_Scheduler::task_stats *stats = scheduler.get_task_stats(i);
+        if (stats == nullptr || stats->count == 0) {
+            continue;
+        }
+        struct log_Scheduler_Task pkt = {
+            LOG_PACKET_HEADER_INIT(LOG_SCHED_TASK_MSG),
+            time_us  : time_us,
+            name     : {},
+            count    : stats->count,
+            min_us   : stats->min_us,
+            avg_us   : (uint16_t)(stats->total_us / stats->count),
+            max_us   : stats->max_us,
+            p99_us   : scheduler.task_p99_us(i),
+            overruns : stats->overruns,
+            slips    : stats->slips
+        };
+        strncpy(pkt.name, scheduler.task_name(i), sizeof(pkt.name));
+        WriteBlock(&pkt, sizeof(pkt));
+    }
+}
@@ -633,6 +633,99 @@ struct PACKED log_DF_MAV_Stats {
     // uint8_t state_retry_max;
 };
 
+struct PACKED log_DF_File_Stats {
+    LOG_PACKET_HEADER;
+    uint32_t timestamp;
+    uint32_t dropped;
+    float rate_kbs;
+    uint8_t in_flight;
+    uint32_t max_latency_us;
+    uint32_t buf_space;
+};
+
+struct PACKED log_Scheduler_Task {
+    LOG_PACKET_HEADER;
+    uint64_t time_us;
+    char name[16];
+    uint32_t count;
+    uint16_t min_us;
+    uint16_t avg_us;
+    uint16_t max_us;
+    uint16_t p99_us;
+    uint16_t overruns;
+    uint16_t slips;
+};
+
+struct PACKED log_MAVLink_Link {
+    LOG_PACKET_HEADER;
+    uint64_t time_us;
+    uint8_t chan;
+    uint32_t budget_bps;
+    uint32_t sent_bps;
+    uint16_t messages_sent;
+    uint16_t budget_waits;
+    uint16_t txspace_waits;
+    uint8_t pending;
+    uint8_t slowdown;
+};
+
+// traffic on one learned MAVLink route
+struct PACKED log_MAVLink_Route {
+    LOG_PACKET_HEADER;
+    uint64_t time_us;
+    uint8_t chan;
+    uint8_t sysid;
+    uint8_t compid;
+    uint8_t mavtype;
+    uint32_t packets_in;
+    uint32_t packets_out;
+};
+
+struct PACKED log_Storage {
+    LOG_PACKET_HEADER;
+    uint64_t time_us;
+    uint32_t bytes_changed;
+    uint32_t bytes_written;
+    float amplification;
+};
+
+struct PACKED log_FFT {
+    LOG_PACKET_HEADER;
+    uint64_t time_us;
+    uint8_t sensor;
+    uint8_t instance;
+    float freq_x;
+    float freq_y;
+    float freq_z;
+    float energy_x;
+    float energy_y;
+    float energy_z;
+};
+
+// header of a batch of raw IMU samples, written before its data
+struct PACKED log_ISBH {
+    LOG_PACKET_HEADER;
+    uint64_t time_us;
+    uint16_t seqno;
+    uint8_t sensor_type;
+    uint8_t instance;
+    float multiplier;
+    uint16_t sample_count;
+    uint64_t sample_us;
+    float sample_rate_hz;
+};
+
+// 32 raw samples of a batch, seqno matching the header
+struct PACKED log_ISBD {
+    LOG_PACKET_HEADER;
+    uint64_t time_us;
+    uint16_t isb_seqno;
+    uint16_t seqno;
+    int16_t x[32];
+    int16_t y[32];
+    int16_t z[32];
+};
+
 struct PACKED log_ORGN {
     LOG_PACKET_HEADER;
     uint64_t time_us;
@@ -717,6 +810,7 @@ struct PACKED log_Rally {
 
 /*
 Format characters in the format string for binary log messages
+  a   : int16_t[32]
   b   : int8_t
   B   : uint8_t
   h   : int16_t
@@ -916,7 +1010,23 @@ Format characters in the format string for binary log messages
     { LOG_RATE_MSG, sizeof(log_Rate), \
       "RATE", "Qffffffffffff",  "TimeUS,RDes,R,ROut,PDes,P,POut,YDes,Y,YOut,ADes,A,AOut" }, \
     { LOG_RALLY_MSG, sizeof(log_Rally), \
-      "RALY", "QBBLLh", "TimeUS,Tot,Seq,Lat,Lng,Alt" }
+      "RALY", "QBBLLh", "TimeUS,Tot,Seq,Lat,Lng,Alt" }, \
+    { LOG_DF_FILE_STATS, sizeof(log_DF_File_Stats), \
+      "DFS", "IIfBII", "TimeMS,Dp,KBs,InF,MxLat,BufFree" }, \
+    { LOG_SCHED_TASK_MSG, sizeof(log_Scheduler_Task), \
+      "SCHD", "QNIHHHHHH", "TimeUS,Name,N,Min,Avg,Max,P99,Ovr,Slip" }, \
+    { LOG_MAVLINK_LINK_MSG, sizeof(log_MAVLink_Link), \
+      "MAVL", "QBIIHHHBB", "TimeUS,Chan,BudBs,SentBs,NMsg,BudW,TxW,Pend,Slow" }, \
+    { LOG_FFT_MSG, sizeof(log_FFT), \
+      "FFT", "QBBffffff", "TimeUS,Sens,Inst,FrqX,FrqY,FrqZ,EnX,EnY,EnZ" }, \
+    { LOG_ISBH_MSG, sizeof(log_ISBH), \
+      "ISBH", "QHBBfHQf", "TimeUS,N,Type,Inst,Mul,SCnt,SampleUS,SRate" }, \
+    { LOG_ISBD_MSG, sizeof(log_ISBD), \
+      "ISBD", "QHHaaa", "TimeUS,N,Seq,x,y,z" }, \
+    { LOG_MAVLINK_ROUTE_MSG, sizeof(log_MAVLink_Route), \
+      "MAVR", "QBBBBII", "TimeUS,Chan,Sys,Comp,Type,PIn,POut" }, \
+    { LOG_STORAGE_MSG, sizeof(log_Storage), \
+      "STOR", "QIIf", "TimeUS,BChg,BWr,Amp" }
 
 // #if SBP_HW_LOGGING
 #define LOG_SBP_STRUCTURES \
@@ -1032,6 +1142,14 @@ enum LogMessages {
     LOG_GIMBAL3_MSG,
     LOG_RATE_MSG,
     LOG_RALLY_MSG,
+    LOG_DF_FILE_STATS,
+    LOG_SCHED_TASK_MSG,
+    LOG_MAVLINK_LINK_MSG,
+    LOG_FFT_MSG,
+    LOG_ISBH_MSG,
+    LOG_ISBD_MSG,
+    LOG_MAVLINK_ROUTE_MSG,
+    LOG_STORAGE_MSG,
 };
 
 enum LogOriginType {
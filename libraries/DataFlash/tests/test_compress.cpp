@@ -0,0 +1,115 @@
+/*
+  round trip tests for the block compressed log format
+ */
+#include <AP_gtest.h>
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_Math/pseudo_random.h>
+#include <DataFlash/DataFlash_Compress.h>
+#include <string.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+static DataFlash_Compressor compressor;
+static uint8_t raw[DATAFLASH_COMPRESS_BLOCK_SIZE];
+static uint8_t frame[DATAFLASH_COMPRESS_MAX_FRAME];
+static uint8_t out[DATAFLASH_COMPRESS_BLOCK_SIZE];
+
+// compress and expand raw[0..len), returning the block length
+static uint32_t round_trip(uint16_t len)
+{
+    const uint32_t frame_len = compressor.compress_block(raw, len, 1234, frame);
+
+    struct log_compressed_block_header hdr;
+    memcpy(&hdr, frame, sizeof(hdr));
+    EXPECT_EQ(DATAFLASH_COMPRESS_SYNC1, hdr.sync1);
+    EXPECT_EQ(DATAFLASH_COMPRESS_SYNC2, hdr.sync2);
+    EXPECT_EQ(len, hdr.raw_len);
+    EXPECT_EQ(1234U, hdr.time_us);
+
+    memset(out, 0, sizeof(out));
+    if (hdr.comp_len == 0) {
+        EXPECT_EQ(sizeof(hdr) + len, frame_len);
+        memcpy(out, &frame[sizeof(hdr)], len);
+    } else {
+        EXPECT_EQ(sizeof(hdr) + hdr.comp_len, frame_len);
+        EXPECT_EQ(len, DataFlash_Compressor::decompress(&frame[sizeof(hdr)], hdr.comp_len, out, sizeof(out)));
+    }
+    EXPECT_EQ(0, memcmp(raw, out, len));
+    return frame_len;
+}
+
+TEST(DataFlashCompress, Random)
+{
+    PseudoRandom prng(1);
+    for (uint16_t len=0; len<100; len++) {
+        for (uint16_t i=0; i<len; i++) {
+            raw[i] = prng.next_byte();
+        }
+        // incompressible data is stored as it is
+        EXPECT_LE(round_trip(len), sizeof(struct log_compressed_block_header) + len);
+    }
+}
+
+TEST(DataFlashCompress, LogLike)
+{
+    // a stream of fixed size messages with slowly changing contents
+    const uint8_t msg_len = 45;
+    PseudoRandom prng(1);
+    for (uint32_t ofs=0; ofs<sizeof(raw); ofs++) {
+        const uint32_t msg = ofs / msg_len;
+        const uint8_t field = ofs % msg_len;
+        const uint8_t noise = prng.next_byte();
+        switch (field) {
+        case 0:
+            raw[ofs] = 0xA3;
+            break;
+        case 1:
+            raw[ofs] = 0x95;
+            break;
+        case 3:
+            raw[ofs] = msg & 0xFF;
+            break;
+        case 20:
+        case 28:
+        case 36:
+            // noisy low bytes of sensor values
+            raw[ofs] = noise;
+            break;
+        default:
+            raw[ofs] = (field < 12) ? 0 : field + (msg >> 6);
+            break;
+        }
+    }
+    const uint16_t lengths[] = { 12, 13, 100, 1000, 4096 };
+    for (uint8_t i=0; i<ARRAY_SIZE(lengths); i++) {
+        round_trip(lengths[i]);
+    }
+    EXPECT_LT(round_trip(DATAFLASH_COMPRESS_BLOCK_SIZE), DATAFLASH_COMPRESS_BLOCK_SIZE / 2);
+}
+
+TEST(DataFlashCompress, Runs)
+{
+    memset(raw, 7, sizeof(raw));
+    EXPECT_LT(round_trip(DATAFLASH_COMPRESS_BLOCK_SIZE), 100U);
+}
+
+TEST(DataFlashCompress, Corrupt)
+{
+    memset(raw, 7, sizeof(raw));
+    compressor.compress_block(raw, sizeof(raw), 0, frame);
+    struct log_compressed_block_header hdr;
+    memcpy(&hdr, frame, sizeof(hdr));
+    ASSERT_NE(0, hdr.comp_len);
+
+    // output too small
+    EXPECT_EQ(-1, DataFlash_Compressor::decompress(&frame[sizeof(hdr)], hdr.comp_len, out, 100));
+    // truncated in the middle of a match offset
+    const uint8_t truncated[] = { 0x10, 'a', 0x01 };
+    EXPECT_EQ(-1, DataFlash_Compressor::decompress(truncated, sizeof(truncated), out, sizeof(out)));
+    // match offset before the start of the output
+    const uint8_t bad[] = { 0x10, 'a', 0x05, 0x00 };
+    EXPECT_EQ(-1, DataFlash_Compressor::decompress(bad, sizeof(bad), out, sizeof(out)));
+}
+
+AP_GTEST_MAIN()
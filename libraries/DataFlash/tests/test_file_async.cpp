@@ -0,0 +1,74 @@
+/*
+  tests for the asynchronous log writer
+ */
+#include <AP_gtest.h>
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_Math/AP_Math.h>
+#include <DataFlash/DataFlash_File_Async.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+#if DATAFLASH_FILE_ASYNC
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// spans several AIO buffers and ends part way through a block
+#define ASYNC_LEN (3 * DATAFLASH_ASYNC_BUFFER_SIZE + 1000)
+#define SYNC_LEN 5000
+
+static DataFlash_File_Async async;
+static uint8_t data[ASYNC_LEN + SYNC_LEN];
+static uint8_t readback[ASYNC_LEN + SYNC_LEN + 1];
+
+/*
+  log through the async writer, flush it and then keep logging with
+  write() as DataFlash_File does. The file must read back whole
+ */
+TEST(DataFlashFileAsync, WriteAfterStop)
+{
+    if (!async.init()) {
+        // no kernel AIO here, DataFlash_File would write synchronously
+        return;
+    }
+
+    for (uint32_t i = 0; i < sizeof(data); i++) {
+        data[i] = (i * 7) ^ (i >> 8);
+    }
+
+    char path[] = "/tmp/dataflash_async_XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_NE(-1, fd);
+    close(fd);
+    fd = open(path, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+    ASSERT_NE(-1, fd);
+
+    ASSERT_TRUE(async.start(fd));
+    uint32_t ofs = 0;
+    while (ofs < ASYNC_LEN) {
+        ofs += async.write(&data[ofs], MIN(ASYNC_LEN - ofs, 1000U));
+        async.poll();
+        ASSERT_FALSE(async.failed());
+    }
+    async.stop();
+    EXPECT_FALSE(async.failed());
+    EXPECT_FALSE(async.active());
+
+    EXPECT_EQ(SYNC_LEN, write(fd, &data[ASYNC_LEN], SYNC_LEN));
+    close(fd);
+
+    fd = open(path, O_RDONLY);
+    ASSERT_NE(-1, fd);
+    EXPECT_EQ((ssize_t)sizeof(data), read(fd, readback, sizeof(readback)));
+    close(fd);
+    unlink(path);
+
+    EXPECT_EQ(0, memcmp(data, readback, sizeof(data)));
+}
+
+#endif // DATAFLASH_FILE_ASYNC
+
+AP_GTEST_MAIN()
@@ -0,0 +1,123 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "BiquadFilterBank.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define BIQUAD_BANK_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define BIQUAD_BANK_NEON 1
+#endif
+
+/*
+  the multiplies and subtractions are kept separate, in the same order as
+  DigitalBiquadFilter::apply(), so the SIMD and scalar versions agree
+ */
+void BiquadFilterBankBase::apply_channel(const biquad_params &params, float *state,
+                                         const Vector3f *in, Vector3f *out, uint16_t count)
+{
+    if (is_zero(params.cutoff_freq) || is_zero(params.sample_freq)) {
+        if (out != in) {
+            memcpy(out, in, count * sizeof(Vector3f));
+        }
+        return;
+    }
+
+#if BIQUAD_BANK_SSE2
+    const __m128 a1 = _mm_set1_ps(params.a1);
+    const __m128 a2 = _mm_set1_ps(params.a2);
+    const __m128 b0 = _mm_set1_ps(params.b0);
+    const __m128 b1 = _mm_set1_ps(params.b1);
+    const __m128 b2 = _mm_set1_ps(params.b2);
+    __m128 d1 = _mm_loadu_ps(&state[0]);
+    __m128 d2 = _mm_loadu_ps(&state[4]);
+
+    for (uint16_t i = 0; i < count; i++) {
+        const __m128 s = _mm_setr_ps(in[i].x, in[i].y, in[i].z, 0.0f);
+        const __m128 d0 = _mm_sub_ps(_mm_sub_ps(s, _mm_mul_ps(d1, a1)), _mm_mul_ps(d2, a2));
+        const __m128 o = _mm_add_ps(_mm_add_ps(_mm_mul_ps(d0, b0), _mm_mul_ps(d1, b1)),
+                                    _mm_mul_ps(d2, b2));
+        d2 = d1;
+        d1 = d0;
+
+        float r[4];
+        _mm_storeu_ps(r, o);
+        out[i].x = r[0];
+        out[i].y = r[1];
+        out[i].z = r[2];
+    }
+
+    _mm_storeu_ps(&state[0], d1);
+    _mm_storeu_ps(&state[4], d2);
+#elif BIQUAD_BANK_NEON
+    const float32x4_t a1 = vdupq_n_f32(params.a1);
+    const float32x4_t a2 = vdupq_n_f32(params.a2);
+    const float32x4_t b0 = vdupq_n_f32(params.b0);
+    const float32x4_t b1 = vdupq_n_f32(params.b1);
+    const float32x4_t b2 = vdupq_n_f32(params.b2);
+    float32x4_t d1 = vld1q_f32(&state[0]);
+    float32x4_t d2 = vld1q_f32(&state[4]);
+
+    for (uint16_t i = 0; i < count; i++) {
+        const float v[4] = { in[i].x, in[i].y, in[i].z, 0.0f };
+        const float32x4_t s = vld1q_f32(v);
+        const float32x4_t d0 = vsubq_f32(vsubq_f32(s, vmulq_f32(d1, a1)), vmulq_f32(d2, a2));
+        const float32x4_t o = vaddq_f32(vaddq_f32(vmulq_f32(d0, b0), vmulq_f32(d1, b1)),
+                                        vmulq_f32(d2, b2));
+        d2 = d1;
+        d1 = d0;
+
+        float r[4];
+        vst1q_f32(r, o);
+        out[i].x = r[0];
+        out[i].y = r[1];
+        out[i].z = r[2];
+    }
+
+    vst1q_f32(&state[0], d1);
+    vst1q_f32(&state[4], d2);
+#else
+    apply_channel_scalar(params, state, in, out, count);
+#endif
+}
+
+void BiquadFilterBankBase::apply_channel_scalar(const biquad_params &params, float *state,
+                                                const Vector3f *in, Vector3f *out, uint16_t count)
+{
+    if (is_zero(params.cutoff_freq) || is_zero(params.sample_freq)) {
+        if (out != in) {
+            memcpy(out, in, count * sizeof(Vector3f));
+        }
+        return;
+    }
+
+    Vector3f d1(state[0], state[1], state[2]);
+    Vector3f d2(state[4], state[5], state[6]);
+
+    for (uint16_t i = 0; i < count; i++) {
+        const Vector3f d0 = in[i] - d1 * params.a1 - d2 * params.a2;
+        out[i] = d0 * params.b0 + d1 * params.b1 + d2 * params.b2;
+        d2 = d1;
+        d1 = d0;
+    }
+
+    state[0] = d1.x;
+    state[1] = d1.y;
+    state[2] = d1.z;
+    state[4] = d2.x;
+    state[5] = d2.y;
+    state[6] = d2.z;
+}
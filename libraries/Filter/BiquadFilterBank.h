@@ -0,0 +1,87 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <AP_Math/AP_Math.h>
+#include <inttypes.h>
+
+#include "LowPassFilter2p.h"
+
+/// @file   BiquadFilterBank.h
+/// @brief  A bank of biquad filters on Vector3f channels. The delay
+///         elements of all channels are kept together, four float lanes
+///         per channel (x, y, z and a pad), so that the three axes of a
+///         channel are filtered with one SIMD operation per step on CPUs
+///         with SSE2 or NEON. The results match DigitalBiquadFilter<Vector3f>.
+
+class BiquadFilterBankBase {
+public:
+    typedef DigitalBiquadFilter<float>::biquad_params biquad_params;
+
+    /*
+      run count samples through one channel. state points at the eight
+      floats of delay elements of the channel. out may be the same as in
+     */
+    static void apply_channel(const biquad_params &params, float *state,
+                              const Vector3f *in, Vector3f *out, uint16_t count);
+
+    // the same, one lane at a time, for comparison with the SIMD version
+    static void apply_channel_scalar(const biquad_params &params, float *state,
+                                     const Vector3f *in, Vector3f *out, uint16_t count);
+};
+
+template <uint8_t N>
+class BiquadFilterBank3f : public BiquadFilterBankBase {
+public:
+    BiquadFilterBank3f() {
+        memset(_params, 0, sizeof(_params));
+        memset(_state, 0, sizeof(_state));
+    }
+
+    // set a channel to a second order low pass
+    void set_cutoff_frequency(uint8_t channel, float sample_freq, float cutoff_freq) {
+        DigitalBiquadFilter<float>::compute_params(sample_freq, cutoff_freq, _params[channel]);
+    }
+
+    // set a channel to any biquad, e.g. a notch
+    void set_params(uint8_t channel, const biquad_params &params) {
+        _params[channel] = params;
+    }
+
+    const biquad_params &get_params(uint8_t channel) const { return _params[channel]; }
+    float get_cutoff_freq(uint8_t channel) const { return _params[channel].cutoff_freq; }
+    float get_sample_freq(uint8_t channel) const { return _params[channel].sample_freq; }
+
+    // filter one sample
+    Vector3f apply(uint8_t channel, const Vector3f &sample) {
+        Vector3f ret;
+        apply_channel(_params[channel], _state[channel], &sample, &ret, 1);
+        return ret;
+    }
+
+    // filter a burst of samples, such as a FIFO read, keeping the state in registers
+    void apply(uint8_t channel, const Vector3f *samples, Vector3f *out, uint16_t count) {
+        apply_channel(_params[channel], _state[channel], samples, out, count);
+    }
+
+    void reset(uint8_t channel) {
+        memset(_state[channel], 0, sizeof(_state[channel]));
+    }
+
+private:
+    biquad_params _params[N];
+    // delay element 1 in lanes 0-3, delay element 2 in lanes 4-7
+    float _state[N][8];
+};
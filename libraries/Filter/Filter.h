@@ -9,3 +9,5 @@
 #include "LowPassFilter.h"
 #include "ModeFilter.h"
 #include "Butter.h"
+#include "BiquadFilterBank.h"
+#include "NotchFilter.h"
@@ -95,6 +95,12 @@ void LowPassFilter2p<T>::reset(void) {
  * Make an instances
  * Otherwise we have to move the constructor implementations to the header file :P
  */
+template class DigitalBiquadFilter<int>;
+template class DigitalBiquadFilter<long>;
+template class DigitalBiquadFilter<float>;
+template class DigitalBiquadFilter<Vector2f>;
+template class DigitalBiquadFilter<Vector3f>;
+
 template class LowPassFilter2p<int>;
 template class LowPassFilter2p<long>;
 template class LowPassFilter2p<float>;
@@ -0,0 +1,134 @@
+#include "NotchFilter.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+// NotchFilter
+////////////////////////////////////////////////////////////////////////////////////////////
+
+template <class T>
+NotchFilter<T>::NotchFilter() {
+    memset(&_params, 0, sizeof(_params));
+}
+
+template <class T>
+void NotchFilter<T>::init(float sample_freq_hz, float center_freq_hz, float bandwidth_hz, float attenuation_dB) {
+    compute_params(sample_freq_hz, center_freq_hz, bandwidth_hz, attenuation_dB, _params);
+}
+
+template <class T>
+T NotchFilter<T>::apply(const T &sample) {
+    return _filter.apply(sample, _params);
+}
+
+template <class T>
+void NotchFilter<T>::reset(void) {
+    _filter.reset();
+}
+
+/*
+  the notch of the Audio EQ Cookbook (R. Bristow-Johnson), with the
+  depth of the notch set by the attenuation rather than being infinite
+ */
+template <class T>
+void NotchFilter<T>::compute_params(float sample_freq_hz, float center_freq_hz, float bandwidth_hz,
+                                    float attenuation_dB, typename DigitalBiquadFilter<T>::biquad_params &ret) {
+    memset(&ret, 0, sizeof(ret));
+
+    const float half_bandwidth_hz = bandwidth_hz * 0.5f;
+    if (sample_freq_hz <= 0 || half_bandwidth_hz <= 0 ||
+        center_freq_hz <= half_bandwidth_hz ||
+        center_freq_hz + half_bandwidth_hz >= sample_freq_hz * 0.5f) {
+        return;
+    }
+
+    const float octaves = log2f(center_freq_hz / (center_freq_hz - half_bandwidth_hz)) * 2.0f;
+    const float A = powf(10.0f, -attenuation_dB / 40.0f);
+    const float Q = sqrtf(powf(2.0f, octaves)) / (powf(2.0f, octaves) - 1.0f);
+    const float omega = 2.0f * M_PI * center_freq_hz / sample_freq_hz;
+    const float alpha = sinf(omega) / (2.0f * Q);
+    const float a0 = 1.0f + alpha;
+
+    ret.cutoff_freq = center_freq_hz;
+    ret.sample_freq = sample_freq_hz;
+    ret.b0 = (1.0f + alpha * sq(A)) / a0;
+    ret.b1 = -2.0f * cosf(omega) / a0;
+    ret.b2 = (1.0f - alpha * sq(A)) / a0;
+    ret.a1 = ret.b1;
+    ret.a2 = (1.0f - alpha) / a0;
+}
+
+template class NotchFilter<float>;
+template class NotchFilter<Vector3f>;
+
+////////////////////////////////////////////////////////////////////////////////////////////
+// NotchFilterParams
+////////////////////////////////////////////////////////////////////////////////////////////
+
+const AP_Param::GroupInfo NotchFilterParams::var_info[] = {
+    // @Param: ENABLE
+    // @DisplayName: Notch filter enable
+    // @Description: Enable the notch filter
+    // @Values: 0:Disabled,1:Enabled
+    // @User: Advanced
+    AP_GROUPINFO_FLAGS("ENABLE", 1, NotchFilterParams, _enable, 0, AP_PARAM_FLAG_ENABLE),
+
+    // @Param: MODE
+    // @DisplayName: Notch filter mode
+    // @Description: With Fixed the notch stays at FREQ. With Throttle it follows the motor noise, moving up from FREQ at the REF throttle with the square root of the throttle
+    // @Values: 0:Fixed,1:Throttle
+    // @User: Advanced
+    AP_GROUPINFO("MODE", 2, NotchFilterParams, _mode, MODE_FIXED),
+
+    // @Param: FREQ
+    // @DisplayName: Notch filter centre frequency
+    // @Description: Centre frequency of the notch on the fundamental. In Throttle mode this is the frequency at the REF throttle, usually the hover throttle, and the notch never goes below it
+    // @Units: Hz
+    // @Range: 10 400
+    // @User: Advanced
+    AP_GROUPINFO("FREQ", 3, NotchFilterParams, _center_freq_hz, 80),
+
+    // @Param: BW
+    // @DisplayName: Notch filter bandwidth
+    // @Description: Bandwidth of the notch on the fundamental. Each harmonic notch is as wide, relative to its frequency
+    // @Units: Hz
+    // @Range: 5 200
+    // @User: Advanced
+    AP_GROUPINFO("BW", 4, NotchFilterParams, _bandwidth_hz, 40),
+
+    // @Param: ATT
+    // @DisplayName: Notch filter attenuation
+    // @Description: Attenuation at the centre of each notch
+    // @Units: dB
+    // @Range: 5 50
+    // @User: Advanced
+    AP_GROUPINFO("ATT", 5, NotchFilterParams, _attenuation_dB, 40),
+
+    // @Param: HMNCS
+    // @DisplayName: Notch filter harmonics
+    // @Description: Bitmask of the harmonics to notch. The fundamental is the first
+    // @Bitmask: 0:Fundamental,1:Second harmonic,2:Third harmonic
+    // @User: Advanced
+    AP_GROUPINFO("HMNCS", 6, NotchFilterParams, _harmonics, 1),
+
+    // @Param: REF
+    // @DisplayName: Notch filter reference throttle
+    // @Description: Throttle, between 0 and 1, at which the motor noise is at FREQ. Only used in Throttle mode
+    // @Range: 0.1 0.9
+    // @User: Advanced
+    AP_GROUPINFO("REF", 7, NotchFilterParams, _reference, 0.35f),
+
+    AP_GROUPEND
+};
+
+NotchFilterParams::NotchFilterParams(void)
+{
+    AP_Param::setup_object_defaults(this, var_info);
+}
+
+float NotchFilterParams::center_freq_hz(float throttle) const
+{
+    if (_mode != MODE_THROTTLE || _reference <= 0) {
+        return _center_freq_hz;
+    }
+    // motor noise frequency goes with the rpm, and the thrust with the square of it
+    return _center_freq_hz * MAX(1.0f, safe_sqrt(throttle / _reference));
+}
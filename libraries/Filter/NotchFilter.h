@@ -0,0 +1,90 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <AP_Math/AP_Math.h>
+#include <AP_Param/AP_Param.h>
+#include <inttypes.h>
+
+#include "LowPassFilter2p.h"
+
+/// @file   NotchFilter.h
+/// @brief  A biquad notch (band stop) filter, run by DigitalBiquadFilter,
+///         and the parameters of a harmonic notch that can follow the
+///         motor noise of a multicopter as the throttle changes
+
+template <class T>
+class NotchFilter {
+public:
+    NotchFilter();
+
+    // set the centre frequency, the -3dB bandwidth and the attenuation at the centre
+    void init(float sample_freq_hz, float center_freq_hz, float bandwidth_hz, float attenuation_dB);
+    float get_center_freq(void) const { return _params.cutoff_freq; }
+    T apply(const T &sample);
+    void reset(void);
+
+    /*
+      notch coefficients, with the centre frequency as the cutoff
+      frequency. If the notch doesn't fit below the Nyquist frequency
+      the cutoff is zero, which makes DigitalBiquadFilter pass samples
+      through unchanged
+     */
+    static void compute_params(float sample_freq_hz, float center_freq_hz, float bandwidth_hz,
+                               float attenuation_dB, typename DigitalBiquadFilter<T>::biquad_params &ret);
+
+private:
+    typename DigitalBiquadFilter<T>::biquad_params _params;
+    DigitalBiquadFilter<T> _filter;
+};
+
+typedef NotchFilter<float>    NotchFilterFloat;
+typedef NotchFilter<Vector3f> NotchFilterVector3f;
+
+/*
+  parameters for a notch on a fundamental frequency and a chosen set of
+  its harmonics
+ */
+class NotchFilterParams {
+public:
+    // notches on the fundamental and up to two harmonics
+    static const uint8_t max_harmonics = 3;
+
+    enum Mode {
+        MODE_FIXED    = 0,
+        MODE_THROTTLE = 1,
+    };
+
+    NotchFilterParams(void);
+
+    bool enabled(void) const { return _enable != 0; }
+    float bandwidth_hz(void) const { return _bandwidth_hz; }
+    float attenuation_dB(void) const { return _attenuation_dB; }
+    uint8_t harmonics(void) const { return _harmonics; }
+
+    // fundamental frequency for a throttle between 0 and 1
+    float center_freq_hz(float throttle) const;
+
+    static const struct AP_Param::GroupInfo var_info[];
+
+private:
+    AP_Int8 _enable;
+    AP_Int8 _mode;
+    AP_Float _center_freq_hz;
+    AP_Float _bandwidth_hz;
+    AP_Float _attenuation_dB;
+    AP_Int8 _harmonics;
+    AP_Float _reference;
+};
@@ -0,0 +1,74 @@
+/*
+  filtering the gyros of three IMUs, one FIFO read of state.range_x()
+  samples at a time, with a LowPassFilter2pVector3f per IMU and with
+  the filter bank
+ */
+#include <AP_gbenchmark.h>
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_Math/pseudo_random.h>
+#include <Filter/BiquadFilterBank.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+#define NUM_IMUS 3
+#define MAX_BURST 32
+
+static void make_samples(Vector3f *samples, uint16_t count)
+{
+    PseudoRandom prng(1);
+    for (uint16_t i = 0; i < count; i++) {
+        const float noise = prng.next_float();
+        samples[i] = Vector3f(0.1f + noise, sinf(i * 0.3f), -noise);
+    }
+}
+
+static void BM_LowPassFilter2pVector3f(benchmark::State& state)
+{
+    const uint16_t burst = state.range_x();
+    LowPassFilter2pVector3f filters[NUM_IMUS];
+    Vector3f samples[MAX_BURST];
+    Vector3f filtered;
+
+    for (uint8_t imu = 0; imu < NUM_IMUS; imu++) {
+        filters[imu].set_cutoff_frequency(1000, 20);
+    }
+    make_samples(samples, burst);
+
+    while (state.KeepRunning()) {
+        for (uint8_t imu = 0; imu < NUM_IMUS; imu++) {
+            for (uint16_t i = 0; i < burst; i++) {
+                filtered = filters[imu].apply(samples[i]);
+            }
+            gbenchmark_escape(&filtered);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * NUM_IMUS * burst);
+}
+
+static void BM_BiquadFilterBank(benchmark::State& state)
+{
+    const uint16_t burst = state.range_x();
+    BiquadFilterBank3f<NUM_IMUS> bank;
+    Vector3f samples[MAX_BURST];
+    Vector3f filtered[MAX_BURST];
+
+    for (uint8_t imu = 0; imu < NUM_IMUS; imu++) {
+        bank.set_cutoff_frequency(imu, 1000, 20);
+    }
+    make_samples(samples, burst);
+
+    while (state.KeepRunning()) {
+        for (uint8_t imu = 0; imu < NUM_IMUS; imu++) {
+            bank.apply(imu, samples, filtered, burst);
+            gbenchmark_escape(filtered);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * NUM_IMUS * burst);
+}
+
+/* samples per FIFO read */
+BENCHMARK(BM_LowPassFilter2pVector3f)->Arg(1)->Arg(8)->Arg(32);
+BENCHMARK(BM_BiquadFilterBank)->Arg(1)->Arg(8)->Arg(32);
+
+BENCHMARK_MAIN()
@@ -0,0 +1,103 @@
+/*
+  check the filter bank gives the same output as one
+  LowPassFilter2pVector3f per channel, one sample at a time or in bursts
+ */
+#include <AP_gtest.h>
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_Math/pseudo_random.h>
+#include <Filter/BiquadFilterBank.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+#define NUM_CHANNELS 3
+#define NUM_SAMPLES 2000
+
+static void expect_vector_near(const Vector3f &expected, const Vector3f &v)
+{
+    EXPECT_NEAR(expected.x, v.x, 1.0e-5f * MAX(1.0f, fabsf(expected.x)));
+    EXPECT_NEAR(expected.y, v.y, 1.0e-5f * MAX(1.0f, fabsf(expected.y)));
+    EXPECT_NEAR(expected.z, v.z, 1.0e-5f * MAX(1.0f, fabsf(expected.z)));
+}
+
+TEST(BiquadFilterBankTest, MatchesLowPassFilter2p)
+{
+    const float sample_freq[NUM_CHANNELS] { 1000, 8000, 800 };
+    const float cutoff_freq[NUM_CHANNELS] { 20, 98, 0 };
+    LowPassFilter2pVector3f reference[NUM_CHANNELS];
+    BiquadFilterBank3f<NUM_CHANNELS> bank;
+    BiquadFilterBank3f<NUM_CHANNELS> burst_bank;
+    PseudoRandom prng(1);
+
+    for (uint8_t c = 0; c < NUM_CHANNELS; c++) {
+        reference[c].set_cutoff_frequency(sample_freq[c], cutoff_freq[c]);
+        bank.set_cutoff_frequency(c, sample_freq[c], cutoff_freq[c]);
+        burst_bank.set_cutoff_frequency(c, sample_freq[c], cutoff_freq[c]);
+        EXPECT_FLOAT_EQ(cutoff_freq[c], bank.get_cutoff_freq(c));
+        EXPECT_FLOAT_EQ(sample_freq[c], bank.get_sample_freq(c));
+    }
+
+    for (uint16_t n = 0; n < NUM_SAMPLES; n += 8) {
+        for (uint8_t c = 0; c < NUM_CHANNELS; c++) {
+            // a step, a tone and some noise, like a gyro on a vibrating frame
+            Vector3f samples[8];
+            Vector3f burst_out[8];
+            for (uint8_t i = 0; i < 8; i++) {
+                const float t = (n + i) / sample_freq[c];
+                samples[i] = Vector3f(3.0f + prng.next_float(),
+                                      sinf(2 * M_PI * 150 * t) + prng.next_float(),
+                                      -9.8f + 0.1f * prng.next_float());
+            }
+
+            burst_bank.apply(c, samples, burst_out, 8);
+            for (uint8_t i = 0; i < 8; i++) {
+                const Vector3f expected = reference[c].apply(samples[i]);
+                expect_vector_near(expected, bank.apply(c, samples[i]));
+                expect_vector_near(expected, burst_out[i]);
+            }
+        }
+    }
+}
+
+TEST(BiquadFilterBankTest, ScalarMatchesSIMD)
+{
+    BiquadFilterBankBase::biquad_params params;
+    DigitalBiquadFilter<float>::compute_params(1000, 30, params);
+    float state[8] {};
+    float state_scalar[8] {};
+    Vector3f samples[64];
+    Vector3f out[64];
+    Vector3f out_scalar[64];
+    PseudoRandom prng(2);
+
+    for (uint8_t i = 0; i < 64; i++) {
+        samples[i] = Vector3f(prng.next_float(), prng.next_float(), prng.next_float()) * 10;
+    }
+
+    BiquadFilterBankBase::apply_channel(params, state, samples, out, 64);
+    BiquadFilterBankBase::apply_channel_scalar(params, state_scalar, samples, out_scalar, 64);
+    for (uint8_t i = 0; i < 64; i++) {
+        expect_vector_near(out_scalar[i], out[i]);
+    }
+}
+
+TEST(BiquadFilterBankTest, Reset)
+{
+    BiquadFilterBank3f<2> bank;
+    bank.set_cutoff_frequency(0, 1000, 20);
+    bank.set_cutoff_frequency(1, 1000, 20);
+
+    const Vector3f sample(1, 2, 3);
+    for (uint8_t i = 0; i < 100; i++) {
+        bank.apply(0, sample);
+        bank.apply(1, sample);
+    }
+    bank.reset(0);
+
+    // only the reset channel starts again from zero
+    LowPassFilter2pVector3f reference(1000, 20);
+    expect_vector_near(reference.apply(sample), bank.apply(0, sample));
+    EXPECT_GT(bank.apply(1, sample).x, 0.5f);
+}
+
+AP_GTEST_MAIN()
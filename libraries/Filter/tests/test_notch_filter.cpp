@@ -0,0 +1,83 @@
+/*
+  check the notch filter takes out the centre frequency by the
+  attenuation asked for, leaves frequencies well away from it alone,
+  and runs the same in the filter bank as in NotchFilter
+ */
+#include <AP_gtest.h>
+
+#include <AP_HAL/AP_HAL.h>
+#include <Filter/NotchFilter.h>
+#include <Filter/BiquadFilterBank.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+#define SAMPLE_FREQ 1000.0f
+
+/*
+  amplitude of a sine at freq_hz after the filter has settled, relative
+  to the amplitude going in
+ */
+static float gain(float freq_hz, float center_freq_hz, float bandwidth_hz, float attenuation_dB)
+{
+    NotchFilterFloat filter;
+    filter.init(SAMPLE_FREQ, center_freq_hz, bandwidth_hz, attenuation_dB);
+
+    float peak = 0;
+    for (uint16_t i = 0; i < 4000; i++) {
+        const float out = filter.apply(sinf(2 * M_PI * freq_hz * i / SAMPLE_FREQ));
+        if (i >= 2000) {
+            peak = MAX(peak, fabsf(out));
+        }
+    }
+    return peak;
+}
+
+TEST(NotchFilterTest, Response)
+{
+    // the attenuation asked for at the centre
+    EXPECT_NEAR(0.01f, gain(80, 80, 40, 40), 0.005f);
+    EXPECT_NEAR(0.1f, gain(150, 150, 30, 20), 0.01f);
+
+    // -3dB at the edges of the band
+    EXPECT_NEAR(M_SQRT1_2, gain(100, 80, 40, 40), 0.1f);
+
+    // little change well away from the centre
+    EXPECT_NEAR(1.0f, gain(10, 80, 40, 40), 0.05f);
+    EXPECT_NEAR(1.0f, gain(300, 80, 40, 40), 0.05f);
+}
+
+TEST(NotchFilterTest, PassThrough)
+{
+    NotchFilterFloat filter;
+
+    // not initialised
+    EXPECT_FLOAT_EQ(3.0f, filter.apply(3.0f));
+
+    // a notch above the Nyquist frequency, as a high harmonic might be
+    filter.init(SAMPLE_FREQ, 600, 40, 40);
+    EXPECT_FLOAT_EQ(0.0f, filter.get_center_freq());
+    EXPECT_FLOAT_EQ(3.0f, filter.apply(3.0f));
+}
+
+TEST(NotchFilterTest, FilterBank)
+{
+    NotchFilterVector3f reference;
+    BiquadFilterBank3f<2> bank;
+    BiquadFilterBankBase::biquad_params params;
+
+    reference.init(SAMPLE_FREQ, 120, 50, 30);
+    NotchFilter<float>::compute_params(SAMPLE_FREQ, 120, 50, 30, params);
+    bank.set_params(1, params);
+
+    for (uint16_t i = 0; i < 500; i++) {
+        const float t = i / SAMPLE_FREQ;
+        const Vector3f sample(sinf(2 * M_PI * 120 * t), 0.5f + sinf(2 * M_PI * 30 * t), -1.0f);
+        const Vector3f expected = reference.apply(sample);
+        const Vector3f v = bank.apply(1, sample);
+        EXPECT_NEAR(expected.x, v.x, 1.0e-5f);
+        EXPECT_NEAR(expected.y, v.y, 1.0e-5f);
+        EXPECT_NEAR(expected.z, v.z, 1.0e-5f);
+    }
+}
+
+AP_GTEST_MAIN()
@@ -16,6 +16,7 @@
 #include <AP_Avoidance/AP_Avoidance.h>
 #include <AP_HAL/utility/RingBuffer.h>
 #include <AP_Frsky_Telem/AP_Frsky_Telem.h>
+#include <AP_Scheduler/AP_Scheduler.h>
 
 // check if a message will fit in the payload space available
 #define HAVE_PAYLOAD_SPACE(chan, id) (comm_get_txspace(chan) >= GCS_MAVLINK::packet_overhead_chan(chan)+MAVLINK_MSG_ID_ ## id ## _LEN)
@@ -76,6 +77,8 @@ enum ap_message {
     MSG_MISSION_ITEM_REACHED,
     MSG_POSITION_TARGET_GLOBAL_INT,
     MSG_ADSB_VEHICLE,
+    MSG_SCHED_STATS,
+    MSG_FFT_PEAKS,
     MSG_RETRY_DEFERRED // this must be last
 };
 
@@ -166,6 +169,8 @@ public:
     void send_autopilot_version(uint8_t major_version, uint8_t minor_version, uint8_t patch_version, uint8_t version_type) const;
     void send_local_position(const AP_AHRS &ahrs) const;
     void send_vibration(const AP_InertialSensor &ins) const;
+    void send_scheduler_stats(const AP_Scheduler &scheduler);
+    void send_fft_peaks(const AP_InertialSensor &ins);
     void send_home(const Location &home) const;
     static void send_home_all(const Location &home);
     void send_heartbeat(uint8_t type, uint8_t base_mode, uint32_t custom_mode, uint8_t system_status);
@@ -364,10 +369,37 @@ private:
     // start page of log data
     uint16_t _log_data_page;
 
-    // deferred message handling
-    enum ap_message deferred_messages[MSG_RETRY_DEFERRED];
-    uint8_t next_deferred_message;
-    uint8_t num_deferred_messages;
+    // messages waiting to be sent, one bit per ap_message. They go out
+    // in priority order as the link budget and txspace allow
+    uint64_t pending_messages;
+
+    // token bucket of bytes we may send on the link, refilled at the
+    // configured baud rate. Zero bytes per second means no limit
+    uint32_t link_bytes_per_sec;
+    uint32_t link_budget;
+    uint32_t link_budget_last_ms;
+
+    // link statistics since the last MAVL log message
+    struct link_stats {
+        uint32_t bytes_sent;
+        uint16_t messages_sent;
+        uint16_t budget_waits;
+        uint16_t txspace_waits;
+    } link_stats;
+    uint32_t link_stats_last_ms;
+
+    static const enum ap_message message_send_order[];
+    static uint16_t message_payload_length(enum ap_message id);
+    bool link_budget_limited(void);
+    void refill_link_budget(void);
+    void send_pending_messages(void);
+    void log_link_stats(void);
+
+    // next scheduler task to send statistics for
+    uint8_t next_sched_stats_task;
+
+    // whether the energies of the FFT peaks go next, rather than the frequencies
+    bool fft_send_energy;
 
     // time when we missed sending a parameter for GCS
     static uint32_t reserve_param_space_start_ms;
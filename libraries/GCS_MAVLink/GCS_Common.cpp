@@ -105,7 +105,11 @@ GCS_MAVLINK::setup_uart(const AP_SerialManager& serial_manager, AP_SerialManager
     uart->set_flow_control(old_flow_control);
 
     // now change back to desired baudrate
-    uart->begin(serial_manager.find_baudrate(protocol, instance));
+    const uint32_t baudrate = serial_manager.find_baudrate(protocol, instance);
+    uart->begin(baudrate);
+
+    // 10 bits on the wire for each byte
+    link_bytes_per_sec = baudrate / 10;
 
     // and init the gcs instance
     init(uart, mav_chan);
@@ -188,8 +192,13 @@ GCS_MAVLINK::queued_param_send()
             _queued_parameter_count,
             _queued_parameter_index);
 
-        _queued_parameter = AP_Param::next_scalar(&_queued_parameter_token, &_queued_parameter_type);
         _queued_parameter_index++;
+#if AP_PARAM_INDEX_ENABLED
+        // constant time, and numbered the same as PARAM_REQUEST_READ
+        _queued_parameter = AP_Param::find_by_index(_queued_parameter_index, &_queued_parameter_type, &_queued_parameter_token);
+#else
+        _queued_parameter = AP_Param::next_scalar(&_queued_parameter_token, &_queued_parameter_type);
+#endif
     }
     _queued_parameter_send_time_ms = tnow;
 }
@@ -906,57 +915,294 @@ GCS_MAVLINK::handle_gps_inject(const mavlink_message_t *msg, AP_GPS &gps)
 
 }
 
-// send a message using mavlink, handling message queueing
-void GCS_MAVLINK::send_message(enum ap_message id)
+/*
+  the order pending messages are sent in, most important first. When
+  the link is short of bandwidth it is the messages at the end that wait
+ */
+const enum ap_message GCS_MAVLINK::message_send_order[] = {
+    MSG_HEARTBEAT,
+    MSG_STATUSTEXT,
+    MSG_NEXT_WAYPOINT,
+    MSG_MISSION_ITEM_REACHED,
+    MSG_CURRENT_WAYPOINT,
+    MSG_NEXT_PARAM,
+    MSG_MAG_CAL_REPORT,
+    MSG_MAG_CAL_PROGRESS,
+    MSG_ATTITUDE,
+    MSG_LOCATION,
+    MSG_EXTENDED_STATUS1,
+    MSG_GPS_RAW,
+    MSG_VFR_HUD,
+    MSG_NAV_CONTROLLER_OUTPUT,
+    MSG_POSITION_TARGET_GLOBAL_INT,
+    MSG_EKF_STATUS_REPORT,
+    MSG_ADSB_VEHICLE,
+    MSG_LOCAL_POSITION,
+    MSG_FENCE_STATUS,
+    MSG_LIMITS_STATUS,
+    MSG_BATTERY2,
+    MSG_RADIO_IN,
+    MSG_RADIO_OUT,
+    MSG_SERVO_OUT,
+    MSG_TERRAIN,
+    MSG_CAMERA_FEEDBACK,
+    MSG_MOUNT_STATUS,
+    MSG_GIMBAL_REPORT,
+    MSG_WIND,
+    MSG_RANGEFINDER,
+    MSG_OPTICAL_FLOW,
+    MSG_SYSTEM_TIME,
+    MSG_EXTENDED_STATUS2,
+    MSG_AHRS,
+    MSG_HWSTATUS,
+    MSG_VIBRATION,
+    MSG_RPM,
+    MSG_RAW_IMU1,
+    MSG_RAW_IMU2,
+    MSG_RAW_IMU3,
+    MSG_SIMSTATE,
+    MSG_PID_TUNING,
+    MSG_SCHED_STATS,
+    MSG_FFT_PEAKS,
+};
+
+/*
+  payload bytes a message puts on the link, for the link budget. Where
+  an id sends several MAVLink messages this covers the usual ones
+ */
+uint16_t GCS_MAVLINK::message_payload_length(enum ap_message id)
 {
-    uint8_t i, nextid;
+    switch (id) {
+    case MSG_HEARTBEAT:
+        return MAVLINK_MSG_ID_HEARTBEAT_LEN;
+    case MSG_ATTITUDE:
+        return MAVLINK_MSG_ID_ATTITUDE_LEN;
+    case MSG_LOCATION:
+        return MAVLINK_MSG_ID_GLOBAL_POSITION_INT_LEN;
+    case MSG_EXTENDED_STATUS1:
+        return MAVLINK_MSG_ID_SYS_STATUS_LEN + MAVLINK_MSG_ID_POWER_STATUS_LEN;
+    case MSG_EXTENDED_STATUS2:
+        return MAVLINK_MSG_ID_MEMINFO_LEN;
+    case MSG_NAV_CONTROLLER_OUTPUT:
+        return MAVLINK_MSG_ID_NAV_CONTROLLER_OUTPUT_LEN;
+    case MSG_CURRENT_WAYPOINT:
+        return MAVLINK_MSG_ID_MISSION_CURRENT_LEN;
+    case MSG_VFR_HUD:
+        return MAVLINK_MSG_ID_VFR_HUD_LEN;
+    case MSG_RADIO_OUT:
+        return MAVLINK_MSG_ID_SERVO_OUTPUT_RAW_LEN;
+    case MSG_RADIO_IN:
+        return MAVLINK_MSG_ID_RC_CHANNELS_LEN;
+    case MSG_RAW_IMU1:
+        return MAVLINK_MSG_ID_RAW_IMU_LEN;
+    case MSG_RAW_IMU2:
+        return MAVLINK_MSG_ID_SCALED_PRESSURE_LEN;
+    case MSG_RAW_IMU3:
+        return MAVLINK_MSG_ID_SENSOR_OFFSETS_LEN;
+    case MSG_GPS_RAW:
+        return MAVLINK_MSG_ID_GPS_RAW_INT_LEN;
+    case MSG_SYSTEM_TIME:
+        return MAVLINK_MSG_ID_SYSTEM_TIME_LEN;
+    case MSG_SERVO_OUT:
+        return MAVLINK_MSG_ID_RC_CHANNELS_SCALED_LEN;
+    case MSG_NEXT_WAYPOINT:
+        return MAVLINK_MSG_ID_MISSION_REQUEST_LEN;
+    case MSG_NEXT_PARAM:
+        return MAVLINK_MSG_ID_PARAM_VALUE_LEN;
+    case MSG_STATUSTEXT:
+        return MAVLINK_MSG_ID_STATUSTEXT_LEN;
+    case MSG_LIMITS_STATUS:
+        return MAVLINK_MSG_ID_LIMITS_STATUS_LEN;
+    case MSG_FENCE_STATUS:
+        return MAVLINK_MSG_ID_FENCE_STATUS_LEN;
+    case MSG_AHRS:
+        return MAVLINK_MSG_ID_AHRS_LEN;
+    case MSG_SIMSTATE:
+        return MAVLINK_MSG_ID_SIMSTATE_LEN + MAVLINK_MSG_ID_AHRS2_LEN;
+    case MSG_HWSTATUS:
+        return MAVLINK_MSG_ID_HWSTATUS_LEN;
+    case MSG_WIND:
+        return MAVLINK_MSG_ID_WIND_LEN;
+    case MSG_RANGEFINDER:
+        return MAVLINK_MSG_ID_RANGEFINDER_LEN;
+    case MSG_TERRAIN:
+        return MAVLINK_MSG_ID_TERRAIN_REQUEST_LEN;
+    case MSG_BATTERY2:
+        return MAVLINK_MSG_ID_BATTERY2_LEN;
+    case MSG_CAMERA_FEEDBACK:
+        return MAVLINK_MSG_ID_CAMERA_FEEDBACK_LEN;
+    case MSG_MOUNT_STATUS:
+        return MAVLINK_MSG_ID_MOUNT_STATUS_LEN;
+    case MSG_OPTICAL_FLOW:
+        return MAVLINK_MSG_ID_OPTICAL_FLOW_LEN;
+    case MSG_GIMBAL_REPORT:
+        return MAVLINK_MSG_ID_GIMBAL_REPORT_LEN;
+    case MSG_MAG_CAL_PROGRESS:
+        return MAVLINK_MSG_ID_MAG_CAL_PROGRESS_LEN;
+    case MSG_MAG_CAL_REPORT:
+        return MAVLINK_MSG_ID_MAG_CAL_REPORT_LEN;
+    case MSG_EKF_STATUS_REPORT:
+        return MAVLINK_MSG_ID_EKF_STATUS_REPORT_LEN;
+    case MSG_LOCAL_POSITION:
+        return MAVLINK_MSG_ID_LOCAL_POSITION_NED_LEN;
+    case MSG_PID_TUNING:
+        return MAVLINK_MSG_ID_PID_TUNING_LEN;
+    case MSG_VIBRATION:
+        return MAVLINK_MSG_ID_VIBRATION_LEN;
+    case MSG_RPM:
+        return MAVLINK_MSG_ID_RPM_LEN;
+    case MSG_MISSION_ITEM_REACHED:
+        return MAVLINK_MSG_ID_MISSION_ITEM_REACHED_LEN;
+    case MSG_POSITION_TARGET_GLOBAL_INT:
+        return MAVLINK_MSG_ID_POSITION_TARGET_GLOBAL_INT_LEN;
+    case MSG_ADSB_VEHICLE:
+        return MAVLINK_MSG_ID_ADSB_VEHICLE_LEN;
+    case MSG_SCHED_STATS:
+    case MSG_FFT_PEAKS:
+        return MAVLINK_MSG_ID_DEBUG_VECT_LEN;
+    case MSG_RETRY_DEFERRED:
+        break;
+    }
+    return 0;
+}
 
-    if (id == MSG_HEARTBEAT) {
-        save_signing_timestamp(false);
+/*
+  return true if streamed messages on this channel are limited to the
+  baud rate. USB runs much faster than its nominal baud rate, so is
+  limited only by txspace
+ */
+bool GCS_MAVLINK::link_budget_limited(void)
+{
+    if (link_bytes_per_sec == 0) {
+        return false;
     }
-    
-    // see if we can send the deferred messages, if any
-    while (num_deferred_messages != 0) {
-        if (!try_send_message(deferred_messages[next_deferred_message])) {
-            break;
-        }
-        next_deferred_message++;
-        if (next_deferred_message == MSG_RETRY_DEFERRED) {
-            next_deferred_message = 0;
-        }
-        num_deferred_messages--;
+    if (chan == MAVLINK_COMM_0 && hal.gpio->usb_connected()) {
+        return false;
     }
+    return true;
+}
 
-    if (id == MSG_RETRY_DEFERRED) {
+/*
+  add the bytes the link could have carried since the last refill to
+  the budget. The budget is capped at 100ms of traffic, as a bigger
+  burst would only sit in the radio's buffer
+ */
+void GCS_MAVLINK::refill_link_budget(void)
+{
+    const uint32_t tnow = AP_HAL::millis();
+    uint32_t dt = tnow - link_budget_last_ms;
+    if (dt == 0) {
         return;
     }
+    link_budget_last_ms = tnow;
+    if (dt > 1000) {
+        dt = 1000;
+    }
+    const uint32_t burst = MAX(link_bytes_per_sec / 10, (uint32_t)MAVLINK_MAX_PACKET_LEN);
+    link_budget = MIN(link_budget + link_bytes_per_sec * dt / 1000, burst);
+}
 
-    // this message id might already be deferred
-    for (i=0, nextid = next_deferred_message; i < num_deferred_messages; i++) {
-        if (deferred_messages[nextid] == id) {
-            // it's already deferred, discard
-            return;
+/*
+  send as many pending messages as the link budget and txspace allow,
+  most important first. A message that doesn't fit is skipped so a
+  smaller, less important one can use the space that is left
+ */
+void GCS_MAVLINK::send_pending_messages(void)
+{
+    static_assert(ARRAY_SIZE(message_send_order) == MSG_RETRY_DEFERRED,
+                  "every message needs a place in message_send_order");
+    static_assert(MSG_RETRY_DEFERRED <= 64, "pending_messages holds 64 messages");
+
+    const bool limited = link_budget_limited();
+    if (limited) {
+        refill_link_budget();
+    }
+    for (uint8_t i=0; i<ARRAY_SIZE(message_send_order) && pending_messages != 0; i++) {
+        const enum ap_message id = message_send_order[i];
+        const uint64_t mask = 1ULL << id;
+        if (!(pending_messages & mask)) {
+            continue;
         }
-        nextid++;
-        if (nextid == MSG_RETRY_DEFERRED) {
-            nextid = 0;
+        const uint16_t len = message_payload_length(id) + packet_overhead();
+        if (limited && len > link_budget) {
+            link_stats.budget_waits++;
+            continue;
         }
+        if (!try_send_message(id)) {
+            link_stats.txspace_waits++;
+            continue;
+        }
+        pending_messages &= ~mask;
+        if (limited) {
+            link_budget -= len;
+        }
+        link_stats.bytes_sent += len;
+        link_stats.messages_sent++;
     }
+}
 
-    if (num_deferred_messages != 0 ||
-        !try_send_message(id)) {
-        // can't send it now, so defer it
-        if (num_deferred_messages == MSG_RETRY_DEFERRED) {
-            // the defer buffer is full, discard
-            return;
-        }
-        nextid = next_deferred_message + num_deferred_messages;
-        if (nextid >= MSG_RETRY_DEFERRED) {
-            nextid -= MSG_RETRY_DEFERRED;
+// send a message using mavlink, handling message queueing
+void GCS_MAVLINK::send_message(enum ap_message id)
+{
+    if (id == MSG_HEARTBEAT) {
+        save_signing_timestamp(false);
+    }
+
+    // a message that is already pending is sent once, with the
+    // latest data, when its turn comes
+    if (id != MSG_RETRY_DEFERRED) {
+        pending_messages |= (1ULL << id);
+    }
+
+    send_pending_messages();
+}
+
+/*
+  write the link statistics to the log once a second, along with the
+  traffic on each route learned on this link
+ */
+void GCS_MAVLINK::log_link_stats(void)
+{
+    const uint32_t tnow = AP_HAL::millis();
+    if (tnow - link_stats_last_ms < 1000) {
+        return;
+    }
+    if (dataflash_p != nullptr) {
+        const uint32_t dt = tnow - link_stats_last_ms;
+        struct log_MAVLink_Link pkt = {
+            LOG_PACKET_HEADER_INIT(LOG_MAVLINK_LINK_MSG),
+            time_us       : AP_HAL::micros64(),
+            chan          : (uint8_t)chan,
+            budget_bps    : link_budget_limited() ? link_bytes_per_sec : 0,
+            sent_bps      : (uint32_t)(link_stats.bytes_sent * 1000ULL / dt),
+            messages_sent : link_stats.messages_sent,
+            budget_waits  : link_stats.budget_waits,
+            txspace_waits : link_stats.txspace_waits,
+            pending       : (uint8_t)__builtin_popcountll(pending_messages),
+            slowdown      : stream_slowdown
+        };
+        dataflash_p->WriteBlock(&pkt, sizeof(pkt));
+
+        const MAVLink_routing::route *r;
+        for (uint16_t i=0; (r = routing.get_route(i)) != nullptr; i++) {
+            if (r->channel != chan) {
+                continue;
+            }
+            struct log_MAVLink_Route rpkt = {
+                LOG_PACKET_HEADER_INIT(LOG_MAVLINK_ROUTE_MSG),
+                time_us     : pkt.time_us,
+                chan        : (uint8_t)chan,
+                sysid       : r->sysid,
+                compid      : r->compid,
+                mavtype     : r->mavtype,
+                packets_in  : r->packets_in,
+                packets_out : r->packets_out
+            };
+            dataflash_p->WriteBlock(&rpkt, sizeof(rpkt));
         }
-        deferred_messages[nextid] = id;
-        num_deferred_messages++;
     }
+    memset(&link_stats, 0, sizeof(link_stats));
+    link_stats_last_ms = tnow;
 }
 
 void GCS_MAVLINK::packetReceived(const mavlink_status_t &status,
@@ -1025,6 +1271,8 @@ GCS_MAVLINK::update(run_cli_fn run_cli)
         }
     }
 
+    log_link_stats();
+
     if (!waypoint_receiving) {
         return;
     }
@@ -1342,6 +1590,13 @@ void GCS_MAVLINK::send_statustext_chan(MAV_SEVERITY severity, uint8_t dest_chan,
 */
 void GCS_MAVLINK::send_statustext(MAV_SEVERITY severity, uint8_t dest_bitmask, const char *text)
 {
+    // the log and the queues below may be used from several threads at
+    // once, for example by EKF cores running in parallel
+    static AP_HAL::Semaphore *sem = hal.util->new_semaphore();
+    if (sem != nullptr && !sem->take(HAL_SEMAPHORE_BLOCK_FOREVER)) {
+        return;
+    }
+
     if (dataflash_p != nullptr) {
         dataflash_p->Log_Write_Message(text);
     }
@@ -1356,6 +1611,9 @@ void GCS_MAVLINK::send_statustext(MAV_SEVERITY severity, uint8_t dest_bitmask, c
     statustext.bitmask = (mavlink_active | chan_is_streaming) & dest_bitmask;
     if (!statustext.bitmask) {
         // nowhere to send
+        if (sem != nullptr) {
+            sem->give();
+        }
         return;
     }
 
@@ -1369,6 +1627,10 @@ void GCS_MAVLINK::send_statustext(MAV_SEVERITY severity, uint8_t dest_bitmask, c
 
     // try and send immediately if possible
     service_statustext();
+
+    if (sem != nullptr) {
+        sem->give();
+    }
 }
 /*
     send a statustext message to specific MAVLink connections in a bitmask
@@ -1621,6 +1883,64 @@ void GCS_MAVLINK::send_vibration(const AP_InertialSensor &ins) const
         ins.get_accel_clip_count(2));
 }
 
+/*
+  send the run time statistics of one scheduler task as a DEBUG_VECT,
+  named after the task, with x, y and z the average, 99th percentile
+  and maximum run times in microseconds. Each call sends the next task
+  so the whole table is covered at a fraction of the stream rate. Only
+  sent when scheduler debugging is enabled
+ */
+void GCS_MAVLINK::send_scheduler_stats(const AP_Scheduler &scheduler)
+{
+    if (scheduler.debug() == 0 || scheduler.num_tasks() == 0) {
+        return;
+    }
+    if (next_sched_stats_task >= scheduler.num_tasks()) {
+        next_sched_stats_task = 0;
+    }
+    const uint8_t i = next_sched_stats_task++;
+    const struct AP_Scheduler::task_stats *stats = scheduler.get_task_stats(i);
+    if (stats == nullptr || stats->count == 0) {
+        return;
+    }
+    char name[MAVLINK_MSG_DEBUG_VECT_FIELD_NAME_LEN] {};
+    strncpy(name, scheduler.task_name(i), sizeof(name));
+    mavlink_msg_debug_vect_send(
+        chan,
+        name,
+        AP_HAL::micros64(),
+        stats->total_us / (float)stats->count,
+        scheduler.task_p99_us(i),
+        stats->max_us);
+}
+
+/*
+  send the peaks of the latest window of the IMU spectral analysis as
+  DEBUG_VECTs, alternating between FFT_FREQ with the frequency of the
+  peak on each axis in Hz and FFT_ENRG with its energy. Only sent once
+  the analysis has a window
+ */
+void GCS_MAVLINK::send_fft_peaks(const AP_InertialSensor &ins)
+{
+    const SpectralAnalysis &spectral = ins.get_spectral_analysis();
+    if (!spectral.enabled()) {
+        return;
+    }
+    struct SpectralAnalysis::peaks peaks;
+    if (!spectral.get_peaks(peaks)) {
+        return;
+    }
+    const Vector3f &v = fft_send_energy ? peaks.energy : peaks.freq_hz;
+    mavlink_msg_debug_vect_send(
+        chan,
+        fft_send_energy ? "FFT_ENRG" : "FFT_FREQ",
+        peaks.time_us,
+        v.x,
+        v.y,
+        v.z);
+    fft_send_energy = !fft_send_energy;
+}
+
 void GCS_MAVLINK::send_home(const Location &home) const
 {
     if (HAVE_PAYLOAD_SPACE(chan, HOME_POSITION)) {
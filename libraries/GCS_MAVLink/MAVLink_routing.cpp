@@ -27,7 +27,10 @@ extern const AP_HAL::HAL& hal;
 #define ROUTING_DEBUG 0
 
 // constructor
-MAVLink_routing::MAVLink_routing(void) : num_routes(0) {}
+MAVLink_routing::MAVLink_routing(void) : num_routes(0)
+{
+    memset(route_hash, 0xFF, sizeof(route_hash));
+}
 
 /*
   forward a MAVLink message to the right port. This also
@@ -138,26 +141,18 @@ bool MAVLink_routing::check_and_forward(mavlink_channel_t in_channel, const mavl
     bool forwarded = false;
     bool sent_to_chan[MAVLINK_COMM_NUM_BUFFERS];
     memset(sent_to_chan, 0, sizeof(sent_to_chan));
-    for (uint8_t i=0; i<num_routes; i++) {
-        if (broadcast_system || (target_system == routes[i].sysid &&
-                                 (broadcast_component || 
-                                  target_component == routes[i].compid ||
-                                  !match_system))) {
-            if (in_channel != routes[i].channel && !sent_to_chan[routes[i].channel]) {
-                if (comm_get_txspace(routes[i].channel) >= ((uint16_t)msg->len) +
-                    GCS_MAVLINK::packet_overhead_chan(routes[i].channel)) {
-#if ROUTING_DEBUG
-                    ::printf("fwd msg %u from chan %u on chan %u sysid=%d compid=%d\n",
-                             msg->msgid,
-                             (unsigned)in_channel,
-                             (unsigned)routes[i].channel,
-                             (int)target_system,
-                             (int)target_component);
-#endif
-                    _mavlink_resend_uart(routes[i].channel, msg);
-                }
-                sent_to_chan[routes[i].channel] = true;
-                forwarded = true;
+    if (broadcast_system) {
+        for (uint16_t i=0; i<num_routes; i++) {
+            forwarded |= forward_to_route(i, in_channel, msg, sent_to_chan);
+        }
+    } else {
+        // only routes to the target system can match
+        for (uint16_t i=route_hash[route_bucket(target_system)]; i != MAVLINK_ROUTE_NONE; i=routes[i].hash_next) {
+            if (target_system == routes[i].sysid &&
+                (broadcast_component ||
+                 target_component == routes[i].compid ||
+                 !match_system)) {
+                forwarded |= forward_to_route(i, in_channel, msg, sent_to_chan);
             }
         }
     }
@@ -168,6 +163,36 @@ bool MAVLink_routing::check_and_forward(mavlink_channel_t in_channel, const mavl
     return process_locally;
 }
 
+/*
+  forward a message along a route, unless it came in on the route's
+  channel or has already been sent on it. Returns true if the route
+  counts as having taken the message, even when there was no space to
+  send it
+*/
+bool MAVLink_routing::forward_to_route(uint16_t idx, mavlink_channel_t in_channel,
+                                       const mavlink_message_t* msg, bool sent_to_chan[])
+{
+    struct route &r = routes[idx];
+    if (in_channel == r.channel || sent_to_chan[r.channel]) {
+        return false;
+    }
+    if (comm_get_txspace(r.channel) >= ((uint16_t)msg->len) +
+        GCS_MAVLINK::packet_overhead_chan(r.channel)) {
+#if ROUTING_DEBUG
+        ::printf("fwd msg %u from chan %u on chan %u sysid=%u compid=%u\n",
+                 msg->msgid,
+                 (unsigned)in_channel,
+                 (unsigned)r.channel,
+                 (unsigned)r.sysid,
+                 (unsigned)r.compid);
+#endif
+        _mavlink_resend_uart(r.channel, msg);
+        r.packets_out++;
+    }
+    sent_to_chan[r.channel] = true;
+    return true;
+}
+
 /*
   send a MAVLink message to all components with this vehicle's system id
 
@@ -179,7 +204,7 @@ void MAVLink_routing::send_to_components(const mavlink_message_t* msg)
     memset(sent_to_chan, 0, sizeof(sent_to_chan));
 
     // check learned routes
-    for (uint8_t i=0; i<num_routes; i++) {
+    for (uint16_t i=route_hash[route_bucket(mavlink_system.sysid)]; i != MAVLINK_ROUTE_NONE; i=routes[i].hash_next) {
         if ((routes[i].sysid == mavlink_system.sysid) && !sent_to_chan[routes[i].channel]) {
             if (comm_get_txspace(routes[i].channel) >= ((uint16_t)msg->len) +
                 GCS_MAVLINK::packet_overhead_chan(routes[i].channel)) {
@@ -191,6 +216,7 @@ void MAVLink_routing::send_to_components(const mavlink_message_t* msg)
                          (unsigned)routes[i].compid);
 #endif
                 _mavlink_resend_uart(routes[i].channel, msg);
+                routes[i].packets_out++;
                 sent_to_chan[routes[i].channel] = true;
             }
         }
@@ -204,7 +230,7 @@ void MAVLink_routing::send_to_components(const mavlink_message_t* msg)
 bool MAVLink_routing::find_by_mavtype(uint8_t mavtype, uint8_t &sysid, uint8_t &compid, mavlink_channel_t &channel)
 {
     // check learned routes
-    for (uint8_t i=0; i<num_routes; i++) {
+    for (uint16_t i=0; i<num_routes; i++) {
         if (routes[i].mavtype == mavtype) {
             sysid = routes[i].sysid;
             compid = routes[i].compid;
@@ -217,42 +243,107 @@ bool MAVLink_routing::find_by_mavtype(uint8_t mavtype, uint8_t &sysid, uint8_t &
     return false;
 }
 
+/*
+  find the route to a sysid/compid on a channel, returning
+  MAVLINK_ROUTE_NONE if it hasn't been learned
+*/
+uint16_t MAVLink_routing::find_route(uint8_t sysid, uint8_t compid, mavlink_channel_t channel) const
+{
+    for (uint16_t i=route_hash[route_bucket(sysid)]; i != MAVLINK_ROUTE_NONE; i=routes[i].hash_next) {
+        if (routes[i].sysid == sysid &&
+            routes[i].compid == compid &&
+            routes[i].channel == channel) {
+            return i;
+        }
+    }
+    return MAVLINK_ROUTE_NONE;
+}
+
+/*
+  return the route not heard from for longest, if it has timed out,
+  or MAVLINK_ROUTE_NONE
+*/
+uint16_t MAVLink_routing::expired_route(uint32_t now_ms) const
+{
+    uint16_t oldest = MAVLINK_ROUTE_NONE;
+    uint32_t oldest_age = MAVLINK_ROUTE_TIMEOUT_MS;
+    for (uint16_t i=0; i<num_routes; i++) {
+        const uint32_t age = now_ms - routes[i].last_seen_ms;
+        if (age >= oldest_age) {
+            oldest = i;
+            oldest_age = age;
+        }
+    }
+    return oldest;
+}
+
+/*
+  remove a route from its hash bucket
+*/
+void MAVLink_routing::unlink_route(uint16_t idx)
+{
+    uint16_t *p = &route_hash[route_bucket(routes[idx].sysid)];
+    while (*p != MAVLINK_ROUTE_NONE) {
+        if (*p == idx) {
+            *p = routes[idx].hash_next;
+            return;
+        }
+        p = &routes[*p].hash_next;
+    }
+}
+
 /*
   see if the message is for a new route and learn it
 */
 void MAVLink_routing::learn_route(mavlink_channel_t in_channel, const mavlink_message_t* msg)
 {
-    uint8_t i;
     if (msg->sysid == 0 || 
         (msg->sysid == mavlink_system.sysid && 
          msg->compid == mavlink_system.compid)) {
         return;
     }
-    for (i=0; i<num_routes; i++) {
-        if (routes[i].sysid == msg->sysid && 
-            routes[i].compid == msg->compid &&
-            routes[i].channel == in_channel) {
-            if (routes[i].mavtype == 0 && msg->msgid == MAVLINK_MSG_ID_HEARTBEAT) {
-                routes[i].mavtype = mavlink_msg_heartbeat_get_type(msg);
-            }
-            break;
+    const uint32_t now_ms = AP_HAL::millis();
+    uint16_t i = find_route(msg->sysid, msg->compid, in_channel);
+    if (i != MAVLINK_ROUTE_NONE) {
+        struct route &r = routes[i];
+        if (r.mavtype == 0 && msg->msgid == MAVLINK_MSG_ID_HEARTBEAT) {
+            r.mavtype = mavlink_msg_heartbeat_get_type(msg);
         }
+        r.last_seen_ms = now_ms;
+        r.packets_in++;
+        return;
     }
-    if (i == num_routes && i<MAVLINK_MAX_ROUTES) {
-        routes[i].sysid = msg->sysid;
-        routes[i].compid = msg->compid;
-        routes[i].channel = in_channel;
-        if (msg->msgid == MAVLINK_MSG_ID_HEARTBEAT) {
-            routes[i].mavtype = mavlink_msg_heartbeat_get_type(msg);
+
+    if (num_routes < MAVLINK_MAX_ROUTES) {
+        i = num_routes++;
+    } else {
+        // the table is full, take over a route that has gone quiet
+        i = expired_route(now_ms);
+        if (i == MAVLINK_ROUTE_NONE) {
+            return;
         }
-        num_routes++;
+        unlink_route(i);
+    }
+
+    struct route &r = routes[i];
+    r.sysid = msg->sysid;
+    r.compid = msg->compid;
+    r.channel = in_channel;
+    r.mavtype = 0;
+    if (msg->msgid == MAVLINK_MSG_ID_HEARTBEAT) {
+        r.mavtype = mavlink_msg_heartbeat_get_type(msg);
+    }
+    r.last_seen_ms = now_ms;
+    r.packets_in = 1;
+    r.packets_out = 0;
+    r.hash_next = route_hash[route_bucket(r.sysid)];
+    route_hash[route_bucket(r.sysid)] = i;
 #if ROUTING_DEBUG
-        ::printf("learned route %u %u via %u\n",
-                 (unsigned)msg->sysid, 
-                 (unsigned)msg->compid,
-                 (unsigned)in_channel);
+    ::printf("learned route %u %u via %u\n",
+             (unsigned)msg->sysid, 
+             (unsigned)msg->compid,
+             (unsigned)in_channel);
 #endif
-    }
 }
 
 
@@ -273,7 +364,7 @@ void MAVLink_routing::handle_heartbeat(mavlink_channel_t in_channel, const mavli
     mask &= ~no_route_mask;
     
     // mask out channels that are known sources for this sysid/compid
-    for (uint8_t i=0; i<num_routes; i++) {
+    for (uint16_t i=route_hash[route_bucket(msg->sysid)]; i != MAVLINK_ROUTE_NONE; i=routes[i].hash_next) {
         if (routes[i].sysid == msg->sysid && routes[i].compid == msg->compid) {
             mask &= ~(1U<<((unsigned)(routes[i].channel-MAVLINK_COMM_0)));
         }
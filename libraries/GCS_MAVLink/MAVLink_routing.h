@@ -6,9 +6,29 @@
 #include <AP_Common/AP_Common.h>
 #include "GCS_MAVLink.h"
 
-// 20 routes should be enough for now. This may need to increase as
-// we make more extensive use of MAVLink forwarding
+/*
+  maximum number of routes, each being a sysid/compid pair seen on a
+  channel. A vehicle with a companion computer and a gimbal needs a
+  handful, a gateway with many vehicles on its links needs a lot more
+ */
+#ifndef MAVLINK_MAX_ROUTES
+#if HAL_CPU_CLASS >= HAL_CPU_CLASS_1000
+#define MAVLINK_MAX_ROUTES 256
+#else
 #define MAVLINK_MAX_ROUTES 20
+#endif
+#endif
+
+// number of hash buckets for looking up routes by sysid, a power of 2
+#ifndef MAVLINK_ROUTE_HASH_SIZE
+#define MAVLINK_ROUTE_HASH_SIZE (MAVLINK_MAX_ROUTES > 32 ? 64 : 16)
+#endif
+
+// when the table is full a new route replaces the one not heard from
+// for longest, if that is at least this old
+#define MAVLINK_ROUTE_TIMEOUT_MS 30000
+
+#define MAVLINK_ROUTE_NONE 0xFFFF
 
 /*
   object to handle MAVLink packet routing
@@ -41,16 +61,35 @@ public:
      */
     bool find_by_mavtype(uint8_t mavtype, uint8_t &sysid, uint8_t &compid, mavlink_channel_t &channel);
 
-private:
-    // a simple linear routing table. We don't expect to have a lot of
-    // routes, so a scalable structure isn't worthwhile yet.
-    uint8_t num_routes;
     struct route {
         uint8_t sysid;
         uint8_t compid;
         mavlink_channel_t channel;
         uint8_t mavtype;
-    } routes[MAVLINK_MAX_ROUTES];
+        uint16_t hash_next;         // next route in the same hash bucket
+        uint32_t last_seen_ms;      // last time a packet came from this route
+        uint32_t packets_in;        // packets received from this sysid/compid on the channel
+        uint32_t packets_out;       // packets forwarded along this route
+    };
+
+    /*
+      return a learned route, for logging the traffic counters.
+      Returns nullptr when idx is past the last route
+     */
+    const struct route *get_route(uint16_t idx) const {
+        return idx < num_routes ? &routes[idx] : nullptr;
+    }
+
+private:
+    // the routes are kept in learning order, with a hash table on
+    // sysid for finding the routes to a system
+    uint16_t num_routes;
+    struct route routes[MAVLINK_MAX_ROUTES];
+    uint16_t route_hash[MAVLINK_ROUTE_HASH_SIZE];
+
+    static uint8_t route_bucket(uint8_t sysid) {
+        return sysid & (MAVLINK_ROUTE_HASH_SIZE-1);
+    }
     
     // a channel mask to block routing as required
     uint8_t no_route_mask;
@@ -58,6 +97,19 @@ private:
     // learn new routes
     void learn_route(mavlink_channel_t in_channel, const mavlink_message_t* msg);
 
+    // find the route to a sysid/compid on a channel
+    uint16_t find_route(uint8_t sysid, uint8_t compid, mavlink_channel_t channel) const;
+
+    // pick a route to replace when the table is full
+    uint16_t expired_route(uint32_t now_ms) const;
+
+    // remove a route from its hash bucket
+    void unlink_route(uint16_t idx);
+
+    // forward a message along a route unless already sent on its channel
+    bool forward_to_route(uint16_t idx, mavlink_channel_t in_channel,
+                          const mavlink_message_t* msg, bool sent_to_chan[]);
+
     // extract target sysid and compid from a message
     void get_targets(const mavlink_message_t* msg, int16_t &sysid, int16_t &compid);
 
@@ -0,0 +1,91 @@
+/*
+  routing throughput, in packets per second, for a GCS on channel 0
+  talking to vehicles spread over the other channels, as a gateway
+  for a number of vehicles would see it
+ */
+#include <AP_gbenchmark.h>
+
+#include <AP_HAL/AP_HAL.h>
+#include <GCS_MAVLink/GCS.h>
+#include <GCS_MAVLink/MAVLink_routing.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+#define GCS_SYSID 255
+#define GCS_COMPID 190
+#define FIRST_VEHICLE_SYSID 20
+
+/*
+  a port that takes anything written to it, so the benchmark times the
+  routing and not a driver
+ */
+class NullUART : public AP_HAL::UARTDriver {
+public:
+    void begin(uint32_t baud) override {}
+    void begin(uint32_t baud, uint16_t rxSpace, uint16_t txSpace) override {}
+    void end() override {}
+    void flush() override {}
+    bool is_initialized() override { return true; }
+    void set_blocking_writes(bool blocking) override {}
+    bool tx_pending() override { return false; }
+    uint32_t available() override { return 0; }
+    uint32_t txspace() override { return 4096; }
+    int16_t read() override { return -1; }
+    size_t write(uint8_t c) override { return 1; }
+    size_t write(const uint8_t *buffer, size_t size) override { return size; }
+};
+
+static NullUART null_uart[MAVLINK_COMM_NUM_BUFFERS];
+
+static mavlink_channel_t vehicle_channel(uint16_t v)
+{
+    return (mavlink_channel_t)(MAVLINK_COMM_1 + v % (MAVLINK_COMM_NUM_BUFFERS - 1));
+}
+
+/*
+  PARAM_REQUEST_READ from the GCS to each of state.range_x() vehicles
+  in turn, after the routes to them have been learned
+ */
+static void BM_RouteTargeted(benchmark::State& state)
+{
+    const uint16_t num_vehicles = state.range_x();
+    MAVLink_routing *routing = new MAVLink_routing;
+    mavlink_message_t *msgs = new mavlink_message_t[num_vehicles];
+    mavlink_message_t msg;
+
+    for (uint8_t i = 0; i < MAVLINK_COMM_NUM_BUFFERS; i++) {
+        mavlink_comm_port[i] = &null_uart[i];
+    }
+
+    for (uint16_t v = 0; v < num_vehicles; v++) {
+        const uint8_t sysid = FIRST_VEHICLE_SYSID + v;
+
+        // a packet from the vehicle, addressed to us, to learn its route
+        mavlink_msg_param_request_read_pack(sysid, MAV_COMP_ID_AUTOPILOT1, &msg,
+                                            mavlink_system.sysid, mavlink_system.compid,
+                                            "SYSID_THISMAV", -1);
+        routing->check_and_forward(vehicle_channel(v), &msg);
+
+        mavlink_msg_param_request_read_pack(GCS_SYSID, GCS_COMPID, &msgs[v],
+                                            sysid, MAV_COMP_ID_AUTOPILOT1,
+                                            "SYSID_THISMAV", -1);
+    }
+
+    uint16_t v = 0;
+    while (state.KeepRunning()) {
+        bool local = routing->check_and_forward(MAVLINK_COMM_0, &msgs[v]);
+        gbenchmark_escape(&local);
+        if (++v == num_vehicles) {
+            v = 0;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+
+    delete[] msgs;
+    delete routing;
+}
+
+/* number of vehicles */
+BENCHMARK(BM_RouteTargeted)->Arg(4)->Arg(20)->Arg(64)->Arg(200);
+
+BENCHMARK_MAIN()
@@ -140,7 +140,7 @@ bool StorageAccess::read_block(void *data, uint16_t addr, size_t n) const
             addr -= length;
             continue;
         }
-        uint8_t count = n;
+        uint16_t count = n;
         if (count+addr > length) {
             // the data crosses a boundary between two areas
             count = length - addr;
@@ -180,7 +180,7 @@ bool StorageAccess::write_block(uint16_t addr, const void *data, size_t n) const
             addr -= length;
             continue;
         }
-        uint8_t count = n;
+        uint16_t count = n;
         if (count+addr > length) {
             // the data crosses a boundary between two areas
             count = length - addr;